@@ -1,3 +1,4 @@
+#include "dq_real.h"
 #include "dq.h"
 
 #include <stdio.h>
@@ -9,23 +10,56 @@
 
 #include "dq_vec3.h"
 #include "dq_mat3.h"
+#include "dq_thread.h"
+#include "dq_sincos.h"
+
+
+/*
+ * Double precision dispatches the core operations to the vectorized kernels
+ *  through a table. Single precision and the header-only build (see
+ *  dq_inline.h) call the scalar implementations directly instead, so the
+ *  compiler can inline them.
+ */
+#if !defined(DQ_FLOAT) && !defined(DQ_INLINE)
+#  define DQ_DISPATCH
+#include "dq_simd.h"
+#endif /* !DQ_FLOAT && !DQ_INLINE */
 
 
 #define MIN(a,b)     (((a)<(b))?(a):(b))
 
 
-void dq_cr_rotation( dq_t O, double theta, const double s[3], const double c[3] )
+/*
+ * Scalar implementations of the operations that can be dispatched to the
+ *  vectorized kernels. The table is replaced at load time, see dq_simd_set.
+ *  Single precision only has the scalar implementations.
+ */
+static void dq_conj( dq_t O, const dq_t Q );
+static void dq_mul( dq_t PQ, const dq_t P, const dq_t Q );
+static void dq_f4g( dq_t ABA, const dq_t A, const dq_t B );
+static void dq_extract( dq_real_t R[3][3], dq_real_t d[3], const dq_t Q );
+static void dq_extract4( dq_real_t V[12][4], dq_t *Q );
+#ifdef DQ_DISPATCH
+static dq_kernels_t dq_kernels = { dq_mul, dq_f4g, dq_extract, dq_conj, dq_extract4 };
+static int dq_simd_level = DQ_SIMD_SCALAR; /**< Currently used kernels. */
+#  define DQ_KERNEL(name)   dq_kernels.name
+#else /* DQ_DISPATCH */
+#  define DQ_KERNEL(name)   dq_##name
+#endif /* DQ_DISPATCH */
+
+
+DQ_API void dq_cr_rotation( dq_t O, dq_real_t theta, const dq_real_t s[3], const dq_real_t c[3] )
 {
-   double s0[3];
+   dq_real_t s0[3];
    /* We do cross product with the line point and line vector to get the plucker coordinates. */
    vec3_cross( s0, c, s );
    dq_cr_rotation_plucker( O, theta, s, s0 );
 }
 
 
-void dq_cr_rotation_plucker( dq_t O, double theta, const double s[3], const double s0[3] )
+DQ_API void dq_cr_rotation_plucker( dq_t O, dq_real_t theta, const dq_real_t s[3], const dq_real_t s0[3] )
 {
-   double ss, cs;
+   dq_real_t ss, cs;
 
 #if DQ_CHECK
    assert( fabs(vec3_dot(s,s)-1.) < DQ_PRECISION );
@@ -33,8 +67,8 @@ void dq_cr_rotation_plucker( dq_t O, double theta, const double s[3], const doub
 #endif /* DQ_CHECK */
 
    /* Store sin and cos values to speed up calculations. */
-   ss = sin( theta/2. );
-   cs = cos( theta/2. );
+   ss = (dq_real_t) sin( theta/2. );
+   cs = (dq_real_t) cos( theta/2. );
 
    O[0] = cs;
    O[1] = ss*s[0];
@@ -47,88 +81,229 @@ void dq_cr_rotation_plucker( dq_t O, double theta, const double s[3], const doub
 }
 
 
-void dq_cr_rotation_matrix( dq_t O, double R[3][3] )
+/**
+ * Angles whose sine and cosine dq_cr_rotation_plucker_n computes at once.
+ */
+#define DQ_SINCOS_BLOCK    64
+
+
+DQ_API void dq_cr_rotation_plucker_n( dq_t *O, dq_real_t *theta, dq_real_t s[][3], dq_real_t s0[][3], int n )
 {
-   double Rminus[3][3], Rplus[3][3], Rinv[3][3], B[3][3], eye[3][3];
-   double s[3];
-   double z2, tz, sz, cz;
+   double h[ DQ_SINCOS_BLOCK ], ss[ DQ_SINCOS_BLOCK ], cs[ DQ_SINCOS_BLOCK ];
+   dq_real_t sn;
+   int i, k, m;
 
-#ifdef DQ_CHECK
-   assert( fabs(mat3_det(R) - 1.) < DQ_PRECISION );
+   for (i=0; i<n; i+=DQ_SINCOS_BLOCK) {
+      m = MIN( DQ_SINCOS_BLOCK, n-i );
+      for (k=0; k<m; k++)
+         h[k] = theta[i+k] / 2.;
+      dq_sincos_n( ss, cs, h, m );
+
+      for (k=0; k<m; k++) {
+#if DQ_CHECK
+         assert( fabs(vec3_dot(s[i+k],s[i+k])-1.) < DQ_PRECISION );
+         assert( fabs(vec3_dot(s[i+k],s0[i+k]))   < DQ_PRECISION );
 #endif /* DQ_CHECK */
+         sn = (dq_real_t) ss[k];
+         O[i+k][0] = (dq_real_t) cs[k];
+         O[i+k][1] = sn*s[i+k][0];
+         O[i+k][2] = sn*s[i+k][1];
+         O[i+k][3] = sn*s[i+k][2];
+         O[i+k][4] = sn*s0[i+k][0];
+         O[i+k][5] = sn*s0[i+k][1];
+         O[i+k][6] = sn*s0[i+k][2];
+         O[i+k][7] = 0.;
+      }
+   }
+}
 
-   /* B = (R-I)(R+I)^{-1} */
-   mat3_eye( eye );
-   mat3_sub( Rminus, R, eye );
-   mat3_add( Rplus, R, eye );
-   mat3_inv( Rinv, Rplus );
-   mat3_mul( B, Rminus, Rinv );
+
+/**
+ * @brief Rotation quaternion of a rotation matrix given by its rows.
+ *
+ * Taking the rows lets the same code read 3x3 matrices and the rotation part
+ *  of 3x4 homogeneous matrices. The dual part is not set.
+ */
+static void dq_rotation_rows( dq_t O, const dq_real_t *R[3] )
+{
+   dq_real_t tr, r, f;
 
    /*
-    *      0 -b_z  b_y
-    * B = b_z  0  -b_x
-    *    -b_y b_x   0
+    * Shepperd's method. From the rotation matrix of dq_op_extract:
     *
-    * b = { b_x b_y b_z }
+    *    4 q0^2 = 1 + R00 + R11 + R22     4 q0 q1 = R21 - R12
+    *    4 q1^2 = 1 + R00 - R11 - R22     4 q0 q2 = R02 - R20
+    *    4 q2^2 = 1 - R00 + R11 - R22     4 q0 q3 = R10 - R01
+    *    4 q3^2 = 1 - R00 - R11 + R22     4 q1 q2 = R01 + R10
+    *                                     4 q1 q3 = R02 + R20
+    *                                     4 q2 q3 = R12 + R21
     *
-    * s           = b / ||b||
-    * tan(theta/2) = ||b||
+    * The largest component is taken from the diagonal, it is at least 1/2 so
+    *  the others are obtained dividing by it without loss of precision.
     */
-   s[0] = B[2][1];
-   s[1] = B[0][2];
-   s[2] = B[1][0];
-   tz   = vec3_norm( s );
-   /* Avoid normalizing 0. vectors. */
-   if (tz > 0.) {
-      s[0] /= tz;
-      s[1] /= tz;
-      s[2] /= tz;
+   tr = R[0][0] + R[1][1] + R[2][2];
+   if ((tr >= R[0][0]) && (tr >= R[1][1]) && (tr >= R[2][2])) {
+      r    = (dq_real_t) sqrt( 1. + tr );
+      f    = 1 / (2*r);
+      O[0] = r / 2;
+      O[1] = (R[2][1] - R[1][2]) * f;
+      O[2] = (R[0][2] - R[2][0]) * f;
+      O[3] = (R[1][0] - R[0][1]) * f;
+   }
+   else if ((R[0][0] >= R[1][1]) && (R[0][0] >= R[2][2])) {
+      r    = (dq_real_t) sqrt( 1. + R[0][0] - R[1][1] - R[2][2] );
+      f    = 1 / (2*r);
+      O[0] = (R[2][1] - R[1][2]) * f;
+      O[1] = r / 2;
+      O[2] = (R[0][1] + R[1][0]) * f;
+      O[3] = (R[0][2] + R[2][0]) * f;
+   }
+   else if (R[1][1] >= R[2][2]) {
+      r    = (dq_real_t) sqrt( 1. - R[0][0] + R[1][1] - R[2][2] );
+      f    = 1 / (2*r);
+      O[0] = (R[0][2] - R[2][0]) * f;
+      O[1] = (R[0][1] + R[1][0]) * f;
+      O[2] = r / 2;
+      O[3] = (R[1][2] + R[2][1]) * f;
+   }
+   else {
+      r    = (dq_real_t) sqrt( 1. - R[0][0] - R[1][1] + R[2][2] );
+      f    = 1 / (2*r);
+      O[0] = (R[1][0] - R[0][1]) * f;
+      O[1] = (R[0][2] + R[2][0]) * f;
+      O[2] = (R[1][2] + R[2][1]) * f;
+      O[3] = r / 2;
+   }
+
+   /* Same sign convention as before, positive scalar part. */
+   if (O[0] < 0.) {
+      O[0] = -O[0];
+      O[1] = -O[1];
+      O[2] = -O[2];
+      O[3] = -O[3];
    }
-   z2   = atan(tz);
+}
+
 
-    /*
-     * Build the rotational part.
-     */
-    sz = sin( z2 );
-    cz = cos( z2 );
-    O[0] = cz;
-    O[1] = sz*s[0];
-    O[2] = sz*s[1];
-    O[3] = sz*s[2];
-    O[4] = 0.;
-    O[5] = 0.;
-    O[6] = 0.;
-    O[7] = 0.;
+/**
+ * @brief Dual part of the transformation rotating by O[0..3] then translating by d.
+ *
+ * Expanded form of multiplying the translation by the rotation, most of the
+ *  terms are null.
+ */
+static void dq_homo_dual( dq_t O, const dq_real_t d[3] )
+{
+   dq_real_t t[3];
+   t[0] = d[0] / 2;
+   t[1] = d[1] / 2;
+   t[2] = d[2] / 2;
+   O[4] =   t[0]*O[0] + t[1]*O[3] - t[2]*O[2];
+   O[5] =   t[1]*O[0] + t[2]*O[1] - t[0]*O[3];
+   O[6] =   t[2]*O[0] + t[0]*O[2] - t[1]*O[1];
+   O[7] = -(t[0]*O[1] + t[1]*O[2] + t[2]*O[3]);
 }
 
 
-void dq_cr_translation( dq_t O, double t, const double s[3] )
+DQ_API void dq_cr_rotation_matrix( dq_t O, dq_real_t R[3][3] )
+{
+   const dq_real_t *rows[3];
+
+#ifdef DQ_CHECK
+   assert( fabs(mat3_det(R) - 1.) < DQ_PRECISION );
+#endif /* DQ_CHECK */
+
+   rows[0] = R[0];
+   rows[1] = R[1];
+   rows[2] = R[2];
+   dq_rotation_rows( O, rows );
+   O[4] = 0.;
+   O[5] = 0.;
+   O[6] = 0.;
+   O[7] = 0.;
+}
+
+
+DQ_API void dq_cr_rotation_matrix_n( dq_t *O, dq_real_t R[][3][3], int n )
+{
+   int i;
+   for (i=0; i<n; i++)
+      dq_cr_rotation_matrix( O[i], R[i] );
+}
+
+
+DQ_API void dq_cr_translation( dq_t O, dq_real_t t, const dq_real_t s[3] )
 {
    O[0] = 1.;
    O[1] = 0.;
    O[2] = 0.;
    O[3] = 0.;
-   O[4] = t*s[0] / 2.;
-   O[5] = t*s[1] / 2.;
-   O[6] = t*s[2] / 2.;
+   O[4] = t*s[0] / 2;
+   O[5] = t*s[1] / 2;
+   O[6] = t*s[2] / 2;
    O[7] = 0.;
 }
 
 
-void dq_cr_translation_vector( dq_t O, const double t[3] )
+DQ_API void dq_cr_translation_vector( dq_t O, const dq_real_t t[3] )
 {
    O[0] = 1.;
    O[1] = 0.;
    O[2] = 0.;
    O[3] = 0.;
-   O[4] = t[0] / 2.;
-   O[5] = t[1] / 2.;
-   O[6] = t[2] / 2.;
+   O[4] = t[0] / 2;
+   O[5] = t[1] / 2;
+   O[6] = t[2] / 2;
    O[7] = 0.;
 }
 
 
-void dq_cr_point( dq_t O, const double pos[3] )
+DQ_API void dq_cr_dh( dq_t O, dq_real_t theta, dq_real_t d, dq_real_t a, dq_real_t alpha )
+{
+   dq_real_t ct, st, ca, sa;
+
+   ct = (dq_real_t) cos( theta/2. );
+   st = (dq_real_t) sin( theta/2. );
+   ca = (dq_real_t) cos( alpha/2. );
+   sa = (dq_real_t) sin( alpha/2. );
+   d /= 2;
+   a /= 2;
+
+   /* Rz(theta) Tz(d) is a screw along z and Tx(a) Rx(alpha) one along x. */
+   O[0] =  ct*ca;
+   O[1] =  ct*sa;
+   O[2] =  st*sa;
+   O[3] =  st*ca;
+   O[4] =  a*ct*ca - d*st*sa;
+   O[5] =  d*ct*sa + a*st*ca;
+   O[6] =  d*ct*ca - a*st*sa;
+   O[7] = -d*st*ca - a*ct*sa;
+}
+
+
+DQ_API void dq_cr_mdh( dq_t O, dq_real_t theta, dq_real_t d, dq_real_t a, dq_real_t alpha )
+{
+   dq_real_t ct, st, ca, sa;
+
+   ct = (dq_real_t) cos( theta/2. );
+   st = (dq_real_t) sin( theta/2. );
+   ca = (dq_real_t) cos( alpha/2. );
+   sa = (dq_real_t) sin( alpha/2. );
+   d /= 2;
+   a /= 2;
+
+   /* Same screws as dq_cr_dh multiplied the other way around. */
+   O[0] =  ca*ct;
+   O[1] =  sa*ct;
+   O[2] = -sa*st;
+   O[3] =  ca*st;
+   O[4] =  a*ca*ct - d*sa*st;
+   O[5] = -d*sa*ct - a*ca*st;
+   O[6] =  d*ca*ct - a*sa*st;
+   O[7] = -a*sa*ct - d*ca*st;
+}
+
+
+DQ_API void dq_cr_point( dq_t O, const dq_real_t pos[3] )
 {
    O[0] = 1.;
    O[1] = 0.;
@@ -141,16 +316,16 @@ void dq_cr_point( dq_t O, const double pos[3] )
 }
 
 
-void dq_cr_line( dq_t O, const double s[3], const double c[3] )
+DQ_API void dq_cr_line( dq_t O, const dq_real_t s[3], const dq_real_t c[3] )
 {
-   double s0[3];
+   dq_real_t s0[3];
    /* We do cross product with the line point and line vector to get the plucker coordinates. */
    vec3_cross( s0, c, s );
    dq_cr_line_plucker( O, s, s0 );
 }
 
 
-void dq_cr_line_plucker( dq_t O, const double s[3], const double s0[3] )
+DQ_API void dq_cr_line_plucker( dq_t O, const dq_real_t s[3], const dq_real_t s0[3] )
 {
 #if DQ_CHECK
    assert( fabs(vec3_dot(s,s)-1.) < DQ_PRECISION );
@@ -168,7 +343,7 @@ void dq_cr_line_plucker( dq_t O, const double s[3], const double s0[3] )
 }
 
 
-void dq_cr_plane( dq_t O, const double n[3], const double d )
+DQ_API void dq_cr_plane( dq_t O, const dq_real_t n[3], const dq_real_t d )
 {
 #if DQ_CHECK
    assert( fabs(vec3_dot(n,n)-1.) < DQ_PRECISION );
@@ -185,27 +360,48 @@ void dq_cr_plane( dq_t O, const double n[3], const double d )
 }
 
 
-void dq_cr_homo( dq_t O, double R[3][3], const double d[3] )
+DQ_API void dq_cr_homo( dq_t O, dq_real_t R[3][3], const dq_real_t d[3] )
 {
-   dq_t QR, QT;
+   const dq_real_t *rows[3];
 
 #ifdef DQ_CHECK
    assert( fabs(mat3_det(R) - 1.) < DQ_PRECISION );
 #endif /* DQ_CHECK */
 
-   dq_cr_rotation_matrix( QR, R );
-   dq_cr_translation_vector( QT, d );
-   dq_op_mul( O, QT, QR );
+   rows[0] = R[0];
+   rows[1] = R[1];
+   rows[2] = R[2];
+   dq_rotation_rows( O, rows );
+   dq_homo_dual( O, d );
 }
 
 
-void dq_cr_copy( dq_t O, const dq_t Q )
+DQ_API void dq_cr_homo_n( dq_t *O, dq_real_t H[][3][4], int n )
+{
+   const dq_real_t *rows[3];
+   dq_real_t d[3];
+   int i;
+
+   for (i=0; i<n; i++) {
+      rows[0] = H[i][0];
+      rows[1] = H[i][1];
+      rows[2] = H[i][2];
+      d[0]    = H[i][0][3];
+      d[1]    = H[i][1][3];
+      d[2]    = H[i][2][3];
+      dq_rotation_rows( O[i], rows );
+      dq_homo_dual( O[i], d );
+   }
+}
+
+
+DQ_API void dq_cr_copy( dq_t O, const dq_t Q )
 {
    memcpy( O, Q, sizeof(dq_t) );
 }
 
 
-void dq_cr_conj( dq_t O, const dq_t Q )
+static void dq_conj( dq_t O, const dq_t Q )
 {
    O[0] =  Q[0];
    O[1] = -Q[1];
@@ -218,9 +414,15 @@ void dq_cr_conj( dq_t O, const dq_t Q )
 }
 
 
-void dq_cr_inv( dq_t O, const dq_t Q )
+DQ_API void dq_cr_conj( dq_t O, const dq_t Q )
+{
+   DQ_KERNEL(conj)( O, Q );
+}
+
+
+DQ_API void dq_cr_inv( dq_t O, const dq_t Q )
 {
-   double real, dual;
+   dq_real_t real, dual;
    /* Get the dual number of t he norm. */
    dq_op_norm2( &real, &dual, Q );
    /* we suppose that Q is a rotation so real = 1 */
@@ -240,14 +442,14 @@ void dq_cr_inv( dq_t O, const dq_t Q )
 
 
 
-void dq_op_norm2( double *real, double *dual, const dq_t Q )
+DQ_API void dq_op_norm2( dq_real_t *real, dq_real_t *dual, const dq_t Q )
 {
    *real =     Q[0]*Q[0] + Q[1]*Q[1] + Q[2]*Q[2] + Q[3]*Q[3];
-   *dual = 2.*(Q[0]*Q[7] + Q[1]*Q[4] + Q[2]*Q[5] + Q[3]*Q[6]);
+   *dual = 2*(Q[0]*Q[7] + Q[1]*Q[4] + Q[2]*Q[5] + Q[3]*Q[6]);
 }
 
 
-void dq_op_add( dq_t O, const dq_t P, const dq_t Q )
+DQ_API void dq_op_add( dq_t O, const dq_t P, const dq_t Q )
 {
    int i;
    for (i=0; i<8; i++)
@@ -255,7 +457,7 @@ void dq_op_add( dq_t O, const dq_t P, const dq_t Q )
 }
 
 
-void dq_op_sub( dq_t O, const dq_t P, const dq_t Q )
+DQ_API void dq_op_sub( dq_t O, const dq_t P, const dq_t Q )
 {
    int i;
    for (i=0; i<8; i++)
@@ -263,9 +465,12 @@ void dq_op_sub( dq_t O, const dq_t P, const dq_t Q )
 }
 
 
-void dq_op_mul( dq_t PQ, const dq_t P, const dq_t Q )
+/**
+ * @brief Multiplies two dual quaternions writing directly to the result.
+ */
+static void dq_mul_direct( dq_real_t * DQ_RESTRICT PQ,
+      const dq_real_t * DQ_RESTRICT P, const dq_real_t * DQ_RESTRICT Q )
 {
-   dq_t T;
    /* Multiplication table:
     *
     *  Q1*Q2 | Q2.1  Q2.i  Q2.j  Q2.k  Q2.ei  Q2.ej  Q2.ek  Q2.e
@@ -292,27 +497,317 @@ void dq_op_mul( dq_t PQ, const dq_t P, const dq_t Q )
     *  q1*q2 = (r1*r2-v1.v2, r1*v2 + r2*v1 + v1 x v2)
     */
    /* Real quaternion. */
-   T[0] = P[0]*Q[0] - P[1]*Q[1] - P[2]*Q[2] - P[3]*Q[3];
-   T[1] = P[0]*Q[1] + P[1]*Q[0] + P[2]*Q[3] - P[3]*Q[2];
-   T[2] = P[0]*Q[2] + P[2]*Q[0] - P[1]*Q[3] + P[3]*Q[1];
-   T[3] = P[0]*Q[3] + P[3]*Q[0] + P[1]*Q[2] - P[2]*Q[1];
+   PQ[0] = P[0]*Q[0] - P[1]*Q[1] - P[2]*Q[2] - P[3]*Q[3];
+   PQ[1] = P[0]*Q[1] + P[1]*Q[0] + P[2]*Q[3] - P[3]*Q[2];
+   PQ[2] = P[0]*Q[2] + P[2]*Q[0] - P[1]*Q[3] + P[3]*Q[1];
+   PQ[3] = P[0]*Q[3] + P[3]*Q[0] + P[1]*Q[2] - P[2]*Q[1];
 
    /* Dual unit Quaternion. */
-   T[4] = P[4]*Q[0] + P[0]*Q[4] + P[7]*Q[1] + P[1]*Q[7] -
-          P[6]*Q[2] + P[2]*Q[6] + P[5]*Q[3] - P[3]*Q[5];
-   T[5] = P[5]*Q[0] + P[0]*Q[5] + P[6]*Q[1] - P[1]*Q[6] +
-          P[7]*Q[2] + P[2]*Q[7] - P[4]*Q[3] + P[3]*Q[4];
-   T[6] = P[6]*Q[0] + P[0]*Q[6] - P[5]*Q[1] + P[1]*Q[5] +
-          P[4]*Q[2] - P[2]*Q[4] + P[7]*Q[3] + P[3]*Q[7];
-   T[7] = P[7]*Q[0] + P[0]*Q[7] - P[1]*Q[4] - P[4]*Q[1] -
-          P[2]*Q[5] - P[5]*Q[2] - P[3]*Q[6] - P[6]*Q[3];
-
-   /* Copy over results. */
+   PQ[4] = P[4]*Q[0] + P[0]*Q[4] + P[7]*Q[1] + P[1]*Q[7] -
+           P[6]*Q[2] + P[2]*Q[6] + P[5]*Q[3] - P[3]*Q[5];
+   PQ[5] = P[5]*Q[0] + P[0]*Q[5] + P[6]*Q[1] - P[1]*Q[6] +
+           P[7]*Q[2] + P[2]*Q[7] - P[4]*Q[3] + P[3]*Q[4];
+   PQ[6] = P[6]*Q[0] + P[0]*Q[6] - P[5]*Q[1] + P[1]*Q[5] +
+           P[4]*Q[2] - P[2]*Q[4] + P[7]*Q[3] + P[3]*Q[7];
+   PQ[7] = P[7]*Q[0] + P[0]*Q[7] - P[1]*Q[4] - P[4]*Q[1] -
+           P[2]*Q[5] - P[5]*Q[2] - P[3]*Q[6] - P[6]*Q[3];
+}
+
+
+/**
+ * @brief Scalar dual quaternion product.
+ */
+static void dq_mul( dq_t PQ, const dq_t P, const dq_t Q )
+{
+   dq_t T;
+   dq_mul_direct( T, P, Q );
    memcpy( PQ, T, sizeof(dq_t) );
 }
 
 
-void dq_op_sign( dq_t P, const dq_t Q )
+DQ_API void dq_op_mul( dq_t PQ, const dq_t P, const dq_t Q )
+{
+   DQ_KERNEL(mul)( PQ, P, Q );
+}
+
+
+DQ_API void dq_op_mul_nr( dq_real_t * DQ_RESTRICT PQ, const dq_real_t * DQ_RESTRICT P, const dq_real_t * DQ_RESTRICT Q )
+{
+   dq_mul_direct( PQ, P, Q );
+}
+
+
+DQ_API void dq_op_mul_ip( dq_t P, const dq_t Q )
+{
+   dq_t T;
+   /* Only the left operand needs to be saved as Q is not overwritten. */
+   memcpy( T, P, sizeof(dq_t) );
+   dq_mul_direct( P, T, Q );
+}
+
+
+DQ_API void dq_op_mul_n( dq_t *PQ, const dq_t *P, const dq_t *Q, int n )
+{
+   int i;
+   for (i=0; i<n; i++)
+      DQ_KERNEL(mul)( PQ[i], P[i], Q[i] );
+}
+
+
+/**
+ * Maximum number of links multiplied as a leaf of the reduction tree of
+ *  dq_op_mul_chain. The products of each level of a leaf are independent so
+ *  they can be in flight at the same time.
+ */
+#define DQ_CHAIN_LEAF      8
+/**
+ * Minimum number of links per thread for dq_op_mul_chain to use threads.
+ */
+#define DQ_CHAIN_THREADED  4096
+
+
+/**
+ * @brief Multiplies up to DQ_CHAIN_LEAF links with a balanced tree.
+ */
+static void dq_chain_leaf( dq_t out, dq_t *L, int n )
+{
+   dq_t T[ DQ_CHAIN_LEAF/2 ];
+   int i, m;
+
+   if (n == 1) {
+      memcpy( out, L[0], sizeof(dq_t) );
+      return;
+   }
+
+   /* First level reads the links, the rest work in place. */
+   for (i=0; i<n/2; i++)
+      DQ_KERNEL(mul)( T[i], L[2*i], L[2*i+1] );
+   if (n % 2)
+      memcpy( T[n/2], L[n-1], sizeof(dq_t) );
+   m = (n+1) / 2;
+   while (m > 1) {
+      for (i=0; i<m/2; i++)
+         DQ_KERNEL(mul)( T[i], T[2*i], T[2*i+1] );
+      if (m % 2)
+         memcpy( T[m/2], T[m-1], sizeof(dq_t) );
+      m = (m+1) / 2;
+   }
+   memcpy( out, T[0], sizeof(dq_t) );
+}
+
+
+/**
+ * @brief Number of links in the left half when splitting n links, a multiple of the leaf size.
+ */
+static int dq_chain_split( int n )
+{
+   return ((n/2 + DQ_CHAIN_LEAF-1) / DQ_CHAIN_LEAF) * DQ_CHAIN_LEAF;
+}
+
+
+/**
+ * @brief Multiplies n > 0 links with a balanced tree.
+ */
+static void dq_chain_tree( dq_t out, dq_t *L, int n )
+{
+   dq_t A, B;
+   int h;
+
+   if (n <= DQ_CHAIN_LEAF) {
+      dq_chain_leaf( out, L, n );
+      return;
+   }
+   h = dq_chain_split( n );
+   dq_chain_tree( A, L, h );
+   dq_chain_tree( B, &L[h], n-h );
+   DQ_KERNEL(mul)( out, A, B );
+}
+
+
+/**
+ * @brief Subtrees of the reduction tree computed by each thread.
+ */
+typedef struct dq_chain_task_s {
+   dq_t *L[ DQ_THREADS_MAX ]; /**< First link of each subtree. */
+   int n[ DQ_THREADS_MAX ];   /**< Number of links of each subtree. */
+   dq_t P[ DQ_THREADS_MAX ];  /**< Product of each subtree. */
+   int count;                 /**< Number of subtrees. */
+} dq_chain_task_t;
+
+
+static void dq_chain_thread( void *data, int i )
+{
+   dq_chain_task_t *task = data;
+   dq_chain_tree( task->P[i], task->L[i], task->n[i] );
+}
+
+
+/**
+ * @brief Collects the subtrees at the given depth of the reduction tree.
+ */
+static void dq_chain_subtrees( dq_chain_task_t *task, dq_t *L, int n, int depth )
+{
+   int h;
+
+   if ((depth == 0) || (n <= DQ_CHAIN_LEAF)) {
+      task->L[ task->count ] = L;
+      task->n[ task->count ] = n;
+      task->count++;
+      return;
+   }
+   h = dq_chain_split( n );
+   dq_chain_subtrees( task, L, h, depth-1 );
+   dq_chain_subtrees( task, &L[h], n-h, depth-1 );
+}
+
+
+/**
+ * @brief Combines the products of the subtrees in the same order as dq_chain_tree.
+ */
+static void dq_chain_combine( dq_t out, dq_chain_task_t *task, int *k, int n, int depth )
+{
+   dq_t A, B;
+   int h;
+
+   if ((depth == 0) || (n <= DQ_CHAIN_LEAF)) {
+      memcpy( out, task->P[ (*k)++ ], sizeof(dq_t) );
+      return;
+   }
+   h = dq_chain_split( n );
+   dq_chain_combine( A, task, k, h, depth-1 );
+   dq_chain_combine( B, task, k, n-h, depth-1 );
+   DQ_KERNEL(mul)( out, A, B );
+}
+
+
+DQ_API void dq_op_mul_chain( dq_t out, dq_t *links, int n )
+{
+   dq_chain_task_t task;
+   int depth, k;
+
+#ifdef DQ_CHECK
+   assert( n >= 0 );
+#endif /* DQ_CHECK */
+
+   if (n == 0) {
+      memset( out, 0, sizeof(dq_t) );
+      out[0] = 1.;
+      return;
+   }
+
+   /* Use 2^depth threads, each computing a subtree of the same tree. */
+   depth = 0;
+   while (((2 << depth) <= dq_threads_get()) &&
+         ((2 << depth) * DQ_CHAIN_THREADED <= n))
+      depth++;
+   if (depth == 0) {
+      dq_chain_tree( out, links, n );
+      return;
+   }
+
+   task.count = 0;
+   dq_chain_subtrees( &task, links, n, depth );
+   dq_thread_run( dq_chain_thread, &task, task.count );
+   k = 0;
+   dq_chain_combine( out, &task, &k, n, depth );
+}
+
+
+/**
+ * Minimum number of links per thread for dq_op_scan to use threads.
+ */
+#define DQ_SCAN_THREADED   4096
+
+
+/**
+ * @brief Blocks of the chain scanned by each thread.
+ */
+typedef struct dq_scan_task_s {
+   dq_t *out;                 /**< Partial products. */
+   dq_t *L;                   /**< Links. */
+   int n;                     /**< Number of links. */
+   int count;                 /**< Number of blocks. */
+   dq_t C[ DQ_THREADS_MAX ];  /**< Product of all the links up to the end of each block. */
+} dq_scan_task_t;
+
+
+/**
+ * @brief Gets the links [start,end) of a block, the first n%count blocks get one more.
+ */
+static void dq_scan_block( const dq_scan_task_t *task, int i, int *start, int *end )
+{
+   int m = task->n / task->count;
+   int r = task->n % task->count;
+   *start = i*m + MIN( i, r );
+   *end   = *start + m + ((i < r) ? 1 : 0);
+}
+
+
+/**
+ * @brief Scans the links of a block on their own.
+ */
+static void dq_scan_local( void *data, int i )
+{
+   dq_scan_task_t *task = data;
+   int j, start, end;
+
+   dq_scan_block( task, i, &start, &end );
+   memcpy( task->out[start], task->L[start], sizeof(dq_t) );
+   for (j=start+1; j<end; j++)
+      DQ_KERNEL(mul)( task->out[j], task->out[j-1], task->L[j] );
+}
+
+
+/**
+ * @brief Prepends the product of all the previous blocks to a block.
+ */
+static void dq_scan_fixup( void *data, int i )
+{
+   dq_scan_task_t *task = data;
+   int j, start, end;
+
+   /* The first block is already final. */
+   dq_scan_block( task, i+1, &start, &end );
+   for (j=start; j<end; j++)
+      DQ_KERNEL(mul)( task->out[j], task->C[i], task->out[j] );
+}
+
+
+DQ_API void dq_op_scan( dq_t *out, dq_t *links, int n )
+{
+   dq_scan_task_t task;
+   int i, start, end;
+
+#ifdef DQ_CHECK
+   assert( n >= 0 );
+#endif /* DQ_CHECK */
+
+   if (n == 0)
+      return;
+
+   task.out   = out;
+   task.L     = links;
+   task.n     = n;
+   task.count = MIN( dq_threads_get(), n / DQ_SCAN_THREADED );
+   if (task.count <= 1) {
+      task.count = 1;
+      dq_scan_local( &task, 0 );
+      return;
+   }
+
+   /* Scan the blocks independently, then chain their totals. */
+   dq_thread_run( dq_scan_local, &task, task.count );
+   dq_scan_block( &task, 0, &start, &end );
+   memcpy( task.C[0], out[end-1], sizeof(dq_t) );
+   for (i=1; i<task.count-1; i++) {
+      dq_scan_block( &task, i, &start, &end );
+      DQ_KERNEL(mul)( task.C[i], task.C[i-1], out[end-1] );
+   }
+   dq_thread_run( dq_scan_fixup, &task, task.count-1 );
+}
+
+
+DQ_API void dq_op_sign( dq_t P, const dq_t Q )
 {
    int i;
    for (i=0; i<8; i++)
@@ -320,72 +815,338 @@ void dq_op_sign( dq_t P, const dq_t Q )
 }
 
 
-void dq_op_f1g( dq_t ABA, const dq_t A, const dq_t B )
+/**
+ * @brief Linear map B -> ABC where C is one of the conjugates of A.
+ *
+ * Splitting B into its real part b = (B[0],B[1],B[2],B[3]) and its dual part
+ *  taken as e = (B[7],B[4],B[5],B[6]), all four transformations have the form
+ *
+ *    real = S b
+ *    dual = S e + C b
+ *
+ * where S and C are 4x4 matrices quadratic in A. f1g and f3g share S, the
+ *  quaternion product aba. f2g and f4g share S, the norm of a followed by the
+ *  rotation matrix of dq_op_extract, which is block diagonal. The terms are
+ *  computed once so each transformation only costs the products with B.
+ */
+typedef struct dq_sandwich_s {
+   dq_real_t S[4][4]; /**< Transformation of the real and of the dual part. */
+   dq_real_t C[4][4]; /**< Contribution of the real part to the dual part. */
+} dq_sandwich_t;
+
+
+/**
+ * @brief Fills S for f1g and f3g.
+ */
+static void dq_sandwich_S_quat( dq_sandwich_t *W, const dq_t A )
+{
+   dq_real_t a00, v2;
+
+   a00 = A[0]*A[0];
+   v2  = A[1]*A[1] + A[2]*A[2] + A[3]*A[3];
+
+   W->S[0][0] = a00 - v2;
+   W->S[0][1] = -2*A[0]*A[1];
+   W->S[0][2] = -2*A[0]*A[2];
+   W->S[0][3] = -2*A[0]*A[3];
+   W->S[1][0] = -W->S[0][1];
+   W->S[1][1] = a00 + v2 - 2*A[1]*A[1];
+   W->S[1][2] = -2*A[1]*A[2];
+   W->S[1][3] = -2*A[1]*A[3];
+   W->S[2][0] = -W->S[0][2];
+   W->S[2][1] = W->S[1][2];
+   W->S[2][2] = a00 + v2 - 2*A[2]*A[2];
+   W->S[2][3] = -2*A[2]*A[3];
+   W->S[3][0] = -W->S[0][3];
+   W->S[3][1] = W->S[1][3];
+   W->S[3][2] = W->S[2][3];
+   W->S[3][3] = a00 + v2 - 2*A[3]*A[3];
+}
+
+
+/**
+ * @brief Fills S for f2g and f4g, the off diagonal blocks are left unset.
+ */
+static void dq_sandwich_S_conj( dq_sandwich_t *W, const dq_t A )
 {
-   dq_op_mul( ABA, A, B );
-   dq_op_mul( ABA, ABA, A );
+   dq_real_t a00, a11, a22, a33;
+
+   a00 = A[0]*A[0];
+   a11 = A[1]*A[1];
+   a22 = A[2]*A[2];
+   a33 = A[3]*A[3];
+
+   W->S[0][0] = a00 + a11 + a22 + a33;
+   W->S[1][1] = a00 + a11 - a22 - a33;
+   W->S[1][2] = 2*(A[1]*A[2] - A[0]*A[3]);
+   W->S[1][3] = 2*(A[1]*A[3] + A[0]*A[2]);
+   W->S[2][1] = 2*(A[1]*A[2] + A[0]*A[3]);
+   W->S[2][2] = a00 - a11 + a22 - a33;
+   W->S[2][3] = 2*(A[2]*A[3] - A[0]*A[1]);
+   W->S[3][1] = 2*(A[1]*A[3] - A[0]*A[2]);
+   W->S[3][2] = 2*(A[2]*A[3] + A[0]*A[1]);
+   W->S[3][3] = a00 - a11 - a22 + a33;
 }
 
 
-void dq_op_f2g( dq_t ABA, const dq_t A, const dq_t B )
+static void dq_sandwich_f1g( dq_sandwich_t *W, const dq_t A )
 {
-   dq_t Astar;
+   dq_real_t w0, w1, w2, w3;
+
+   dq_sandwich_S_quat( W, A );
+
+   w0 = A[0]*A[7];
+   w1 = A[1]*A[4];
+   w2 = A[2]*A[5];
+   w3 = A[3]*A[6];
+   W->C[0][0] = 2*(w0 - w1 - w2 - w3);
+   W->C[0][1] = -2*(A[0]*A[4] + A[1]*A[7]);
+   W->C[0][2] = -2*(A[0]*A[5] + A[2]*A[7]);
+   W->C[0][3] = -2*(A[0]*A[6] + A[3]*A[7]);
+   W->C[1][0] = -W->C[0][1];
+   W->C[1][1] = 2*(w0 - w1 + w2 + w3);
+   W->C[1][2] = -2*(A[1]*A[5] + A[2]*A[4]);
+   W->C[1][3] = -2*(A[1]*A[6] + A[3]*A[4]);
+   W->C[2][0] = -W->C[0][2];
+   W->C[2][1] = W->C[1][2];
+   W->C[2][2] = 2*(w0 + w1 - w2 + w3);
+   W->C[2][3] = -2*(A[2]*A[6] + A[3]*A[5]);
+   W->C[3][0] = -W->C[0][3];
+   W->C[3][1] = W->C[1][3];
+   W->C[3][2] = W->C[2][3];
+   W->C[3][3] = 2*(w0 + w1 + w2 - w3);
+}
+
+
+static void dq_sandwich_f2g( dq_sandwich_t *W, const dq_t A )
+{
+   dq_real_t w0, w1, w2, w3, p, q, r, s, u, v;
+
+   dq_sandwich_S_conj( W, A );
+
+   w0 = A[0]*A[7];
+   w1 = A[1]*A[4];
+   w2 = A[2]*A[5];
+   w3 = A[3]*A[6];
+   p  = A[1]*A[5] + A[2]*A[4];
+   q  = A[0]*A[6] + A[3]*A[7];
+   r  = A[1]*A[6] + A[3]*A[4];
+   s  = A[0]*A[5] + A[2]*A[7];
+   u  = A[2]*A[6] + A[3]*A[5];
+   v  = A[0]*A[4] + A[1]*A[7];
+   W->C[0][0] = 2*(w0 + w1 + w2 + w3);
+   W->C[0][1] = 0;
+   W->C[0][2] = 0;
+   W->C[0][3] = 0;
+   W->C[1][0] = 0;
+   W->C[1][1] = 2*(w0 + w1 - w2 - w3);
+   W->C[1][2] = 2*(p - q);
+   W->C[1][3] = 2*(r + s);
+   W->C[2][0] = 0;
+   W->C[2][1] = 2*(p + q);
+   W->C[2][2] = 2*(w0 - w1 + w2 - w3);
+   W->C[2][3] = 2*(u - v);
+   W->C[3][0] = 0;
+   W->C[3][1] = 2*(r - s);
+   W->C[3][2] = 2*(u + v);
+   W->C[3][3] = 2*(w0 - w1 - w2 + w3);
+}
+
+
+static void dq_sandwich_f3g( dq_sandwich_t *W, const dq_t A )
+{
+   dq_sandwich_S_quat( W, A );
+
+   W->C[0][0] = 0;
+   W->C[0][1] = 2*(A[3]*A[5] - A[2]*A[6]);
+   W->C[0][2] = 2*(A[1]*A[6] - A[3]*A[4]);
+   W->C[0][3] = 2*(A[2]*A[4] - A[1]*A[5]);
+   W->C[1][0] = W->C[0][1];
+   W->C[1][1] = 0;
+   W->C[1][2] = 2*(A[3]*A[7] - A[0]*A[6]);
+   W->C[1][3] = 2*(A[0]*A[5] - A[2]*A[7]);
+   W->C[2][0] = W->C[0][2];
+   W->C[2][1] = -W->C[1][2];
+   W->C[2][2] = 0;
+   W->C[2][3] = 2*(A[1]*A[7] - A[0]*A[4]);
+   W->C[3][0] = W->C[0][3];
+   W->C[3][1] = -W->C[1][3];
+   W->C[3][2] = -W->C[2][3];
+   W->C[3][3] = 0;
+}
+
+
+static void dq_sandwich_f4g( dq_sandwich_t *W, const dq_t A )
+{
+   dq_real_t x[3], y[3];
+
+   dq_sandwich_S_conj( W, A );
+
+   /* The translation and its counterpart share all the products. */
+   x[0] = A[0]*A[4] - A[1]*A[7];
+   y[0] = A[2]*A[6] - A[3]*A[5];
+   x[1] = A[0]*A[5] - A[2]*A[7];
+   y[1] = A[3]*A[4] - A[1]*A[6];
+   x[2] = A[0]*A[6] - A[3]*A[7];
+   y[2] = A[1]*A[5] - A[2]*A[4];
+   W->C[0][0] = 0;
+   W->C[0][1] = 2*(y[0] - x[0]);
+   W->C[0][2] = 2*(y[1] - x[1]);
+   W->C[0][3] = 2*(y[2] - x[2]);
+   W->C[1][0] = 2*(x[0] + y[0]);
+   W->C[1][1] = 0;
+   W->C[1][2] = 0;
+   W->C[1][3] = 0;
+   W->C[2][0] = 2*(x[1] + y[1]);
+   W->C[2][1] = 0;
+   W->C[2][2] = 0;
+   W->C[2][3] = 0;
+   W->C[3][0] = 2*(x[2] + y[2]);
+   W->C[3][1] = 0;
+   W->C[3][2] = 0;
+   W->C[3][3] = 0;
+}
+
+
+/**
+ * @brief Applies the map of f1g or f3g, O may be the same as B.
+ */
+static void dq_sandwich_apply_quat( dq_t O, const dq_sandwich_t *W, const dq_t B )
+{
+   dq_real_t b[4], e[4], r[4], d[4];
+   int i;
+
+   b[0] = B[0]; b[1] = B[1]; b[2] = B[2]; b[3] = B[3];
+   e[0] = B[7]; e[1] = B[4]; e[2] = B[5]; e[3] = B[6];
+   for (i=0; i<4; i++) {
+      r[i] = W->S[i][0]*b[0] + W->S[i][1]*b[1] + W->S[i][2]*b[2] + W->S[i][3]*b[3];
+      d[i] = W->S[i][0]*e[0] + W->S[i][1]*e[1] + W->S[i][2]*e[2] + W->S[i][3]*e[3] +
+             W->C[i][0]*b[0] + W->C[i][1]*b[1] + W->C[i][2]*b[2] + W->C[i][3]*b[3];
+   }
+   O[0] = r[0]; O[1] = r[1]; O[2] = r[2]; O[3] = r[3];
+   O[4] = d[1]; O[5] = d[2]; O[6] = d[3]; O[7] = d[0];
+}
+
+
+/**
+ * @brief Applies the map of f2g or f4g, O may be the same as B.
+ */
+static void dq_sandwich_apply_conj( dq_t O, const dq_sandwich_t *W, const dq_t B )
+{
+   dq_real_t b[4], e[4], r[4], d[4];
+   int i;
+
+   b[0] = B[0]; b[1] = B[1]; b[2] = B[2]; b[3] = B[3];
+   e[0] = B[7]; e[1] = B[4]; e[2] = B[5]; e[3] = B[6];
+   r[0] = W->S[0][0]*b[0];
+   d[0] = W->S[0][0]*e[0];
+   for (i=1; i<4; i++) {
+      r[i] = W->S[i][1]*b[1] + W->S[i][2]*b[2] + W->S[i][3]*b[3];
+      d[i] = W->S[i][1]*e[1] + W->S[i][2]*e[2] + W->S[i][3]*e[3];
+   }
+   for (i=0; i<4; i++)
+      d[i] += W->C[i][0]*b[0] + W->C[i][1]*b[1] + W->C[i][2]*b[2] + W->C[i][3]*b[3];
+   O[0] = r[0]; O[1] = r[1]; O[2] = r[2]; O[3] = r[3];
+   O[4] = d[1]; O[5] = d[2]; O[6] = d[3]; O[7] = d[0];
+}
+
+
+DQ_API void dq_op_f1g( dq_t ABA, const dq_t A, const dq_t B )
+{
+   dq_sandwich_t W;
+   dq_sandwich_f1g( &W, A );
+   dq_sandwich_apply_quat( ABA, &W, B );
+}
+
+
+DQ_API void dq_op_f1g_n( dq_t *ABA, const dq_t A, dq_t *B, int n )
+{
+   dq_sandwich_t W;
+   int i;
+   dq_sandwich_f1g( &W, A );
+   for (i=0; i<n; i++)
+      dq_sandwich_apply_quat( ABA[i], &W, B[i] );
+}
+
+
+DQ_API void dq_op_f2g( dq_t ABA, const dq_t A, const dq_t B )
+{
+   dq_sandwich_t W;
+   dq_sandwich_f2g( &W, A );
+   dq_sandwich_apply_conj( ABA, &W, B );
+}
+
 
-   dq_op_mul( ABA, A, B );
-   dq_cr_conj( Astar, A );
-   dq_op_mul( ABA, ABA, Astar );
+DQ_API void dq_op_f2g_n( dq_t *ABA, const dq_t A, dq_t *B, int n )
+{
+   dq_sandwich_t W;
+   int i;
+   dq_sandwich_f2g( &W, A );
+   for (i=0; i<n; i++)
+      dq_sandwich_apply_conj( ABA[i], &W, B[i] );
 }
 
-void dq_op_f3g( dq_t ABA, const dq_t A, const dq_t B )
+
+DQ_API void dq_op_f3g( dq_t ABA, const dq_t A, const dq_t B )
 {
-   dq_t Astar;
+   dq_sandwich_t W;
+   dq_sandwich_f3g( &W, A );
+   dq_sandwich_apply_quat( ABA, &W, B );
+}
+
 
-   dq_op_mul( ABA, A, B );
-   Astar[0] =  A[0];
-   Astar[1] =  A[1];
-   Astar[2] =  A[2];
-   Astar[3] =  A[3];
-   Astar[4] = -A[4];
-   Astar[5] = -A[5];
-   Astar[6] = -A[6];
-   Astar[7] = -A[7];
-   dq_op_mul( ABA, ABA, Astar );
+DQ_API void dq_op_f3g_n( dq_t *ABA, const dq_t A, dq_t *B, int n )
+{
+   dq_sandwich_t W;
+   int i;
+   dq_sandwich_f3g( &W, A );
+   for (i=0; i<n; i++)
+      dq_sandwich_apply_quat( ABA[i], &W, B[i] );
 }
 
 
-void dq_op_f4g( dq_t ABA, const dq_t A, const dq_t B )
+static void dq_f4g( dq_t ABA, const dq_t A, const dq_t B )
 {
-   dq_t Astar;
+   dq_sandwich_t W;
+   dq_sandwich_f4g( &W, A );
+   dq_sandwich_apply_conj( ABA, &W, B );
+}
+
 
-   dq_op_mul( ABA, A, B );
-   Astar[0] =  A[0];
-   Astar[1] = -A[1];
-   Astar[2] = -A[2];
-   Astar[3] = -A[3];
-   Astar[4] =  A[4];
-   Astar[5] =  A[5];
-   Astar[6] =  A[6];
-   Astar[7] = -A[7];
-   dq_op_mul( ABA, ABA, Astar );
+DQ_API void dq_op_f4g( dq_t ABA, const dq_t A, const dq_t B )
+{
+   /* The vector kernels keep the two products, which beat the fused form
+    * that is the scalar kernel. */
+   DQ_KERNEL(f4g)( ABA, A, B );
 }
 
 
-void dq_op_extract( double R[3][3], double d[3], const dq_t Q )
+DQ_API void dq_op_f4g_n( dq_t *ABA, const dq_t A, dq_t *B, int n )
+{
+   dq_sandwich_t W;
+   int i;
+   dq_sandwich_f4g( &W, A );
+   for (i=0; i<n; i++)
+      dq_sandwich_apply_conj( ABA[i], &W, B[i] );
+}
+
+
+static void dq_extract( dq_real_t R[3][3], dq_real_t d[3], const dq_t Q )
 {
 #if DQ_CHECK
-   double t;
+   dq_real_t t;
 #endif /* DQ_CHECK */
 
    /* Formula for extracting the orthogonal matrix of the rotation. */
    /*C  R */
    R[0][0] = Q[0]*Q[0] + Q[1]*Q[1] - Q[2]*Q[2] - Q[3]*Q[3];
-   R[0][1] = 2.*Q[1]*Q[2] - 2.*Q[0]*Q[3];
-   R[0][2] = 2.*Q[1]*Q[3] + 2.*Q[0]*Q[2];
-   R[1][0] = 2.*Q[1]*Q[2] + 2.*Q[0]*Q[3];
+   R[0][1] = 2*Q[1]*Q[2] - 2*Q[0]*Q[3];
+   R[0][2] = 2*Q[1]*Q[3] + 2*Q[0]*Q[2];
+   R[1][0] = 2*Q[1]*Q[2] + 2*Q[0]*Q[3];
    R[1][1] = Q[0]*Q[0] - Q[1]*Q[1] + Q[2]*Q[2] - Q[3]*Q[3];
-   R[1][2] = 2.*Q[2]*Q[3] - 2.*Q[0]*Q[1];
-   R[2][0] = 2.*Q[1]*Q[3] - 2.*Q[0]*Q[2];
-   R[2][1] = 2.*Q[2]*Q[3] + 2.*Q[0]*Q[1];
+   R[1][2] = 2*Q[2]*Q[3] - 2*Q[0]*Q[1];
+   R[2][0] = 2*Q[1]*Q[3] - 2*Q[0]*Q[2];
+   R[2][1] = 2*Q[2]*Q[3] + 2*Q[0]*Q[1];
    R[2][2] = Q[0]*Q[0] - Q[1]*Q[1] - Q[2]*Q[2] + Q[3]*Q[3];
 
    /* Extraction of displacement.
@@ -396,15 +1157,332 @@ void dq_op_extract( double R[3][3], double d[3], const dq_t Q )
    t =  Q[0]*Q[7] + Q[1]*Q[4] + Q[2]*Q[5] + Q[3]*Q[6];
    assert( fabs( t ) < DQ_PRECISION );
 #endif /* DQ_CHECK */
-   d[0] = 2.*( Q[0]*Q[4] - Q[1]*Q[7] + Q[2]*Q[6] - Q[3]*Q[5] );
-   d[1] = 2.*( Q[0]*Q[5] - Q[2]*Q[7] - Q[1]*Q[6] + Q[3]*Q[4] );
-   d[2] = 2.*( Q[0]*Q[6] - Q[3]*Q[7] + Q[1]*Q[5] - Q[2]*Q[4] );
+   d[0] = 2*( Q[0]*Q[4] - Q[1]*Q[7] + Q[2]*Q[6] - Q[3]*Q[5] );
+   d[1] = 2*( Q[0]*Q[5] - Q[2]*Q[7] - Q[1]*Q[6] + Q[3]*Q[4] );
+   d[2] = 2*( Q[0]*Q[6] - Q[3]*Q[7] + Q[1]*Q[5] - Q[2]*Q[4] );
+}
+
+
+DQ_API void dq_op_extract( dq_real_t R[3][3], dq_real_t d[3], const dq_t Q )
+{
+   DQ_KERNEL(extract)( R, d, Q );
+}
+
+
+DQ_API void dq_op_transform_points( const dq_t Q, const dq_real_t *in, dq_real_t *out, int n )
+{
+   dq_real_t R[3][3], d[3];
+   dq_real_t x, y, z;
+   int i;
+
+   /* Convert once to rotation and translation, then it's just p' = R p + d. */
+   DQ_KERNEL(extract)( R, d, Q );
+   for (i=0; i<n; i++) {
+      x = in[3*i+0];
+      y = in[3*i+1];
+      z = in[3*i+2];
+      out[3*i+0] = R[0][0]*x + R[0][1]*y + R[0][2]*z + d[0];
+      out[3*i+1] = R[1][0]*x + R[1][1]*y + R[1][2]*z + d[1];
+      out[3*i+2] = R[2][0]*x + R[2][1]*y + R[2][2]*z + d[2];
+   }
+}
+
+
+/**
+ * Angle under which the screw functions switch to series, the closed forms
+ *  lose precision to cancellation close to zero.
+ */
+#define DQ_SCREW_SMALL     1e-2
+
+
+/**
+ * @brief Exponential of t times a pure dual quaternion u + e w.
+ *
+ * With p = t |u| and the sine and cosine of p already computed:
+ *
+ *    exp(t (u + e w)) = cos p + sin(p)/p t u
+ *          + e ( -sin(p)/p t^2 u.w + sin(p)/p t w + (cos p - sin(p)/p)/p^2 t^3 (u.w) u )
+ *
+ * Both coefficients are even in p and replaced by their series for small
+ *  angles.
+ */
+static void dq_exp_screw( dq_t O, const dq_real_t u[3], const dq_real_t w[3], double t,
+      double p, double sp, double cp )
+{
+   double sc, e, p2, uw;
+
+   p2 = p*p;
+   if (fabs(p) < DQ_SCREW_SMALL) {
+      sc = 1. - p2/6. + p2*p2/120.;
+      e  = -1./3. + p2/30. - p2*p2/840.;
+   }
+   else {
+      sc = sp / p;
+      e  = (cp - sc) / p2;
+   }
+   uw = (double)u[0]*w[0] + (double)u[1]*w[1] + (double)u[2]*w[2];
+   e  *= t*t*t * uw;
+   uw *= -sc * t*t;
+   sc *= t;
+   O[0] = (dq_real_t) cp;
+   O[1] = (dq_real_t) (sc*u[0]);
+   O[2] = (dq_real_t) (sc*u[1]);
+   O[3] = (dq_real_t) (sc*u[2]);
+   O[4] = (dq_real_t) (sc*w[0] + e*u[0]);
+   O[5] = (dq_real_t) (sc*w[1] + e*u[1]);
+   O[6] = (dq_real_t) (sc*w[2] + e*u[2]);
+   O[7] = (dq_real_t) uw;
+}
+
+
+DQ_API void dq_op_exp( dq_t O, const dq_t X )
+{
+   double p;
+
+   p = sqrt( (double)X[1]*X[1] + (double)X[2]*X[2] + (double)X[3]*X[3] );
+   dq_exp_screw( O, &X[1], &X[4], 1., p, sin(p), cos(p) );
+}
+
+
+DQ_API void dq_op_log( dq_t O, const dq_t Q )
+{
+   double r0, r[3], d[3], d0, v[3], u[3], w[3];
+   double sn, p, k, a, b, uv;
+   int i;
+
+   /* Shortest of the two screws of the displacement, the one of the dual
+    * quaternion with a positive scalar. */
+   k = (Q[0] < 0.) ? -1. : 1.;
+   r0 = k*Q[0];
+   d0 = k*Q[7];
+   for (i=0; i<3; i++) {
+      r[i] = k*Q[1+i];
+      d[i] = k*Q[4+i];
+   }
+
+   /* Half the translation, v = q' q^*. */
+   v[0] = r0*d[0] - d0*r[0] + r[1]*d[2] - r[2]*d[1];
+   v[1] = r0*d[1] - d0*r[1] + r[2]*d[0] - r[0]*d[2];
+   v[2] = r0*d[2] - d0*r[2] + r[0]*d[1] - r[1]*d[0];
+
+   /* Half the angle p around the axis s, u = p s. */
+   sn = sqrt( r[0]*r[0] + r[1]*r[1] + r[2]*r[2] );
+   p  = atan2( sn, r0 );
+   k  = (sn > 0.) ? p / sn : 1.;
+   for (i=0; i<3; i++)
+      u[i] = k*r[i];
+
+   /*
+    * The dual part is p m + d/2 s for the moment m and displacement d of
+    *  the screw. Splitting v along and across the axis:
+    *
+    *    w = p cot(p) v + (1 - p cot(p))/p^2 (u.v) u - u x v
+    */
+   a  = k*r0;
+   if (p < DQ_SCREW_SMALL)
+      b = 1./3. + p*p/45. + 2.*p*p*p*p/945.;
+   else
+      b = (1. - a) / (p*p);
+   uv = b * (u[0]*v[0] + u[1]*v[1] + u[2]*v[2]);
+   w[0] = a*v[0] + uv*u[0] - (u[1]*v[2] - u[2]*v[1]);
+   w[1] = a*v[1] + uv*u[1] - (u[2]*v[0] - u[0]*v[2]);
+   w[2] = a*v[2] + uv*u[2] - (u[0]*v[1] - u[1]*v[0]);
+
+   O[0] = 0.;
+   O[7] = 0.;
+   for (i=0; i<3; i++) {
+      O[1+i] = (dq_real_t) u[i];
+      O[4+i] = (dq_real_t) w[i];
+   }
+}
+
+
+DQ_API void dq_op_pow( dq_t O, const dq_t Q, dq_real_t t )
+{
+   dq_t L;
+   double p;
+
+   dq_op_log( L, Q );
+   p = t * sqrt( (double)L[1]*L[1] + (double)L[2]*L[2] + (double)L[3]*L[3] );
+   dq_exp_screw( O, &L[1], &L[4], t, p, sin(p), cos(p) );
+}
+
+
+DQ_API void dq_op_pow_n( dq_t *O, const dq_t Q, const dq_real_t *t, int n )
+{
+   double h[ DQ_SINCOS_BLOCK ], ss[ DQ_SINCOS_BLOCK ], cs[ DQ_SINCOS_BLOCK ];
+   double p;
+   dq_t L;
+   int i, k, m;
+
+   /* The screw is the same for every t, only its angle and displacement
+    * are scaled. */
+   dq_op_log( L, Q );
+   p = sqrt( (double)L[1]*L[1] + (double)L[2]*L[2] + (double)L[3]*L[3] );
+   for (i=0; i<n; i+=DQ_SINCOS_BLOCK) {
+      m = MIN( DQ_SINCOS_BLOCK, n-i );
+      for (k=0; k<m; k++)
+         h[k] = t[i+k] * p;
+      dq_sincos_n( ss, cs, h, m );
+      for (k=0; k<m; k++)
+         dq_exp_screw( O[i+k], &L[1], &L[4], t[i+k], h[k], ss[k], cs[k] );
+   }
+}
+
+
+DQ_API void dq_op_sclerp( dq_t O, const dq_t P, const dq_t Q, dq_real_t t )
+{
+   dq_t D, E;
+
+   /* P (P^* Q)^t, P^* is the inverse of a unit dual quaternion. */
+   DQ_KERNEL(conj)( E, P );
+   DQ_KERNEL(mul)( D, E, Q );
+   dq_op_pow( E, D, t );
+   DQ_KERNEL(mul)( O, P, E );
+}
+
+
+DQ_API void dq_op_sclerp_n( dq_t *O, const dq_t P, const dq_t Q, const dq_real_t *t, int n )
+{
+   dq_t D, E;
+   int i;
+
+   DQ_KERNEL(conj)( E, P );
+   DQ_KERNEL(mul)( D, E, Q );
+   dq_op_pow_n( O, D, t, n );
+   for (i=0; i<n; i++)
+      DQ_KERNEL(mul)( O[i], P, O[i] );
+}
+
+
+/**
+ * @brief Scalar computation of the row-major 3x4 matrices of four dual quaternions.
+ *
+ * Same formulas as dq_extract, V[4*r+c][k] is entry (r,c) of the k-th matrix.
+ *  Working on four dual quaternions at a time lets the vectorized kernels
+ *  compute one entry of all four matrices per instruction.
+ */
+static void dq_extract4( dq_real_t V[12][4], dq_t *Q )
+{
+   int k;
+   const dq_real_t *q;
+
+   for (k=0; k<4; k++) {
+      q = Q[k];
+      V[0][k]  = q[0]*q[0] + q[1]*q[1] - q[2]*q[2] - q[3]*q[3];
+      V[1][k]  = 2*(q[1]*q[2] - q[0]*q[3]);
+      V[2][k]  = 2*(q[1]*q[3] + q[0]*q[2]);
+      V[3][k]  = 2*(q[0]*q[4] - q[1]*q[7] + q[2]*q[6] - q[3]*q[5]);
+      V[4][k]  = 2*(q[1]*q[2] + q[0]*q[3]);
+      V[5][k]  = q[0]*q[0] - q[1]*q[1] + q[2]*q[2] - q[3]*q[3];
+      V[6][k]  = 2*(q[2]*q[3] - q[0]*q[1]);
+      V[7][k]  = 2*(q[0]*q[5] - q[2]*q[7] - q[1]*q[6] + q[3]*q[4]);
+      V[8][k]  = 2*(q[1]*q[3] - q[0]*q[2]);
+      V[9][k]  = 2*(q[2]*q[3] + q[0]*q[1]);
+      V[10][k] = q[0]*q[0] - q[1]*q[1] - q[2]*q[2] + q[3]*q[3];
+      V[11][k] = 2*(q[0]*q[6] - q[3]*q[7] + q[1]*q[5] - q[2]*q[4]);
+   }
+}
+
+
+/**
+ * @brief Computes the matrices of the m <= 4 dual quaternions starting at Q.
+ */
+static void dq_extract_quad( dq_real_t V[12][4], dq_t *Q, int m )
+{
+   dq_t T[4];
+
+   if (m == 4) {
+      DQ_KERNEL(extract4)( V, Q );
+      return;
+   }
+   /* Pad the last block. */
+   memset( T, 0, sizeof(T) );
+   memcpy( T, Q, sizeof(dq_t) * (size_t)m );
+   DQ_KERNEL(extract4)( V, T );
 }
 
 
-int dq_ch_unit( const dq_t Q )
+/**
+ * @brief Computes where each entry of a matrix goes for the DQ_MATRIX_* flags.
+ *
+ *    @param[out] idx Offset of entry (r,c) is idx[4*r+c], the bottom row is 12-15.
+ *    @param[in] flags DQ_MATRIX_* flags.
+ *    @return Number of entries of each matrix, 12 or 16.
+ */
+static int dq_extract_layout( int idx[16], int flags )
 {
-   double real, dual;
+   int r, c, rows;
+
+   rows = (flags & DQ_MATRIX_3X4) ? 3 : 4;
+   for (r=0; r<4; r++)
+      for (c=0; c<4; c++)
+         idx[4*r+c] = (flags & DQ_MATRIX_COL_MAJOR) ? c*rows + r : 4*r + c;
+   return 4*rows;
+}
+
+
+DQ_API void dq_op_extract_n( double *M, int stride, int flags, dq_t *Q, int n )
+{
+   dq_real_t V[12][4];
+   int idx[16];
+   int b, e, k, m, size;
+   double *O;
+
+   size = dq_extract_layout( idx, flags );
+   if (stride <= 0)
+      stride = size;
+
+   for (b=0; b<n; b+=4) {
+      m = MIN( n-b, 4 );
+      dq_extract_quad( V, &Q[b], m );
+      for (k=0; k<m; k++) {
+         O = &M[ (size_t)(b+k) * (size_t)stride ];
+         for (e=0; e<12; e++)
+            O[ idx[e] ] = V[e][k];
+         if (size == 16) {
+            O[ idx[12] ] = 0.;
+            O[ idx[13] ] = 0.;
+            O[ idx[14] ] = 0.;
+            O[ idx[15] ] = 1.;
+         }
+      }
+   }
+}
+
+
+DQ_API void dq_op_extract_nf( float *M, int stride, int flags, dq_t *Q, int n )
+{
+   dq_real_t V[12][4];
+   int idx[16];
+   int b, e, k, m, size;
+   float *O;
+
+   size = dq_extract_layout( idx, flags );
+   if (stride <= 0)
+      stride = size;
+
+   for (b=0; b<n; b+=4) {
+      m = MIN( n-b, 4 );
+      dq_extract_quad( V, &Q[b], m );
+      for (k=0; k<m; k++) {
+         O = &M[ (size_t)(b+k) * (size_t)stride ];
+         for (e=0; e<12; e++)
+            O[ idx[e] ] = (float) V[e][k];
+         if (size == 16) {
+            O[ idx[12] ] = 0.f;
+            O[ idx[13] ] = 0.f;
+            O[ idx[14] ] = 0.f;
+            O[ idx[15] ] = 1.f;
+         }
+      }
+   }
+}
+
+
+DQ_API int dq_ch_unit( const dq_t Q )
+{
+   dq_real_t real, dual;
    dq_op_norm2( &real, &dual, Q );
    if ((fabs(real-1.) > DQ_PRECISION) || (fabs(dual-0.) > DQ_PRECISION))
       return 0;
@@ -412,19 +1490,19 @@ int dq_ch_unit( const dq_t Q )
 }
 
 
-int dq_ch_point_plane( const dq_t P, const dq_t Q )
+DQ_API int dq_ch_point_plane( const dq_t P, const dq_t Q )
 {
    return (fabs(P[1]*Q[4]+P[2]*Q[5]+P[3]*Q[6]-P[7]) < DQ_PRECISION);
 }
 
 
-int dq_ch_cmp( const dq_t P, const dq_t Q )
+DQ_API int dq_ch_cmp( const dq_t P, const dq_t Q )
 {
    return dq_ch_cmpV( P, Q, DQ_PRECISION );
 }
 
 
-int dq_ch_cmpV( const dq_t P, const dq_t Q, double precision )
+DQ_API int dq_ch_cmpV( const dq_t P, const dq_t Q, dq_real_t precision )
 {
    int i, ret1, ret2;
 
@@ -442,14 +1520,14 @@ int dq_ch_cmpV( const dq_t P, const dq_t Q, double precision )
 }
 
 
-void dq_print( const dq_t Q )
+DQ_API void dq_print( const dq_t Q )
 {
    printf( "%.3f + %.3fi + %.3fj + %.3fk + %.3fie + %.3fje + %.3fke + %.3fe\n",
          Q[0], Q[1], Q[2], Q[3], Q[4], Q[5], Q[6], Q[7] );
 }
 
 
-void dq_print_vert( const dq_t Q )
+DQ_API void dq_print_vert( const dq_t Q )
 {
    printf( "   % 3.3fi   % 3.3fi\n", Q[1], Q[4] );
    printf( "   % 3.3fj   % 3.3fj\n", Q[2], Q[5] );
@@ -457,8 +1535,61 @@ void dq_print_vert( const dq_t Q )
    printf( "   % 3.3f    % 3.3f\n",  Q[0], Q[7] );
 }
 
-void dq_version( int *major, int *minor )
+
+/*
+ * Functions that do not depend on the precision are only built once.
+ */
+#ifndef DQ_FLOAT
+DQ_API void dq_version( int *major, int *minor )
 {
    *major = DQ_VERSION_MAJOR;
    *minor = DQ_VERSION_MINOR;
 }
+
+
+#ifdef DQ_DISPATCH
+DQ_API int dq_simd_set( int level )
+{
+   dq_kernels_t K = { dq_mul, dq_f4g, dq_extract, dq_conj, dq_extract4 };
+
+   level = MIN( level, dq_simd_detect() );
+   if (level < DQ_SIMD_SCALAR)
+      level = DQ_SIMD_SCALAR;
+   dq_simd_kernels( &K, level );
+
+   dq_kernels    = K;
+   dq_simd_level = level;
+   return level;
+}
+
+
+DQ_API int dq_simd_get( void )
+{
+   return dq_simd_level;
+}
+
+
+#ifdef __GNUC__
+/**
+ * @brief Picks the best kernels for the CPU when the library is loaded.
+ */
+static void dq_simd_init( void ) __attribute__((constructor));
+static void dq_simd_init( void )
+{
+   dq_simd_set( DQ_SIMD_AVX512 );
+}
+#endif /* __GNUC__ */
+#else /* DQ_DISPATCH */
+DQ_API int dq_simd_set( int level )
+{
+   (void) level;
+   return DQ_SIMD_SCALAR;
+}
+
+
+DQ_API int dq_simd_get( void )
+{
+   return DQ_SIMD_SCALAR;
+}
+#endif /* DQ_DISPATCH */
+#endif /* DQ_FLOAT */
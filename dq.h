@@ -4,7 +4,7 @@
 /**
  * @mainpage libdq doxygen documentation
  * @author Edgar Simo-Serra <bobbens@gmail.com>
- * @version 2.3
+ * @version 2.4
  * @date October 2021
  *
  * @section License
@@ -81,9 +81,39 @@
  * Auxiliary functions are also provided to help manipulate common data
  * structures when working with dual quaternions.
  *
+ * The library can also be used header-only by including <dq/dq_inline.h>
+ * instead, which lets the compiler inline the functions into the caller.
+ *
  *
  * @section Changelog
  *
+ * - Version 2.4, unreleased
+ *    - Added dq_op_mul_n and the structure-of-arrays dq_soa_t batch API
+ *    - Fixed missing include in homogeneous matrix functions
+ *    - Added dq_op_transform_points
+ *    - Runtime dispatched SSE2, AVX2 and AVX-512 kernels for dq_op_mul, dq_op_f4g, dq_op_extract and dq_cr_conj
+ *    - Added single precision dqf_t API (dqf.h) built from the same sources
+ *    - Fused closed form dq_op_f1g, dq_op_f2g, dq_op_f3g and dq_op_f4g, added batch versions dq_op_f1g_n to dq_op_f4g_n
+ *    - dq_cr_rotation_matrix uses Shepperd's method and works for half turns, added dq_cr_rotation_matrix_n
+ *    - Direct construction in dq_cr_homo, added dq_cr_homo_n
+ *    - Added dq_op_extract_n and dq_op_extract_nf to export strided row or column-major matrices
+ *    - Added dq_op_mul_chain with tree reduction and optional threads, added dq_threads_set
+ *    - Added dq_op_scan to compute the partial products of a chain
+ *    - Added copy-free dq_op_mul_nr, mat3_mul_nr, mat3_mul_vec_nr and homo_op_mul_nr, and in place _ip versions
+ *    - Added opt-in header-only build with static inline functions (dq_inline.h)
+ *    - Added dq_chain_t serial chain forward kinematics (dq_chain.h)
+ *    - Added incremental chain forward kinematics with dq_chain_set_joint and dq_chain_links
+ *    - Added analytic chain Jacobian dq_chain_jacobian
+ *    - Added damped least squares inverse kinematics dq_chain_ik
+ *    - Added dq_chain_fk_batch to compute a chain for many configurations
+ *    - Added dq_tree_t kinematic trees (dq_tree.h)
+ *    - Added dq_cr_rotation_plucker_n with vectorized sine and cosine, and dq_sincos_set
+ *    - Added parallel random restart kinematic synthesis dq_chain_synth
+ *    - Added Monte Carlo workspace sampling into voxel grids dq_chain_workspace
+ *    - Added Denavit-Hartenberg constructors dq_cr_dh and dq_cr_mdh, and dq_chain_create_dh
+ *    - Added dq_codegen tool generating constant-folded forward kinematics and Jacobians of fixed chains
+ *    - Added text chain descriptions dq_chain_load and dq_chain_parse, and joint limits dq_chain_set_limits
+ *    - Added dq_op_exp, dq_op_log, dq_op_pow and screw linear interpolation dq_op_sclerp, with batch versions
  * - Version 2.3, October 2021
  *    - Fixed dq_cr_inv (patch by @thery, thanks!)
  * - Version 2.2, February 2013
@@ -154,6 +184,11 @@
  * @sa operations
  * @sa check
  * @sa misc
+ * @sa soa
+ * @sa dqf
+ * @sa chain
+ * @sa tree
+ * @sa dq_inline.h
  */
 
 
@@ -162,12 +197,67 @@
  * @brief The include for the libdq dual quaternion library.
  */
 #define DQ_VERSION_MAJOR   2 /**< Major version of the libdq library. */
-#define DQ_VERSION_MINOR   3 /**< Minor version of the libdq library. */
+#define DQ_VERSION_MINOR   4 /**< Minor version of the libdq library. */
 
 
 #define DQ_PRECISION    1e-10 /**< Precision to use when comparing doubles. */
 
 
+#define DQ_SIMD_SCALAR  0 /**< Portable C implementation. */
+#define DQ_SIMD_SSE2    1 /**< x86 SSE2 kernels. */
+#define DQ_SIMD_AVX2    2 /**< x86 AVX2 and FMA kernels. */
+#define DQ_SIMD_AVX512  3 /**< x86 AVX-512 kernels. */
+
+
+#define DQ_THREADS_MAX  64 /**< Maximum number of threads used by the parallel functions. */
+
+
+#define DQ_SINCOS_LIBM     0 /**< Sine and cosine from libm, one angle at a time. */
+#define DQ_SINCOS_VECTOR   1 /**< Vectorized polynomials within 1 ulp of libm (default). */
+#define DQ_SINCOS_FAST     2 /**< Vectorized shorter polynomials with an error below 3e-9. */
+
+
+/**
+ * Qualifies the arguments of the _nr functions as not aliasing each other.
+ *  It is the C99 restrict keyword, the compiler specific spelling in C89 mode
+ *  or nothing if the compiler does not support it.
+ */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L)
+#  define DQ_RESTRICT   restrict
+#elif defined(__GNUC__)
+#  define DQ_RESTRICT   __restrict__
+#elif defined(_MSC_VER)
+#  define DQ_RESTRICT   __restrict
+#else
+#  define DQ_RESTRICT
+#endif
+
+
+/**
+ * Storage class of the library functions. It is empty when building or
+ *  linking against libdq. When DQ_INLINE is defined the library is instead
+ *  compiled into every file including it as static inline functions, see
+ *  dq_inline.h.
+ */
+#ifndef DQ_INLINE
+#  define DQ_API
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L)
+#  define DQ_API        static inline
+#elif defined(__GNUC__)
+#  define DQ_API        static __inline__
+#elif defined(_MSC_VER)
+#  define DQ_API        static __inline
+#else
+#  define DQ_API        static
+#endif
+
+
+#define DQ_MATRIX_ROW_MAJOR   0x0 /**< Matrices are stored row by row (default). */
+#define DQ_MATRIX_COL_MAJOR   0x1 /**< Matrices are stored column by column. */
+#define DQ_MATRIX_4X4         0x0 /**< Full homogeneous matrices including the bottom row (default). */
+#define DQ_MATRIX_3X4         0x2 /**< Homogeneous matrices without the bottom row. */
+
+
 /**
  * @brief A representation of a dual quaternion.
  *
@@ -245,7 +335,7 @@ typedef double dq_t[8];
  * @sa dq_cr_rotation_plucker
  * @sa dq_cr_rotation_matrix
  */
-void dq_cr_rotation( dq_t O, double theta, const double s[3], const double c[3] );
+DQ_API void dq_cr_rotation( dq_t O, double theta, const double s[3], const double c[3] );
 /**
  * @brief Creates a pure rotation dual quaternion using plucker coordinates.
  *
@@ -256,16 +346,46 @@ void dq_cr_rotation( dq_t O, double theta, const double s[3], const double c[3]
  * @sa dq_cr_rotation
  * @sa dq_cr_rotation_matrix
  */
-void dq_cr_rotation_plucker( dq_t O, double theta, const double s[3], const double s0[3] );
+DQ_API void dq_cr_rotation_plucker( dq_t O, double theta, const double s[3], const double s0[3] );
+/**
+ * @brief Creates pure rotation dual quaternions from arrays of angles and Plücker coordinates.
+ *
+ * Equivalent to calling dq_cr_rotation_plucker on each element, but the
+ *  sines and cosines of all the angles are computed together, vectorized
+ *  unless changed with dq_sincos_set.
+ *
+ *    @param[out] O Array of n dual quaternions created.
+ *    @param[in] theta Array of n angles to rotate.
+ *    @param[in] s Array of n vectors to rotate around (normalized).
+ *    @param[in] s0 Array of n moments of the vectors.
+ *    @param[in] n Number of rotations.
+ * @sa dq_cr_rotation_plucker
+ * @sa dq_sincos_set
+ */
+DQ_API void dq_cr_rotation_plucker_n( dq_t *O, double *theta, double s[][3], double s0[][3], int n );
 /**
  * @brief Creates a pure rotation dual quaternion from a rotation matrix.
  *
+ * Uses Shepperd's method, which is stable for any rotation including half
+ *  turns. The scalar part of the result is not negative.
+ *
  *    @param[out] O Dual quaternion created.
  *    @param[in] R 3x3 Rotation matrix.
  * @sa dq_cr_rotation
  * @sa dq_cr_rotation_plucker
  */
-void dq_cr_rotation_matrix( dq_t O, double R[3][3] );
+DQ_API void dq_cr_rotation_matrix( dq_t O, double R[3][3] );
+/**
+ * @brief Creates pure rotation dual quaternions from an array of rotation matrices.
+ *
+ * Equivalent to calling dq_cr_rotation_matrix on each element.
+ *
+ *    @param[out] O Array of n dual quaternions created.
+ *    @param[in] R Array of n 3x3 rotation matrices.
+ *    @param[in] n Number of rotation matrices.
+ * @sa dq_cr_rotation_matrix
+ */
+DQ_API void dq_cr_rotation_matrix_n( dq_t *O, double R[][3][3], int n );
 /**
  * @brief Creates a pure translation dual quaternion.
  *
@@ -274,7 +394,7 @@ void dq_cr_rotation_matrix( dq_t O, double R[3][3] );
  *    @param[in] s Translation vector (normalized).
  * @sa dq_cr_translation_vector
  */
-void dq_cr_translation( dq_t O, double t, const double s[3] );
+DQ_API void dq_cr_translation( dq_t O, double t, const double s[3] );
 /**
  * @brief Creates a pure translation dual quaternion from a traslation vector.
  *
@@ -282,7 +402,46 @@ void dq_cr_translation( dq_t O, double t, const double s[3] );
  *    @param[in] t Traslation vector.
  * @sa dq_cr_translation
  */
-void dq_cr_translation_vector( dq_t O, const double t[3] );
+DQ_API void dq_cr_translation_vector( dq_t O, const double t[3] );
+/**
+ * @brief Creates the transform of a row of a Denavit-Hartenberg table.
+ *
+ * Built in closed form, it is the same as the product of a rotation around
+ *  z, a translation along z, a translation along x and a rotation around x:
+ *
+ * \f[
+ * \widehat{T} = R_z(\theta) T_z(d) T_x(a) R_x(\alpha)
+ * \f]
+ *
+ *    @param[out] O Dual quaternion created.
+ *    @param[in] theta Angle around z.
+ *    @param[in] d Offset along z.
+ *    @param[in] a Length along x.
+ *    @param[in] alpha Twist around x.
+ * @sa dq_cr_mdh
+ */
+DQ_API void dq_cr_dh( dq_t O, double theta, double d, double a, double alpha );
+/**
+ * @brief Creates the transform of a row of a modified (Craig) Denavit-Hartenberg table.
+ *
+ * Built in closed form, it is the same as the product of a rotation around
+ *  x, a translation along x, a rotation around z and a translation along z:
+ *
+ * \f[
+ * \widehat{T} = R_x(\alpha) T_x(a) R_z(\theta) T_z(d)
+ * \f]
+ *
+ * The parameters are in the same order as dq_cr_dh, alpha and a being
+ *  those of the previous link in Craig's notation.
+ *
+ *    @param[out] O Dual quaternion created.
+ *    @param[in] theta Angle around z.
+ *    @param[in] d Offset along z.
+ *    @param[in] a Length along x.
+ *    @param[in] alpha Twist around x.
+ * @sa dq_cr_dh
+ */
+DQ_API void dq_cr_mdh( dq_t O, double theta, double d, double a, double alpha );
 /**
  * @brief Creates a dual quaternion representing a point.
  *
@@ -290,7 +449,7 @@ void dq_cr_translation_vector( dq_t O, const double t[3] );
  *    @param[in] pos Position of the point.
  * @sa dq_op_f4g
  */
-void dq_cr_point( dq_t O, const double pos[3] );
+DQ_API void dq_cr_point( dq_t O, const double pos[3] );
 /**
  * @brief Creates a dual quaternion representing a line.
  *
@@ -300,7 +459,7 @@ void dq_cr_point( dq_t O, const double pos[3] );
  * @sa dq_cr_line_plucker
  * @sa dq_op_f2g
  */
-void dq_cr_line( dq_t O, const double s[3], const double c[3] );
+DQ_API void dq_cr_line( dq_t O, const double s[3], const double c[3] );
 /**
  * @brief Creates a dual quaternion representing a line from plucker coordinates.
  *
@@ -310,7 +469,7 @@ void dq_cr_line( dq_t O, const double s[3], const double c[3] );
  * @sa dq_cr_line
  * @sa dq_op_f2g
  */
-void dq_cr_line_plucker( dq_t O, const double s[3], const double s0[3] );
+DQ_API void dq_cr_line_plucker( dq_t O, const double s[3], const double s0[3] );
 /**
  * @brief Creates a unit dual quaternion representing a plane.
  *
@@ -318,22 +477,40 @@ void dq_cr_line_plucker( dq_t O, const double s[3], const double s0[3] );
  *    @param[in] n Normal of the plane.
  *    @param[in] d Distancefrom the origin to the plane.
  */
-void dq_cr_plane( dq_t O, const double n[3], const double d );
+DQ_API void dq_cr_plane( dq_t O, const double n[3], const double d );
 /**
  * @brief Creates a dual quaternion from a homogeneous transformation matrix.
  *
+ * The dual part is built directly from d and the rotation quaternion of R,
+ *  without creating and multiplying a translation dual quaternion.
+ *
  *    @param[out] O Dual quaternion created.
  *    @param[in] R Rotation matrix.
  *    @param[in] d Translation vector.
  */
-void dq_cr_homo( dq_t O, double R[3][3], const double d[3] );
+DQ_API void dq_cr_homo( dq_t O, double R[3][3], const double d[3] );
+/**
+ * @brief Creates dual quaternions from an array of homogeneous transformation matrices.
+ *
+ * The matrices use the 3x4 layout of the homogeneous matrix functions, the
+ *  rotation matrix followed by the translation vector as last column.
+ *  Equivalent to splitting each matrix with homo_op_split and calling
+ *  dq_cr_homo.
+ *
+ *    @param[out] O Array of n dual quaternions created.
+ *    @param[in] H Array of n homogeneous matrices.
+ *    @param[in] n Number of homogeneous matrices.
+ * @sa dq_cr_homo
+ * @sa homo
+ */
+DQ_API void dq_cr_homo_n( dq_t *O, double H[][3][4], int n );
 /**
  * @brief Copies a dual quaternion.
  *
  *    @param[out] O Dual quaternion created.
  *    @param[in] Q Dual quaternion to copy.
  */
-void dq_cr_copy( dq_t O, const dq_t Q );
+DQ_API void dq_cr_copy( dq_t O, const dq_t Q );
 /**
  * @brief Conjugates a dual quaternion.
  *
@@ -344,7 +521,7 @@ void dq_cr_copy( dq_t O, const dq_t Q );
  *    @param[out] O Dual quaternion created (conjugated).
  *    @param[in] Q Dual quaternion to conjugate.
  */
-void dq_cr_conj( dq_t O, const dq_t Q );
+DQ_API void dq_cr_conj( dq_t O, const dq_t Q );
 /**
  * @brief Inverts a dual quaternion.
  *
@@ -385,7 +562,7 @@ void dq_cr_conj( dq_t O, const dq_t Q );
  *    @param[out] O Dual quaternion created (inverted).
  *    @param[in] Q Dual quaternion to invert.
  */
-void dq_cr_inv( dq_t O, const dq_t Q );
+DQ_API void dq_cr_inv( dq_t O, const dq_t Q );
 /** @} */
 
 
@@ -424,7 +601,7 @@ void dq_cr_inv( dq_t O, const dq_t Q );
  *    @param[in] Q Dual quaternion to get square of norm of.
  * @sa dq_cr_conj
  */
-void dq_op_norm2( double *real, double *dual, const dq_t Q );
+DQ_API void dq_op_norm2( double *real, double *dual, const dq_t Q );
 /**
  * @brief Adds two dual quaternions.
  *
@@ -437,7 +614,7 @@ void dq_op_norm2( double *real, double *dual, const dq_t Q );
  *    @param[in] Q Second quaternion to add.
  * @sa dq_op_sub
  */
-void dq_op_add( dq_t O, const dq_t P, const dq_t Q );
+DQ_API void dq_op_add( dq_t O, const dq_t P, const dq_t Q );
 /**
  * @brief Subtracts two dual quaternions.
  *
@@ -450,7 +627,7 @@ void dq_op_add( dq_t O, const dq_t P, const dq_t Q );
  *    @param[in] Q Dual quaternion to subtract.
  * @sa dq_op_add
  */
-void dq_op_sub( dq_t O, const dq_t P, const dq_t Q );
+DQ_API void dq_op_sub( dq_t O, const dq_t P, const dq_t Q );
 /**
  * @brief Multiplies to dual quaternions.
  *
@@ -477,14 +654,112 @@ void dq_op_sub( dq_t O, const dq_t P, const dq_t Q );
  *    @param[in] P First dual quaternion to multiply.
  *    @param[in] Q Second dual quaternion to multiply.
  */
-void dq_op_mul( dq_t PQ, const dq_t P, const dq_t Q );
+DQ_API void dq_op_mul( dq_t PQ, const dq_t P, const dq_t Q );
+/**
+ * @brief Multiplies two dual quaternions that do not alias the result.
+ *
+ * Same as dq_op_mul, but PQ must not overlap P or Q so the result is written
+ *  directly instead of through a temporary. This is not checked. It always
+ *  uses the scalar code, while dq_op_mul goes through the kernels selected
+ *  with dq_simd_set, so the two may differ in the last bits.
+ *
+ *    @param[out] PQ Result of the multiplication, must not overlap P nor Q.
+ *    @param[in] P First dual quaternion to multiply.
+ *    @param[in] Q Second dual quaternion to multiply.
+ * @sa dq_op_mul_ip
+ */
+DQ_API void dq_op_mul_nr( double * DQ_RESTRICT PQ, const double * DQ_RESTRICT P, const double * DQ_RESTRICT Q );
+/**
+ * @brief Multiplies a dual quaternion in place by another on the right.
+ *
+ * \f[
+ * \widehat{P} \leftarrow \widehat{P} \widehat{Q}
+ * \f]
+ *
+ *    @param P Dual quaternion to multiply, overwritten with the result.
+ *    @param[in] Q Dual quaternion to multiply by, must not be P.
+ * @sa dq_op_mul_nr
+ */
+DQ_API void dq_op_mul_ip( dq_t P, const dq_t Q );
+/**
+ * @brief Multiplies two arrays of dual quaternions element by element.
+ *
+ * \f[
+ * \widehat{PQ}_i = \widehat{P}_i \widehat{Q}_i \quad i = 0 \ldots n-1
+ * \f]
+ *
+ * Equivalent to calling dq_op_mul on each element. The output may be the
+ *  same array as either of the inputs. Before C23, passing arrays that are
+ *  not const to P or Q needs a cast in pedantic ISO C.
+ *
+ *    @param[out] PQ Array of n results of the multiplications.
+ *    @param[in] P Array of n first dual quaternions to multiply.
+ *    @param[in] Q Array of n second dual quaternions to multiply.
+ *    @param[in] n Number of dual quaternions in each array.
+ * @sa dq_op_mul
+ * @sa dq_soa_op_mul
+ */
+DQ_API void dq_op_mul_n( dq_t *PQ, const dq_t *P, const dq_t *Q, int n );
+/**
+ * @brief Multiplies a chain of dual quaternions.
+ *
+ * \f[
+ * \widehat{O} = \widehat{L}_0 \widehat{L}_1 \cdots \widehat{L}_{n-1}
+ * \f]
+ *
+ * The order of the links is preserved, but instead of multiplying them from
+ *  left to right the products are associated as a balanced tree. Products of
+ *  the same level do not depend on each other, so they overlap in the CPU
+ *  pipeline instead of waiting for the previous one as with repeated
+ *  dq_op_mul calls. The result of an empty chain is the identity.
+ *
+ * Dual quaternion multiplication is associative so both orders give the same
+ *  result in exact arithmetic. With floating point each link goes through
+ *  about log2(n) products instead of up to n, so the accumulated rounding
+ *  error grows with log2(n) instead of n. The result may differ from the left
+ *  to right product by that rounding error, it is deterministic and does not
+ *  depend on the number of threads.
+ *
+ * Very long chains are split into 2^k subtrees computed on separate threads,
+ *  see dq_threads_set.
+ *
+ *    @param[out] out Product of the chain.
+ *    @param[in] links Array of n dual quaternions to multiply.
+ *    @param[in] n Number of dual quaternions in the chain.
+ * @sa dq_op_mul
+ */
+DQ_API void dq_op_mul_chain( dq_t out, dq_t *links, int n );
+/**
+ * @brief Computes every partial product of a chain of dual quaternions.
+ *
+ * \f[
+ * \widehat{O}_i = \widehat{L}_0 \widehat{L}_1 \cdots \widehat{L}_i
+ * \f]
+ *
+ * For a kinematic chain this gives the pose of every link in the base frame.
+ *  The output may be the same array as the links.
+ *
+ * With a single thread the partial products are computed from left to right
+ *  and match repeated dq_op_mul calls exactly. With several threads (see
+ *  dq_threads_set) the chain is split into a block per thread, every block is
+ *  scanned on its own, and then the product of the previous blocks is
+ *  prepended to each one. This does about twice the multiplications, so it
+ *  only pays off with more than two threads, and the results differ from the
+ *  left to right product by rounding error.
+ *
+ *    @param[out] out Array of n partial products.
+ *    @param[in] links Array of n dual quaternions to multiply.
+ *    @param[in] n Number of dual quaternions in the chain.
+ * @sa dq_op_mul_chain
+ */
+DQ_API void dq_op_scan( dq_t *out, dq_t *links, int n );
 /**
  * @brief Swaps the sign of all the elements in a dual quaternion.
  *
  *    @param[out] P Result of swapping all values of the elements.
  *    @param[in] Q Dual quaternion to swap sign of all elements.
  */
-void dq_op_sign( dq_t P, const dq_t Q );
+DQ_API void dq_op_sign( dq_t P, const dq_t Q );
 /**
  * @brief Clifford conjugation transformation of type \f$f_{1g}\f$ (Alba Perez notation).
  *
@@ -500,7 +775,24 @@ void dq_op_sign( dq_t P, const dq_t Q );
  * @sa dq_op_f3g
  * @sa dq_op_f4g
  */
-void dq_op_f1g( dq_t ABA, const dq_t A, const dq_t B );
+DQ_API void dq_op_f1g( dq_t ABA, const dq_t A, const dq_t B );
+/**
+ * @brief Applies the transformation of dq_op_f1g to an array of dual quaternions.
+ *
+ * \f[
+ * \widehat{ABA}_i = f_{1g}(\widehat{A}, \widehat{B}_i) \quad i = 0 \ldots n-1
+ * \f]
+ *
+ * The quadratic terms of A are computed once and shared by all the
+ *  transformations. The output may be the same array as B.
+ *
+ *    @param[out] ABA Array of n results of the transformation.
+ *    @param[in] A Dual quaternion representing the transformation.
+ *    @param[in] B Array of n dual quaternions being transformated.
+ *    @param[in] n Number of dual quaternions in each array.
+ * @sa dq_op_f1g
+ */
+DQ_API void dq_op_f1g_n( dq_t *ABA, const dq_t A, dq_t *B, int n );
 /**
  * @brief Clifford conjugation transformation of type \f$f_{2g}\f$ (Alba Perez notation).
  *
@@ -518,7 +810,24 @@ void dq_op_f1g( dq_t ABA, const dq_t A, const dq_t B );
  * @sa dq_op_f3g
  * @sa dq_op_f4g
  */
-void dq_op_f2g( dq_t ABA, const dq_t A, const dq_t B );
+DQ_API void dq_op_f2g( dq_t ABA, const dq_t A, const dq_t B );
+/**
+ * @brief Applies the transformation of dq_op_f2g to an array of dual quaternions.
+ *
+ * \f[
+ * \widehat{ABA}_i = f_{2g}(\widehat{A}, \widehat{B}_i) \quad i = 0 \ldots n-1
+ * \f]
+ *
+ * The quadratic terms of A are computed once and shared by all the
+ *  transformations. The output may be the same array as B.
+ *
+ *    @param[out] ABA Array of n results of the transformation.
+ *    @param[in] A Dual quaternion representing the transformation.
+ *    @param[in] B Array of n dual quaternions being transformated.
+ *    @param[in] n Number of dual quaternions in each array.
+ * @sa dq_op_f2g
+ */
+DQ_API void dq_op_f2g_n( dq_t *ABA, const dq_t A, dq_t *B, int n );
 /**
  * @brief Clifford conjugation transformation of type \f$f_{3g}\f$ (Alba Perez notation).
  *
@@ -534,7 +843,24 @@ void dq_op_f2g( dq_t ABA, const dq_t A, const dq_t B );
  * @sa dq_op_f2g
  * @sa dq_op_f4g
  */
-void dq_op_f3g( dq_t ABA, const dq_t A, const dq_t B );
+DQ_API void dq_op_f3g( dq_t ABA, const dq_t A, const dq_t B );
+/**
+ * @brief Applies the transformation of dq_op_f3g to an array of dual quaternions.
+ *
+ * \f[
+ * \widehat{ABA}_i = f_{3g}(\widehat{A}, \widehat{B}_i) \quad i = 0 \ldots n-1
+ * \f]
+ *
+ * The quadratic terms of A are computed once and shared by all the
+ *  transformations. The output may be the same array as B.
+ *
+ *    @param[out] ABA Array of n results of the transformation.
+ *    @param[in] A Dual quaternion representing the transformation.
+ *    @param[in] B Array of n dual quaternions being transformated.
+ *    @param[in] n Number of dual quaternions in each array.
+ * @sa dq_op_f3g
+ */
+DQ_API void dq_op_f3g_n( dq_t *ABA, const dq_t A, dq_t *B, int n );
 /**
  * @brief Clifford conjugation transformation of type \f$f_{4g}\f$ (Alba Perez notation).
  *
@@ -552,7 +878,24 @@ void dq_op_f3g( dq_t ABA, const dq_t A, const dq_t B );
  * @sa dq_op_f2g
  * @sa dq_op_f3g
  */
-void dq_op_f4g( dq_t ABA, const dq_t A, const dq_t B );
+DQ_API void dq_op_f4g( dq_t ABA, const dq_t A, const dq_t B );
+/**
+ * @brief Applies the transformation of dq_op_f4g to an array of dual quaternions.
+ *
+ * \f[
+ * \widehat{ABA}_i = f_{4g}(\widehat{A}, \widehat{B}_i) \quad i = 0 \ldots n-1
+ * \f]
+ *
+ * The quadratic terms of A are computed once and shared by all the
+ *  transformations. The output may be the same array as B.
+ *
+ *    @param[out] ABA Array of n results of the transformation.
+ *    @param[in] A Dual quaternion representing the transformation.
+ *    @param[in] B Array of n dual quaternions being transformated.
+ *    @param[in] n Number of dual quaternions in each array.
+ * @sa dq_op_f4g
+ */
+DQ_API void dq_op_f4g_n( dq_t *ABA, const dq_t A, dq_t *B, int n );
 /**
  * @brief Extracts the rotation matrix and translation vector assosciated to a dual quaternion.
  *
@@ -560,7 +903,169 @@ void dq_op_f4g( dq_t ABA, const dq_t A, const dq_t B );
  *    @param[out] d Translation vector.
  *    @param[in] Q Dual quaternion to extract R and d from.
  */
-void dq_op_extract( double R[3][3], double d[3], const dq_t Q );
+DQ_API void dq_op_extract( double R[3][3], double d[3], const dq_t Q );
+/**
+ * @brief Transforms an array of points by a unit dual quaternion.
+ *
+ * Gives the same result as creating a point with dq_cr_point and applying
+ *  dq_op_f4g to each point, but the dual quaternion is converted once to a
+ *  rotation matrix and translation vector so that each point only costs a
+ *  3x3 matrix-vector product:
+ *
+ * \f[
+ *    p'_i = R p_i + d
+ * \f]
+ *
+ *    @param[in] Q Unit dual quaternion to transform by.
+ *    @param[in] in Array of n points stored as consecutive x, y, z triples.
+ *    @param[out] out Array of n transformed points, may be the same as in.
+ *    @param[in] n Number of points.
+ * @sa dq_op_f4g
+ * @sa dq_op_extract
+ */
+DQ_API void dq_op_transform_points( const dq_t Q, const double *in, double *out, int n );
+/**
+ * @brief Exponential of a pure dual quaternion.
+ *
+ * A pure dual quaternion \f$\widehat{X} = \frac{\widehat{\theta}}{2} \widehat{s}\f$,
+ *  with the dual angle \f$\widehat{\theta} = \theta + \epsilon d\f$ and the
+ *  line \f$\widehat{s} = s + \epsilon s_0\f$, gives the screw displacement
+ *  of angle \f$\theta\f$ and translation d along that line:
+ *
+ * \f[
+ * e^{\widehat{X}} = \cos \frac{\widehat{\theta}}{2} + \widehat{s} \sin \frac{\widehat{\theta}}{2}
+ * \f]
+ *
+ * Small angles, including pure translations, use series instead of the
+ *  closed forms so the result keeps full precision.
+ *
+ *    @param[out] O Unit dual quaternion of the displacement.
+ *    @param[in] X Pure dual quaternion, its scalar parts X[0] and X[7] are
+ *               ignored.
+ * @sa dq_op_log
+ */
+DQ_API void dq_op_exp( dq_t O, const dq_t X );
+/**
+ * @brief Logarithm of a unit dual quaternion.
+ *
+ * Inverse of dq_op_exp, gives the screw \f$\frac{\widehat{\theta}}{2} \widehat{s}\f$
+ *  of the displacement. Of the two screws giving the same displacement,
+ *  \f$\widehat{Q}\f$ and \f$-\widehat{Q}\f$, the one with the smallest
+ *  angle is returned, so the angle is in \f$[0,\pi]\f$.
+ *
+ *    @param[out] O Pure dual quaternion, O[0] and O[7] are zero.
+ *    @param[in] Q Unit dual quaternion.
+ * @sa dq_op_exp
+ */
+DQ_API void dq_op_log( dq_t O, const dq_t Q );
+/**
+ * @brief Raises a unit dual quaternion to a real power.
+ *
+ * \f[
+ * \widehat{Q}^t = e^{t \log \widehat{Q}}
+ * \f]
+ *
+ * The displacement along the shortest screw of Q scaled by t, so t = 0.5
+ *  gives half of the motion and t = -1 its inverse.
+ *
+ *    @param[out] O Dual quaternion raised to the power.
+ *    @param[in] Q Unit dual quaternion.
+ *    @param[in] t Power.
+ * @sa dq_op_pow_n
+ */
+DQ_API void dq_op_pow( dq_t O, const dq_t Q, double t );
+/**
+ * @brief Raises a unit dual quaternion to many real powers.
+ *
+ * Same as calling dq_op_pow for each power, but the logarithm is computed
+ *  once and the sines and cosines of all the angles together, vectorized
+ *  unless changed with dq_sincos_set.
+ *
+ *    @param[out] O Array of n dual quaternions raised to the powers.
+ *    @param[in] Q Unit dual quaternion.
+ *    @param[in] t Array of n powers.
+ *    @param[in] n Number of powers.
+ * @sa dq_op_pow
+ */
+DQ_API void dq_op_pow_n( dq_t *O, const dq_t Q, const double *t, int n );
+/**
+ * @brief Screw linear interpolation (ScLERP) between two unit dual quaternions.
+ *
+ * \f[
+ * \widehat{O} = \widehat{P} (\widehat{P}^* \widehat{Q})^t
+ * \f]
+ *
+ * Moves from P at t = 0 to Q at t = 1 along the single screw between them,
+ *  with constant angular and linear velocity, taking the shortest way.
+ *
+ *    @param[out] O Interpolated dual quaternion.
+ *    @param[in] P Unit dual quaternion at t = 0.
+ *    @param[in] Q Unit dual quaternion at t = 1.
+ *    @param[in] t Interpolation parameter, extrapolates outside of [0,1].
+ * @sa dq_op_sclerp_n
+ * @sa dq_op_pow
+ */
+DQ_API void dq_op_sclerp( dq_t O, const dq_t P, const dq_t Q, double t );
+/**
+ * @brief Screw linear interpolation at many parameters.
+ *
+ * Same as calling dq_op_sclerp for each parameter, the screw between P and
+ *  Q is computed once as in dq_op_pow_n. Meant for sampling trajectories.
+ *
+ *    @param[out] O Array of n interpolated dual quaternions.
+ *    @param[in] P Unit dual quaternion at t = 0.
+ *    @param[in] Q Unit dual quaternion at t = 1.
+ *    @param[in] t Array of n interpolation parameters.
+ *    @param[in] n Number of parameters.
+ * @sa dq_op_sclerp
+ */
+DQ_API void dq_op_sclerp_n( dq_t *O, const dq_t P, const dq_t Q, const double *t, int n );
+/**
+ * @brief Extracts the homogeneous matrices of an array of unit dual quaternions.
+ *
+ * Writes the matrix
+ *
+ * \f[
+ *    H = \left( \begin{array}{cc}
+ *       R & d \\
+ *       0 & 1
+ *    \end{array} \right)
+ * \f]
+ *
+ *  of each dual quaternion as computed by dq_op_extract directly into a
+ *  caller provided buffer. The layout is chosen by combining DQ_MATRIX_ROW_MAJOR
+ *  or DQ_MATRIX_COL_MAJOR with DQ_MATRIX_4X4 or DQ_MATRIX_3X4. Row-major 3x4
+ *  matches the layout of the homogeneous matrix functions, column-major 4x4
+ *  the layout usually expected by graphics APIs.
+ *
+ * The matrices are computed four at a time, with vectorized kernels when
+ *  available (see dq_simd_set).
+ *
+ *    @param[out] M Buffer to write the matrices to.
+ *    @param[in] stride Number of elements between the start of consecutive
+ *               matrices, 0 for packed matrices (12 or 16).
+ *    @param[in] flags DQ_MATRIX_* flags selecting the layout.
+ *    @param[in] Q Array of n unit dual quaternions.
+ *    @param[in] n Number of dual quaternions.
+ * @sa dq_op_extract
+ * @sa dq_op_extract_nf
+ */
+DQ_API void dq_op_extract_n( double *M, int stride, int flags, dq_t *Q, int n );
+/**
+ * @brief Extracts the homogeneous matrices of an array of unit dual quaternions as floats.
+ *
+ * Same as dq_op_extract_n but writes single precision matrices, for example
+ *  to upload them directly to a GPU.
+ *
+ *    @param[out] M Buffer to write the matrices to.
+ *    @param[in] stride Number of elements between the start of consecutive
+ *               matrices, 0 for packed matrices (12 or 16).
+ *    @param[in] flags DQ_MATRIX_* flags selecting the layout.
+ *    @param[in] Q Array of n unit dual quaternions.
+ *    @param[in] n Number of dual quaternions.
+ * @sa dq_op_extract_n
+ */
+DQ_API void dq_op_extract_nf( float *M, int stride, int flags, dq_t *Q, int n );
 /** @} */
 
 
@@ -575,7 +1080,7 @@ void dq_op_extract( double R[3][3], double d[3], const dq_t Q );
  *    @param[in] Q Dual quaternion to check if is a unit quaternion.
  *    @return 1 if is a unit dual quaternion or 0 otherwise.
  */
-int dq_ch_unit( const dq_t Q );
+DQ_API int dq_ch_unit( const dq_t Q );
 /**
  * @brief Checks to see if a point Q is on the plane P.
  *
@@ -583,7 +1088,7 @@ int dq_ch_unit( const dq_t Q );
  *    @param[in] Q Point to check if is on plane P.
  *    @return 1 if point Q is on plane P.
  */
-int dq_ch_point_plane( const dq_t P, const dq_t Q );
+DQ_API int dq_ch_point_plane( const dq_t P, const dq_t Q );
 /**
  * @brief Compares two dual quaternions.
  *
@@ -592,7 +1097,7 @@ int dq_ch_point_plane( const dq_t P, const dq_t Q );
  *    @return 0 if they are equal.
  * @sa dq_ch_cmpV
  */
-int dq_ch_cmp( const dq_t P, const dq_t Q );
+DQ_API int dq_ch_cmp( const dq_t P, const dq_t Q );
 /**
  * @brief Compares two dual quaternions with variable precision.
  *
@@ -602,7 +1107,7 @@ int dq_ch_cmp( const dq_t P, const dq_t Q );
  *    @return 0 if they are equal.
  * @sa dq_ch_cmp
  */
-int dq_ch_cmpV( const dq_t P, const dq_t Q, double precision );
+DQ_API int dq_ch_cmpV( const dq_t P, const dq_t Q, double precision );
 /** @} */
 
 
@@ -617,14 +1122,14 @@ int dq_ch_cmpV( const dq_t P, const dq_t Q, double precision );
  *    @param[in] Q Dual quaternion to print.
  * @sa dq_printVert
  */
-void dq_print( const dq_t Q );
+DQ_API void dq_print( const dq_t Q );
 /**
  * @brief Prints a dual quaternion vertically.
  *
  *    @param[in] Q Dual quaternion to print.
  * @sa dq_print
  */
-void dq_print_vert( const dq_t Q );
+DQ_API void dq_print_vert( const dq_t Q );
 /**
  * @brief Gets the version of the library during runtime.
  *
@@ -634,7 +1139,103 @@ void dq_print_vert( const dq_t Q );
  *    @param[out] major Major version of the library.
  *    @param[out] minor Minor version of the library.
  */
-void dq_version( int *major, int *minor );
+DQ_API void dq_version( int *major, int *minor );
+/**
+ * @brief Selects the implementation used for the core operations.
+ *
+ * dq_op_mul, dq_op_f4g, dq_op_extract, dq_op_extract_n and dq_cr_conj have
+ *  vectorized implementations on x86. When the library is loaded the best
+ *  instruction set supported by the CPU is selected, this function allows
+ *  overriding it, for example to compare against the scalar implementation.
+ *  Results of the different implementations agree within DQ_PRECISION.
+ *  The header-only build (dq_inline.h) always uses the scalar implementation.
+ *
+ * This is not thread safe and should be called before using the library.
+ *
+ *    @param[in] level One of the DQ_SIMD_* levels, it is lowered to the best
+ *                     level supported by the CPU.
+ *    @return The level actually selected.
+ * @sa dq_simd_get
+ */
+DQ_API int dq_simd_set( int level );
+/**
+ * @brief Gets the implementation used for the core operations.
+ *
+ *    @return The currently selected DQ_SIMD_* level.
+ * @sa dq_simd_set
+ */
+DQ_API int dq_simd_get( void );
+/**
+ * @brief Sets the number of threads used by the parallel functions.
+ *
+ * Functions that work on large amounts of data, such as dq_op_mul_chain, split
+ *  the work among this many threads. Threads are only used when each one gets
+ *  enough work to make up for creating it. The default is a single thread.
+ *
+ * There is no pool: every parallel call creates its threads and joins them
+ *  before returning, some calls even twice, which costs in the order of tens
+ *  of microseconds per thread. Calls too small to amortize that run on the
+ *  calling thread, but many medium sized calls in a loop may be faster with
+ *  a single thread and the loop itself split among threads by the caller.
+ *
+ * This is not thread safe and should be called before using the library.
+ *
+ *    @param[in] n Number of threads, 0 or less to use one per online CPU. It
+ *                 is limited to DQ_THREADS_MAX.
+ *    @return The number of threads that will be used, always 1 if the
+ *            library was built without thread support.
+ * @sa dq_threads_get
+ */
+DQ_API int dq_threads_set( int n );
+/**
+ * @brief Gets the number of threads used by the parallel functions.
+ *
+ *    @return The number of threads that will be used.
+ * @sa dq_threads_set
+ */
+DQ_API int dq_threads_get( void );
+/**
+ * @brief Sets how the batch functions compute sines and cosines.
+ *
+ * The batch functions building many rotations, such as
+ *  dq_cr_rotation_plucker_n and dq_chain_fk_batch, compute the sine and
+ *  cosine of all their angles together. With DQ_SINCOS_VECTOR and
+ *  DQ_SINCOS_FAST this is done with polynomials the compiler vectorizes
+ *  instead of calling libm for every angle:
+ *
+ *    - DQ_SINCOS_VECTOR uses the same polynomials as fdlibm and differs from
+ *      libm by at most one unit in the last place (2.3e-16 for angles up
+ *      to 1).
+ *    - DQ_SINCOS_FAST uses the shorter single precision polynomials of
+ *      cephes, with an absolute error below 3e-9, for when speed matters
+ *      more than the last digits.
+ *
+ * Angles larger than 1e5 radians, infinities and NaN always go through
+ *  libm. Functions working on a single rotation always use libm. So does
+ *  code built with -ffast-math, which would break the polynomials, and
+ *  the mode stays DQ_SINCOS_LIBM there. This includes callers of
+ *  dq_inline.h built with -ffast-math or -Ofast.
+ *
+ * This is not thread safe and should be called before using the library.
+ *
+ *    @param[in] mode DQ_SINCOS_LIBM, DQ_SINCOS_VECTOR or DQ_SINCOS_FAST.
+ *    @return The mode actually selected, unchanged if mode is not valid.
+ * @sa dq_sincos_get
+ */
+DQ_API int dq_sincos_set( int mode );
+/**
+ * @brief Gets how the batch functions compute sines and cosines.
+ *
+ *    @return The currently selected DQ_SINCOS_* mode.
+ * @sa dq_sincos_set
+ */
+DQ_API int dq_sincos_get( void );
 /** @} */
 
+
+/* Header-only build, pulls in the definitions of all the functions. */
+#ifdef DQ_INLINE
+#include "dq_inline.h"
+#endif /* DQ_INLINE */
+
 #endif /* _DQ_H */
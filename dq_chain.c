@@ -0,0 +1,1683 @@
+#include "dq_chain.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#ifdef DQ_CHECK
+#include <assert.h>
+#endif /* DQ_CHECK */
+
+#include "dq_vec3.h"
+#include "dq_thread.h"
+#include "dq_sincos.h"
+
+
+#define MIN(a,b)     (((a)<(b))?(a):(b))
+#define MAX(a,b)     (((a)>(b))?(a):(b))
+
+#define DQ_PI              3.14159265358979323846
+
+#define DQ_CHAIN_WORK      7     /**< Scratch doubles per joint, the Jacobian and a copy of the joints. */
+#define DQ_CHAIN_LINE      1024  /**< Size of the buffer of a line of a chain description, with its newline and terminator. */
+#define DQ_IK_LAMBDA_MIN   1e-6  /**< Smallest damping, keeps singular Jacobians solvable. */
+#define DQ_IK_LAMBDA_MAX   1e10  /**< Damping at which a solve is considered stalled. */
+
+
+DQ_API int dq_chain_create( dq_chain_t *C, int n )
+{
+   double z[3] = { 0., 0., 1. };
+   double o[3] = { 0., 0., 0. };
+   int i;
+
+#ifdef DQ_CHECK
+   assert( n >= 0 );
+#endif /* DQ_CHECK */
+
+   /* Dual quaternions go first as they have the strictest alignment. Avoid
+    * malloc(0) as it may return NULL and look like a failure. */
+   C->home = malloc( (3*sizeof(dq_t) + sizeof(dq_joint_t) + (3+DQ_CHAIN_WORK)*sizeof(double)) *
+         (size_t)(n>0 ? n : 1) );
+   if (C->home == NULL)
+      return -1;
+   C->prefix   = &C->home[n];
+   C->link     = &C->prefix[n];
+   C->joint    = (dq_joint_t*) &C->link[n];
+   C->q        = (double*) &C->joint[n];
+   C->limit    = &C->q[n];
+   C->work     = &C->limit[2*n];
+   C->has_home = 0;
+   C->n        = n;
+   C->dirty    = 0;
+   for (i=0; i<n; i++) {
+      dq_chain_set_axis( C, i, DQ_JOINT_REVOLUTE, z, o );
+      dq_cr_translation_vector( C->home[i], o );
+      C->q[i]         = 0.;
+      C->limit[2*i]   = -HUGE_VAL;
+      C->limit[2*i+1] = HUGE_VAL;
+   }
+   dq_chain_stats_reset( C );
+   return 0;
+}
+
+
+DQ_API void dq_chain_free( dq_chain_t *C )
+{
+   free( C->home );
+   memset( C, 0, sizeof(dq_chain_t) );
+}
+
+
+DQ_API void dq_chain_set_axis( dq_chain_t *C, int i, int type, const double s[3], const double s0[3] )
+{
+   dq_joint_t *J;
+
+#ifdef DQ_CHECK
+   assert( (i >= 0) && (i < C->n) );
+   assert( (type == DQ_JOINT_REVOLUTE) || (type == DQ_JOINT_PRISMATIC) );
+   assert( fabs(vec3_dot(s,s)-1.) < DQ_PRECISION );
+   assert( (type != DQ_JOINT_REVOLUTE) || (fabs(vec3_dot(s,s0)) < DQ_PRECISION) );
+#endif /* DQ_CHECK */
+
+   J = &C->joint[i];
+   memcpy( J->s, s, sizeof(double)*3 );
+   if (type == DQ_JOINT_REVOLUTE)
+      memcpy( J->s0, s0, sizeof(double)*3 );
+   else
+      memset( J->s0, 0, sizeof(double)*3 );
+   J->type = type;
+   C->dirty = MIN( C->dirty, i );
+}
+
+
+DQ_API void dq_chain_set_home( dq_chain_t *C, int i, const dq_t M )
+{
+#ifdef DQ_CHECK
+   assert( (i >= 0) && (i < C->n) );
+#endif /* DQ_CHECK */
+
+   dq_cr_copy( C->home[i], M );
+   /* All the links must be recomputed when the home poses start being used. */
+   C->dirty    = C->has_home ? MIN( C->dirty, i ) : 0;
+   C->has_home = 1;
+}
+
+
+DQ_API void dq_chain_set_limits( dq_chain_t *C, int i, double lo, double hi )
+{
+#ifdef DQ_CHECK
+   assert( (i >= 0) && (i < C->n) );
+   assert( lo <= hi );
+#endif /* DQ_CHECK */
+
+   C->limit[2*i]   = lo;
+   C->limit[2*i+1] = hi;
+}
+
+
+DQ_API int dq_chain_create_dh( dq_chain_t *C, const double *dh, const int *type, int n, int convention )
+{
+   dq_t M, T, P;
+   double R[3][3], c[3], s0[3], s[3];
+   int i;
+
+#ifdef DQ_CHECK
+   assert( (convention == DQ_DH_STANDARD) || (convention == DQ_DH_MODIFIED) );
+#endif /* DQ_CHECK */
+
+   if (dq_chain_create( C, n ) != 0)
+      return -1;
+
+   /* Poses of the links with the joints at their offsets. A joint moves
+    * along the z axis of the frame before its row in the standard
+    * convention, and of the frame after it in the modified one. */
+   memset( M, 0, sizeof(dq_t) );
+   M[0] = 1.;
+   for (i=0; i<n; i++) {
+      dq_cr_copy( P, M );
+      if (convention == DQ_DH_MODIFIED)
+         dq_cr_mdh( T, dh[4*i], dh[4*i+1], dh[4*i+2], dh[4*i+3] );
+      else
+         dq_cr_dh( T, dh[4*i], dh[4*i+1], dh[4*i+2], dh[4*i+3] );
+      dq_op_mul( M, P, T );
+
+      dq_op_extract( R, c, (convention == DQ_DH_MODIFIED) ? M : P );
+      s[0] = R[0][2];
+      s[1] = R[1][2];
+      s[2] = R[2][2];
+      vec3_normalize( s );
+      vec3_cross( s0, c, s );
+      dq_chain_set_axis( C, i, type[i], s, s0 );
+      dq_chain_set_home( C, i, M );
+   }
+   return 0;
+}
+
+
+/**
+ * @brief State of the parser of chain descriptions.
+ */
+typedef struct dq_load_s {
+   dq_chain_t *C; /**< Chain being built, allocated by the joints line. */
+   int joints;    /**< Joints read so far, -1 before the joints line. */
+} dq_load_t;
+
+
+/**
+ * @brief Whether a character ends a word or a number.
+ */
+static int dq_load_end( char c )
+{
+   return (c == '\0') || (c == '#') || isspace( (unsigned char)c );
+}
+
+
+/**
+ * @brief Reads the next word of a line.
+ *
+ *    @return Length of the word, 0 at the end of the line and -1 if it is
+ *            not a word or does not fit.
+ */
+static int dq_load_word( const char **p, char *w, int size )
+{
+   int n;
+
+   while (isspace( (unsigned char)**p ))
+      (*p)++;
+   n = 0;
+   while (!dq_load_end( **p )) {
+      if ((n >= size-1) || !isalpha( (unsigned char)**p ))
+         return -1;
+      w[n++] = *(*p)++;
+   }
+   w[n] = '\0';
+   return n;
+}
+
+
+/**
+ * @brief Reads finite numbers from a line.
+ *
+ *    @return 0 on success, -1 on error.
+ */
+static int dq_load_nums( const char **p, double *v, int n )
+{
+   char *end;
+   int i;
+
+   for (i=0; i<n; i++) {
+      v[i] = strtod( *p, &end );
+      /* Also rejects infinities and NaN. */
+      if ((end == *p) || !dq_load_end( *end ) || !(v[i] - v[i] == 0.))
+         return -1;
+      *p = end;
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Normalizes a direction read from a description, and a moment with it.
+ *
+ *    @return 0 on success, -1 if it has no direction.
+ */
+static int dq_load_unit( double s[3], double s0[3] )
+{
+   double m, l;
+   int k;
+
+   /* Scaled by the largest component first so the norm can not overflow
+    * nor underflow. */
+   m = MAX( MAX( fabs(s[0]), fabs(s[1]) ), fabs(s[2]) );
+   if (!(m > 0.))
+      return -1;
+   l = sqrt( (s[0]/m)*(s[0]/m) + (s[1]/m)*(s[1]/m) + (s[2]/m)*(s[2]/m) );
+   for (k=0; k<3; k++) {
+      s[k] = (s[k]/m) / l;
+      if (s0 != NULL)
+         s0[k] = (s0[k]/m) / l;
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Parses the line with the number of joints, which allocates the chain.
+ */
+static int dq_load_joints( dq_load_t *L, const char *p )
+{
+   char *end;
+   long n;
+
+   n = strtol( p, &end, 10 );
+   if ((end == p) || !dq_load_end( *end ) || (n < 1) || (n > DQ_CHAIN_LOAD_MAX))
+      return -1;
+   while (isspace( (unsigned char)*end ))
+      end++;
+   if ((*end != '\0') && (*end != '#'))
+      return -1;
+   if (dq_chain_create( L->C, (int)n ) != 0)
+      return -1;
+   L->joints = 0;
+   return 0;
+}
+
+
+/**
+ * @brief Parses the line of a joint.
+ */
+static int dq_load_joint( dq_load_t *L, const char *p, int type )
+{
+   char w[16];
+   double s[3], c[3], s0[3], lim[2], t[3], r[4], d;
+   double z[3] = { 0., 0., 0. };
+   dq_t T, R, M;
+   int has_s, has_c, has_m, has_l, has_t, has_r, n;
+
+   if (L->joints >= L->C->n)
+      return -1;
+   has_s = has_c = has_m = has_l = has_t = has_r = 0;
+   while ((n = dq_load_word( &p, w, (int)sizeof(w) )) > 0) {
+      if ((strcmp( w, "axis" ) == 0) && !has_s) {
+         has_s = 1;
+         n = dq_load_nums( &p, s, 3 );
+      }
+      else if ((strcmp( w, "point" ) == 0) && !has_c && !has_m) {
+         has_c = 1;
+         n = dq_load_nums( &p, c, 3 );
+      }
+      else if ((strcmp( w, "plucker" ) == 0) && !has_s && !has_c) {
+         has_s = 1;
+         has_m = 1;
+         n = dq_load_nums( &p, s, 3 ) || dq_load_nums( &p, s0, 3 );
+      }
+      else if ((strcmp( w, "limits" ) == 0) && !has_l) {
+         has_l = 1;
+         n = dq_load_nums( &p, lim, 2 );
+      }
+      else if ((strcmp( w, "offset" ) == 0) && !has_t) {
+         has_t = 1;
+         n = dq_load_nums( &p, t, 3 );
+      }
+      else if ((strcmp( w, "rotate" ) == 0) && !has_r) {
+         has_r = 1;
+         n = dq_load_nums( &p, r, 4 );
+      }
+      else
+         return -1;
+      if (n != 0)
+         return -1;
+   }
+   if ((n < 0) || !has_s)
+      return -1;
+
+   /* The moment of Plücker coordinates is scaled with the direction. */
+   if (dq_load_unit( s, has_m ? s0 : NULL ) != 0)
+      return -1;
+   if (has_c)
+      vec3_cross( s0, c, s );
+   else if (!has_m)
+      memset( s0, 0, sizeof(s0) );
+   if (!(vec3_dot( s0, s0 ) < HUGE_VAL) ||
+         (fabs( vec3_dot( s, s0 ) ) > 1e-9 * (1. + vec3_norm( s0 ))))
+      return -1;
+   /* Drop the rounding left along the axis. */
+   d = vec3_dot( s, s0 );
+   for (n=0; n<3; n++)
+      s0[n] -= d * s[n];
+   dq_chain_set_axis( L->C, L->joints, type, s, s0 );
+
+   if (has_l) {
+      if (!(lim[0] <= lim[1]))
+         return -1;
+      dq_chain_set_limits( L->C, L->joints, lim[0], lim[1] );
+   }
+
+   /* Home pose, the offset then a rotation around an axis through it. */
+   if (has_t || has_r) {
+      dq_cr_translation_vector( T, has_t ? t : z );
+      memset( R, 0, sizeof(dq_t) );
+      R[0] = 1.;
+      if (has_r) {
+         if (dq_load_unit( &r[1], NULL ) != 0)
+            return -1;
+         dq_cr_rotation_plucker( R, r[0], &r[1], z );
+      }
+      dq_op_mul( M, T, R );
+      dq_chain_set_home( L->C, L->joints, M );
+   }
+   L->joints++;
+   return 0;
+}
+
+
+/**
+ * @brief Parses a line of a description.
+ *
+ *    @return 0 on success, -1 on error.
+ */
+static int dq_load_line( dq_load_t *L, const char *p )
+{
+   char w[16];
+   int n;
+
+   n = dq_load_word( &p, w, (int)sizeof(w) );
+   if (n <= 0)
+      return n;
+   if (L->joints < 0)
+      return (strcmp( w, "joints" ) == 0) ? dq_load_joints( L, p ) : -1;
+   if (strcmp( w, "revolute" ) == 0)
+      return dq_load_joint( L, p, DQ_JOINT_REVOLUTE );
+   if (strcmp( w, "prismatic" ) == 0)
+      return dq_load_joint( L, p, DQ_JOINT_PRISMATIC );
+   return -1;
+}
+
+
+/**
+ * @brief Checks the whole description was read, frees the chain on errors.
+ */
+static int dq_load_finish( dq_load_t *L, int ret, int l, int *line )
+{
+   /* Descriptions that end early fail after their last line. */
+   if ((ret == 0) && ((L->joints < 0) || (L->joints < L->C->n))) {
+      ret = -1;
+      l++;
+   }
+   if (ret != 0)
+      dq_chain_free( L->C );
+   if (line != NULL)
+      *line = (ret != 0) ? l : 0;
+   return ret;
+}
+
+
+DQ_API int dq_chain_load( dq_chain_t *C, FILE *fp, int *line )
+{
+   char buf[DQ_CHAIN_LINE];
+   dq_load_t L;
+   int l, ret;
+
+   memset( C, 0, sizeof(dq_chain_t) );
+   L.C      = C;
+   L.joints = -1;
+   ret      = 0;
+   l        = 0;
+   while ((ret == 0) && (fgets( buf, (int)sizeof(buf), fp ) != NULL)) {
+      l++;
+      /* Lines that do not fit are errors, not split in two. */
+      if ((strchr( buf, '\n' ) == NULL) && !feof( fp ))
+         ret = -1;
+      else
+         ret = dq_load_line( &L, buf );
+   }
+   if ((ret == 0) && ferror( fp ))
+      ret = -1;
+   return dq_load_finish( &L, ret, l, line );
+}
+
+
+DQ_API int dq_chain_parse( dq_chain_t *C, const char *str, int *line )
+{
+   char buf[DQ_CHAIN_LINE];
+   dq_load_t L;
+   size_t len;
+   int l, ret;
+
+   memset( C, 0, sizeof(dq_chain_t) );
+   L.C      = C;
+   L.joints = -1;
+   ret      = 0;
+   l        = 0;
+   while ((ret == 0) && (*str != '\0')) {
+      l++;
+      len = strcspn( str, "\n" );
+      /* Same limit as dq_chain_load, which also needs room for the newline. */
+      if (len >= sizeof(buf)-1) {
+         ret = -1;
+         break;
+      }
+      memcpy( buf, str, len );
+      buf[len] = '\0';
+      str     += len + (str[len] == '\n');
+      ret      = dq_load_line( &L, buf );
+   }
+   return dq_load_finish( &L, ret, l, line );
+}
+
+
+/**
+ * @brief Multiplies on the right by the rotation of a revolute joint.
+ *
+ * Same as dq_op_mul with the dual quaternion built by dq_cr_rotation_plucker,
+ *  whose dual scalar part is zero.
+ */
+static void dq_chain_revolute( dq_t P, const dq_joint_t *J, double theta )
+{
+   double q0, q1, q2, q3, q4, q5, q6, sn;
+   double p0, p1, p2, p3, p4, p5, p6, p7;
+
+   sn = sin( theta/2. );
+   q0 = cos( theta/2. );
+   q1 = sn*J->s[0];
+   q2 = sn*J->s[1];
+   q3 = sn*J->s[2];
+   q4 = sn*J->s0[0];
+   q5 = sn*J->s0[1];
+   q6 = sn*J->s0[2];
+   p0 = P[0]; p1 = P[1]; p2 = P[2]; p3 = P[3];
+   p4 = P[4]; p5 = P[5]; p6 = P[6]; p7 = P[7];
+
+   P[0] = p0*q0 - p1*q1 - p2*q2 - p3*q3;
+   P[1] = p0*q1 + p1*q0 + p2*q3 - p3*q2;
+   P[2] = p0*q2 + p2*q0 - p1*q3 + p3*q1;
+   P[3] = p0*q3 + p3*q0 + p1*q2 - p2*q1;
+   P[4] = p4*q0 + p0*q4 + p7*q1 - p6*q2 + p2*q6 + p5*q3 - p3*q5;
+   P[5] = p5*q0 + p0*q5 + p6*q1 - p1*q6 + p7*q2 - p4*q3 + p3*q4;
+   P[6] = p6*q0 + p0*q6 - p5*q1 + p1*q5 + p4*q2 - p2*q4 + p7*q3;
+   P[7] = p7*q0 - p1*q4 - p4*q1 - p2*q5 - p5*q2 - p3*q6 - p6*q3;
+}
+
+
+/**
+ * @brief Multiplies on the right by the translation of a prismatic joint.
+ *
+ * Same as dq_op_mul with the dual quaternion built by dq_cr_translation,
+ *  which only changes the dual part.
+ */
+static void dq_chain_prismatic( dq_t P, const dq_joint_t *J, double t )
+{
+   double v0, v1, v2;
+
+   v0 = t*J->s[0] / 2.;
+   v1 = t*J->s[1] / 2.;
+   v2 = t*J->s[2] / 2.;
+
+   P[4] += P[0]*v0 + P[2]*v2 - P[3]*v1;
+   P[5] += P[0]*v1 - P[1]*v2 + P[3]*v0;
+   P[6] += P[0]*v2 + P[1]*v1 - P[2]*v0;
+   P[7] -= P[1]*v0 + P[2]*v1 + P[3]*v2;
+}
+
+
+/**
+ * @brief Computes the links from "from" to "to" continuing the product of the previous joints.
+ *
+ *    @param[in] C Chain to compute.
+ *    @param[in] q Value of each joint.
+ *    @param[in] from First link to compute.
+ *    @param[in] to Last link to compute.
+ *    @param P Product of the joints before from, the identity if from is 0.
+ *             Overwritten with the product up to to.
+ *    @param[out] prefix Products of the joints up to each link or NULL.
+ *    @param[out] out Pose of each link.
+ */
+static void dq_chain_eval( const dq_chain_t *C, const double *q, int from, int to,
+      dq_t P, dq_t *prefix, dq_t *out )
+{
+   int i;
+
+   for (i=from; i<=to; i++) {
+      if (C->joint[i].type == DQ_JOINT_REVOLUTE)
+         dq_chain_revolute( P, &C->joint[i], q[i] );
+      else
+         dq_chain_prismatic( P, &C->joint[i], q[i] );
+
+      if (prefix != NULL)
+         memcpy( prefix[i], P, sizeof(dq_t) );
+      if (C->has_home)
+         dq_op_mul( out[i], P, C->home[i] );
+      else if (out != prefix)
+         memcpy( out[i], P, sizeof(dq_t) );
+   }
+}
+
+
+DQ_API void dq_chain_fk( const dq_chain_t *C, const double *q, dq_t *out )
+{
+   dq_t P;
+
+   memset( P, 0, sizeof(dq_t) );
+   P[0] = 1.;
+   dq_chain_eval( C, q, 0, C->n-1, P, NULL, out );
+}
+
+
+/**
+ * Configurations computed together by dq_chain_fk_batch, one per SIMD lane.
+ */
+#define DQ_CHAIN_LANES     8
+/**
+ * Minimum number of configurations per thread for dq_chain_fk_batch to use threads.
+ */
+#define DQ_BATCH_THREADED  1024
+
+
+/**
+ * @brief Computes the tip pose of up to DQ_CHAIN_LANES configurations at once.
+ *
+ * The running products are kept as a structure of arrays, P[k][l] is
+ *  component k of configuration l, and every joint is applied to all the
+ *  lanes with the same operations so the compiler vectorizes across
+ *  configurations. Unused lanes compute the zero configuration.
+ */
+static void dq_chain_fk_lanes( const dq_chain_t *C, const double *q, dq_t *out, int m )
+{
+   double P[8][DQ_CHAIN_LANES], h[DQ_CHAIN_LANES], sn[DQ_CHAIN_LANES], cs[DQ_CHAIN_LANES];
+   double q0, q1, q2, q3, q4, q5, q6, q7;
+   double p0, p1, p2, p3, p4, p5, p6, p7;
+   double v0, v1, v2;
+   const dq_joint_t *J;
+   const double *H;
+   int i, k, l, n;
+
+   n = C->n;
+   for (k=0; k<8; k++)
+      for (l=0; l<DQ_CHAIN_LANES; l++)
+         P[k][l] = (k == 0) ? 1. : 0.;
+
+   for (i=0; i<n; i++) {
+      J = &C->joint[i];
+      for (l=0; l<DQ_CHAIN_LANES; l++)
+         sn[l] = (l < m) ? q[l*n+i] : 0.;
+
+      if (J->type == DQ_JOINT_REVOLUTE) {
+         for (l=0; l<DQ_CHAIN_LANES; l++)
+            h[l] = sn[l] / 2.;
+         dq_sincos_n( sn, cs, h, DQ_CHAIN_LANES );
+         /* Same products as dq_chain_revolute. */
+         for (l=0; l<DQ_CHAIN_LANES; l++) {
+            q0 = cs[l];
+            q1 = sn[l]*J->s[0];
+            q2 = sn[l]*J->s[1];
+            q3 = sn[l]*J->s[2];
+            q4 = sn[l]*J->s0[0];
+            q5 = sn[l]*J->s0[1];
+            q6 = sn[l]*J->s0[2];
+            p0 = P[0][l]; p1 = P[1][l]; p2 = P[2][l]; p3 = P[3][l];
+            p4 = P[4][l]; p5 = P[5][l]; p6 = P[6][l]; p7 = P[7][l];
+            P[0][l] = p0*q0 - p1*q1 - p2*q2 - p3*q3;
+            P[1][l] = p0*q1 + p1*q0 + p2*q3 - p3*q2;
+            P[2][l] = p0*q2 + p2*q0 - p1*q3 + p3*q1;
+            P[3][l] = p0*q3 + p3*q0 + p1*q2 - p2*q1;
+            P[4][l] = p4*q0 + p0*q4 + p7*q1 - p6*q2 + p2*q6 + p5*q3 - p3*q5;
+            P[5][l] = p5*q0 + p0*q5 + p6*q1 - p1*q6 + p7*q2 - p4*q3 + p3*q4;
+            P[6][l] = p6*q0 + p0*q6 - p5*q1 + p1*q5 + p4*q2 - p2*q4 + p7*q3;
+            P[7][l] = p7*q0 - p1*q4 - p4*q1 - p2*q5 - p5*q2 - p3*q6 - p6*q3;
+         }
+      }
+      else {
+         /* Same products as dq_chain_prismatic. */
+         for (l=0; l<DQ_CHAIN_LANES; l++) {
+            v0 = sn[l]*J->s[0] / 2.;
+            v1 = sn[l]*J->s[1] / 2.;
+            v2 = sn[l]*J->s[2] / 2.;
+            P[4][l] += P[0][l]*v0 + P[2][l]*v2 - P[3][l]*v1;
+            P[5][l] += P[0][l]*v1 - P[1][l]*v2 + P[3][l]*v0;
+            P[6][l] += P[0][l]*v2 + P[1][l]*v1 - P[2][l]*v0;
+            P[7][l] -= P[1][l]*v0 + P[2][l]*v1 + P[3][l]*v2;
+         }
+      }
+   }
+
+   /* Home pose of the tip, the same for all the lanes. */
+   if (C->has_home) {
+      H  = C->home[n-1];
+      q0 = H[0]; q1 = H[1]; q2 = H[2]; q3 = H[3];
+      q4 = H[4]; q5 = H[5]; q6 = H[6]; q7 = H[7];
+      for (l=0; l<DQ_CHAIN_LANES; l++) {
+         p0 = P[0][l]; p1 = P[1][l]; p2 = P[2][l]; p3 = P[3][l];
+         p4 = P[4][l]; p5 = P[5][l]; p6 = P[6][l]; p7 = P[7][l];
+         P[0][l] = p0*q0 - p1*q1 - p2*q2 - p3*q3;
+         P[1][l] = p0*q1 + p1*q0 + p2*q3 - p3*q2;
+         P[2][l] = p0*q2 + p2*q0 - p1*q3 + p3*q1;
+         P[3][l] = p0*q3 + p3*q0 + p1*q2 - p2*q1;
+         P[4][l] = p4*q0 + p0*q4 + p7*q1 - p6*q2 + p2*q6 + p5*q3 - p3*q5 + p1*q7;
+         P[5][l] = p5*q0 + p0*q5 + p6*q1 - p1*q6 + p7*q2 - p4*q3 + p3*q4 + p2*q7;
+         P[6][l] = p6*q0 + p0*q6 - p5*q1 + p1*q5 + p4*q2 - p2*q4 + p7*q3 + p3*q7;
+         P[7][l] = p7*q0 - p1*q4 - p4*q1 - p2*q5 - p5*q2 - p3*q6 - p6*q3 + p0*q7;
+      }
+   }
+
+   for (l=0; l<m; l++)
+      for (k=0; k<8; k++)
+         out[l][k] = P[k][l];
+}
+
+
+/**
+ * @brief Configurations computed by each thread of dq_chain_fk_batch.
+ */
+typedef struct dq_batch_task_s {
+   const dq_chain_t *C;       /**< Chain to compute. */
+   const double *q;           /**< Joint values of each configuration. */
+   dq_t *out;                 /**< Pose of the tip for each configuration. */
+   int n;                     /**< Number of configurations. */
+   int count;                 /**< Number of blocks. */
+} dq_batch_task_t;
+
+
+static void dq_batch_thread( void *data, int i )
+{
+   dq_batch_task_t *task = data;
+   int j, start, end, dof;
+
+   /* Blocks of whole lane groups, the first ones get one more group. */
+   j     = (task->n + DQ_CHAIN_LANES-1) / DQ_CHAIN_LANES;
+   start = (i*(j / task->count) + MIN( i, j % task->count )) * DQ_CHAIN_LANES;
+   end   = start + (j / task->count + ((i < j % task->count) ? 1 : 0)) * DQ_CHAIN_LANES;
+   end   = MIN( end, task->n );
+   dof   = task->C->n;
+   for (j=start; j<end; j+=DQ_CHAIN_LANES)
+      dq_chain_fk_lanes( task->C, &task->q[(size_t)j*(size_t)dof], &task->out[j],
+            MIN( DQ_CHAIN_LANES, end-j ) );
+}
+
+
+DQ_API void dq_chain_fk_batch( const dq_chain_t *C, const double *q, dq_t *out, int n )
+{
+   dq_batch_task_t task;
+
+#ifdef DQ_CHECK
+   assert( n >= 0 );
+#endif /* DQ_CHECK */
+
+   if (C->n == 0) {
+      for (task.n=0; task.n<n; task.n++) {
+         memset( out[task.n], 0, sizeof(dq_t) );
+         out[task.n][0] = 1.;
+      }
+      return;
+   }
+
+   task.C     = C;
+   task.q     = q;
+   task.out   = out;
+   task.n     = n;
+   task.count = MIN( dq_threads_get(), n / DQ_BATCH_THREADED );
+   if (task.count <= 1) {
+      task.count = 1;
+      dq_batch_thread( &task, 0 );
+      return;
+   }
+   dq_thread_run( dq_batch_thread, &task, task.count );
+}
+
+
+DQ_API void dq_chain_set_joint( dq_chain_t *C, int i, double q )
+{
+#ifdef DQ_CHECK
+   assert( (i >= 0) && (i < C->n) );
+#endif /* DQ_CHECK */
+
+   if (C->q[i] == q)
+      return;
+   C->q[i]  = q;
+   C->dirty = MIN( C->dirty, i );
+}
+
+
+DQ_API void dq_chain_set_joints( dq_chain_t *C, const double *q )
+{
+   int i;
+   for (i=0; i<C->n; i++)
+      dq_chain_set_joint( C, i, q[i] );
+}
+
+
+/**
+ * @brief Brings the cached links up to date up to link i.
+ */
+static void dq_chain_update( dq_chain_t *C, int i )
+{
+   dq_t P;
+   int from;
+
+   from = C->dirty;
+   C->stats.evaluations++;
+   if (from > i) {
+      C->stats.saved += (unsigned long)(i+1);
+      return;
+   }
+
+   if (from == 0) {
+      memset( P, 0, sizeof(dq_t) );
+      P[0] = 1.;
+   }
+   else
+      memcpy( P, C->prefix[from-1], sizeof(dq_t) );
+   /* Without home poses the links are the products. */
+   dq_chain_eval( C, C->q, from, i, P, C->prefix, C->has_home ? C->link : C->prefix );
+
+   C->dirty           = i+1;
+   C->stats.computed += (unsigned long)(i+1-from);
+   C->stats.saved    += (unsigned long)from;
+}
+
+
+DQ_API void dq_chain_link( dq_chain_t *C, int i, dq_t O )
+{
+#ifdef DQ_CHECK
+   assert( (i >= 0) && (i < C->n) );
+#endif /* DQ_CHECK */
+
+   dq_chain_update( C, i );
+   memcpy( O, C->has_home ? C->link[i] : C->prefix[i], sizeof(dq_t) );
+}
+
+
+DQ_API dq_t *dq_chain_links( dq_chain_t *C )
+{
+   dq_chain_update( C, C->n-1 );
+   return C->has_home ? C->link : C->prefix;
+}
+
+
+DQ_API void dq_chain_jacobian( dq_chain_t *C, double *J, int ld, int flags )
+{
+   dq_t L, S;
+   double R[3][3], p[3], col[6];
+   int i, k, rs, cs;
+
+   if (C->n == 0)
+      return;
+   dq_chain_update( C, C->n-1 );
+
+   /* Strides between rows and columns. */
+   if (flags & DQ_MATRIX_COL_MAJOR) {
+      rs = 1;
+      cs = (ld > 0) ? ld : 6;
+   }
+   else {
+      rs = (ld > 0) ? ld : C->n;
+      cs = 1;
+   }
+   if (flags & DQ_JACOBIAN_TIP)
+      dq_op_extract( R, p, C->has_home ? C->link[C->n-1] : C->prefix[C->n-1] );
+
+   for (i=0; i<C->n; i++) {
+      /* The joint does not move its own axis, so the product up to and
+       * including it can be used. */
+      dq_cr_line_plucker( L, C->joint[i].s, C->joint[i].s0 );
+      dq_op_f2g( S, C->prefix[i], L );
+      if (C->joint[i].type == DQ_JOINT_REVOLUTE) {
+         col[0] = S[4];
+         col[1] = S[5];
+         col[2] = S[6];
+         if (flags & DQ_JACOBIAN_TIP) {
+            col[0] += S[2]*p[2] - S[3]*p[1];
+            col[1] += S[3]*p[0] - S[1]*p[2];
+            col[2] += S[1]*p[1] - S[2]*p[0];
+         }
+         col[3] = S[1];
+         col[4] = S[2];
+         col[5] = S[3];
+      }
+      else {
+         col[0] = S[1];
+         col[1] = S[2];
+         col[2] = S[3];
+         col[3] = col[4] = col[5] = 0.;
+      }
+      for (k=0; k<6; k++)
+         J[ k*rs + i*cs ] = col[k];
+   }
+}
+
+
+DQ_API void dq_chain_ik_init( dq_chain_ik_t *P )
+{
+   P->max_iter   = 100;
+   P->tol        = 1e-9;
+   P->lambda     = 1e-2;
+   P->weight     = 1.;
+   P->iterations = 0;
+   P->residual   = 0.;
+}
+
+
+/**
+ * @brief Computes the error between a target pose and the pose of the tip.
+ *
+ * The error is the translation between both origins and the rotation vector
+ *  taking the tip to the target, both in the base frame, so it matches the
+ *  columns of the Jacobian with DQ_JACOBIAN_TIP.
+ *
+ *    @param[out] e Error, translation in 0 to 2 and rotation in 3 to 5.
+ *    @param[in] T Target pose.
+ *    @param[in] L Pose of the tip.
+ *    @param[in] w Weight of the rotation.
+ *    @return Norm of the error.
+ */
+static double dq_chain_ik_error( double e[6], const dq_t T, const dq_t L, double w )
+{
+   double pt[3], pl[3], s, v[3], nv, a;
+   int i;
+
+   /* Same displacement formula as dq_op_extract. */
+   pt[0] = 2.*( T[0]*T[4] - T[1]*T[7] + T[2]*T[6] - T[3]*T[5] );
+   pt[1] = 2.*( T[0]*T[5] - T[2]*T[7] - T[1]*T[6] + T[3]*T[4] );
+   pt[2] = 2.*( T[0]*T[6] - T[3]*T[7] + T[1]*T[5] - T[2]*T[4] );
+   pl[0] = 2.*( L[0]*L[4] - L[1]*L[7] + L[2]*L[6] - L[3]*L[5] );
+   pl[1] = 2.*( L[0]*L[5] - L[2]*L[7] - L[1]*L[6] + L[3]*L[4] );
+   pl[2] = 2.*( L[0]*L[6] - L[3]*L[7] + L[1]*L[5] - L[2]*L[4] );
+
+   /* Rotation quaternion of T L*, taking the shortest way. */
+   s    = T[0]*L[0] + T[1]*L[1] + T[2]*L[2] + T[3]*L[3];
+   v[0] = L[0]*T[1] - T[0]*L[1] - (T[2]*L[3] - T[3]*L[2]);
+   v[1] = L[0]*T[2] - T[0]*L[2] - (T[3]*L[1] - T[1]*L[3]);
+   v[2] = L[0]*T[3] - T[0]*L[3] - (T[1]*L[2] - T[2]*L[1]);
+   if (s < 0.) {
+      s = -s;
+      vec3_sign( v );
+   }
+   nv = vec3_norm( v );
+   /* Logarithm, the angle over the sine of half of it tends to 2. */
+   a  = (nv > DQ_PRECISION) ? 2.*atan2( nv, s ) / nv : 2.;
+
+   for (i=0; i<3; i++) {
+      e[i]   = pt[i] - pl[i];
+      e[3+i] = w*a*v[i];
+   }
+   return sqrt( e[0]*e[0] + e[1]*e[1] + e[2]*e[2] + e[3]*e[3] + e[4]*e[4] + e[5]*e[5] );
+}
+
+
+/**
+ * @brief Solves the symmetric positive definite system A x = b in place with Cholesky.
+ *
+ *    @param A Matrix, overwritten with its factor.
+ *    @param b Right hand side, overwritten with the solution.
+ *    @return 0 on success, -1 if A is not positive definite.
+ */
+static int dq_chain_ik_solve( double A[6][6], double b[6] )
+{
+   double t;
+   int i, j, k;
+
+   for (j=0; j<6; j++) {
+      t = A[j][j];
+      for (k=0; k<j; k++)
+         t -= A[j][k]*A[j][k];
+      if (t <= 0.)
+         return -1;
+      A[j][j] = sqrt( t );
+      for (i=j+1; i<6; i++) {
+         t = A[i][j];
+         for (k=0; k<j; k++)
+            t -= A[i][k]*A[j][k];
+         A[i][j] = t / A[j][j];
+      }
+   }
+   for (i=0; i<6; i++) {
+      for (k=0; k<i; k++)
+         b[i] -= A[i][k]*b[k];
+      b[i] /= A[i][i];
+   }
+   for (i=5; i>=0; i--) {
+      for (k=i+1; k<6; k++)
+         b[i] -= A[k][i]*b[k];
+      b[i] /= A[i][i];
+   }
+   return 0;
+}
+
+
+DQ_API int dq_chain_ik( dq_chain_t *C, const dq_t T, dq_chain_ik_t *P )
+{
+   double e[6], et[6], y[6], A[6][6], JJ[6][6];
+   double *J, *q, mu, nu, r, rt, rho, t;
+   dq_t L;
+   int i, j, k, l, n, fresh;
+
+   n = C->n;
+   J = C->work;
+   q = &J[6*n];
+
+   /* An empty chain has nothing to move, its tip is the base frame. */
+   if (n == 0) {
+      memset( e, 0, sizeof(e) );
+      dq_cr_translation_vector( L, e );
+      P->iterations = 0;
+      P->residual   = dq_chain_ik_error( e, T, L, P->weight );
+      return (P->residual <= P->tol) ? 0 : -1;
+   }
+
+   dq_chain_link( C, n-1, L );
+   r     = dq_chain_ik_error( e, T, L, P->weight );
+   mu    = P->lambda*P->lambda;
+   nu    = 2.;
+   fresh = 0;
+   for (k=0; (k < P->max_iter) && (r > P->tol); k++) {
+      /* The Jacobian only changes when a step is taken. */
+      if (!fresh) {
+         dq_chain_jacobian( C, J, 0, DQ_MATRIX_ROW_MAJOR | DQ_JACOBIAN_TIP );
+         for (l=3*n; l<6*n; l++)
+            J[l] *= P->weight;
+         for (i=0; i<6; i++) {
+            for (j=0; j<=i; j++) {
+               t = 0.;
+               for (l=0; l<n; l++)
+                  t += J[n*i+l]*J[n*j+l];
+               JJ[i][j] = JJ[j][i] = t;
+            }
+         }
+         fresh = 1;
+      }
+
+      /* Damped least squares step dq = J^T (J J^T + mu I)^-1 e. */
+      memcpy( A, JJ, sizeof(A) );
+      for (i=0; i<6; i++)
+         A[i][i] += mu;
+      memcpy( y, e, sizeof(y) );
+      rho = -1.;
+      if (dq_chain_ik_solve( A, y ) == 0) {
+         memcpy( q, C->q, sizeof(double)*(size_t)n );
+         for (j=0; j<n; j++)
+            dq_chain_set_joint( C, j, q[j] + J[j]*y[0] + J[n+j]*y[1] + J[2*n+j]*y[2] +
+                  J[3*n+j]*y[3] + J[4*n+j]*y[4] + J[5*n+j]*y[5] );
+         dq_chain_link( C, n-1, L );
+         rt = dq_chain_ik_error( et, T, L, P->weight );
+         /* Compare with the reduction predicted by the linearization, whose
+          * remaining error is e - J dq = mu y. */
+         t = r*r - mu*mu*(y[0]*y[0] + y[1]*y[1] + y[2]*y[2] + y[3]*y[3] + y[4]*y[4] + y[5]*y[5]);
+         if (t > 0.)
+            rho = (r*r - rt*rt) / t;
+         if (rho <= 0.)
+            dq_chain_set_joints( C, q );
+      }
+
+      /* Trust the linearization more the better it predicted the step. */
+      if (rho > 0.) {
+         memcpy( e, et, sizeof(e) );
+         r     = rt;
+         fresh = 0;
+         t     = 2.*rho - 1.;
+         mu   *= MAX( 1./3., 1. - t*t*t );
+         mu    = MAX( mu, DQ_IK_LAMBDA_MIN*DQ_IK_LAMBDA_MIN );
+         nu    = 2.;
+      }
+      else {
+         mu *= nu;
+         nu *= 2.;
+         if (mu > DQ_IK_LAMBDA_MAX*DQ_IK_LAMBDA_MAX) {
+            k++;
+            break;
+         }
+      }
+   }
+
+   P->iterations = k;
+   P->residual   = r;
+   return (r <= P->tol) ? 0 : -1;
+}
+
+
+DQ_API void dq_chain_synth_init( dq_chain_synth_t *P )
+{
+   P->restarts   = 64;
+   P->max_iter   = 200;
+   P->tol        = 1e-8;
+   P->scale      = 1.;
+   P->weight     = 1.;
+   P->seed       = 0;
+   P->best       = -1;
+   P->iterations = 0;
+   P->residual   = 0.;
+}
+
+
+/**
+ * @brief Work space of a thread of dq_chain_synth.
+ *
+ * The parameters of a fit are, for each joint, a direction v and a point c
+ *  of its axis, then the value of every joint for each target.
+ */
+typedef struct dq_synth_work_s {
+   dq_chain_t C;        /**< Chain the thread evaluates. */
+   dq_t *L;             /**< Links computed by the forward kinematics. */
+   double *x;           /**< Current parameters. */
+   double *xt;          /**< Trial parameters. */
+   double *xb;          /**< Best parameters found by the thread. */
+   double *e;           /**< Error of the current parameters. */
+   double *et;          /**< Error of the trial parameters. */
+   double *J;           /**< Jacobian of the error, row-major. */
+   double *A;           /**< Damped normal equations. */
+   double *g;           /**< Gradient, J^T e. */
+   double *d;           /**< Step. */
+   unsigned long rng;   /**< State of the random number generator. */
+   double fb;           /**< Squared error of the best parameters. */
+   int best;            /**< Restart of the best parameters, -1 if none. */
+   int iterations;      /**< Steps taken by the best restart. */
+} dq_synth_work_t;
+
+
+/**
+ * @brief Restarts computed by each thread of dq_chain_synth.
+ */
+typedef struct dq_synth_task_s {
+   const dq_chain_t *C;       /**< Chain with the joint types. */
+   dq_t *D;                   /**< Target displacements. */
+   int m;                     /**< Number of targets. */
+   int p;                     /**< Number of parameters. */
+   const dq_chain_synth_t *P; /**< Parameters of the solver. */
+   int count;                 /**< Number of threads. */
+   dq_synth_work_t W[ DQ_THREADS_MAX ]; /**< Work space of each thread. */
+} dq_synth_task_t;
+
+
+/**
+ * @brief Mixes a seed into the 32 bit state of a random number generator (lowbias32).
+ */
+static unsigned long dq_synth_seed( unsigned long x )
+{
+   x &= 0xFFFFFFFFUL;
+   x ^= x >> 16;
+   x  = (x * 0x7FEB352DUL) & 0xFFFFFFFFUL;
+   x ^= x >> 15;
+   x  = (x * 0x846CA68BUL) & 0xFFFFFFFFUL;
+   x ^= x >> 16;
+   return (x != 0) ? x : 1;
+}
+
+
+/**
+ * @brief Generates a random value in [0,1) with xorshift32.
+ */
+static double dq_synth_rnd( unsigned long *state )
+{
+   unsigned long x = *state;
+   x ^= (x << 13) & 0xFFFFFFFFUL;
+   x ^= x >> 17;
+   x ^= (x << 5) & 0xFFFFFFFFUL;
+   *state = x;
+   return (double)x / 4294967296.;
+}
+
+
+/**
+ * @brief Sets the axes of the chain of a thread from the parameters.
+ *
+ *    @return 0 on success, -1 if a direction is degenerate.
+ */
+static int dq_synth_axes( dq_synth_task_t *task, dq_synth_work_t *W, const double *x )
+{
+   double s[3], s0[3], nv;
+   int i;
+
+   for (i=0; i<task->C->n; i++) {
+      nv = vec3_norm( &x[6*i] );
+      if (!(nv > DQ_PRECISION))
+         return -1;
+      s[0] = x[6*i+0] / nv;
+      s[1] = x[6*i+1] / nv;
+      s[2] = x[6*i+2] / nv;
+      vec3_cross( s0, &x[6*i+3], s );
+      dq_chain_set_axis( &W->C, i, task->C->joint[i].type, s, s0 );
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Computes the error of target k for the current axes.
+ */
+static double dq_synth_target( dq_synth_task_t *task, dq_synth_work_t *W,
+      const double *x, int k, double e[6] )
+{
+   int n = task->C->n;
+   dq_chain_fk( &W->C, &x[6*n + k*n], W->L );
+   return dq_chain_ik_error( e, task->D[k], W->L[n-1], task->P->weight );
+}
+
+
+/**
+ * @brief Computes the error of all the targets.
+ *
+ *    @return Squared norm of the error, HUGE_VAL if the parameters are not valid.
+ */
+static double dq_synth_eval( dq_synth_task_t *task, dq_synth_work_t *W, const double *x, double *e )
+{
+   double f, r;
+   int k;
+
+   if (dq_synth_axes( task, W, x ) != 0)
+      return HUGE_VAL;
+   f = 0.;
+   for (k=0; k<task->m; k++) {
+      r  = dq_synth_target( task, W, x, k, &e[6*k] );
+      f += r*r;
+   }
+   return f;
+}
+
+
+/**
+ * @brief Computes the Jacobian of the error by forward differences.
+ *
+ * The value of a joint for a target only changes the error of that target.
+ */
+static void dq_synth_jacobian( dq_synth_task_t *task, dq_synth_work_t *W )
+{
+   double h, *J;
+   int i, j, k, r, n, p, rows;
+
+   n    = task->C->n;
+   p    = task->p;
+   rows = 6*task->m;
+   J    = W->J;
+   memset( J, 0, sizeof(double)*(size_t)(rows*p) );
+
+   memcpy( W->xt, W->x, sizeof(double)*(size_t)p );
+   for (j=0; j<6*n; j++) {
+      h = 1e-7 * MAX( 1., fabs(W->x[j]) );
+      W->xt[j] = W->x[j] + h;
+      if (dq_synth_eval( task, W, W->xt, W->et ) < HUGE_VAL)
+         for (r=0; r<rows; r++)
+            J[r*p+j] = (W->et[r] - W->e[r]) / h;
+      W->xt[j] = W->x[j];
+   }
+
+   dq_synth_axes( task, W, W->x );
+   for (k=0; k<task->m; k++) {
+      for (i=0; i<n; i++) {
+         j = 6*n + k*n + i;
+         h = 1e-7 * MAX( 1., fabs(W->x[j]) );
+         W->xt[j] = W->x[j] + h;
+         dq_synth_target( task, W, W->xt, k, W->et );
+         for (r=0; r<6; r++)
+            J[(6*k+r)*p+j] = (W->et[r] - W->e[6*k+r]) / h;
+         W->xt[j] = W->x[j];
+      }
+   }
+}
+
+
+/**
+ * @brief Solves the symmetric positive definite system A x = b of size p in place with Cholesky.
+ *
+ *    @return 0 on success, -1 if A is not positive definite.
+ */
+static int dq_synth_solve( double *A, double *b, int p )
+{
+   double t;
+   int i, j, k;
+
+   for (j=0; j<p; j++) {
+      t = A[j*p+j];
+      for (k=0; k<j; k++)
+         t -= A[j*p+k]*A[j*p+k];
+      if (!(t > 0.))
+         return -1;
+      A[j*p+j] = sqrt( t );
+      for (i=j+1; i<p; i++) {
+         t = A[i*p+j];
+         for (k=0; k<j; k++)
+            t -= A[i*p+k]*A[j*p+k];
+         A[i*p+j] = t / A[j*p+j];
+      }
+   }
+   for (i=0; i<p; i++) {
+      for (k=0; k<i; k++)
+         b[i] -= A[i*p+k]*b[k];
+      b[i] /= A[i*p+i];
+   }
+   for (i=p-1; i>=0; i--) {
+      for (k=i+1; k<p; k++)
+         b[i] -= A[k*p+i]*b[k];
+      b[i] /= A[i*p+i];
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Fits the parameters from a random starting point with Levenberg-Marquardt.
+ *
+ *    @return Number of steps tried.
+ */
+static int dq_synth_restart( dq_synth_task_t *task, dq_synth_work_t *W, double *f )
+{
+   const dq_chain_synth_t *P = task->P;
+   double mu, nu, ft, rho, pred, t, *JJ;
+   int i, j, k, r, n, p, rows, fresh;
+
+   n    = task->C->n;
+   p    = task->p;
+   rows = 6*task->m;
+   JJ   = W->A;
+
+   /* Axes through the region of the mechanism and joints over their range. */
+   for (i=0; i<n; i++) {
+      for (j=0; j<3; j++) {
+         W->x[6*i+j]   = 2.*dq_synth_rnd( &W->rng ) - 1.;
+         W->x[6*i+3+j] = P->scale * (2.*dq_synth_rnd( &W->rng ) - 1.);
+      }
+   }
+   for (k=0; k<task->m; k++) {
+      for (i=0; i<n; i++) {
+         t = 2.*dq_synth_rnd( &W->rng ) - 1.;
+         W->x[6*n+k*n+i] = (task->C->joint[i].type == DQ_JOINT_REVOLUTE) ? DQ_PI*t : P->scale*t;
+      }
+   }
+
+   *f    = dq_synth_eval( task, W, W->x, W->e );
+   mu    = -1.;
+   nu    = 2.;
+   fresh = 0;
+   for (k=0; (k < P->max_iter) && (*f < HUGE_VAL) && (sqrt(*f) > P->tol); k++) {
+      if (!fresh) {
+         dq_synth_jacobian( task, W );
+         fresh = 1;
+      }
+
+      /* Damped normal equations (J^T J + mu I) d = -J^T e, rebuilt every time
+       * as the factorization overwrites them. */
+      for (i=0; i<p; i++) {
+         for (j=0; j<=i; j++) {
+            t = 0.;
+            for (r=0; r<rows; r++)
+               t += W->J[r*p+i]*W->J[r*p+j];
+            JJ[i*p+j] = JJ[j*p+i] = t;
+         }
+         t = 0.;
+         for (r=0; r<rows; r++)
+            t += W->J[r*p+i]*W->e[r];
+         W->g[i] = t;
+      }
+      if (mu < 0.) {
+         mu = 0.;
+         for (i=0; i<p; i++)
+            mu = MAX( mu, JJ[i*p+i] );
+         mu = MAX( 1e-3*mu, DQ_IK_LAMBDA_MIN*DQ_IK_LAMBDA_MIN );
+      }
+      for (i=0; i<p; i++) {
+         JJ[i*p+i] += mu;
+         W->d[i]    = -W->g[i];
+      }
+
+      rho = -1.;
+      if (dq_synth_solve( JJ, W->d, p ) == 0) {
+         pred = 0.;
+         for (i=0; i<p; i++) {
+            W->xt[i] = W->x[i] + W->d[i];
+            pred    += W->d[i]*(mu*W->d[i] - W->g[i]);
+         }
+         ft = dq_synth_eval( task, W, W->xt, W->et );
+         if ((ft < HUGE_VAL) && (pred > 0.))
+            rho = (*f - ft) / pred;
+      }
+
+      /* Same damping update as dq_chain_ik. */
+      if (rho > 0.) {
+         memcpy( W->x, W->xt, sizeof(double)*(size_t)p );
+         memcpy( W->e, W->et, sizeof(double)*(size_t)rows );
+         *f    = ft;
+         fresh = 0;
+         t     = 2.*rho - 1.;
+         mu   *= MAX( 1./3., 1. - t*t*t );
+         mu    = MAX( mu, DQ_IK_LAMBDA_MIN*DQ_IK_LAMBDA_MIN );
+         nu    = 2.;
+      }
+      else {
+         mu *= nu;
+         nu *= 2.;
+         if (mu > DQ_IK_LAMBDA_MAX*DQ_IK_LAMBDA_MAX) {
+            k++;
+            break;
+         }
+      }
+   }
+   return k;
+}
+
+
+static void dq_synth_thread( void *data, int i )
+{
+   dq_synth_task_t *task = data;
+   dq_synth_work_t *W = &task->W[i];
+   double f;
+   int r, k;
+
+   /* Each restart is seeded on its own so the result does not depend on the
+    * number of threads. */
+   for (r=i; r<task->P->restarts; r+=task->count) {
+      W->rng = dq_synth_seed( task->P->seed + 0x9E3779B9UL*(unsigned long)(r+1) );
+      k      = dq_synth_restart( task, W, &f );
+      if ((W->best < 0) || (f < W->fb)) {
+         memcpy( W->xb, W->x, sizeof(double)*(size_t)task->p );
+         W->fb         = f;
+         W->best       = r;
+         W->iterations = k;
+      }
+   }
+}
+
+
+DQ_API int dq_chain_synth( dq_chain_t *C, dq_t *D, int m, double *q, dq_chain_synth_t *P )
+{
+   dq_synth_task_t task;
+   dq_synth_work_t *W, *B;
+   double s[3], s0[3], nv;
+   size_t size;
+   int i, n, p, rows, ret;
+
+   /* Nothing to fit, no restart would leave a best fit to copy. */
+   if ((m <= 0) || (C->n <= 0) || (P->restarts <= 0))
+      return -1;
+
+   n    = C->n;
+   p    = 6*n + n*m;
+   rows = 6*m;
+   task.C     = C;
+   task.D     = D;
+   task.m     = m;
+   task.p     = p;
+   task.P     = P;
+   task.count = MIN( dq_threads_get(), P->restarts );
+   P->best       = -1;
+   P->iterations = 0;
+   P->residual   = HUGE_VAL;
+
+   /* All the memory of a thread in one block, links first for alignment. */
+   ret  = 0;
+   size = sizeof(dq_t)*(size_t)n + sizeof(double)*(size_t)(5*p + 2*rows + rows*p + p*p);
+   for (i=0; i<task.count; i++) {
+      W       = &task.W[i];
+      W->L    = malloc( size );
+      W->best = -1;
+      if ((W->L == NULL) || (dq_chain_create( &W->C, n ) != 0)) {
+         free( W->L );
+         W->L = NULL;
+         ret  = -1;
+         continue;
+      }
+      W->x  = (double*) &W->L[n];
+      W->xt = &W->x[p];
+      W->xb = &W->xt[p];
+      W->g  = &W->xb[p];
+      W->d  = &W->g[p];
+      W->e  = &W->d[p];
+      W->et = &W->e[rows];
+      W->J  = &W->et[rows];
+      W->A  = &W->J[rows*p];
+   }
+   if (ret != 0) {
+      for (i=0; i<task.count; i++) {
+         if (task.W[i].L != NULL) {
+            dq_chain_free( &task.W[i].C );
+            free( task.W[i].L );
+         }
+      }
+      return -1;
+   }
+
+   dq_thread_run( dq_synth_thread, &task, task.count );
+
+   /* Best fit over the threads, the first restart wins ties. */
+   B = NULL;
+   for (i=0; i<task.count; i++) {
+      W = &task.W[i];
+      if ((W->best >= 0) && ((B == NULL) || (W->fb < B->fb) ||
+               ((W->fb == B->fb) && (W->best < B->best))))
+         B = W;
+   }
+   for (i=0; i<n; i++) {
+      nv = vec3_norm( &B->xb[6*i] );
+      if (!(nv > DQ_PRECISION))
+         continue;
+      s[0] = B->xb[6*i+0] / nv;
+      s[1] = B->xb[6*i+1] / nv;
+      s[2] = B->xb[6*i+2] / nv;
+      vec3_cross( s0, &B->xb[6*i+3], s );
+      dq_chain_set_axis( C, i, C->joint[i].type, s, s0 );
+   }
+   if (q != NULL)
+      memcpy( q, &B->xb[6*n], sizeof(double)*(size_t)(n*m) );
+   P->best       = B->best;
+   P->iterations = B->iterations;
+   P->residual   = sqrt( B->fb );
+
+   for (i=0; i<task.count; i++) {
+      dq_chain_free( &task.W[i].C );
+      free( task.W[i].L );
+   }
+   return (P->residual <= P->tol) ? 0 : -1;
+}
+
+
+DQ_API int dq_chain_grid_create( dq_chain_grid_t *G, const double min[3], const double max[3],
+      double voxel, int slices )
+{
+   double t;
+   int i;
+
+#ifdef DQ_CHECK
+   assert( (voxel > 0.) && (slices >= 0) );
+#endif /* DQ_CHECK */
+
+   memset( G, 0, sizeof(dq_chain_grid_t) );
+   for (i=0; i<3; i++) {
+      t         = ceil( (max[i] - min[i]) / voxel );
+      G->min[i] = min[i];
+      G->dim[i] = (t > 1.) ? (int)t : 1;
+   }
+   G->voxel  = voxel;
+   G->slices = ((slices > 0) && (slices < G->dim[2])) ? slices : G->dim[2];
+   G->count  = malloc( sizeof(size_t) *
+         (size_t)G->dim[0] * (size_t)G->dim[1] * (size_t)G->slices );
+   if (G->count == NULL)
+      return -1;
+   dq_chain_grid_slab( G, 0 );
+   return 0;
+}
+
+
+DQ_API void dq_chain_grid_free( dq_chain_grid_t *G )
+{
+   free( G->count );
+   memset( G, 0, sizeof(dq_chain_grid_t) );
+}
+
+
+DQ_API void dq_chain_grid_slab( dq_chain_grid_t *G, int z0 )
+{
+#ifdef DQ_CHECK
+   assert( (z0 >= 0) && (z0 < G->dim[2]) );
+#endif /* DQ_CHECK */
+
+   G->z0      = z0;
+   G->samples = 0;
+   G->outside = 0;
+   memset( G->count, 0, sizeof(size_t) *
+         (size_t)G->dim[0] * (size_t)G->dim[1] * (size_t)G->slices );
+}
+
+
+DQ_API int dq_chain_grid_write( const dq_chain_grid_t *G, FILE *fp )
+{
+   unsigned char buf[8*256];
+   size_t c, i, j, k, n, m;
+
+   /* Only the slices of the slab that are inside the grid. */
+   n = (size_t)G->dim[0] * (size_t)G->dim[1] * (size_t)MIN( G->slices, G->dim[2] - G->z0 );
+   for (i=0; i<n; i+=m) {
+      m = MIN( n-i, 256 );
+      for (j=0; j<m; j++) {
+         c = G->count[i+j];
+         for (k=0; k<8; k++) {
+            buf[8*j+k] = (unsigned char)(c & 0xFF);
+            c = (c >> 4) >> 4;
+         }
+      }
+      if (fwrite( buf, 8, m, fp ) != m)
+         return -1;
+   }
+   return 0;
+}
+
+
+/**
+ * Minimum number of samples per thread for dq_chain_workspace to use threads.
+ */
+#define DQ_WORKSPACE_THREADED 4096
+
+
+/**
+ * @brief Samples counted by each thread of dq_chain_workspace.
+ */
+typedef struct dq_workspace_task_s {
+   const dq_chain_t *C;       /**< Chain to sample. */
+   const double *limits;      /**< Limits of the joints. */
+   dq_chain_grid_t *G;        /**< Grid, its count is used by the first thread. */
+   size_t n;                  /**< Number of samples. */
+   size_t *grid[ DQ_THREADS_MAX ]; /**< Counts of each thread. */
+   size_t outside[ DQ_THREADS_MAX ]; /**< Samples outside of each thread. */
+   double *q;                 /**< Joint values of a group for each thread. */
+   size_t cells;              /**< Number of voxels in the slab. */
+   int count;                 /**< Number of threads. */
+} dq_workspace_task_t;
+
+
+/**
+ * @brief Random value in [0,1) for draw k of the sample sequence of a key.
+ *
+ * Counter based, so any draw is found without the ones before. The key is
+ *  the mixed seed of the grid.
+ */
+static double dq_workspace_rnd( unsigned long key, size_t k )
+{
+   unsigned long hi = (unsigned long)((k >> 16) >> 16);
+   unsigned long lo = (unsigned long)(k & 0xFFFFFFFFUL);
+   return (double)dq_synth_seed( dq_synth_seed( key ^ hi ) ^ lo ) / 4294967296.;
+}
+
+
+static void dq_workspace_thread( void *data, int i )
+{
+   dq_workspace_task_t *task = data;
+   const dq_chain_t *C = task->C;
+   dq_chain_grid_t *G = task->G;
+   dq_t out[ DQ_CHAIN_LANES ];
+   size_t *count, s, start, end, k, outside;
+   unsigned long key;
+   double *q, d[3], t, inv;
+   int j, l, m, dof, x, y, z;
+
+   start   = (task->n / (size_t)task->count) * (size_t)i +
+         (size_t)MIN( i, (int)(task->n % (size_t)task->count) );
+   end     = start + task->n / (size_t)task->count +
+         (((size_t)i < task->n % (size_t)task->count) ? 1 : 0);
+   key     = dq_synth_seed( G->seed );
+   dof     = C->n;
+   q       = &task->q[ i*DQ_CHAIN_LANES*dof ];
+   count   = task->grid[i];
+   outside = 0;
+   inv     = 1. / G->voxel;
+   for (s=start; s<end; s+=(size_t)m) {
+      m = (int)MIN( (size_t)DQ_CHAIN_LANES, end-s );
+      k = (G->samples + s) * (size_t)dof;
+      for (l=0; l<m; l++)
+         for (j=0; j<dof; j++, k++)
+            q[l*dof+j] = task->limits[2*j] +
+                  (task->limits[2*j+1] - task->limits[2*j]) * dq_workspace_rnd( key, k );
+      dq_chain_fk_lanes( C, q, out, m );
+
+      for (l=0; l<m; l++) {
+         /* Translation as in dq_op_extract. */
+         d[0] = 2.*( out[l][0]*out[l][4] - out[l][1]*out[l][7] + out[l][2]*out[l][6] - out[l][3]*out[l][5] );
+         d[1] = 2.*( out[l][0]*out[l][5] - out[l][2]*out[l][7] - out[l][1]*out[l][6] + out[l][3]*out[l][4] );
+         d[2] = 2.*( out[l][0]*out[l][6] - out[l][3]*out[l][7] + out[l][1]*out[l][5] - out[l][2]*out[l][4] );
+
+         /* Compared as doubles first so huge values never reach the casts. */
+         t = floor( (d[0] - G->min[0]) * inv );
+         if (!((t >= 0.) && (t < (double)G->dim[0]))) {
+            outside++;
+            continue;
+         }
+         x = (int)t;
+         t = floor( (d[1] - G->min[1]) * inv );
+         if (!((t >= 0.) && (t < (double)G->dim[1]))) {
+            outside++;
+            continue;
+         }
+         y = (int)t;
+         t = floor( (d[2] - G->min[2]) * inv );
+         if (!((t >= 0.) && (t < (double)G->dim[2]))) {
+            outside++;
+            continue;
+         }
+         z = (int)t - G->z0;
+         if ((z >= 0) && (z < G->slices))
+            count[ ((size_t)z*(size_t)G->dim[1] + (size_t)y)*(size_t)G->dim[0] + (size_t)x ]++;
+      }
+   }
+   task->outside[i] = outside;
+}
+
+
+static void dq_workspace_merge( void *data, int i )
+{
+   dq_workspace_task_t *task = data;
+   size_t c, start, end;
+   int j;
+
+   start = task->cells / (size_t)task->count * (size_t)i;
+   end   = (i == task->count-1) ? task->cells : start + task->cells / (size_t)task->count;
+   for (j=1; j<task->count; j++)
+      for (c=start; c<end; c++)
+         task->grid[0][c] += task->grid[j][c];
+}
+
+
+DQ_API int dq_chain_workspace( const dq_chain_t *C, const double *limits, size_t n,
+      dq_chain_grid_t *G )
+{
+   dq_workspace_task_t task;
+   size_t *buf;
+   int i;
+
+#ifdef DQ_CHECK
+   assert( C->n > 0 );
+#endif /* DQ_CHECK */
+
+   task.C      = C;
+   task.limits = limits;
+   task.G      = G;
+   task.n      = n;
+   task.cells  = (size_t)G->dim[0] * (size_t)G->dim[1] * (size_t)G->slices;
+   task.count  = (int)MIN( (size_t)dq_threads_get(), n / DQ_WORKSPACE_THREADED );
+   task.count  = MAX( task.count, 1 );
+
+   /* Joint values of a group for each thread first for alignment, then the
+    * counts of the threads other than the first. */
+   task.q = malloc( sizeof(double) * (size_t)(task.count*DQ_CHAIN_LANES*C->n) +
+         sizeof(size_t) * task.cells * (size_t)(task.count-1) );
+   if (task.q == NULL)
+      return -1;
+   buf = (size_t*) &task.q[ task.count*DQ_CHAIN_LANES*C->n ];
+   task.grid[0] = G->count;
+   for (i=1; i<task.count; i++)
+      task.grid[i] = &buf[ task.cells * (size_t)(i-1) ];
+   if (task.count > 1)
+      memset( buf, 0, sizeof(size_t) * task.cells * (size_t)(task.count-1) );
+
+   if (task.count == 1)
+      dq_workspace_thread( &task, 0 );
+   else {
+      dq_thread_run( dq_workspace_thread, &task, task.count );
+      dq_thread_run( dq_workspace_merge, &task, task.count );
+   }
+
+   for (i=0; i<task.count; i++)
+      G->outside += task.outside[i];
+   G->samples += n;
+   free( task.q );
+   return 0;
+}
+
+
+DQ_API void dq_chain_stats_reset( dq_chain_t *C )
+{
+   memset( &C->stats, 0, sizeof(dq_chain_stats_t) );
+}
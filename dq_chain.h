@@ -0,0 +1,577 @@
+#ifndef _DQ_CHAIN_H
+#  define _DQ_CHAIN_H
+
+/**
+ * @file dq_chain.h
+ *
+ * @brief File containing functions related to serial kinematic chains.
+ */
+
+#include <stdio.h>
+
+#include "dq.h"
+
+/**
+ * @defgroup chain Serial Kinematic Chain Functions
+ * @brief Set of functions to compute the forward kinematics of serial chains.
+ *
+ * A chain is described with the product of exponentials formulation: every
+ *  joint is a screw axis given by its Plücker coordinates in the base frame
+ *  with all the joints at zero, and the pose of link i for the joint values
+ *  q is:
+ *
+ * \f[
+ * \widehat{L}_i = \widehat{J}_0(q_0) \widehat{J}_1(q_1) \cdots \widehat{J}_i(q_i) \widehat{M}_i
+ * \f]
+ *
+ * Where \f$\widehat{J}_k(q_k)\f$ is the rotation (see dq_cr_rotation_plucker)
+ *  or translation (see dq_cr_translation) of joint k and
+ *  \f$\widehat{M}_i\f$ is the pose of link i with all the joints at zero,
+ *  the identity unless set with dq_chain_set_home.
+ *
+ * The joint DQs are never built, each joint is applied directly to the
+ *  running product using only the non-zero terms of its screw.
+ *
+ * Besides the stateless dq_chain_fk, a chain keeps its own joint values and
+ *  caches the running products. Changing a joint with dq_chain_set_joint
+ *  only invalidates the links from that joint on, and they are recomputed
+ *  when next requested with dq_chain_link or dq_chain_links. When only the
+ *  last joints change every tick, as in teleoperation, most of the chain is
+ *  never recomputed.
+ *
+ * The cached links also give the Jacobian, dq_chain_jacobian, and the
+ *  inverse kinematics, dq_chain_ik, without extra forward kinematics passes.
+ *  The axes of a chain can be fitted to a set of displacements with
+ *  dq_chain_synth, and its reachable workspace sampled into a voxel grid
+ *  with dq_chain_workspace.
+ *
+ * Chains can also be read from a compact text description with
+ *  dq_chain_load or dq_chain_parse.
+ *
+ * Chains are double precision only.
+ */
+/** @{ */
+#define DQ_JOINT_REVOLUTE     0 /**< Joint rotating around its axis, the value is the angle. */
+#define DQ_JOINT_PRISMATIC    1 /**< Joint sliding along its axis, the value is the distance. */
+#define DQ_JACOBIAN_SPATIAL   0x0 /**< Linear velocity of the point at the base origin, the spatial twist (default). */
+#define DQ_JACOBIAN_TIP       0x4 /**< Linear velocity of the origin of the last link, the geometric Jacobian. */
+#define DQ_DH_STANDARD        0 /**< Denavit-Hartenberg rows as in dq_cr_dh. */
+#define DQ_DH_MODIFIED        1 /**< Modified (Craig) Denavit-Hartenberg rows as in dq_cr_mdh. */
+#define DQ_CHAIN_LOAD_MAX     4096 /**< Most joints a description read by dq_chain_load may declare. */
+/**
+ * @brief Screw axis of a joint.
+ *
+ * Everything needed to apply a joint is stored together, so computing a chain
+ *  reads the joints sequentially.
+ */
+typedef struct dq_joint_s {
+   double s[3];   /**< Unit direction of the axis. */
+   double s0[3];  /**< Moment of the axis, s0 = c x s for a point c on it. */
+   int type;      /**< DQ_JOINT_REVOLUTE or DQ_JOINT_PRISMATIC. */
+} dq_joint_t;
+/**
+ * @brief Work done by the incremental forward kinematics of a chain.
+ */
+typedef struct dq_chain_stats_s {
+   unsigned long evaluations; /**< Number of requests for links. */
+   unsigned long computed;    /**< Joints applied to the cached products. */
+   unsigned long saved;       /**< Joints a full recomputation would have applied in addition. */
+} dq_chain_stats_t;
+/**
+ * @brief Serial kinematic chain.
+ */
+typedef struct dq_chain_s {
+   dq_joint_t *joint; /**< Joints from the base to the tip. */
+   dq_t *home;        /**< Pose of each link with all the joints at zero. */
+   int has_home;      /**< Whether any pose in home is not the identity. */
+   int n;             /**< Number of joints, and links. */
+   double *q;         /**< Current value of each joint. */
+   double *limit;     /**< Lower and upper limit of each joint, limit[2*i] and limit[2*i+1]. */
+   dq_t *prefix;      /**< Cached product of the joints up to each one. */
+   dq_t *link;        /**< Cached pose of each link. */
+   int dirty;         /**< First joint whose cached products are invalid, n if none. */
+   dq_chain_stats_t stats; /**< Work done by the incremental forward kinematics. */
+   double *work;      /**< Scratch space of the solvers. */
+} dq_chain_t;
+/**
+ * @brief Parameters and results of the inverse kinematics solver.
+ *
+ * The tolerance is on the norm of the error vector mixing the translation,
+ *  in the units of the chain, and the rotation, in radians times the weight.
+ *  A weight around the size of the chain balances both, otherwise the solver
+ *  fixes the translation first and crawls towards the right orientation.
+ *
+ * @sa dq_chain_ik_init
+ */
+typedef struct dq_chain_ik_s {
+   int max_iter;     /**< Maximum number of steps to try. */
+   double tol;       /**< Norm of the error to stop at. */
+   double lambda;    /**< Initial damping. */
+   double weight;    /**< Length units per radian of rotation error. */
+   int iterations;   /**< Steps tried by the last solve. */
+   double residual;  /**< Norm of the error after the last solve. */
+} dq_chain_ik_t;
+/**
+ * @brief Parameters and results of the kinematic synthesis solver.
+ *
+ * @sa dq_chain_synth_init
+ */
+typedef struct dq_chain_synth_s {
+   int restarts;        /**< Number of random starting points. */
+   int max_iter;        /**< Maximum number of steps of each restart. */
+   double tol;          /**< Norm of the error over all the targets to stop at. */
+   double scale;        /**< Size of the mechanism, axes are drawn through [-scale,scale]^3. */
+   double weight;       /**< Length units per radian of rotation error. */
+   unsigned long seed;  /**< Seed of the random starting points. */
+   int best;            /**< Restart that gave the best fit. */
+   int iterations;      /**< Steps taken by the best restart. */
+   double residual;     /**< Norm of the error of the best fit over all the targets. */
+} dq_chain_synth_t;
+/**
+ * @brief Voxel grid counting the positions reached by dq_chain_workspace.
+ *
+ * Voxel (x,y,z) spans voxel edges from min + voxel*(x,y,z). Grids too large
+ *  for memory are computed in slabs of slices along z: only the slices z0
+ *  to z0+slices-1 are kept, voxel (x,y,z) of the slab being
+ *  count[((z-z0)*dim[1] + y)*dim[0] + x].
+ *
+ * @sa dq_chain_grid_create
+ */
+typedef struct dq_chain_grid_s {
+   double min[3];          /**< Corner of the grid. */
+   double voxel;           /**< Edge of the voxels. */
+   int dim[3];             /**< Number of voxels along each axis. */
+   int z0;                 /**< First slice of the slab in memory. */
+   int slices;             /**< Number of slices of the slab in memory. */
+   size_t *count;          /**< Samples in each voxel of the slab. */
+   size_t samples;         /**< Samples drawn since the slab was started. */
+   size_t outside;         /**< Samples that fell outside the whole grid. */
+   unsigned long seed;     /**< Seed of the samples, 0 when created. */
+} dq_chain_grid_t;
+/**
+ * @brief Allocates a chain of n joints.
+ *
+ * Joints are revolute around the z axis through the origin, their values
+ *  are zero, they have no limits and the home poses are the identity until
+ *  set. Everything, including the cache of the incremental forward
+ *  kinematics and the scratch space of the Jacobian and the inverse
+ *  kinematics, is allocated in a single block so those never allocate
+ *  memory.
+ *
+ *    @param[out] C Chain to allocate.
+ *    @param[in] n Number of joints.
+ *    @return 0 on success, -1 if out of memory.
+ * @sa dq_chain_free
+ */
+DQ_API int dq_chain_create( dq_chain_t *C, int n );
+/**
+ * @brief Frees a chain allocated with dq_chain_create.
+ *
+ *    @param C Chain to free.
+ * @sa dq_chain_create
+ */
+DQ_API void dq_chain_free( dq_chain_t *C );
+/**
+ * @brief Sets the screw axis of a joint.
+ *
+ *    @param C Chain to modify.
+ *    @param[in] i Index of the joint.
+ *    @param[in] type DQ_JOINT_REVOLUTE or DQ_JOINT_PRISMATIC.
+ *    @param[in] s Unit direction of the axis.
+ *    @param[in] s0 Moment of the axis, perpendicular to s. Only used by
+ *               revolute joints.
+ * @sa dq_cr_rotation_plucker
+ */
+DQ_API void dq_chain_set_axis( dq_chain_t *C, int i, int type, const double s[3], const double s0[3] );
+/**
+ * @brief Sets the pose of a link with all the joints at zero.
+ *
+ *    @param C Chain to modify.
+ *    @param[in] i Index of the link.
+ *    @param[in] M Pose of the link.
+ */
+DQ_API void dq_chain_set_home( dq_chain_t *C, int i, const dq_t M );
+/**
+ * @brief Sets the limits of a joint.
+ *
+ * The limits are only kept with the chain, none of the chain functions
+ *  enforce them. They are in the layout dq_chain_workspace expects.
+ *
+ *    @param C Chain to modify.
+ *    @param[in] i Index of the joint.
+ *    @param[in] lo Lower limit, -HUGE_VAL if none.
+ *    @param[in] hi Upper limit, HUGE_VAL if none.
+ */
+DQ_API void dq_chain_set_limits( dq_chain_t *C, int i, double lo, double hi );
+/**
+ * @brief Allocates a chain from a Denavit-Hartenberg table.
+ *
+ * Each row is theta, d, a and alpha as given to dq_cr_dh or dq_cr_mdh. The
+ *  joint value is added to theta for revolute joints and to d for prismatic
+ *  ones, so theta or d are the offsets of the joint.
+ *
+ * The table is converted once to the screw axes and home poses of the
+ *  chain. Then the forward kinematics only apply the joint values to the
+ *  running products and the home poses, none of the constant rotations and
+ *  translations of the rows are evaluated again:
+ *
+ * \f[
+ * \widehat{L}_i = \widehat{T}_0(q_0) \cdots \widehat{T}_i(q_i)
+ *  = \widehat{J}_0(q_0) \cdots \widehat{J}_i(q_i) \widehat{M}_i
+ * \f]
+ *
+ *    @param[out] C Chain to allocate, free with dq_chain_free.
+ *    @param[in] dh Table of n rows, dh[4*i] to dh[4*i+3] are theta, d, a
+ *               and alpha of joint i.
+ *    @param[in] type Type of each joint, DQ_JOINT_REVOLUTE or DQ_JOINT_PRISMATIC.
+ *    @param[in] n Number of joints.
+ *    @param[in] convention DQ_DH_STANDARD or DQ_DH_MODIFIED.
+ *    @return 0 on success, -1 if out of memory.
+ * @sa dq_cr_dh
+ * @sa dq_cr_mdh
+ */
+DQ_API int dq_chain_create_dh( dq_chain_t *C, const double *dh, const int *type, int n, int convention );
+/**
+ * @brief Allocates a chain from a text description read from a stream.
+ *
+ * The description is read line by line in a single pass. It starts with
+ *  the number of joints, which allocates the chain, then has one line per
+ *  joint from the base to the tip with the joint type and its attributes,
+ *  in any order. Everything after a # is a comment:
+ *
+ @verbatim
+   # SCARA with limits, in millimetres.
+   joints 4
+   revolute  axis 0 0 1  point 0 0 0      limits -2.5 2.5
+   revolute  plucker 0 0 1  0 -300 0      limits -2.5 2.5
+   revolute  axis 0 0 1  point 650 0 0
+   prismatic axis 0 0 -1  limits 0 150  offset 650 0 0  rotate 3.14159 1 0 0
+ @endverbatim
+ *
+ * The attributes are, all in the base frame with the joints at zero:
+ *
+ *  - axis sx sy sz: Direction of the axis, need not be unit.
+ *  - point cx cy cz: Any point of the axis, the origin by default.
+ *  - plucker sx sy sz mx my mz: Direction and moment of the axis, instead
+ *    of axis and point. Both are scaled to make the direction unit.
+ *  - limits lo hi: Limits of the joint, see dq_chain_set_limits.
+ *  - offset tx ty tz: Translation of the home pose of the link.
+ *  - rotate angle sx sy sz: Rotation of the home pose of the link around
+ *    an axis through its offset, in radians.
+ *
+ * Every joint needs a direction. At most DQ_CHAIN_LOAD_MAX joints can be
+ *  declared, so untrusted text can not request huge allocations. Lines are
+ *  at most 1022 characters long, not counting the newline. Only serial
+ *  chains can be described, trees built with dq_tree_create have no joints
+ *  to describe. The same descriptions are read by the dq_codegen tool.
+ *
+ *    @param[out] C Chain to allocate, free with dq_chain_free.
+ *    @param[in] fp Stream to read the description from.
+ *    @param[out] line Line of the first error, or 0 on success. Missing
+ *                joints are reported past the last line. May be NULL.
+ *    @return 0 on success, -1 if the description is invalid or out of
+ *            memory, in which case nothing is left allocated.
+ * @sa dq_chain_parse
+ */
+DQ_API int dq_chain_load( dq_chain_t *C, FILE *fp, int *line );
+/**
+ * @brief Allocates a chain from a text description in memory.
+ *
+ * Same as dq_chain_load with the description in a string.
+ *
+ *    @param[out] C Chain to allocate, free with dq_chain_free.
+ *    @param[in] str Description, as described in dq_chain_load.
+ *    @param[out] line Line of the first error, or 0 on success. May be NULL.
+ *    @return 0 on success, -1 if the description is invalid or out of
+ *            memory, in which case nothing is left allocated.
+ * @sa dq_chain_load
+ */
+DQ_API int dq_chain_parse( dq_chain_t *C, const char *str, int *line );
+/**
+ * @brief Computes the pose of every link of a chain.
+ *
+ * This does not use nor modify the joint values and cache of the chain.
+ *
+ *    @param[in] C Chain to compute.
+ *    @param[in] q Value of each joint.
+ *    @param[out] out Pose of each link, the last one is the tip.
+ * @sa dq_chain_links
+ */
+DQ_API void dq_chain_fk( const dq_chain_t *C, const double *q, dq_t *out );
+/**
+ * @brief Computes the pose of the tip of a chain for many configurations.
+ *
+ * Meant for sampling, as in motion planning, where the same chain is
+ *  evaluated for many candidate joint values. Configurations are computed in
+ *  groups of eight, kept as a structure of arrays so each product runs on
+ *  one SIMD lane per configuration, and the groups are split across the
+ *  threads set with dq_threads_set when there are enough of them. The sines
+ *  and cosines are computed as selected with dq_sincos_set.
+ *
+ * Like dq_chain_fk it does not use nor modify the joint values and cache of
+ *  the chain.
+ *
+ *    @param[in] C Chain to compute.
+ *    @param[in] q Joint values, q[k*C->n + i] is joint i of configuration k.
+ *    @param[out] out Pose of the tip for each configuration.
+ *    @param[in] n Number of configurations.
+ * @sa dq_chain_fk
+ */
+DQ_API void dq_chain_fk_batch( const dq_chain_t *C, const double *q, dq_t *out, int n );
+/**
+ * @brief Sets the value of a joint of the chain.
+ *
+ * The links from joint i on are marked to be recomputed the next time they
+ *  are requested. Setting a joint to its current value does nothing.
+ *
+ *    @param C Chain to modify.
+ *    @param[in] i Index of the joint.
+ *    @param[in] q New value of the joint.
+ * @sa dq_chain_set_joints
+ */
+DQ_API void dq_chain_set_joint( dq_chain_t *C, int i, double q );
+/**
+ * @brief Sets the value of all the joints of the chain.
+ *
+ * Same as calling dq_chain_set_joint for every joint.
+ *
+ *    @param C Chain to modify.
+ *    @param[in] q New value of each joint.
+ * @sa dq_chain_set_joint
+ */
+DQ_API void dq_chain_set_joints( dq_chain_t *C, const double *q );
+/**
+ * @brief Gets the pose of a link for the current joint values.
+ *
+ * Only the links up to i that were invalidated since they were last computed
+ *  are recomputed.
+ *
+ *    @param C Chain to evaluate.
+ *    @param[in] i Index of the link.
+ *    @param[out] O Pose of the link.
+ * @sa dq_chain_links
+ */
+DQ_API void dq_chain_link( dq_chain_t *C, int i, dq_t O );
+/**
+ * @brief Gets the pose of all the links for the current joint values.
+ *
+ * Only the links that were invalidated since they were last computed are
+ *  recomputed.
+ *
+ *    @param C Chain to evaluate.
+ *    @return Pose of each link, owned by the chain and valid until it is
+ *            modified. It must not be written to.
+ * @sa dq_chain_link
+ */
+DQ_API dq_t *dq_chain_links( dq_chain_t *C );
+/**
+ * @brief Computes the Jacobian of the chain for the current joint values.
+ *
+ * Column i is the velocity of the last link per unit velocity of joint i,
+ *  with the linear velocity in rows 0 to 2 and the angular velocity in rows 3
+ *  to 5, all in the base frame. It is obtained from the axis of joint i as a
+ *  line (see dq_cr_line_plucker) moved by the cached product of the joints up
+ *  to it with dq_op_f2g:
+ *
+ * \f[
+ * \widehat{S}'_i = \widehat{P}_i \widehat{S}_i \widehat{P}_i^* = (0, s'_i, s'_{0i}, 0)
+ * \f]
+ *
+ * The column of a revolute joint is \f$(s'_{0i}, s'_i)\f$ and that of a
+ *  prismatic joint \f$(s'_i, 0)\f$. With DQ_JACOBIAN_TIP the linear
+ *  velocity is that of the origin of the last link p instead, adding
+ *  \f$s'_i \times p\f$ to revolute columns.
+ *
+ * The cost is that of bringing the cached links up to date, at most one
+ *  forward kinematics pass, plus one dq_op_f2g per joint.
+ *
+ *    @param C Chain to compute.
+ *    @param[out] J Buffer to write the 6 by n Jacobian to.
+ *    @param[in] ld Number of elements between consecutive rows, or columns
+ *               if column-major, 0 for a packed matrix (n or 6).
+ *    @param[in] flags DQ_MATRIX_ROW_MAJOR or DQ_MATRIX_COL_MAJOR, and
+ *               DQ_JACOBIAN_SPATIAL or DQ_JACOBIAN_TIP.
+ * @sa dq_chain_links
+ */
+DQ_API void dq_chain_jacobian( dq_chain_t *C, double *J, int ld, int flags );
+/**
+ * @brief Sets the default parameters of the inverse kinematics solver.
+ *
+ * At most 100 steps, a tolerance of 1e-9, an initial damping of 1e-2 and a
+ *  rotation weight of 1.
+ *
+ *    @param[out] P Parameters to initialize.
+ */
+DQ_API void dq_chain_ik_init( dq_chain_ik_t *P );
+/**
+ * @brief Solves the joint values that place the last link at a target pose.
+ *
+ * The error e between the tip and the target is their translation and the
+ *  rotation vector taking one to the other, and each step is the damped
+ *  least squares solution:
+ *
+ * \f[
+ * \Delta q = J^T \left( J J^T + \lambda^2 I \right)^{-1} e
+ * \f]
+ *
+ * With J from dq_chain_jacobian with DQ_JACOBIAN_TIP. The damping adapts
+ *  to how well the last step matched the reduction of the error predicted by
+ *  the linearization: steps increasing the error are undone and increase it,
+ *  good steps decrease it. The solver moves like Gauss-Newton near the
+ *  solution and like gradient descent near singularities, and gives up when
+ *  the damping grows too large to make progress.
+ *
+ * The solver starts from the current joint values of the chain, so when
+ *  tracking a moving target the previous solution is a warm start, and leaves
+ *  the best values found in it. Nothing is allocated, the scratch space is
+ *  part of the chain. The tip of a chain without joints is its base frame,
+ *  so it only reaches the identity.
+ *
+ *    @param C Chain to solve, with the initial guess as its joint values.
+ *    @param[in] T Target pose of the last link.
+ *    @param P Parameters of the solver, the number of steps tried and the
+ *             final error are written back.
+ *    @return 0 if the error is within the tolerance, -1 otherwise.
+ * @sa dq_chain_ik_init
+ */
+DQ_API int dq_chain_ik( dq_chain_t *C, const dq_t T, dq_chain_ik_t *P );
+/**
+ * @brief Sets the default parameters of the kinematic synthesis solver.
+ *
+ * 64 restarts of at most 200 steps, a tolerance of 1e-8, a scale and a
+ *  rotation weight of 1 and a seed of 0.
+ *
+ *    @param[out] P Parameters to initialize.
+ */
+DQ_API void dq_chain_synth_init( dq_chain_synth_t *P );
+/**
+ * @brief Fits the axes of the joints of a chain to a set of displacements.
+ *
+ * Kinematic synthesis finds a chain able to move its last link through
+ *  the given displacements. The joint types are taken from C, and the axes
+ *  and the joint values for each displacement are found such that:
+ *
+ * \f[
+ * \widehat{D}_k = \widehat{J}_0(q_{k0}) \widehat{J}_1(q_{k1}) \cdots \widehat{J}_{n-1}(q_{k,n-1})
+ * \f]
+ *
+ * Displacements are taken from the configuration with all the joints at
+ *  zero, so for poses \f$\widehat{T}_k\f$ of the last link measured from a
+ *  reference pose \f$\widehat{T}_0\f$ they are
+ *  \f$\widehat{T}_k \widehat{T}_0^{-1}\f$. The home poses are not used.
+ *
+ * Each restart draws random axes and joint values and minimizes the error,
+ *  as in dq_chain_ik, of all the targets with Levenberg-Marquardt. The
+ *  restarts are independent and shared among the threads set with
+ *  dq_threads_set, each with its own random number generator seeded from
+ *  the seed and the index of the restart, so the result only depends on
+ *  the parameters and never on the number of threads. The best fit wins,
+ *  the first restart in case of a tie.
+ *
+ *    @param C Chain with the joint types, its axes are set to the best fit.
+ *    @param[in] D Displacements of the last link.
+ *    @param[in] m Number of displacements.
+ *    @param[out] q Joint values of the best fit for each displacement,
+ *               q[k*C->n + i] is joint i for displacement k, or NULL.
+ *    @param P Parameters of the solver, the best restart, its number of
+ *             steps and its error are written back.
+ *    @return 0 if the error of the best fit is within the tolerance, -1
+ *            otherwise, if out of memory or if there are no joints,
+ *            displacements or restarts, leaving the chain untouched.
+ * @sa dq_chain_synth_init
+ */
+DQ_API int dq_chain_synth( dq_chain_t *C, dq_t *D, int m, double *q, dq_chain_synth_t *P );
+/**
+ * @brief Allocates a voxel grid for dq_chain_workspace.
+ *
+ * The grid covers the box from min to max, rounded up to whole voxels. All
+ *  the counts and the seed are zero and the first slab is in memory.
+ *
+ *    @param[out] G Grid to allocate.
+ *    @param[in] min Lower corner of the box.
+ *    @param[in] max Upper corner of the box.
+ *    @param[in] voxel Edge of the voxels.
+ *    @param[in] slices Number of slices along z kept in memory, 0 for all.
+ *    @return 0 on success, -1 if out of memory.
+ * @sa dq_chain_grid_free
+ */
+DQ_API int dq_chain_grid_create( dq_chain_grid_t *G, const double min[3], const double max[3],
+      double voxel, int slices );
+/**
+ * @brief Frees a grid allocated with dq_chain_grid_create.
+ *
+ *    @param G Grid to free.
+ */
+DQ_API void dq_chain_grid_free( dq_chain_grid_t *G );
+/**
+ * @brief Starts a slab of a grid.
+ *
+ * Clears the counts, the number of samples and of samples outside. The
+ *  seed is kept.
+ *
+ *    @param G Grid to start the slab of.
+ *    @param[in] z0 First slice of the slab.
+ */
+DQ_API void dq_chain_grid_slab( dq_chain_grid_t *G, int z0 );
+/**
+ * @brief Writes the counts of the slab in memory to a stream.
+ *
+ * Counts are written in the order of count as 64 bit little endian
+ *  integers, so writing every slab in order gives the whole grid as a raw
+ *  dim[0] x dim[1] x dim[2] volume.
+ *
+ *    @param[in] G Grid to write.
+ *    @param fp Stream to write to.
+ *    @return 0 on success, -1 on write error.
+ */
+DQ_API int dq_chain_grid_write( const dq_chain_grid_t *G, FILE *fp );
+/**
+ * @brief Samples the reachable workspace of a chain into a voxel grid.
+ *
+ * Joint values are drawn uniformly within their limits, the pose of the tip
+ *  is computed in groups as in dq_chain_fk_batch, and its translation, as
+ *  given by dq_op_extract, adds one to the count of its voxel if it falls in
+ *  the slab in memory. Samples are not stored, so memory does not grow with
+ *  their number and calls accumulate, continuing the same sequence.
+ *
+ * Every sample is drawn from a hash of the seed of the grid and of its
+ *  index since the slab was started, so the counts are the same for any
+ *  number of threads and computing a large grid slab by slab, with the same
+ *  calls for every slab, gives the same counts as computing it at once, at
+ *  the cost of sampling again for each slab:
+ *
+ @verbatim
+   dq_chain_grid_create( &G, min, max, voxel, 64 );
+   for (z=0; z<G.dim[2]; z+=G.slices) {
+      dq_chain_grid_slab( &G, z );
+      dq_chain_workspace( &C, limits, n, &G );
+      dq_chain_grid_write( &G, fp );
+   }
+ @endverbatim
+ *
+ * Runs with different seeds draw independent samples, so a large run can
+ *  be split among processes or machines, each with its own seed, and the
+ *  counts of their grids added.
+ *
+ * With threads, set with dq_threads_set, each thread counts into its own
+ *  copy of the slab and the copies are added at the end.
+ *
+ *    @param[in] C Chain to sample, the home pose of the tip is included.
+ *    @param[in] limits Lower and upper limit of each joint, limits[2*i] and
+ *               limits[2*i+1] for joint i. May be C->limit when all are
+ *               finite.
+ *    @param[in] n Number of samples.
+ *    @param G Grid to count the samples into.
+ *    @return 0 on success, -1 if out of memory.
+ */
+DQ_API int dq_chain_workspace( const dq_chain_t *C, const double *limits, size_t n,
+      dq_chain_grid_t *G );
+/**
+ * @brief Resets the statistics of the incremental forward kinematics.
+ *
+ *    @param C Chain to reset the statistics of.
+ */
+DQ_API void dq_chain_stats_reset( dq_chain_t *C );
+/** @} */
+
+#endif /* _DQ_CHAIN_H */
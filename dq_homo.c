@@ -1,3 +1,4 @@
+#include "dq_real.h"
 #include "dq_homo.h"
 
 #include <stdio.h>
@@ -8,9 +9,10 @@
 #endif /* DQ_CHECK */
 
 #include "dq.h"
+#include "dq_mat3.h"
 
 
-void homo_cr_join( double H[3][4], double R[3][3], double d[3] )
+DQ_API void homo_cr_join( dq_real_t H[3][4], dq_real_t R[3][3], dq_real_t d[3] )
 {
    int i, j;
 
@@ -26,9 +28,9 @@ void homo_cr_join( double H[3][4], double R[3][3], double d[3] )
 }
 
 
-void homo_op_mul( double O[3][4], double A[3][4], double B[3][4] )
+DQ_API void homo_op_mul( dq_real_t O[3][4], dq_real_t A[3][4], dq_real_t B[3][4] )
 {
-   double H[3][4];
+   dq_real_t H[3][4];
    int i, j;
 
    for (j=0; j<3; j++)
@@ -37,11 +39,36 @@ void homo_op_mul( double O[3][4], double A[3][4], double B[3][4] )
    for (i=0; i<3; i++)
       H[i][3] += A[i][3];
 
-   memcpy( O, H, sizeof(double)*3*4 );
+   memcpy( O, H, sizeof(dq_real_t)*3*4 );
 }
 
 
-void homo_op_mul_vec( double o[4], double H[3][4], const double v[4] )
+DQ_API void homo_op_mul_nr( dq_real_t (* DQ_RESTRICT O)[4], dq_real_t (* DQ_RESTRICT A)[4], dq_real_t (* DQ_RESTRICT B)[4] )
+{
+   int i, j;
+   for (j=0; j<3; j++) {
+      for (i=0; i<3; i++)
+         O[j][i] = A[j][0]*B[0][i] + A[j][1]*B[1][i] + A[j][2]*B[2][i];
+      O[j][3] = A[j][0]*B[0][3] + A[j][1]*B[1][3] + A[j][2]*B[2][3] + A[j][3];
+   }
+}
+
+
+DQ_API void homo_op_mul_ip( dq_real_t A[3][4], dq_real_t B[3][4] )
+{
+   dq_real_t a[4];
+   int i, j;
+   /* Each row of the result only depends on the same row of A. */
+   for (j=0; j<3; j++) {
+      memcpy( a, A[j], sizeof(dq_real_t)*4 );
+      for (i=0; i<3; i++)
+         A[j][i] = a[0]*B[0][i] + a[1]*B[1][i] + a[2]*B[2][i];
+      A[j][3] = a[0]*B[0][3] + a[1]*B[1][3] + a[2]*B[2][3] + a[3];
+   }
+}
+
+
+DQ_API void homo_op_mul_vec( dq_real_t o[4], dq_real_t H[3][4], const dq_real_t v[4] )
 {
    int i;
    for (i=0; i<3; i++)
@@ -50,7 +77,7 @@ void homo_op_mul_vec( double o[4], double H[3][4], const double v[4] )
 }
 
 
-void homo_op_split( double R[3][3], double d[3], double H[3][4] )
+DQ_API void homo_op_split( dq_real_t R[3][3], dq_real_t d[3], dq_real_t H[3][4] )
 {
    int i, j;
    for (j=0; j<3; j++)
@@ -61,7 +88,7 @@ void homo_op_split( double R[3][3], double d[3], double H[3][4] )
 }
 
 
-int homo_ch_cmpV( double A[3][4], double B[3][4], double precision )
+DQ_API int homo_ch_cmpV( dq_real_t A[3][4], dq_real_t B[3][4], dq_real_t precision )
 {
    int i, j, ret;
    ret = 0;
@@ -73,13 +100,13 @@ int homo_ch_cmpV( double A[3][4], double B[3][4], double precision )
 }
 
 
-int homo_ch_cmp( double A[3][4], double B[3][4] )
+DQ_API int homo_ch_cmp( dq_real_t A[3][4], dq_real_t B[3][4] )
 {
    return homo_ch_cmpV( A, B, DQ_PRECISION );
 }
 
 
-void homo_print( double H[3][4] )
+DQ_API void homo_print( dq_real_t H[3][4] )
 {
    printf( "   % 3.3f % 3.3f % 3.3f % 3.3f\n"
            "   % 3.3f % 3.3f % 3.3f % 3.3f\n"
@@ -6,6 +6,8 @@
  * @brief File containing functions related to 4 by 4 homogeneous matrix.
  */
 
+#include "dq.h"
+
 /**
  * @defgroup homo Auxiliary Homogeneous Matrix Functions
  * @brief Set of auxiliary functions to manipulate homogeneous matrix.
@@ -50,7 +52,7 @@
  *    @param[in] d 3d translation vector.
  * @sa homo_op_split
  */
-void homo_cr_join( double H[3][4], double R[3][3], double d[3] );
+DQ_API void homo_cr_join( double H[3][4], double R[3][3], double d[3] );
 /**
  * @brief Multiplies two homogeneous matrix.
  *
@@ -63,7 +65,31 @@ void homo_cr_join( double H[3][4], double R[3][3], double d[3] );
  *    @param[in] B Second homogeneous matrix to operate on.
  * @sa homo_op_mul_vec
  */
-void homo_op_mul( double O[3][4], double A[3][4], double B[3][4] );
+DQ_API void homo_op_mul( double O[3][4], double A[3][4], double B[3][4] );
+/**
+ * @brief Multiplies two homogeneous matrix that do not alias the result.
+ *
+ * Same as homo_op_mul, but the result is written directly so O must not
+ *  overlap A or B. This is not checked.
+ *
+ *    @param[out] O Resulting homogeneous matrix, must not overlap A nor B.
+ *    @param[in] A First homogeneous matrix to operate on.
+ *    @param[in] B Second homogeneous matrix to operate on.
+ * @sa homo_op_mul_ip
+ */
+DQ_API void homo_op_mul_nr( double (* DQ_RESTRICT O)[4], double (* DQ_RESTRICT A)[4], double (* DQ_RESTRICT B)[4] );
+/**
+ * @brief Multiplies a homogeneous matrix in place by another on the right.
+ *
+ * \f[
+ *    A \leftarrow A * B
+ * \f]
+ *
+ *    @param A Homogeneous matrix to multiply, overwritten with the result.
+ *    @param[in] B Homogeneous matrix to multiply by, must not be A.
+ * @sa homo_op_mul_nr
+ */
+DQ_API void homo_op_mul_ip( double A[3][4], double B[3][4] );
 /**
  * @brief Splits a homogeneous matrix into a 3x3 rotation matrix and a 3d translation vector.
  *
@@ -71,7 +97,7 @@ void homo_op_mul( double O[3][4], double A[3][4], double B[3][4] );
  *    @param[out] d 3d translation vector extracted from the homogeneous matrix.
  *    @param[in] H Homogeneous matrix to split.
  */
-void homo_op_split( double R[3][3], double d[3], double H[3][4] );
+DQ_API void homo_op_split( double R[3][3], double d[3], double H[3][4] );
 /**
  * @brief Multiplies a homogeneous matrix by a 4d vector.
  *
@@ -82,7 +108,7 @@ void homo_op_split( double R[3][3], double d[3], double H[3][4] );
  *    @param[in] v 4d vector to multiply.
  * @sa homo_op_mul
  */
-void homo_op_mul_vec( double o[4], double H[3][4], const double v[4] );
+DQ_API void homo_op_mul_vec( double o[4], double H[3][4], const double v[4] );
 /**
  * @brief Compares two homogeneous matrix with variable precision.
  *
@@ -92,7 +118,7 @@ void homo_op_mul_vec( double o[4], double H[3][4], const double v[4] );
  *    @return 0 if they are the same, 1 otherwise.
  * @sa homo_ch_cmp
  */
-int homo_ch_cmpV( double A[3][4], double B[3][4], double precision );
+DQ_API int homo_ch_cmpV( double A[3][4], double B[3][4], double precision );
 /**
  * @brief Compares two homogeneous matrix.
  *
@@ -101,13 +127,13 @@ int homo_ch_cmpV( double A[3][4], double B[3][4], double precision );
  *    @return 0 if they are the same, 1 otherwise.
  * @sa homo_ch_cmpV
  */
-int homo_ch_cmp( double A[3][4], double B[3][4] );
+DQ_API int homo_ch_cmp( double A[3][4], double B[3][4] );
 /**
  * @brief Prints a homogeneous matrix on screen.
  *
  *    @param[in] H Homogeneous matrix to print on screen.
  */
-void homo_print( double H[3][4] );
+DQ_API void homo_print( double H[3][4] );
 /** @} */
 
 #endif /* _DQ_HOMO_H */
@@ -0,0 +1,46 @@
+#ifndef _DQ_INLINE_H
+#  define _DQ_INLINE_H
+
+/**
+ * @file dq_inline.h
+ *
+ * @brief Header-only build of the double precision library.
+ *
+ * Defining DQ_INLINE before including any libdq header, or including this
+ *  header first, compiles the library into the including file with every
+ *  function declared static inline. The compiler can then inline the small
+ *  operations into the caller's loops and vectorize them for the target
+ *  instead of calling into libdq.so. There is nothing to link except -lm,
+ *  and -pthread if DQ_THREADS is defined.
+ *
+ * The API is the same as the library's with a few differences:
+ *    - The core operations always use the scalar implementations, the
+ *      compiler options of the including file decide how they are vectorized.
+ *      dq_simd_set has no effect and dq_simd_get returns DQ_SIMD_SCALAR.
+ *    - Every file including it has its own copy of the library state, so
+ *      dq_threads_set only applies to the functions called from that file.
+ *    - Single precision (dqf.h) still comes from libdq.
+ *
+ * The library sources are installed along with this header.
+ */
+
+#ifndef DQ_INLINE
+#  if defined(_DQ_H)
+#    error "dq_inline.h must be included before any other libdq header"
+#  endif
+#  define DQ_INLINE
+#endif /* DQ_INLINE */
+
+#include "dq.h"
+#include "dq_vec3.c"
+#include "dq_mat3.c"
+#include "dq_homo.c"
+#include "dq_soa.c"
+#include "dq_thread.c"
+#include "dq_sincos.c"
+#include "dq.c"
+#include "dq_chain.c"
+#include "dq_tree.c"
+
+
+#endif /* _DQ_INLINE_H */
@@ -1,3 +1,4 @@
+#include "dq_real.h"
 #include "dq_mat3.h"
 
 #include <stdio.h>
@@ -10,7 +11,7 @@
 #include "dq.h"
 
 
-void mat3_eye( double M[3][3] )
+DQ_API void mat3_eye( dq_real_t M[3][3] )
 {
    M[0][0] = 1.;
    M[0][1] = 0.;
@@ -24,7 +25,7 @@ void mat3_eye( double M[3][3] )
 }
 
 
-double mat3_det( double M[3][3] )
+DQ_API dq_real_t mat3_det( dq_real_t M[3][3] )
 {
    return M[0][0]*M[1][1]*M[2][2] +
           M[1][0]*M[2][1]*M[0][2] +
@@ -35,7 +36,7 @@ double mat3_det( double M[3][3] )
 }
 
 
-void mat3_add( double out[3][3], double A[3][3], double B[3][3] )
+DQ_API void mat3_add( dq_real_t out[3][3], dq_real_t A[3][3], dq_real_t B[3][3] )
 {
    int c,r;
    for (c=0; c<3; c++) {
@@ -46,7 +47,7 @@ void mat3_add( double out[3][3], double A[3][3], double B[3][3] )
 }
 
 
-void mat3_sub( double out[3][3], double A[3][3], double B[3][3] )
+DQ_API void mat3_sub( dq_real_t out[3][3], dq_real_t A[3][3], dq_real_t B[3][3] )
 {
    int c,r;
    for (c=0; c<3; c++) {
@@ -57,9 +58,9 @@ void mat3_sub( double out[3][3], double A[3][3], double B[3][3] )
 }
 
 
-void mat3_inv( double out[3][3], double in[3][3] )
+DQ_API void mat3_inv( dq_real_t out[3][3], dq_real_t in[3][3] )
 {
-   double det;
+   dq_real_t det;
 
    det = mat3_det(in);
 
@@ -79,33 +80,75 @@ void mat3_inv( double out[3][3], double in[3][3] )
 }
 
 
-void mat3_mul( double AB[3][3], double A[3][3], double B[3][3] )
+DQ_API void mat3_mul( dq_real_t AB[3][3], dq_real_t A[3][3], dq_real_t B[3][3] )
 {
    int c,r;
-   double T[3][3];
+   dq_real_t T[3][3];
    for (c=0; c<3; c++) {
       for (r=0; r<3; r++) {
          T[r][c] = A[r][0]*B[0][c] + A[r][1]*B[1][c] + A[r][2]*B[2][c];
       }
    }
-   memcpy( AB, T, sizeof(double)*3*3 );
+   memcpy( AB, T, sizeof(dq_real_t)*3*3 );
 }
 
 
-void mat3_mul_vec( double out[3], double M[3][3], const double v[3] )
+DQ_API void mat3_mul_nr( dq_real_t (* DQ_RESTRICT AB)[3], dq_real_t (* DQ_RESTRICT A)[3], dq_real_t (* DQ_RESTRICT B)[3] )
 {
-   double t[3];
+   int c,r;
+   for (r=0; r<3; r++)
+      for (c=0; c<3; c++)
+         AB[r][c] = A[r][0]*B[0][c] + A[r][1]*B[1][c] + A[r][2]*B[2][c];
+}
+
+
+DQ_API void mat3_mul_ip( dq_real_t A[3][3], dq_real_t B[3][3] )
+{
+   int c,r;
+   dq_real_t a[3];
+   /* Each row of the result only depends on the same row of A. */
+   for (r=0; r<3; r++) {
+      memcpy( a, A[r], sizeof(dq_real_t)*3 );
+      for (c=0; c<3; c++)
+         A[r][c] = a[0]*B[0][c] + a[1]*B[1][c] + a[2]*B[2][c];
+   }
+}
+
+
+DQ_API void mat3_mul_vec( dq_real_t out[3], dq_real_t M[3][3], const dq_real_t v[3] )
+{
+   dq_real_t t[3];
    t[0] = M[0][0]*v[0] + M[0][1]*v[1] + M[0][2]*v[2];
    t[1] = M[1][0]*v[0] + M[1][1]*v[1] + M[1][2]*v[2];
    t[2] = M[2][0]*v[0] + M[2][1]*v[1] + M[2][2]*v[2];
-   memcpy( out, t, sizeof(double)*3 );
+   memcpy( out, t, sizeof(dq_real_t)*3 );
+}
+
+
+DQ_API void mat3_mul_vec_nr( dq_real_t * DQ_RESTRICT out, dq_real_t (* DQ_RESTRICT M)[3], const dq_real_t * DQ_RESTRICT v )
+{
+   out[0] = M[0][0]*v[0] + M[0][1]*v[1] + M[0][2]*v[2];
+   out[1] = M[1][0]*v[0] + M[1][1]*v[1] + M[1][2]*v[2];
+   out[2] = M[2][0]*v[0] + M[2][1]*v[1] + M[2][2]*v[2];
+}
+
+
+DQ_API void mat3_mul_vec_ip( dq_real_t v[3], dq_real_t M[3][3] )
+{
+   dq_real_t t0, t1, t2;
+   t0   = v[0];
+   t1   = v[1];
+   t2   = v[2];
+   v[0] = M[0][0]*t0 + M[0][1]*t1 + M[0][2]*t2;
+   v[1] = M[1][0]*t0 + M[1][1]*t1 + M[1][2]*t2;
+   v[2] = M[2][0]*t0 + M[2][1]*t1 + M[2][2]*t2;
 }
 
 
-void mat3_solve( double x[3], double A[3][3], const double b[3] )
+DQ_API void mat3_solve( dq_real_t x[3], dq_real_t A[3][3], const dq_real_t b[3] )
 {
    int i, j;
-   double dA, dT, T[3][3];
+   dq_real_t dA, dT, T[3][3];
 
    dA = mat3_det( A );
 #ifdef DQ_CHECK
@@ -113,7 +156,7 @@ void mat3_solve( double x[3], double A[3][3], const double b[3] )
 #endif /* DQ_CHECK */
 
    for (i=0; i<3; i++) {
-      memcpy( T, A, sizeof(double)*9 );
+      memcpy( T, A, sizeof(dq_real_t)*9 );
       for (j=0; j<3; j++)
          T[j][i] = b[j];
       dT = mat3_det( T );
@@ -122,7 +165,7 @@ void mat3_solve( double x[3], double A[3][3], const double b[3] )
 }
 
 
-int mat3_cmpV( double A[3][3], double B[3][3], double precision )
+DQ_API int mat3_cmpV( dq_real_t A[3][3], dq_real_t B[3][3], dq_real_t precision )
 {
    int c,r, ret;
    ret = 0;
@@ -137,13 +180,13 @@ int mat3_cmpV( double A[3][3], double B[3][3], double precision )
 }
 
 
-int mat3_cmp( double A[3][3], double B[3][3] )
+DQ_API int mat3_cmp( dq_real_t A[3][3], dq_real_t B[3][3] )
 {
    return mat3_cmpV( A, B, DQ_PRECISION );
 }
 
 
-void mat3_print( double M[3][3] )
+DQ_API void mat3_print( dq_real_t M[3][3] )
 {
    printf( "   % 3.3f % 3.3f % 3.3f\n"
            "   % 3.3f % 3.3f % 3.3f\n"
@@ -7,6 +7,8 @@
  * @brief File containing functions related to 3 by 3 matrix.
  */
 
+#include "dq.h"
+
 /**
  * @defgroup mat3 Auxiliary 3x3 Matrix Functions
  * @brief Set of auxiliary functions to manipulate 3x3 matrix.
@@ -25,7 +27,7 @@
  *
  *    @param[out] M An identiy matrix.
  */
-void mat3_eye( double M[3][3] );
+DQ_API void mat3_eye( double M[3][3] );
 /**
  * @brief Gets the determinant of a 3x3 3x3 3x3 matrix.
  *
@@ -36,7 +38,7 @@ void mat3_eye( double M[3][3] );
  *    @param[in] M 3x3 Matrix to get the determinant of.
  *    @return The determinant of the 3x3 matrix.
  */
-double mat3_det( double M[3][3] );
+DQ_API double mat3_det( double M[3][3] );
 /**
  * @brief Adds two 3x3 matrix.
  *
@@ -48,7 +50,7 @@ double mat3_det( double M[3][3] );
  *    @param[in] A First matrix to operate on.
  *    @param[in] B Second matrix to operate on.
  */
-void mat3_add( double out[3][3], double A[3][3], double B[3][3] );
+DQ_API void mat3_add( double out[3][3], double A[3][3], double B[3][3] );
 /**
  * @brief Subtracts two 3x3 matrix.
  *
@@ -60,7 +62,7 @@ void mat3_add( double out[3][3], double A[3][3], double B[3][3] );
  *    @param[in] A First matrix to operate on.
  *    @param[in] B Second matrix to operate on.
  */
-void mat3_sub( double out[3][3], double A[3][3], double B[3][3] );
+DQ_API void mat3_sub( double out[3][3], double A[3][3], double B[3][3] );
 /**
  * @brief Inverts a 3x3 matrix.
  *
@@ -71,7 +73,7 @@ void mat3_sub( double out[3][3], double A[3][3], double B[3][3] );
  *    @param[out] out Inversion of the matrix.
  *    @param[in] in Matrix to invert.
  */
-void mat3_inv( double out[3][3], double in[3][3] );
+DQ_API void mat3_inv( double out[3][3], double in[3][3] );
 /**
  * @brief Multiplies two 3x3 matrix.
  *
@@ -83,7 +85,31 @@ void mat3_inv( double out[3][3], double in[3][3] );
  *    @param[in] A First matrix to operate on.
  *    @param[in] B Second matrix to operate on.
  */
-void mat3_mul( double AB[3][3], double A[3][3], double B[3][3] );
+DQ_API void mat3_mul( double AB[3][3], double A[3][3], double B[3][3] );
+/**
+ * @brief Multiplies two 3x3 matrix that do not alias the result.
+ *
+ * Same as mat3_mul, but the result is written directly so AB must not overlap
+ *  A or B. This is not checked.
+ *
+ *    @param[out] AB Result of the matrix multiplication, must not overlap A nor B.
+ *    @param[in] A First matrix to operate on.
+ *    @param[in] B Second matrix to operate on.
+ * @sa mat3_mul_ip
+ */
+DQ_API void mat3_mul_nr( double (* DQ_RESTRICT AB)[3], double (* DQ_RESTRICT A)[3], double (* DQ_RESTRICT B)[3] );
+/**
+ * @brief Multiplies a 3x3 matrix in place by another on the right.
+ *
+ * \f[
+ *    A \leftarrow A * B
+ * \f]
+ *
+ *    @param A Matrix to multiply, overwritten with the result.
+ *    @param[in] B Matrix to multiply by, must not be A.
+ * @sa mat3_mul_nr
+ */
+DQ_API void mat3_mul_ip( double A[3][3], double B[3][3] );
 /**
  * @brief Multiplies a 3x3 matrix by a vector.
  *
@@ -95,7 +121,28 @@ void mat3_mul( double AB[3][3], double A[3][3], double B[3][3] );
  *    @param[in] M Matrix to operate on.
  *    @param[in] v Vector to operate on.
  */
-void mat3_mul_vec( double out[3], double M[3][3], const double v[3] );
+DQ_API void mat3_mul_vec( double out[3], double M[3][3], const double v[3] );
+/**
+ * @brief Multiplies a 3x3 matrix by a vector that does not alias the result.
+ *
+ *    @param[out] out Result of the multiplication, must not overlap M nor v.
+ *    @param[in] M Matrix to operate on.
+ *    @param[in] v Vector to operate on.
+ * @sa mat3_mul_vec
+ */
+DQ_API void mat3_mul_vec_nr( double * DQ_RESTRICT out, double (* DQ_RESTRICT M)[3], const double * DQ_RESTRICT v );
+/**
+ * @brief Multiplies a vector in place by a 3x3 matrix.
+ *
+ * \f[
+ *    v \leftarrow M * v
+ * \f]
+ *
+ *    @param v Vector to multiply, overwritten with the result.
+ *    @param[in] M Matrix to operate on.
+ * @sa mat3_mul_vec
+ */
+DQ_API void mat3_mul_vec_ip( double v[3], double M[3][3] );
 /**
  * @brief Solves a 3x3 equation system.
  *
@@ -113,7 +160,7 @@ void mat3_mul_vec( double out[3], double M[3][3], const double v[3] );
  *    @param[in] A Matrix of coefficients.
  *    @param[in] b Independent variable matrix.
  */
-void mat3_solve( double x[3], double A[3][3], const double b[3] );
+DQ_API void mat3_solve( double x[3], double A[3][3], const double b[3] );
 /**
  * @brief Compares two 3x3 matrix.
  *
@@ -121,7 +168,7 @@ void mat3_solve( double x[3], double A[3][3], const double b[3] );
  *    @param[in] B Second matrix to compare.
  *    @return 0 if they are the same.
  */
-int mat3_cmp( double A[3][3], double B[3][3] );
+DQ_API int mat3_cmp( double A[3][3], double B[3][3] );
 /**
  * @brief Compares two 3x3 matrix with custom precision.
  *
@@ -130,13 +177,13 @@ int mat3_cmp( double A[3][3], double B[3][3] );
  *    @param[in] precision Precision to use when comparing.
  *    @return 0 if they are the same.
  */
-int mat3_cmpV( double A[3][3], double B[3][3], double precision );
+DQ_API int mat3_cmpV( double A[3][3], double B[3][3], double precision );
 /**
  * @brief Prints the value of a matrix on screen.
  *
  *    @param[in] M Matrix to print.
  */
-void mat3_print( double M[3][3] );
+DQ_API void mat3_print( double M[3][3] );
 /** @} */
 
 #endif /* _MAT3_H */
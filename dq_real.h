@@ -0,0 +1,145 @@
+#ifndef _DQ_REAL_H
+#  define _DQ_REAL_H
+
+/**
+ * @file dq_real.h
+ *
+ * @brief Internal header selecting the precision the library sources are compiled with.
+ *
+ * The sources are written in terms of dq_real_t and the double precision
+ *  names. By default they build the double precision library, when DQ_FLOAT
+ *  is defined (see dqf.c) every public name is mapped to its single precision
+ *  counterpart declared in dqf.h. This header is not installed.
+ */
+
+#include "dq.h"
+#include "dq_vec3.h"
+#include "dq_mat3.h"
+#include "dq_homo.h"
+#include "dq_soa.h"
+
+
+#ifndef DQ_FLOAT
+
+typedef double dq_real_t; /**< Floating point type the sources are built with. */
+
+#else /* DQ_FLOAT */
+
+#include "dqf.h"
+
+typedef float dq_real_t; /**< Floating point type the sources are built with. */
+
+#undef  DQ_PRECISION
+#define DQ_PRECISION             DQF_PRECISION
+
+/* Types. */
+#define dq_t                     dqf_t
+#define dq_soa_s                 dqf_soa_s
+#define dq_soa_t                 dqf_soa_t
+
+/* dq.h */
+#define dq_cr_rotation           dqf_cr_rotation
+#define dq_cr_rotation_plucker   dqf_cr_rotation_plucker
+#define dq_cr_rotation_plucker_n dqf_cr_rotation_plucker_n
+#define dq_cr_rotation_matrix    dqf_cr_rotation_matrix
+#define dq_cr_rotation_matrix_n  dqf_cr_rotation_matrix_n
+#define dq_cr_translation        dqf_cr_translation
+#define dq_cr_translation_vector dqf_cr_translation_vector
+#define dq_cr_dh                 dqf_cr_dh
+#define dq_cr_mdh                dqf_cr_mdh
+#define dq_cr_point              dqf_cr_point
+#define dq_cr_line               dqf_cr_line
+#define dq_cr_line_plucker       dqf_cr_line_plucker
+#define dq_cr_plane              dqf_cr_plane
+#define dq_cr_homo               dqf_cr_homo
+#define dq_cr_homo_n             dqf_cr_homo_n
+#define dq_cr_copy               dqf_cr_copy
+#define dq_cr_conj               dqf_cr_conj
+#define dq_cr_inv                dqf_cr_inv
+#define dq_op_norm2              dqf_op_norm2
+#define dq_op_add                dqf_op_add
+#define dq_op_sub                dqf_op_sub
+#define dq_op_mul                dqf_op_mul
+#define dq_op_mul_nr             dqf_op_mul_nr
+#define dq_op_mul_ip             dqf_op_mul_ip
+#define dq_op_mul_n              dqf_op_mul_n
+#define dq_op_mul_chain          dqf_op_mul_chain
+#define dq_op_scan               dqf_op_scan
+#define dq_op_sign               dqf_op_sign
+#define dq_op_f1g                dqf_op_f1g
+#define dq_op_f1g_n              dqf_op_f1g_n
+#define dq_op_f2g                dqf_op_f2g
+#define dq_op_f2g_n              dqf_op_f2g_n
+#define dq_op_f3g                dqf_op_f3g
+#define dq_op_f3g_n              dqf_op_f3g_n
+#define dq_op_f4g                dqf_op_f4g
+#define dq_op_f4g_n              dqf_op_f4g_n
+#define dq_op_extract            dqf_op_extract
+#define dq_op_transform_points   dqf_op_transform_points
+#define dq_op_exp                dqf_op_exp
+#define dq_op_log                dqf_op_log
+#define dq_op_pow                dqf_op_pow
+#define dq_op_pow_n              dqf_op_pow_n
+#define dq_op_sclerp             dqf_op_sclerp
+#define dq_op_sclerp_n           dqf_op_sclerp_n
+#define dq_op_extract_n          dqf_op_extract_n
+#define dq_op_extract_nf         dqf_op_extract_nf
+#define dq_ch_unit               dqf_ch_unit
+#define dq_ch_point_plane        dqf_ch_point_plane
+#define dq_ch_cmp                dqf_ch_cmp
+#define dq_ch_cmpV               dqf_ch_cmpV
+#define dq_print                 dqf_print
+#define dq_print_vert            dqf_print_vert
+
+/* dq_vec3.h */
+#define vec3_dot                 vec3f_dot
+#define vec3_cross               vec3f_cross
+#define vec3_add                 vec3f_add
+#define vec3_sub                 vec3f_sub
+#define vec3_sign                vec3f_sign
+#define vec3_norm                vec3f_norm
+#define vec3_normalize           vec3f_normalize
+#define vec3_distance            vec3f_distance
+#define vec3_cmp                 vec3f_cmp
+#define vec3_cmpV                vec3f_cmpV
+#define vec3_print               vec3f_print
+
+/* dq_mat3.h */
+#define mat3_eye                 mat3f_eye
+#define mat3_det                 mat3f_det
+#define mat3_add                 mat3f_add
+#define mat3_sub                 mat3f_sub
+#define mat3_inv                 mat3f_inv
+#define mat3_mul                 mat3f_mul
+#define mat3_mul_nr              mat3f_mul_nr
+#define mat3_mul_ip              mat3f_mul_ip
+#define mat3_mul_vec             mat3f_mul_vec
+#define mat3_mul_vec_nr          mat3f_mul_vec_nr
+#define mat3_mul_vec_ip          mat3f_mul_vec_ip
+#define mat3_solve               mat3f_solve
+#define mat3_cmp                 mat3f_cmp
+#define mat3_cmpV                mat3f_cmpV
+#define mat3_print               mat3f_print
+
+/* dq_homo.h */
+#define homo_cr_join             homof_cr_join
+#define homo_op_mul              homof_op_mul
+#define homo_op_mul_nr           homof_op_mul_nr
+#define homo_op_mul_ip           homof_op_mul_ip
+#define homo_op_split            homof_op_split
+#define homo_op_mul_vec          homof_op_mul_vec
+#define homo_ch_cmpV             homof_ch_cmpV
+#define homo_ch_cmp              homof_ch_cmp
+#define homo_print               homof_print
+
+/* dq_soa.h */
+#define dq_soa_create            dqf_soa_create
+#define dq_soa_free              dqf_soa_free
+#define dq_soa_load              dqf_soa_load
+#define dq_soa_store             dqf_soa_store
+#define dq_soa_op_mul            dqf_soa_op_mul
+
+#endif /* DQ_FLOAT */
+
+
+#endif /* _DQ_REAL_H */
@@ -0,0 +1,640 @@
+#include "dq_simd.h"
+
+
+/*
+ * The kernels are written with x86 intrinsics and compiled with GCC function
+ *  target attributes, so the library itself can still be built for the
+ *  baseline instruction set and pick the kernels at runtime.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define DQ_SIMD_X86   1
+#endif
+
+#if DQ_SIMD_X86
+
+#include <immintrin.h>
+
+
+/*
+ * The dual quaternion product can be written as a sum of eight terms, one per
+ *  component of P, each being a signed permutation of Q:
+ *
+ *  PQ[k] = sum_i P[i] * sign(i,k) * Q[perm(i,k)]
+ *
+ *  P0: +0 +1 +2 +3 +4 +5 +6 +7
+ *  P1: -1 +0 -3 +2 +7 -6 +5 -4
+ *  P2: -2 +3 +0 -1 +6 +7 -4 -5
+ *  P3: -3 -2 +1 +0 -5 +4 +7 -6
+ *  P4:  0  0  0  0 +0 -3 +2 -1
+ *  P5:  0  0  0  0 +3 +0 -1 -2
+ *  P6:  0  0  0  0 -2 +1 +0 -3
+ *  P7:  0  0  0  0 +1 +2 +3 +0
+ *
+ * Rows are the components of P and columns the components of PQ. The
+ *  kernels below are all derived from this table.
+ */
+
+
+/*
+ * SSE2.
+ */
+#define SSE2_FN      __attribute__((target("sse2")))
+#define SSE2_SWAP(x) _mm_shuffle_pd( (x), (x), 1 )
+#define SSE2_SIGN(a,b) _mm_setr_pd( (a), (b) )
+
+static SSE2_FN void dq_mul_sse2_core( __m128d o[4], const double *P,
+      __m128d q01, __m128d q23, __m128d q45, __m128d q67 )
+{
+   __m128d p, s01, s23, s45, s67, m03, m30, m21, m12;
+   __m128d o01, o23, o45, o67;
+
+   s01 = SSE2_SWAP( q01 );
+   s23 = SSE2_SWAP( q23 );
+   s45 = SSE2_SWAP( q45 );
+   s67 = SSE2_SWAP( q67 );
+   m03 = _mm_shuffle_pd( q01, q23, 2 );
+   m30 = _mm_shuffle_pd( q23, q01, 1 );
+   m21 = _mm_shuffle_pd( q23, q01, 2 );
+   m12 = _mm_shuffle_pd( q01, q23, 1 );
+
+   p   = _mm_set1_pd( P[0] );
+   o01 = _mm_mul_pd( p, q01 );
+   o23 = _mm_mul_pd( p, q23 );
+   o45 = _mm_mul_pd( p, q45 );
+   o67 = _mm_mul_pd( p, q67 );
+
+   p   = _mm_set1_pd( P[1] );
+   o01 = _mm_add_pd( o01, _mm_mul_pd( p, _mm_xor_pd( s01, SSE2_SIGN(-0., 0.) ) ) );
+   o23 = _mm_add_pd( o23, _mm_mul_pd( p, _mm_xor_pd( s23, SSE2_SIGN(-0., 0.) ) ) );
+   o45 = _mm_add_pd( o45, _mm_mul_pd( p, _mm_xor_pd( s67, SSE2_SIGN( 0.,-0.) ) ) );
+   o67 = _mm_add_pd( o67, _mm_mul_pd( p, _mm_xor_pd( s45, SSE2_SIGN( 0.,-0.) ) ) );
+
+   p   = _mm_set1_pd( P[2] );
+   o01 = _mm_add_pd( o01, _mm_mul_pd( p, _mm_xor_pd( q23, SSE2_SIGN(-0., 0.) ) ) );
+   o23 = _mm_add_pd( o23, _mm_mul_pd( p, _mm_xor_pd( q01, SSE2_SIGN( 0.,-0.) ) ) );
+   o45 = _mm_add_pd( o45, _mm_mul_pd( p, q67 ) );
+   o67 = _mm_add_pd( o67, _mm_mul_pd( p, _mm_xor_pd( q45, SSE2_SIGN(-0.,-0.) ) ) );
+
+   p   = _mm_set1_pd( P[3] );
+   o01 = _mm_add_pd( o01, _mm_mul_pd( p, _mm_xor_pd( s23, SSE2_SIGN(-0.,-0.) ) ) );
+   o23 = _mm_add_pd( o23, _mm_mul_pd( p, s01 ) );
+   o45 = _mm_add_pd( o45, _mm_mul_pd( p, _mm_xor_pd( s45, SSE2_SIGN(-0., 0.) ) ) );
+   o67 = _mm_add_pd( o67, _mm_mul_pd( p, _mm_xor_pd( s67, SSE2_SIGN( 0.,-0.) ) ) );
+
+   p   = _mm_set1_pd( P[4] );
+   o45 = _mm_add_pd( o45, _mm_mul_pd( p, _mm_xor_pd( m03, SSE2_SIGN( 0.,-0.) ) ) );
+   o67 = _mm_add_pd( o67, _mm_mul_pd( p, _mm_xor_pd( m21, SSE2_SIGN( 0.,-0.) ) ) );
+
+   p   = _mm_set1_pd( P[5] );
+   o45 = _mm_add_pd( o45, _mm_mul_pd( p, m30 ) );
+   o67 = _mm_add_pd( o67, _mm_mul_pd( p, _mm_xor_pd( m12, SSE2_SIGN(-0.,-0.) ) ) );
+
+   p   = _mm_set1_pd( P[6] );
+   o45 = _mm_add_pd( o45, _mm_mul_pd( p, _mm_xor_pd( m21, SSE2_SIGN(-0., 0.) ) ) );
+   o67 = _mm_add_pd( o67, _mm_mul_pd( p, _mm_xor_pd( m03, SSE2_SIGN( 0.,-0.) ) ) );
+
+   p   = _mm_set1_pd( P[7] );
+   o45 = _mm_add_pd( o45, _mm_mul_pd( p, m12 ) );
+   o67 = _mm_add_pd( o67, _mm_mul_pd( p, m30 ) );
+
+   o[0] = o01;
+   o[1] = o23;
+   o[2] = o45;
+   o[3] = o67;
+}
+
+static SSE2_FN void dq_mul_sse2( dq_t PQ, const dq_t P, const dq_t Q )
+{
+   __m128d o[4];
+   dq_mul_sse2_core( o, P,
+         _mm_loadu_pd( &Q[0] ), _mm_loadu_pd( &Q[2] ),
+         _mm_loadu_pd( &Q[4] ), _mm_loadu_pd( &Q[6] ) );
+   _mm_storeu_pd( &PQ[0], o[0] );
+   _mm_storeu_pd( &PQ[2], o[1] );
+   _mm_storeu_pd( &PQ[4], o[2] );
+   _mm_storeu_pd( &PQ[6], o[3] );
+}
+
+static SSE2_FN void dq_f4g_sse2( dq_t ABA, const dq_t A, const dq_t B )
+{
+   __m128d o[4];
+   dq_t T;
+
+   /* AB */
+   dq_mul_sse2_core( o, A,
+         _mm_loadu_pd( &B[0] ), _mm_loadu_pd( &B[2] ),
+         _mm_loadu_pd( &B[4] ), _mm_loadu_pd( &B[6] ) );
+   _mm_storeu_pd( &T[0], o[0] );
+   _mm_storeu_pd( &T[2], o[1] );
+   _mm_storeu_pd( &T[4], o[2] );
+   _mm_storeu_pd( &T[6], o[3] );
+
+   /* AB(a_0 - a + \epsilon ( a^0 - a_7 )) */
+   dq_mul_sse2_core( o, T,
+         _mm_xor_pd( _mm_loadu_pd( &A[0] ), SSE2_SIGN( 0.,-0.) ),
+         _mm_xor_pd( _mm_loadu_pd( &A[2] ), SSE2_SIGN(-0.,-0.) ),
+         _mm_loadu_pd( &A[4] ),
+         _mm_xor_pd( _mm_loadu_pd( &A[6] ), SSE2_SIGN( 0.,-0.) ) );
+   _mm_storeu_pd( &ABA[0], o[0] );
+   _mm_storeu_pd( &ABA[2], o[1] );
+   _mm_storeu_pd( &ABA[4], o[2] );
+   _mm_storeu_pd( &ABA[6], o[3] );
+}
+
+static SSE2_FN void dq_conj_sse2( dq_t O, const dq_t Q )
+{
+   _mm_storeu_pd( &O[0], _mm_xor_pd( _mm_loadu_pd( &Q[0] ), SSE2_SIGN( 0.,-0.) ) );
+   _mm_storeu_pd( &O[2], _mm_xor_pd( _mm_loadu_pd( &Q[2] ), SSE2_SIGN(-0.,-0.) ) );
+   _mm_storeu_pd( &O[4], _mm_xor_pd( _mm_loadu_pd( &Q[4] ), SSE2_SIGN(-0.,-0.) ) );
+   _mm_storeu_pd( &O[6], _mm_xor_pd( _mm_loadu_pd( &Q[6] ), SSE2_SIGN(-0., 0.) ) );
+}
+
+/*
+ * For the extraction we write the rotation matrix as
+ *
+ *  R = (q0^2 - v.v) I + 2 v v^T + 2 q0 [v]_x,  v = (q1, q2, q3)
+ *
+ *  and the translation as 2 times the vector part of q^0 q^*.
+ */
+static SSE2_FN void dq_extract_sse2( double R[3][3], double d[3], const dq_t Q )
+{
+   double *r = &R[0][0];
+   __m128d q01, q23, q0, two, s, t;
+
+   q01 = _mm_loadu_pd( &Q[0] );
+   q23 = _mm_loadu_pd( &Q[2] );
+   q0  = _mm_set1_pd( Q[0] );
+   two = _mm_set1_pd( 2. );
+   s   = _mm_set_sd( Q[0]*Q[0] - Q[1]*Q[1] - Q[2]*Q[2] - Q[3]*Q[3] );
+
+   /* R[0][0] R[0][1] */
+   t = _mm_add_pd( _mm_mul_pd( _mm_unpackhi_pd( q01, q01 ), _mm_shuffle_pd( q01, q23, 1 ) ),
+         _mm_mul_pd( q0, _mm_setr_pd( 0., -Q[3] ) ) );
+   _mm_storeu_pd( &r[0], _mm_add_pd( _mm_mul_pd( two, t ), s ) );
+   /* R[0][2] R[1][0] */
+   t = _mm_add_pd( _mm_mul_pd( _mm_shuffle_pd( q01, q23, 1 ), _mm_unpackhi_pd( q23, q01 ) ),
+         _mm_mul_pd( q0, _mm_setr_pd( Q[2], Q[3] ) ) );
+   _mm_storeu_pd( &r[2], _mm_mul_pd( two, t ) );
+   /* R[1][1] R[1][2] */
+   t = _mm_add_pd( _mm_mul_pd( _mm_unpacklo_pd( q23, q23 ), q23 ),
+         _mm_mul_pd( q0, _mm_setr_pd( 0., -Q[1] ) ) );
+   _mm_storeu_pd( &r[4], _mm_add_pd( _mm_mul_pd( two, t ), s ) );
+   /* R[2][0] R[2][1] */
+   t = _mm_add_pd( _mm_mul_pd( _mm_unpackhi_pd( q23, q23 ), _mm_shuffle_pd( q01, q23, 1 ) ),
+         _mm_mul_pd( q0, _mm_setr_pd( -Q[2], Q[1] ) ) );
+   _mm_storeu_pd( &r[6], _mm_mul_pd( two, t ) );
+   /* R[2][2] */
+   r[8] = Q[0]*Q[0] - Q[1]*Q[1] - Q[2]*Q[2] + Q[3]*Q[3];
+
+   /* d[0] d[1] */
+   t = _mm_mul_pd( q0, _mm_loadu_pd( &Q[4] ) );
+   t = _mm_add_pd( t, _mm_mul_pd( _mm_set1_pd( Q[1] ), _mm_setr_pd( -Q[7], -Q[6] ) ) );
+   t = _mm_add_pd( t, _mm_mul_pd( _mm_set1_pd( Q[2] ), _mm_setr_pd(  Q[6], -Q[7] ) ) );
+   t = _mm_add_pd( t, _mm_mul_pd( _mm_set1_pd( Q[3] ), _mm_setr_pd( -Q[5],  Q[4] ) ) );
+   _mm_storeu_pd( &d[0], _mm_mul_pd( two, t ) );
+   d[2] = 2.*( Q[0]*Q[6] - Q[3]*Q[7] + Q[1]*Q[5] - Q[2]*Q[4] );
+}
+
+
+/*
+ * AVX2 + FMA.
+ *
+ * The real and dual parts each fit in a register. Real components of P only
+ *  mix real with real and dual with dual, while dual components of P only
+ *  contribute to the dual part of the result.
+ */
+#define AVX2_FN      __attribute__((target("avx2,fma")))
+#define AVX2_PERM(a,b,c,d) ((a) | ((b)<<2) | ((c)<<4) | ((d)<<6))
+#define AVX2_SIGN(a,b,c,d) _mm256_setr_pd( (a), (b), (c), (d) )
+#define AVX2_TERM(acc,p,x,perm,sign) \
+   (acc) = _mm256_fmadd_pd( (p), _mm256_xor_pd( _mm256_permute4x64_pd( (x), (perm) ), (sign) ), (acc) )
+
+static AVX2_FN void dq_mul_avx2_core( __m256d *olo, __m256d *ohi, const double *P,
+      __m256d lo, __m256d hi )
+{
+   __m256d p, rlo, rhi, rd;
+
+   p   = _mm256_broadcast_sd( &P[0] );
+   rlo = _mm256_mul_pd( p, lo );
+   rhi = _mm256_mul_pd( p, hi );
+
+   p   = _mm256_broadcast_sd( &P[1] );
+   rlo = _mm256_fmadd_pd( p, _mm256_xor_pd( _mm256_permute_pd( lo, 0x5 ),
+            AVX2_SIGN(-0., 0.,-0., 0.) ), rlo );
+   AVX2_TERM( rhi, p, hi, AVX2_PERM(3,2,1,0), AVX2_SIGN( 0.,-0., 0.,-0.) );
+
+   p   = _mm256_broadcast_sd( &P[2] );
+   AVX2_TERM( rlo, p, lo, AVX2_PERM(2,3,0,1), AVX2_SIGN(-0., 0., 0.,-0.) );
+   AVX2_TERM( rhi, p, hi, AVX2_PERM(2,3,0,1), AVX2_SIGN( 0., 0.,-0.,-0.) );
+
+   p   = _mm256_broadcast_sd( &P[3] );
+   AVX2_TERM( rlo, p, lo, AVX2_PERM(3,2,1,0), AVX2_SIGN(-0.,-0., 0., 0.) );
+   rhi = _mm256_fmadd_pd( p, _mm256_xor_pd( _mm256_permute_pd( hi, 0x5 ),
+            AVX2_SIGN(-0., 0., 0.,-0.) ), rhi );
+
+   /* Dual part of P in a separate accumulator to shorten the dependency chain. */
+   rd  = _mm256_mul_pd( _mm256_broadcast_sd( &P[7] ),
+         _mm256_permute4x64_pd( lo, AVX2_PERM(1,2,3,0) ) );
+   AVX2_TERM( rd, _mm256_broadcast_sd( &P[4] ), lo, AVX2_PERM(0,3,2,1), AVX2_SIGN( 0.,-0., 0.,-0.) );
+   AVX2_TERM( rd, _mm256_broadcast_sd( &P[5] ), lo, AVX2_PERM(3,0,1,2), AVX2_SIGN( 0., 0.,-0.,-0.) );
+   AVX2_TERM( rd, _mm256_broadcast_sd( &P[6] ), lo, AVX2_PERM(2,1,0,3), AVX2_SIGN(-0., 0., 0.,-0.) );
+
+   *olo = rlo;
+   *ohi = _mm256_add_pd( rhi, rd );
+}
+
+static AVX2_FN void dq_mul_avx2( dq_t PQ, const dq_t P, const dq_t Q )
+{
+   __m256d lo, hi;
+   dq_mul_avx2_core( &lo, &hi, P, _mm256_loadu_pd( &Q[0] ), _mm256_loadu_pd( &Q[4] ) );
+   _mm256_storeu_pd( &PQ[0], lo );
+   _mm256_storeu_pd( &PQ[4], hi );
+}
+
+static AVX2_FN void dq_f4g_avx2( dq_t ABA, const dq_t A, const dq_t B )
+{
+   __m256d lo, hi;
+   dq_t T;
+
+   /* AB */
+   dq_mul_avx2_core( &lo, &hi, A, _mm256_loadu_pd( &B[0] ), _mm256_loadu_pd( &B[4] ) );
+   _mm256_storeu_pd( &T[0], lo );
+   _mm256_storeu_pd( &T[4], hi );
+
+   /* AB(a_0 - a + \epsilon ( a^0 - a_7 )) */
+   dq_mul_avx2_core( &lo, &hi, T,
+         _mm256_xor_pd( _mm256_loadu_pd( &A[0] ), AVX2_SIGN( 0.,-0.,-0.,-0.) ),
+         _mm256_xor_pd( _mm256_loadu_pd( &A[4] ), AVX2_SIGN( 0., 0., 0.,-0.) ) );
+   _mm256_storeu_pd( &ABA[0], lo );
+   _mm256_storeu_pd( &ABA[4], hi );
+}
+
+static AVX2_FN void dq_conj_avx2( dq_t O, const dq_t Q )
+{
+   _mm256_storeu_pd( &O[0], _mm256_xor_pd( _mm256_loadu_pd( &Q[0] ), AVX2_SIGN( 0.,-0.,-0.,-0.) ) );
+   _mm256_storeu_pd( &O[4], _mm256_xor_pd( _mm256_loadu_pd( &Q[4] ), AVX2_SIGN(-0.,-0.,-0., 0.) ) );
+}
+
+static AVX2_FN void dq_extract_avx2( double R[3][3], double d[3], const dq_t Q )
+{
+   double *r = &R[0][0];
+   __m256d lo, hi, q0, s, t;
+
+   lo = _mm256_loadu_pd( &Q[0] );
+   hi = _mm256_loadu_pd( &Q[4] );
+   q0 = _mm256_broadcast_sd( &Q[0] );
+   s  = _mm256_set_pd( 0., 0., 0., Q[0]*Q[0] - Q[1]*Q[1] - Q[2]*Q[2] - Q[3]*Q[3] );
+
+   /* R[0][0] R[0][1] R[0][2] R[1][0] */
+   t = _mm256_mul_pd( q0, _mm256_xor_pd( _mm256_permute4x64_pd( lo, AVX2_PERM(0,3,2,3) ),
+            AVX2_SIGN( 0.,-0., 0., 0.) ) );
+   t = _mm256_blend_pd( t, _mm256_setzero_pd(), 0x1 );
+   t = _mm256_fmadd_pd( _mm256_permute4x64_pd( lo, AVX2_PERM(1,1,1,2) ),
+         _mm256_permute4x64_pd( lo, AVX2_PERM(1,2,3,1) ), t );
+   _mm256_storeu_pd( &r[0], _mm256_fmadd_pd( _mm256_set1_pd( 2. ), t, s ) );
+   /* R[1][1] R[1][2] R[2][0] R[2][1] */
+   t = _mm256_mul_pd( q0, _mm256_xor_pd( _mm256_permute4x64_pd( lo, AVX2_PERM(0,1,2,1) ),
+            AVX2_SIGN( 0.,-0.,-0., 0.) ) );
+   t = _mm256_blend_pd( t, _mm256_setzero_pd(), 0x1 );
+   t = _mm256_fmadd_pd( _mm256_permute4x64_pd( lo, AVX2_PERM(2,2,3,3) ),
+         _mm256_permute4x64_pd( lo, AVX2_PERM(2,3,1,2) ), t );
+   _mm256_storeu_pd( &r[4], _mm256_fmadd_pd( _mm256_set1_pd( 2. ), t, s ) );
+   /* R[2][2] */
+   r[8] = Q[0]*Q[0] - Q[1]*Q[1] - Q[2]*Q[2] + Q[3]*Q[3];
+
+   /* d */
+   t = _mm256_mul_pd( q0, hi );
+   AVX2_TERM( t, _mm256_broadcast_sd( &Q[1] ), hi, AVX2_PERM(3,2,1,0), AVX2_SIGN(-0.,-0., 0., 0.) );
+   AVX2_TERM( t, _mm256_broadcast_sd( &Q[2] ), hi, AVX2_PERM(2,3,0,1), AVX2_SIGN( 0.,-0.,-0., 0.) );
+   AVX2_TERM( t, _mm256_broadcast_sd( &Q[3] ), hi, AVX2_PERM(1,0,3,2), AVX2_SIGN(-0., 0.,-0., 0.) );
+   t = _mm256_mul_pd( _mm256_set1_pd( 2. ), t );
+   _mm_storeu_pd( &d[0], _mm256_castpd256_pd128( t ) );
+   _mm_store_sd( &d[2], _mm256_extractf128_pd( t, 1 ) );
+}
+
+/* Four dual quaternions at a time, one entry of the four matrices per register. */
+static AVX2_FN void dq_extract4_avx2( double V[12][4], dq_t *Q )
+{
+   __m256d a[4], b[4], t[4], q[8], s00, s11, s22, s33, two;
+   int k;
+
+   for (k=0; k<4; k++) {
+      a[k] = _mm256_loadu_pd( &Q[k][0] );
+      b[k] = _mm256_loadu_pd( &Q[k][4] );
+   }
+   /* Transpose so q[i] holds component i of the four dual quaternions. */
+   t[0] = _mm256_unpacklo_pd( a[0], a[1] );
+   t[1] = _mm256_unpackhi_pd( a[0], a[1] );
+   t[2] = _mm256_unpacklo_pd( a[2], a[3] );
+   t[3] = _mm256_unpackhi_pd( a[2], a[3] );
+   q[0] = _mm256_permute2f128_pd( t[0], t[2], 0x20 );
+   q[1] = _mm256_permute2f128_pd( t[1], t[3], 0x20 );
+   q[2] = _mm256_permute2f128_pd( t[0], t[2], 0x31 );
+   q[3] = _mm256_permute2f128_pd( t[1], t[3], 0x31 );
+   t[0] = _mm256_unpacklo_pd( b[0], b[1] );
+   t[1] = _mm256_unpackhi_pd( b[0], b[1] );
+   t[2] = _mm256_unpacklo_pd( b[2], b[3] );
+   t[3] = _mm256_unpackhi_pd( b[2], b[3] );
+   q[4] = _mm256_permute2f128_pd( t[0], t[2], 0x20 );
+   q[5] = _mm256_permute2f128_pd( t[1], t[3], 0x20 );
+   q[6] = _mm256_permute2f128_pd( t[0], t[2], 0x31 );
+   q[7] = _mm256_permute2f128_pd( t[1], t[3], 0x31 );
+
+   two = _mm256_set1_pd( 2. );
+   s00 = _mm256_mul_pd( q[0], q[0] );
+   s11 = _mm256_mul_pd( q[1], q[1] );
+   s22 = _mm256_mul_pd( q[2], q[2] );
+   s33 = _mm256_mul_pd( q[3], q[3] );
+
+   /* R */
+   _mm256_storeu_pd( V[0],  _mm256_sub_pd( _mm256_add_pd( s00, s11 ), _mm256_add_pd( s22, s33 ) ) );
+   _mm256_storeu_pd( V[5],  _mm256_sub_pd( _mm256_add_pd( s00, s22 ), _mm256_add_pd( s11, s33 ) ) );
+   _mm256_storeu_pd( V[10], _mm256_sub_pd( _mm256_add_pd( s00, s33 ), _mm256_add_pd( s11, s22 ) ) );
+   _mm256_storeu_pd( V[1],  _mm256_mul_pd( two, _mm256_fmsub_pd( q[1], q[2], _mm256_mul_pd( q[0], q[3] ) ) ) );
+   _mm256_storeu_pd( V[4],  _mm256_mul_pd( two, _mm256_fmadd_pd( q[1], q[2], _mm256_mul_pd( q[0], q[3] ) ) ) );
+   _mm256_storeu_pd( V[2],  _mm256_mul_pd( two, _mm256_fmadd_pd( q[1], q[3], _mm256_mul_pd( q[0], q[2] ) ) ) );
+   _mm256_storeu_pd( V[8],  _mm256_mul_pd( two, _mm256_fmsub_pd( q[1], q[3], _mm256_mul_pd( q[0], q[2] ) ) ) );
+   _mm256_storeu_pd( V[6],  _mm256_mul_pd( two, _mm256_fmsub_pd( q[2], q[3], _mm256_mul_pd( q[0], q[1] ) ) ) );
+   _mm256_storeu_pd( V[9],  _mm256_mul_pd( two, _mm256_fmadd_pd( q[2], q[3], _mm256_mul_pd( q[0], q[1] ) ) ) );
+
+   /* d */
+   _mm256_storeu_pd( V[3],  _mm256_mul_pd( two, _mm256_add_pd(
+               _mm256_fmsub_pd( q[0], q[4], _mm256_mul_pd( q[1], q[7] ) ),
+               _mm256_fmsub_pd( q[2], q[6], _mm256_mul_pd( q[3], q[5] ) ) ) ) );
+   _mm256_storeu_pd( V[7],  _mm256_mul_pd( two, _mm256_add_pd(
+               _mm256_fmsub_pd( q[0], q[5], _mm256_mul_pd( q[2], q[7] ) ),
+               _mm256_fmsub_pd( q[3], q[4], _mm256_mul_pd( q[1], q[6] ) ) ) ) );
+   _mm256_storeu_pd( V[11], _mm256_mul_pd( two, _mm256_add_pd(
+               _mm256_fmsub_pd( q[0], q[6], _mm256_mul_pd( q[3], q[7] ) ),
+               _mm256_fmsub_pd( q[1], q[5], _mm256_mul_pd( q[2], q[4] ) ) ) ) );
+}
+
+
+/*
+ * Structure of arrays, one dual quaternion per lane, so the product is the
+ *  expressions of dq_op_mul on whole registers. Every lane is loaded before
+ *  any is stored, so the output rows may be the input rows.
+ */
+#define SOA_MUL(o,p,q,MUL,FMA,FNMA) \
+   do { \
+      o[0] = MUL(  p[0], q[0] ); \
+      o[0] = FNMA( p[1], q[1], o[0] ); \
+      o[0] = FNMA( p[2], q[2], o[0] ); \
+      o[0] = FNMA( p[3], q[3], o[0] ); \
+      o[1] = MUL(  p[0], q[1] ); \
+      o[1] = FMA(  p[1], q[0], o[1] ); \
+      o[1] = FMA(  p[2], q[3], o[1] ); \
+      o[1] = FNMA( p[3], q[2], o[1] ); \
+      o[2] = MUL(  p[0], q[2] ); \
+      o[2] = FMA(  p[2], q[0], o[2] ); \
+      o[2] = FNMA( p[1], q[3], o[2] ); \
+      o[2] = FMA(  p[3], q[1], o[2] ); \
+      o[3] = MUL(  p[0], q[3] ); \
+      o[3] = FMA(  p[3], q[0], o[3] ); \
+      o[3] = FMA(  p[1], q[2], o[3] ); \
+      o[3] = FNMA( p[2], q[1], o[3] ); \
+      o[4] = MUL(  p[4], q[0] ); \
+      o[4] = FMA(  p[0], q[4], o[4] ); \
+      o[4] = FMA(  p[7], q[1], o[4] ); \
+      o[4] = FMA(  p[1], q[7], o[4] ); \
+      o[4] = FNMA( p[6], q[2], o[4] ); \
+      o[4] = FMA(  p[2], q[6], o[4] ); \
+      o[4] = FMA(  p[5], q[3], o[4] ); \
+      o[4] = FNMA( p[3], q[5], o[4] ); \
+      o[5] = MUL(  p[5], q[0] ); \
+      o[5] = FMA(  p[0], q[5], o[5] ); \
+      o[5] = FMA(  p[6], q[1], o[5] ); \
+      o[5] = FNMA( p[1], q[6], o[5] ); \
+      o[5] = FMA(  p[7], q[2], o[5] ); \
+      o[5] = FMA(  p[2], q[7], o[5] ); \
+      o[5] = FNMA( p[4], q[3], o[5] ); \
+      o[5] = FMA(  p[3], q[4], o[5] ); \
+      o[6] = MUL(  p[6], q[0] ); \
+      o[6] = FMA(  p[0], q[6], o[6] ); \
+      o[6] = FNMA( p[5], q[1], o[6] ); \
+      o[6] = FMA(  p[1], q[5], o[6] ); \
+      o[6] = FMA(  p[4], q[2], o[6] ); \
+      o[6] = FNMA( p[2], q[4], o[6] ); \
+      o[6] = FMA(  p[7], q[3], o[6] ); \
+      o[6] = FMA(  p[3], q[7], o[6] ); \
+      o[7] = MUL(  p[7], q[0] ); \
+      o[7] = FMA(  p[0], q[7], o[7] ); \
+      o[7] = FNMA( p[1], q[4], o[7] ); \
+      o[7] = FNMA( p[4], q[1], o[7] ); \
+      o[7] = FNMA( p[2], q[5], o[7] ); \
+      o[7] = FNMA( p[5], q[2], o[7] ); \
+      o[7] = FNMA( p[3], q[6], o[7] ); \
+      o[7] = FNMA( p[6], q[3], o[7] ); \
+   } while (0)
+
+static AVX2_FN int dq_mul_soa_avx2( double *const o[8], double *const p[8], double *const q[8], int n )
+{
+   __m256d P[8], Q[8], O[8];
+   int i, k;
+
+   for (k=0; k+4<=n; k+=4) {
+      for (i=0; i<8; i++) {
+         P[i] = _mm256_loadu_pd( p[i]+k );
+         Q[i] = _mm256_loadu_pd( q[i]+k );
+      }
+      SOA_MUL( O, P, Q, _mm256_mul_pd, _mm256_fmadd_pd, _mm256_fnmadd_pd );
+      for (i=0; i<8; i++)
+         _mm256_storeu_pd( o[i]+k, O[i] );
+   }
+   return k;
+}
+
+
+/*
+ * AVX-512.
+ *
+ * A whole dual quaternion fits in a register, so each row of the table is a
+ *  single permutation, with the signs and zeros applied through masks.
+ */
+#define AVX512_FN    __attribute__((target("avx512f,avx2,fma")))
+#define AVX512_TERM(acc,p,q,zmask,negmask,i0,i1,i2,i3,i4,i5,i6,i7) \
+   do { \
+      __m512d _t = _mm512_maskz_permutexvar_pd( (zmask), \
+            _mm512_setr_epi64( i0, i1, i2, i3, i4, i5, i6, i7 ), (q) ); \
+      _t    = _mm512_mask_sub_pd( _t, (negmask), _mm512_setzero_pd(), _t ); \
+      (acc) = _mm512_fmadd_pd( _mm512_set1_pd( p ), _t, (acc) ); \
+   } while (0)
+
+static AVX512_FN __m512d dq_mul_avx512_core( const double *P, __m512d q )
+{
+   __m512d r, rd;
+   /* Two accumulators to halve the length of the dependency chain. */
+   r  = _mm512_mul_pd( _mm512_set1_pd( P[0] ), q );
+   rd = _mm512_maskz_permutexvar_pd( 0xF0, _mm512_setr_epi64( 0, 0, 0, 0, 1, 2, 3, 0 ), q );
+   rd = _mm512_mul_pd( _mm512_set1_pd( P[7] ), rd );
+   AVX512_TERM( r,  P[1], q, 0xFF, 0xA5, 1, 0, 3, 2, 7, 6, 5, 4 );
+   AVX512_TERM( rd, P[4], q, 0xF0, 0xA0, 0, 0, 0, 0, 0, 3, 2, 1 );
+   AVX512_TERM( r,  P[2], q, 0xFF, 0xC9, 2, 3, 0, 1, 6, 7, 4, 5 );
+   AVX512_TERM( rd, P[5], q, 0xF0, 0xC0, 0, 0, 0, 0, 3, 0, 1, 2 );
+   AVX512_TERM( r,  P[3], q, 0xFF, 0x93, 3, 2, 1, 0, 5, 4, 7, 6 );
+   AVX512_TERM( rd, P[6], q, 0xF0, 0x90, 0, 0, 0, 0, 2, 1, 0, 3 );
+   return _mm512_add_pd( r, rd );
+}
+
+static AVX512_FN void dq_mul_avx512( dq_t PQ, const dq_t P, const dq_t Q )
+{
+   _mm512_storeu_pd( PQ, dq_mul_avx512_core( P, _mm512_loadu_pd( Q ) ) );
+}
+
+static AVX512_FN void dq_f4g_avx512( dq_t ABA, const dq_t A, const dq_t B )
+{
+   __m512d a;
+   dq_t T;
+
+   /* AB */
+   _mm512_storeu_pd( T, dq_mul_avx512_core( A, _mm512_loadu_pd( B ) ) );
+
+   /* AB(a_0 - a + \epsilon ( a^0 - a_7 )) */
+   a = _mm512_loadu_pd( A );
+   a = _mm512_mask_sub_pd( a, 0x8E, _mm512_setzero_pd(), a );
+   _mm512_storeu_pd( ABA, dq_mul_avx512_core( T, a ) );
+}
+
+static AVX512_FN void dq_conj_avx512( dq_t O, const dq_t Q )
+{
+   __m512d q = _mm512_loadu_pd( Q );
+   _mm512_storeu_pd( O, _mm512_mask_sub_pd( q, 0x7E, _mm512_setzero_pd(), q ) );
+}
+
+static AVX512_FN void dq_extract_avx512( double R[3][3], double d[3], const dq_t Q )
+{
+   double *r = &R[0][0];
+   __m512d q, t;
+   __m256d hi, u;
+   double s;
+
+   q = _mm512_loadu_pd( Q );
+   s = Q[0]*Q[0] - Q[1]*Q[1] - Q[2]*Q[2] - Q[3]*Q[3];
+
+   /* First eight elements of R, in row major order. */
+   t = _mm512_maskz_permutexvar_pd( 0xEE, _mm512_setr_epi64( 0, 3, 2, 3, 0, 1, 2, 1 ), q );
+   t = _mm512_mask_sub_pd( t, 0x62, _mm512_setzero_pd(), t );
+   t = _mm512_mul_pd( _mm512_set1_pd( Q[0] ), t );
+   t = _mm512_fmadd_pd( _mm512_permutexvar_pd( _mm512_setr_epi64( 1, 1, 1, 2, 2, 2, 3, 3 ), q ),
+         _mm512_permutexvar_pd( _mm512_setr_epi64( 1, 2, 3, 1, 2, 3, 1, 2 ), q ), t );
+   t = _mm512_mul_pd( _mm512_set1_pd( 2. ), t );
+   t = _mm512_mask_add_pd( t, 0x11, t, _mm512_set1_pd( s ) );
+   _mm512_storeu_pd( r, t );
+   r[8] = Q[0]*Q[0] - Q[1]*Q[1] - Q[2]*Q[2] + Q[3]*Q[3];
+
+   /* The translation only has three elements so it stays in AVX2. */
+   hi = _mm256_loadu_pd( &Q[4] );
+   u  = _mm256_mul_pd( _mm256_broadcast_sd( &Q[0] ), hi );
+   AVX2_TERM( u, _mm256_broadcast_sd( &Q[1] ), hi, AVX2_PERM(3,2,1,0), AVX2_SIGN(-0.,-0., 0., 0.) );
+   AVX2_TERM( u, _mm256_broadcast_sd( &Q[2] ), hi, AVX2_PERM(2,3,0,1), AVX2_SIGN( 0.,-0.,-0., 0.) );
+   AVX2_TERM( u, _mm256_broadcast_sd( &Q[3] ), hi, AVX2_PERM(1,0,3,2), AVX2_SIGN(-0., 0.,-0., 0.) );
+   u = _mm256_mul_pd( _mm256_set1_pd( 2. ), u );
+   _mm_storeu_pd( &d[0], _mm256_castpd256_pd128( u ) );
+   _mm_store_sd( &d[2], _mm256_extractf128_pd( u, 1 ) );
+}
+
+
+static AVX512_FN int dq_mul_soa_avx512( double *const o[8], double *const p[8], double *const q[8], int n )
+{
+   __m512d P[8], Q[8], O[8];
+   int i, k;
+
+   for (k=0; k+8<=n; k+=8) {
+      for (i=0; i<8; i++) {
+         P[i] = _mm512_loadu_pd( p[i]+k );
+         Q[i] = _mm512_loadu_pd( q[i]+k );
+      }
+      SOA_MUL( O, P, Q, _mm512_mul_pd, _mm512_fmadd_pd, _mm512_fnmadd_pd );
+      for (i=0; i<8; i++)
+         _mm512_storeu_pd( o[i]+k, O[i] );
+   }
+   return k;
+}
+
+
+int dq_simd_detect( void )
+{
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports( "avx512f" ) &&
+         __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ))
+      return DQ_SIMD_AVX512;
+   if (__builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ))
+      return DQ_SIMD_AVX2;
+   if (__builtin_cpu_supports( "sse2" ))
+      return DQ_SIMD_SSE2;
+   return DQ_SIMD_SCALAR;
+}
+
+
+void dq_simd_kernels( dq_kernels_t *K, int level )
+{
+   switch (level) {
+      case DQ_SIMD_AVX512:
+         K->mul     = dq_mul_avx512;
+         K->f4g     = dq_f4g_avx512;
+         K->extract = dq_extract_avx512;
+         K->conj    = dq_conj_avx512;
+         /* Four dual quaternions already fill AVX2 registers. */
+         K->extract4 = dq_extract4_avx2;
+         break;
+      case DQ_SIMD_AVX2:
+         K->mul     = dq_mul_avx2;
+         K->f4g     = dq_f4g_avx2;
+         K->extract = dq_extract_avx2;
+         K->conj    = dq_conj_avx2;
+         K->extract4 = dq_extract4_avx2;
+         break;
+      case DQ_SIMD_SSE2:
+         K->mul     = dq_mul_sse2;
+         K->f4g     = dq_f4g_sse2;
+         K->extract = dq_extract_sse2;
+         K->conj    = dq_conj_sse2;
+         break;
+      default:
+         break;
+   }
+}
+
+
+int dq_simd_mul_soa( double *const o[8], double *const p[8], double *const q[8], int n, int level )
+{
+   switch (level) {
+      case DQ_SIMD_AVX512:
+         return dq_mul_soa_avx512( o, p, q, n );
+      case DQ_SIMD_AVX2:
+         return dq_mul_soa_avx2( o, p, q, n );
+      default:
+         /* SSE2 is the baseline the compiler already vectorizes for. */
+         return 0;
+   }
+}
+
+
+#else /* DQ_SIMD_X86 */
+
+
+int dq_simd_detect( void )
+{
+   return DQ_SIMD_SCALAR;
+}
+
+
+void dq_simd_kernels( dq_kernels_t *K, int level )
+{
+   (void) K;
+   (void) level;
+}
+
+
+int dq_simd_mul_soa( double *const o[8], double *const p[8], double *const q[8], int n, int level )
+{
+   (void) o;
+   (void) p;
+   (void) q;
+   (void) n;
+   (void) level;
+   return 0;
+}
+
+
+#endif /* DQ_SIMD_X86 */
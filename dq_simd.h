@@ -0,0 +1,72 @@
+#ifndef _DQ_SIMD_H
+#  define _DQ_SIMD_H
+
+/**
+ * @file dq_simd.h
+ *
+ * @brief Internal interface between dq.c and the vectorized kernels.
+ *
+ * This header is not installed. Users select the kernels with dq_simd_set.
+ */
+
+#include "dq.h"
+
+
+/*
+ * The functions below are shared between the objects of the library but
+ *  are not part of its interface, so they are kept out of the symbols
+ *  exported by the shared library where the compiler allows it.
+ */
+#if defined(__GNUC__) && (__GNUC__ >= 4) && !defined(_WIN32) && !defined(__CYGWIN__)
+#  define DQ_HIDDEN     __attribute__((visibility("hidden")))
+#else
+#  define DQ_HIDDEN
+#endif
+
+
+/**
+ * @brief Table of implementations of the dispatched dual quaternion operations.
+ */
+typedef struct dq_kernels_s {
+   void (*mul)( dq_t PQ, const dq_t P, const dq_t Q ); /**< dq_op_mul */
+   void (*f4g)( dq_t ABA, const dq_t A, const dq_t B ); /**< dq_op_f4g */
+   void (*extract)( double R[3][3], double d[3], const dq_t Q ); /**< dq_op_extract */
+   void (*conj)( dq_t O, const dq_t Q ); /**< dq_cr_conj */
+   void (*extract4)( double V[12][4], dq_t *Q ); /**< Four matrices of dq_op_extract_n */
+} dq_kernels_t;
+
+
+/**
+ * @brief Detects the best instruction set supported by the running CPU.
+ *
+ *    @return One of the DQ_SIMD_* levels.
+ */
+DQ_HIDDEN int dq_simd_detect( void );
+/**
+ * @brief Overwrites the kernels implemented for an instruction set.
+ *
+ * Kernels are only overwritten if they are implemented for the level, so K
+ *  should be filled with the scalar implementations beforehand.
+ *
+ *    @param K Table of kernels to fill.
+ *    @param[in] level Instruction set to use, must be supported by the CPU.
+ */
+DQ_HIDDEN void dq_simd_kernels( dq_kernels_t *K, int level );
+/**
+ * @brief Multiplies the leading lanes of structures of arrays, see dq_soa_op_mul.
+ *
+ * Only whole registers of the instruction set are computed, the caller
+ *  multiplies the remaining lanes. The output rows may be the input rows
+ *  but must not overlap them otherwise.
+ *
+ *    @param o Rows of the results.
+ *    @param[in] p Rows of the first dual quaternions.
+ *    @param[in] q Rows of the second dual quaternions.
+ *    @param[in] n Number of lanes.
+ *    @param[in] level Instruction set to use, must be supported by the CPU.
+ *    @return Number of leading lanes multiplied.
+ */
+DQ_HIDDEN int dq_simd_mul_soa( double *const o[8], double *const p[8], double *const q[8], int n, int level );
+
+
+#endif /* _DQ_SIMD_H */
@@ -0,0 +1,142 @@
+#include "dq_sincos.h"
+
+#include <math.h>
+#ifdef DQ_CHECK
+#include <assert.h>
+#endif /* DQ_CHECK */
+
+
+/**
+ * Largest angle the polynomials handle, beyond it the reduction by pi/2
+ *  loses precision and libm is used instead.
+ */
+#define DQ_SINCOS_RANGE    1e5
+
+
+/*
+ * -ffast-math folds away the rounding of the polynomials below, see
+ *  DQ_ROUND. Such builds, which include the header-only build by a caller
+ *  using those flags, only have libm.
+ */
+#ifdef __FAST_MATH__
+static int dq_sincos_mode = DQ_SINCOS_LIBM; /**< Implementation used by dq_sincos_n. */
+#else /* __FAST_MATH__ */
+static int dq_sincos_mode = DQ_SINCOS_VECTOR; /**< Implementation used by dq_sincos_n. */
+#endif /* __FAST_MATH__ */
+
+
+DQ_API int dq_sincos_set( int mode )
+{
+#ifdef __FAST_MATH__
+   (void) mode;
+#else /* __FAST_MATH__ */
+   if ((mode == DQ_SINCOS_LIBM) || (mode == DQ_SINCOS_VECTOR) || (mode == DQ_SINCOS_FAST))
+      dq_sincos_mode = mode;
+#endif /* __FAST_MATH__ */
+   return dq_sincos_mode;
+}
+
+
+DQ_API int dq_sincos_get( void )
+{
+   return dq_sincos_mode;
+}
+
+
+#ifndef __FAST_MATH__
+/*
+ * The polynomials work on the angle reduced to [-pi/4,pi/4] by subtracting
+ *  the closest multiple q of pi/2, with pi/2 split in three parts so the
+ *  products are exact (Cody and Waite). The quadrant q mod 4 then swaps and
+ *  changes the sign of the results. Every step is arithmetic or a select, so
+ *  the loops vectorize.
+ *
+ * The rounding of x 2/pi to the nearest integer adds and subtracts 1.5 2^52,
+ *  which must not be simplified away by the compiler, so the polynomials
+ *  are left out of builds with -ffast-math.
+ */
+#define DQ_2_PI      6.36619772367581382433e-01 /**< 2/pi */
+#define DQ_PIO2_1    1.57079632673412561417e+00 /**< First 33 bits of pi/2. */
+#define DQ_PIO2_2    6.07710050630396597660e-11 /**< Next 33 bits of pi/2. */
+#define DQ_PIO2_3    2.02226624871116645580e-21 /**< Rest of pi/2. */
+#define DQ_ROUND     6755399441055744.          /**< 1.5 2^52, rounds to integer when added. */
+
+
+/**
+ * @brief Sines and cosines with the fdlibm kernels, within 1 ulp.
+ */
+static void dq_sincos_vector( double *s, double *c, const double *x, int n )
+{
+   double q, r, z, ps, pc, t;
+   int i, k;
+
+   for (i=0; i<n; i++) {
+      q  = (x[i]*DQ_2_PI + DQ_ROUND) - DQ_ROUND;
+      r  = ((x[i] - q*DQ_PIO2_1) - q*DQ_PIO2_2) - q*DQ_PIO2_3;
+      z  = r*r;
+      ps = r + r*z*(-1.66666666666666324348e-01 + z*(8.33333333332248946124e-03 +
+               z*(-1.98412698298579493134e-04 + z*(2.75573137070700676789e-06 +
+               z*(-2.50507602534068634195e-08 + z*1.58969099521155010221e-10)))));
+      pc = 1. - 0.5*z + z*z*(4.16666666666666019037e-02 + z*(-1.38888888888741095749e-03 +
+               z*(2.48015872894767294178e-05 + z*(-2.75573143513906633035e-07 +
+               z*(2.08757232129817482790e-09 + z*-1.13596475577881948265e-11)))));
+      k    = (int) q;
+      t    = (k & 1) ? pc : ps;
+      pc   = (k & 1) ? ps : pc;
+      s[i] = (k & 2) ? -t : t;
+      c[i] = ((k+1) & 2) ? -pc : pc;
+   }
+}
+
+
+/**
+ * @brief Sines and cosines with the cephes single precision kernels, within 3e-9.
+ */
+static void dq_sincos_fast( double *s, double *c, const double *x, int n )
+{
+   double q, r, z, ps, pc, t;
+   int i, k;
+
+   for (i=0; i<n; i++) {
+      q  = (x[i]*DQ_2_PI + DQ_ROUND) - DQ_ROUND;
+      r  = (x[i] - q*DQ_PIO2_1) - q*DQ_PIO2_2;
+      z  = r*r;
+      ps = r + r*z*(-1.6666654611e-01 + z*(8.3321608736e-03 + z*-1.9515295891e-04));
+      pc = 1. - 0.5*z + z*z*(4.166664568298827e-02 + z*(-1.388731625493765e-03 +
+               z*2.443315711809948e-05));
+      k    = (int) q;
+      t    = (k & 1) ? pc : ps;
+      pc   = (k & 1) ? ps : pc;
+      s[i] = (k & 2) ? -t : t;
+      c[i] = ((k+1) & 2) ? -pc : pc;
+   }
+}
+#endif /* !__FAST_MATH__ */
+
+
+DQ_API void dq_sincos_n( double *s, double *c, const double *x, int n )
+{
+   int i;
+
+#ifdef DQ_CHECK
+   assert( n >= 0 );
+#endif /* DQ_CHECK */
+
+   /* Huge angles, infinities and NaN go through libm, the negated test
+    * also stops at NaN. */
+   for (i=0; i<n; i++)
+      if (!(fabs(x[i]) <= DQ_SINCOS_RANGE))
+         break;
+   if ((dq_sincos_mode == DQ_SINCOS_LIBM) || (i < n)) {
+      for (i=0; i<n; i++) {
+         s[i] = sin( x[i] );
+         c[i] = cos( x[i] );
+      }
+   }
+#ifndef __FAST_MATH__
+   else if (dq_sincos_mode == DQ_SINCOS_FAST)
+      dq_sincos_fast( s, c, x, n );
+   else
+      dq_sincos_vector( s, c, x, n );
+#endif /* !__FAST_MATH__ */
+}
@@ -0,0 +1,27 @@
+#ifndef _DQ_SINCOS_H
+#  define _DQ_SINCOS_H
+
+/**
+ * @file dq_sincos.h
+ *
+ * @brief Internal helper computing many sines and cosines at once.
+ *
+ * This header is not installed. Users select the implementation with
+ *  dq_sincos_set.
+ */
+
+#include "dq.h"
+
+
+/**
+ * @brief Computes the sine and cosine of n angles.
+ *
+ *    @param[out] s Sine of each angle.
+ *    @param[out] c Cosine of each angle.
+ *    @param[in] x Angles in radians.
+ *    @param[in] n Number of angles.
+ */
+DQ_API void dq_sincos_n( double *s, double *c, const double *x, int n );
+
+
+#endif /* _DQ_SINCOS_H */
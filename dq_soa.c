@@ -0,0 +1,175 @@
+#include "dq_real.h"
+#include "dq_soa.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef DQ_CHECK
+#include <assert.h>
+#endif /* DQ_CHECK */
+
+
+/*
+ * Double precision hands whole registers to the vectorized kernels of the
+ *  level selected with dq_simd_set, as dq.c does.
+ */
+#if !defined(DQ_FLOAT) && !defined(DQ_INLINE)
+#  define DQ_SOA_DISPATCH
+#include "dq_simd.h"
+#endif /* !DQ_FLOAT && !DQ_INLINE */
+
+
+#define MIN(a,b)        (((a)<(b))?(a):(b))
+
+/**
+ * Number of dual quaternions processed per block when multiplying in place,
+ *  whose results go through a stack buffer.
+ */
+#define DQ_SOA_BLOCK    64
+
+
+DQ_API int dq_soa_create( dq_soa_t *S, int n )
+{
+   dq_real_t *buf;
+   int i;
+
+#ifdef DQ_CHECK
+   assert( n >= 0 );
+#endif /* DQ_CHECK */
+
+   /* Avoid malloc(0) as it may return NULL and look like a failure. */
+   buf = malloc( sizeof(dq_real_t) * 8 * (size_t)(n>0 ? n : 1) );
+   if (buf == NULL)
+      return -1;
+   for (i=0; i<8; i++)
+      S->q[i] = &buf[ i*n ];
+   S->n = n;
+   return 0;
+}
+
+
+DQ_API void dq_soa_free( dq_soa_t *S )
+{
+   free( S->q[0] );
+   memset( S, 0, sizeof(dq_soa_t) );
+}
+
+
+DQ_API void dq_soa_load( dq_soa_t *S, dq_t *Q, int n )
+{
+   int i, k;
+
+#ifdef DQ_CHECK
+   assert( n <= S->n );
+#endif /* DQ_CHECK */
+
+   for (k=0; k<n; k++)
+      for (i=0; i<8; i++)
+         S->q[i][k] = Q[k][i];
+}
+
+
+DQ_API void dq_soa_store( dq_t *Q, const dq_soa_t *S, int n )
+{
+   int i, k;
+
+#ifdef DQ_CHECK
+   assert( n <= S->n );
+#endif /* DQ_CHECK */
+
+   for (k=0; k<n; k++)
+      for (i=0; i<8; i++)
+         Q[k][i] = S->q[i][k];
+}
+
+
+/**
+ * @brief Multiplies m lanes of structures of arrays into separate output streams.
+ *
+ * Every stream is a parameter so the compiler knows from DQ_RESTRICT that
+ *  the outputs do not alias the inputs and vectorizes across lanes without
+ *  a bounce buffer. The input streams may alias each other.
+ */
+static void dq_soa_mul_lanes(
+      dq_real_t * DQ_RESTRICT o0, dq_real_t * DQ_RESTRICT o1,
+      dq_real_t * DQ_RESTRICT o2, dq_real_t * DQ_RESTRICT o3,
+      dq_real_t * DQ_RESTRICT o4, dq_real_t * DQ_RESTRICT o5,
+      dq_real_t * DQ_RESTRICT o6, dq_real_t * DQ_RESTRICT o7,
+      const dq_real_t * DQ_RESTRICT p0, const dq_real_t * DQ_RESTRICT p1,
+      const dq_real_t * DQ_RESTRICT p2, const dq_real_t * DQ_RESTRICT p3,
+      const dq_real_t * DQ_RESTRICT p4, const dq_real_t * DQ_RESTRICT p5,
+      const dq_real_t * DQ_RESTRICT p6, const dq_real_t * DQ_RESTRICT p7,
+      const dq_real_t * DQ_RESTRICT q0, const dq_real_t * DQ_RESTRICT q1,
+      const dq_real_t * DQ_RESTRICT q2, const dq_real_t * DQ_RESTRICT q3,
+      const dq_real_t * DQ_RESTRICT q4, const dq_real_t * DQ_RESTRICT q5,
+      const dq_real_t * DQ_RESTRICT q6, const dq_real_t * DQ_RESTRICT q7, int m )
+{
+   int k;
+
+   /* Same expressions as dq_op_mul, one lane per dual quaternion. */
+   for (k=0; k<m; k++) {
+      /* Real quaternion. */
+      o0[k] = p0[k]*q0[k] - p1[k]*q1[k] - p2[k]*q2[k] - p3[k]*q3[k];
+      o1[k] = p0[k]*q1[k] + p1[k]*q0[k] + p2[k]*q3[k] - p3[k]*q2[k];
+      o2[k] = p0[k]*q2[k] + p2[k]*q0[k] - p1[k]*q3[k] + p3[k]*q1[k];
+      o3[k] = p0[k]*q3[k] + p3[k]*q0[k] + p1[k]*q2[k] - p2[k]*q1[k];
+
+      /* Dual unit Quaternion. */
+      o4[k] = p4[k]*q0[k] + p0[k]*q4[k] + p7[k]*q1[k] + p1[k]*q7[k] -
+              p6[k]*q2[k] + p2[k]*q6[k] + p5[k]*q3[k] - p3[k]*q5[k];
+      o5[k] = p5[k]*q0[k] + p0[k]*q5[k] + p6[k]*q1[k] - p1[k]*q6[k] +
+              p7[k]*q2[k] + p2[k]*q7[k] - p4[k]*q3[k] + p3[k]*q4[k];
+      o6[k] = p6[k]*q0[k] + p0[k]*q6[k] - p5[k]*q1[k] + p1[k]*q5[k] +
+              p4[k]*q2[k] - p2[k]*q4[k] + p7[k]*q3[k] + p3[k]*q7[k];
+      o7[k] = p7[k]*q0[k] + p0[k]*q7[k] - p1[k]*q4[k] - p4[k]*q1[k] -
+              p2[k]*q5[k] - p5[k]*q2[k] - p3[k]*q6[k] - p6[k]*q3[k];
+   }
+}
+
+
+/**
+ * @brief Multiplies m lanes given by their rows, see dq_simd_mul_soa for the aliasing allowed.
+ */
+static void dq_soa_mul_rows( dq_real_t *const o[8], dq_real_t *const p[8], dq_real_t *const q[8], int m )
+{
+   int k;
+
+   k = 0;
+#ifdef DQ_SOA_DISPATCH
+   k = dq_simd_mul_soa( o, p, q, m, dq_simd_get() );
+#endif /* DQ_SOA_DISPATCH */
+   dq_soa_mul_lanes( o[0]+k, o[1]+k, o[2]+k, o[3]+k, o[4]+k, o[5]+k, o[6]+k, o[7]+k,
+                     p[0]+k, p[1]+k, p[2]+k, p[3]+k, p[4]+k, p[5]+k, p[6]+k, p[7]+k,
+                     q[0]+k, q[1]+k, q[2]+k, q[3]+k, q[4]+k, q[5]+k, q[6]+k, q[7]+k, m-k );
+}
+
+
+DQ_API void dq_soa_op_mul( dq_soa_t *PQ, const dq_soa_t *P, const dq_soa_t *Q )
+{
+   dq_real_t T[8][DQ_SOA_BLOCK];
+   dq_real_t *o[8], *p[8], *q[8];
+   int b, i, m;
+
+#ifdef DQ_CHECK
+   assert( (PQ->n == P->n) && (P->n == Q->n) );
+#endif /* DQ_CHECK */
+
+   /* Separate output streams are written directly. */
+   if ((PQ->q[0] != P->q[0]) && (PQ->q[0] != Q->q[0])) {
+      dq_soa_mul_rows( PQ->q, P->q, Q->q, P->n );
+      return;
+   }
+
+   /* In place the results of a block go through a stack buffer first, as
+    * later components still read the overwritten ones. */
+   for (b=0; b<P->n; b+=DQ_SOA_BLOCK) {
+      m = MIN( P->n-b, DQ_SOA_BLOCK );
+      for (i=0; i<8; i++) {
+         o[i] = T[i];
+         p[i] = P->q[i]+b;
+         q[i] = Q->q[i]+b;
+      }
+      dq_soa_mul_rows( o, p, q, m );
+      for (i=0; i<8; i++)
+         memcpy( PQ->q[i]+b, T[i], sizeof(dq_real_t)*(size_t)m );
+   }
+}
@@ -0,0 +1,95 @@
+#ifndef _DQ_SOA_H
+#  define _DQ_SOA_H
+
+/**
+ * @file dq_soa.h
+ *
+ * @brief File containing functions related to structure-of-arrays dual quaternion storage.
+ */
+
+#include "dq.h"
+
+/**
+ * @defgroup soa Structure-of-Arrays Dual Quaternion Functions
+ * @brief Set of functions to operate on many dual quaternions at once.
+ *
+ * An array of @ref dq_t stores the eight components of each dual quaternion
+ *  next to each other. For batch processing it is more efficient to store
+ *  each component in its own stream so that the same component of
+ *  consecutive dual quaternions is contiguous in memory:
+ *
+ @verbatim
+   q[0] : Q0[0] Q1[0] Q2[0] ... Qn[0]
+   q[1] : Q0[1] Q1[1] Q2[1] ... Qn[1]
+    ...
+   q[7] : Q0[7] Q1[7] Q2[7] ... Qn[7]
+ @endverbatim
+ *
+ * This allows the compiler to vectorize operations across dual quaternions.
+ */
+/** @{ */
+/**
+ * @brief Dual quaternions stored as a structure of arrays.
+ */
+typedef struct dq_soa_s {
+   double *q[8]; /**< Component streams, q[i][k] is component i of dual quaternion k. */
+   int n;        /**< Number of dual quaternions stored. */
+} dq_soa_t;
+/**
+ * @brief Allocates storage for n dual quaternions.
+ *
+ * All eight streams are allocated in a single block.
+ *
+ *    @param[out] S Structure of arrays to allocate.
+ *    @param[in] n Number of dual quaternions to allocate.
+ *    @return 0 on success, -1 if out of memory.
+ * @sa dq_soa_free
+ */
+DQ_API int dq_soa_create( dq_soa_t *S, int n );
+/**
+ * @brief Frees storage allocated with dq_soa_create.
+ *
+ *    @param S Structure of arrays to free.
+ * @sa dq_soa_create
+ */
+DQ_API void dq_soa_free( dq_soa_t *S );
+/**
+ * @brief Loads an array of dual quaternions into a structure of arrays.
+ *
+ *    @param[out] S Structure of arrays to load into (must hold at least n).
+ *    @param[in] Q Array of dual quaternions to load.
+ *    @param[in] n Number of dual quaternions to load.
+ * @sa dq_soa_store
+ */
+DQ_API void dq_soa_load( dq_soa_t *S, dq_t *Q, int n );
+/**
+ * @brief Stores a structure of arrays into an array of dual quaternions.
+ *
+ *    @param[out] Q Array of dual quaternions to store into.
+ *    @param[in] S Structure of arrays to store from (must hold at least n).
+ *    @param[in] n Number of dual quaternions to store.
+ * @sa dq_soa_load
+ */
+DQ_API void dq_soa_store( dq_t *Q, const dq_soa_t *S, int n );
+/**
+ * @brief Multiplies two structures of arrays element by element.
+ *
+ * \f[
+ * \widehat{PQ}_i = \widehat{P}_i \widehat{Q}_i
+ * \f]
+ *
+ * All three structures must hold the same number of dual quaternions. The
+ *  output may be the same structure as either of the inputs, otherwise its
+ *  streams must not overlap theirs. Double precision uses the AVX2 and
+ *  AVX-512 kernels when selected with dq_simd_set.
+ *
+ *    @param[out] PQ Result of the multiplications.
+ *    @param[in] P First dual quaternions to multiply.
+ *    @param[in] Q Second dual quaternions to multiply.
+ * @sa dq_op_mul
+ * @sa dq_op_mul_n
+ */
+DQ_API void dq_soa_op_mul( dq_soa_t *PQ, const dq_soa_t *P, const dq_soa_t *Q );
+/** @} */
+
+#endif /* _DQ_SOA_H */
@@ -0,0 +1,96 @@
+#include "dq_thread.h"
+
+#ifdef DQ_CHECK
+#include <assert.h>
+#endif /* DQ_CHECK */
+
+#ifdef DQ_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif /* DQ_THREADS */
+
+
+#define MIN(a,b)     (((a)<(b))?(a):(b))
+
+
+static int dq_threads = 1; /**< Number of threads used by the parallel functions. */
+
+
+DQ_API int dq_threads_set( int n )
+{
+#ifdef DQ_THREADS
+   long cpus;
+
+   if (n <= 0) {
+      cpus = sysconf( _SC_NPROCESSORS_ONLN );
+      n    = (cpus > 0) ? (int) MIN( cpus, DQ_THREADS_MAX ) : 1;
+   }
+   dq_threads = MIN( n, DQ_THREADS_MAX );
+#else /* DQ_THREADS */
+   (void) n;
+#endif /* DQ_THREADS */
+   return dq_threads;
+}
+
+
+DQ_API int dq_threads_get( void )
+{
+   return dq_threads;
+}
+
+
+#ifdef DQ_THREADS
+
+/**
+ * @brief Arguments of a task run on its own thread.
+ */
+typedef struct dq_thread_arg_s {
+   dq_thread_fn fn; /**< Task to run. */
+   void *data;      /**< Shared data. */
+   int i;           /**< Index of the task. */
+} dq_thread_arg_t;
+
+
+static void* dq_thread_main( void *ptr )
+{
+   dq_thread_arg_t *arg = ptr;
+   arg->fn( arg->data, arg->i );
+   return NULL;
+}
+
+
+DQ_API void dq_thread_run( dq_thread_fn fn, void *data, int n )
+{
+   pthread_t threads[ DQ_THREADS_MAX ];
+   dq_thread_arg_t args[ DQ_THREADS_MAX ];
+   int created[ DQ_THREADS_MAX ];
+   int i;
+
+#ifdef DQ_CHECK
+   assert( n <= DQ_THREADS_MAX );
+#endif /* DQ_CHECK */
+
+   for (i=1; i<n; i++) {
+      args[i].fn   = fn;
+      args[i].data = data;
+      args[i].i    = i;
+      created[i]   = (pthread_create( &threads[i], NULL, dq_thread_main, &args[i] ) == 0);
+      if (!created[i])
+         fn( data, i );
+   }
+   fn( data, 0 );
+   for (i=1; i<n; i++)
+      if (created[i])
+         pthread_join( threads[i], NULL );
+}
+
+#else /* DQ_THREADS */
+
+DQ_API void dq_thread_run( dq_thread_fn fn, void *data, int n )
+{
+   int i;
+   for (i=0; i<n; i++)
+      fn( data, i );
+}
+
+#endif /* DQ_THREADS */
@@ -0,0 +1,39 @@
+#ifndef _DQ_THREAD_H
+#  define _DQ_THREAD_H
+
+/**
+ * @file dq_thread.h
+ *
+ * @brief Internal helper to run independent tasks on several threads.
+ *
+ * This header is not installed. Users select the number of threads with
+ *  dq_threads_set. When the library is built without DQ_THREADS the tasks are
+ *  run one after the other on the calling thread.
+ */
+
+#include "dq.h"
+
+
+/**
+ * @brief Task run by dq_thread_run.
+ *
+ *    @param data Data shared by all the tasks.
+ *    @param i Index of the task.
+ */
+typedef void (*dq_thread_fn)( void *data, int i );
+
+
+/**
+ * @brief Runs n tasks in parallel and waits for all of them to finish.
+ *
+ * Task 0 is run on the calling thread and the others on new threads. If a
+ *  thread can not be created its task is run on the calling thread instead.
+ *
+ *    @param fn Task to run.
+ *    @param data Data passed to all the tasks.
+ *    @param n Number of tasks, at most DQ_THREADS_MAX.
+ */
+DQ_API void dq_thread_run( dq_thread_fn fn, void *data, int n );
+
+
+#endif /* _DQ_THREAD_H */
@@ -0,0 +1,228 @@
+#include "dq_tree.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef DQ_CHECK
+#include <assert.h>
+#endif /* DQ_CHECK */
+
+#include "dq_thread.h"
+
+
+#define MIN(a,b)     (((a)<(b))?(a):(b))
+
+/**
+ * Minimum number of nodes per thread for dq_tree_eval to use threads.
+ */
+#define DQ_TREE_THREADED   1024
+
+
+DQ_API int dq_tree_create( dq_tree_t *T, const int *parent, int n )
+{
+   int *first, *child, *bfs, *depth, *size, *lay;
+   int i, j, k, c, m, top, end, pos, g, acc, left, target;
+   size_t N;
+
+#ifdef DQ_CHECK
+   assert( n >= 0 );
+#endif /* DQ_CHECK */
+
+   memset( T, 0, sizeof(dq_tree_t) );
+   for (i=0; i<n; i++)
+      if ((parent[i] < -1) || (parent[i] >= n) || (parent[i] == i))
+         return -1;
+
+   /* Dual quaternions go first as they have the strictest alignment. Avoid
+    * malloc(0) as it may return NULL and look like a failure. */
+   N = (size_t)(n>0 ? n : 1);
+   T->local = malloc( 2*sizeof(dq_t)*N + sizeof(int)*(2*N + DQ_TREE_GROUPS+1) );
+   first    = malloc( sizeof(int)*(6*N + 1) );
+   if ((T->local == NULL) || (first == NULL)) {
+      free( T->local );
+      free( first );
+      T->local = NULL;
+      return -1;
+   }
+   T->world  = &T->local[n];
+   T->parent = (int*) &T->world[n];
+   T->order  = &T->parent[n];
+   T->group  = &T->order[n];
+   T->n      = n;
+   child     = &first[n+1];
+   bfs       = &child[n];
+   depth     = &bfs[n];
+   size      = &depth[n];
+   lay       = &size[n];
+
+   /* Children of each node, child[first[i]] to child[first[i+1]-1]. */
+   memset( first, 0, sizeof(int)*(size_t)(n+1) );
+   for (i=0; i<n; i++)
+      if (parent[i] >= 0)
+         first[ parent[i]+1 ]++;
+   for (i=0; i<n; i++)
+      first[i+1] += first[i];
+   memcpy( size, first, sizeof(int)*(size_t)n );
+   for (i=0; i<n; i++)
+      if (parent[i] >= 0)
+         child[ size[parent[i]]++ ] = i;
+
+   /* Breadth-first from the roots, nodes in a cycle are never reached. */
+   m = 0;
+   for (i=0; i<n; i++) {
+      if (parent[i] < 0) {
+         bfs[m++] = i;
+         depth[i] = 0;
+      }
+   }
+   for (k=0; k<m; k++) {
+      j = bfs[k];
+      for (c=first[j]; c<first[j+1]; c++) {
+         depth[ child[c] ] = depth[j]+1;
+         bfs[m++] = child[c];
+      }
+   }
+   if (m != n) {
+      free( first );
+      dq_tree_free( T );
+      return -1;
+   }
+
+   /* Top levels, down to the first one with enough nodes for the groups. */
+   top = 0;
+   end = 0;
+   while (top < n) {
+      end = top;
+      while ((end < n) && (depth[bfs[end]] == depth[bfs[top]]))
+         end++;
+      if (end-top >= DQ_TREE_GROUPS)
+         break;
+      top = end;
+   }
+   memcpy( lay, bfs, sizeof(int)*(size_t)top );
+
+   /* Size of the subtree of each node. */
+   for (i=0; i<n; i++)
+      size[i] = 1;
+   for (k=n-1; k>0; k--)
+      if (parent[bfs[k]] >= 0)
+         size[ parent[bfs[k]] ] += size[ bfs[k] ];
+
+   /* Pack the subtrees under the cut in groups of similar size, each laid
+    * out breadth-first using its part of lay as the queue. */
+   pos  = top;
+   left = n-top;
+   g    = 0;
+   for (k=top; k<end; ) {
+      T->group[g] = pos;
+      target = (left + DQ_TREE_GROUPS-g-1) / (DQ_TREE_GROUPS-g);
+      acc    = 0;
+      while ((k < end) && ((acc < target) || (g == DQ_TREE_GROUPS-1))) {
+         acc += size[ bfs[k] ];
+         lay[pos++] = bfs[k++];
+      }
+      for (i=T->group[g]; i<pos; i++) {
+         j = lay[i];
+         for (c=first[j]; c<first[j+1]; c++)
+            lay[pos++] = child[c];
+      }
+      left -= acc;
+      g++;
+   }
+   T->groups   = g;
+   T->group[g] = n;
+
+   /* Parents always come first so they are already placed. */
+   for (i=0; i<n; i++) {
+      j            = lay[i];
+      T->order[j]  = i;
+      T->parent[i] = (parent[j] >= 0) ? T->order[ parent[j] ] : -1;
+      memset( T->local[i], 0, sizeof(dq_t) );
+      T->local[i][0] = 1.;
+      memcpy( T->world[i], T->local[i], sizeof(dq_t) );
+   }
+
+   free( first );
+   return 0;
+}
+
+
+DQ_API void dq_tree_free( dq_tree_t *T )
+{
+   free( T->local );
+   memset( T, 0, sizeof(dq_tree_t) );
+}
+
+
+DQ_API void dq_tree_set_local( dq_tree_t *T, int i, const dq_t M )
+{
+#ifdef DQ_CHECK
+   assert( (i >= 0) && (i < T->n) );
+#endif /* DQ_CHECK */
+
+   memcpy( T->local[ T->order[i] ], M, sizeof(dq_t) );
+}
+
+
+/**
+ * @brief Computes the world pose of the nodes [start,end) of the evaluation order.
+ */
+static void dq_tree_range( dq_tree_t *T, int start, int end )
+{
+   int i, p;
+
+   for (i=start; i<end; i++) {
+      p = T->parent[i];
+      if (p < 0)
+         memcpy( T->world[i], T->local[i], sizeof(dq_t) );
+      else
+         dq_op_mul( T->world[i], T->world[p], T->local[i] );
+   }
+}
+
+
+/**
+ * @brief Groups of subtrees computed by each thread.
+ */
+typedef struct dq_tree_task_s {
+   dq_tree_t *T;  /**< Tree to compute. */
+   int count;     /**< Number of threads. */
+} dq_tree_task_t;
+
+
+static void dq_tree_thread( void *data, int i )
+{
+   dq_tree_task_t *task = data;
+   dq_tree_t *T = task->T;
+
+   /* The groups have similar sizes, so share them evenly. */
+   dq_tree_range( T, T->group[ i*T->groups / task->count ],
+         T->group[ (i+1)*T->groups / task->count ] );
+}
+
+
+DQ_API void dq_tree_eval( dq_tree_t *T )
+{
+   dq_tree_task_t task;
+
+   task.T     = T;
+   task.count = MIN( dq_threads_get(), T->groups );
+   task.count = MIN( task.count, (T->n - T->group[0]) / DQ_TREE_THREADED );
+   if (task.count <= 1) {
+      dq_tree_range( T, 0, T->n );
+      return;
+   }
+
+   /* The groups only depend on the top levels. */
+   dq_tree_range( T, 0, T->group[0] );
+   dq_thread_run( dq_tree_thread, &task, task.count );
+}
+
+
+DQ_API void dq_tree_world( const dq_tree_t *T, int i, dq_t O )
+{
+#ifdef DQ_CHECK
+   assert( (i >= 0) && (i < T->n) );
+#endif /* DQ_CHECK */
+
+   memcpy( O, T->world[ T->order[i] ], sizeof(dq_t) );
+}
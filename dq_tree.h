@@ -0,0 +1,106 @@
+#ifndef _DQ_TREE_H
+#  define _DQ_TREE_H
+
+/**
+ * @file dq_tree.h
+ *
+ * @brief File containing functions related to kinematic trees.
+ */
+
+#include "dq.h"
+
+/**
+ * @defgroup tree Kinematic Tree Functions
+ * @brief Set of functions to compute the poses of branched kinematic structures.
+ *
+ * Hands, humanoids and skeletons branch, so instead of a chain they are a
+ *  tree of nodes where every node has a parent, or none for the roots, and a
+ *  local transform relative to it. The world pose of a node is:
+ *
+ * \f[
+ * \widehat{W}_i = \widehat{W}_{parent(i)} \widehat{M}_i
+ * \f]
+ *
+ * Nodes are identified by the index given when creating the tree, but they
+ *  are stored in an order where every parent comes before its children so
+ *  the whole tree is evaluated in a single pass over contiguous memory:
+ *
+ @verbatim
+   top levels, breadth-first | group 0, breadth-first | group 1 | ...
+ @endverbatim
+ *
+ * The top levels go down to the first level with at least DQ_TREE_GROUPS
+ *  nodes. The subtrees hanging from that level are independent, they are
+ *  packed into up to DQ_TREE_GROUPS groups of similar size, each laid out
+ *  breadth-first on its own. When there are threads (see dq_threads_set)
+ *  and enough nodes, the top levels are computed first and then the groups
+ *  are shared among the threads.
+ *
+ * Trees are double precision only.
+ */
+/** @{ */
+#define DQ_TREE_GROUPS     DQ_THREADS_MAX /**< Maximum number of independent groups of subtrees. */
+/**
+ * @brief Kinematic tree.
+ *
+ * The arrays are in the evaluation order, use order to find a node.
+ */
+typedef struct dq_tree_s {
+   dq_t *local;   /**< Transform of each node relative to its parent. */
+   dq_t *world;   /**< Pose of each node after dq_tree_eval. */
+   int *parent;   /**< Parent of each node in the evaluation order, -1 for roots. */
+   int *order;    /**< Position of each node in the evaluation order. */
+   int *group;    /**< Start of each group of subtrees, groups+1 entries. */
+   int groups;    /**< Number of groups of subtrees, 0 if all nodes are in the top levels. */
+   int n;         /**< Number of nodes. */
+} dq_tree_t;
+/**
+ * @brief Allocates a tree from the parent of each node.
+ *
+ * Nodes can be numbered in any order as long as there are no cycles. The
+ *  local transforms are the identity until set. Everything is allocated in
+ *  a single block, no other function allocates memory.
+ *
+ *    @param[out] T Tree to allocate.
+ *    @param[in] parent Parent of each node, -1 for the roots.
+ *    @param[in] n Number of nodes.
+ *    @return 0 on success, -1 if out of memory or parent is not a tree.
+ * @sa dq_tree_free
+ */
+DQ_API int dq_tree_create( dq_tree_t *T, const int *parent, int n );
+/**
+ * @brief Frees a tree allocated with dq_tree_create.
+ *
+ *    @param T Tree to free.
+ * @sa dq_tree_create
+ */
+DQ_API void dq_tree_free( dq_tree_t *T );
+/**
+ * @brief Sets the transform of a node relative to its parent.
+ *
+ * For roots it is the pose in the world.
+ *
+ *    @param T Tree to modify.
+ *    @param[in] i Index of the node.
+ *    @param[in] M Transform of the node.
+ */
+DQ_API void dq_tree_set_local( dq_tree_t *T, int i, const dq_t M );
+/**
+ * @brief Computes the world pose of every node.
+ *
+ *    @param T Tree to compute.
+ * @sa dq_tree_world
+ */
+DQ_API void dq_tree_eval( dq_tree_t *T );
+/**
+ * @brief Gets the world pose of a node computed by the last dq_tree_eval.
+ *
+ *    @param[in] T Tree to get the pose from.
+ *    @param[in] i Index of the node.
+ *    @param[out] O World pose of the node.
+ * @sa dq_tree_eval
+ */
+DQ_API void dq_tree_world( const dq_tree_t *T, int i, dq_t O );
+/** @} */
+
+#endif /* _DQ_TREE_H */
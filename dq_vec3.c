@@ -1,3 +1,4 @@
+#include "dq_real.h"
 #include "dq_vec3.h"
 
 #include <stdio.h>
@@ -10,23 +11,23 @@
 #include "dq.h"
 
 
-double vec3_dot( const double u[3], const double v[3] )
+DQ_API dq_real_t vec3_dot( const dq_real_t u[3], const dq_real_t v[3] )
 {
    return u[0]*v[0] + u[1]*v[1] + u[2]*v[2];
 }
 
 
-void vec3_cross( double o[3], const double u[3], const double v[3] )
+DQ_API void vec3_cross( dq_real_t o[3], const dq_real_t u[3], const dq_real_t v[3] )
 {
-   double t[3];
+   dq_real_t t[3];
    t[0] =  u[1]*v[2] - u[2]*v[1];
    t[1] = -u[0]*v[2] + u[2]*v[0];
    t[2] =  u[0]*v[1] - u[1]*v[0];
-   memcpy( o, t, sizeof(double)*3 );
+   memcpy( o, t, sizeof(dq_real_t)*3 );
 }
 
 
-void vec3_add( double o[3], const double u[3], const double v[3] )
+DQ_API void vec3_add( dq_real_t o[3], const dq_real_t u[3], const dq_real_t v[3] )
 {
    int i;
    for (i=0; i<3; i++)
@@ -34,7 +35,7 @@ void vec3_add( double o[3], const double u[3], const double v[3] )
 }
 
 
-void vec3_sub( double o[3], const double u[3], const double v[3] )
+DQ_API void vec3_sub( dq_real_t o[3], const dq_real_t u[3], const dq_real_t v[3] )
 {
    int i;
    for (i=0; i<3; i++)
@@ -42,7 +43,7 @@ void vec3_sub( double o[3], const double u[3], const double v[3] )
 }
 
 
-void vec3_sign( double v[3] )
+DQ_API void vec3_sign( dq_real_t v[3] )
 {
    int i;
    for (i=0; i<3; i++)
@@ -50,15 +51,15 @@ void vec3_sign( double v[3] )
 }
 
 
-double vec3_norm( const double v[3] )
+DQ_API dq_real_t vec3_norm( const dq_real_t v[3] )
 {
-   return sqrt( vec3_dot( v, v ) );
+   return (dq_real_t) sqrt( vec3_dot( v, v ) );
 }
 
 
-void vec3_normalize( double v[3] )
+DQ_API void vec3_normalize( dq_real_t v[3] )
 {
-   double n = vec3_norm( v );
+   dq_real_t n = vec3_norm( v );
 
 #ifdef DQ_CHECK
    assert( fabs(n) > DQ_PRECISION );
@@ -70,15 +71,15 @@ void vec3_normalize( double v[3] )
 }
 
 
-double vec3_distance( const double u[3], const double v[3] )
+DQ_API dq_real_t vec3_distance( const dq_real_t u[3], const dq_real_t v[3] )
 {
-   double t[3];
+   dq_real_t t[3];
    vec3_sub( t, u, v );
    return vec3_norm( t );
 }
 
 
-int vec3_cmpV( const double u[3], const double v[3], double precision )
+DQ_API int vec3_cmpV( const dq_real_t u[3], const dq_real_t v[3], dq_real_t precision )
 {
    int ret, i;
    ret = 0;
@@ -89,13 +90,13 @@ int vec3_cmpV( const double u[3], const double v[3], double precision )
 }
 
 
-int vec3_cmp( const double u[3], const double v[3] )
+DQ_API int vec3_cmp( const dq_real_t u[3], const dq_real_t v[3] )
 {
    return vec3_cmpV( u, v, DQ_PRECISION );
 }
 
 
-void vec3_print( const double v[3] )
+DQ_API void vec3_print( const dq_real_t v[3] )
 {
    printf( "   %.3f, %.3f, %.3f\n", v[0], v[1], v[2] );
 }
@@ -7,6 +7,8 @@
  * @brief File containing functions related to 3d vectors.
  */
 
+#include "dq.h"
+
 /**
  * @defgroup vec3 Auxiliary 3d Vector Functions
  * @brief Set of auxiliary functions to manipulate 3d vectors.
@@ -23,7 +25,7 @@
  *    @param[in] v Second 3d vector to operate on.
  *    @return The dot product of u.v.
  */
-double vec3_dot( const double u[3], const double v[3] );
+DQ_API double vec3_dot( const double u[3], const double v[3] );
 /**
  * @brief Does the cross product of two 3d vectors.
  *
@@ -35,7 +37,7 @@ double vec3_dot( const double u[3], const double v[3] );
  *    @param[in] u First 3d vector to operate on.
  *    @param[in] v Second 3d vector to operate on.
  */
-void vec3_cross( double o[3], const double u[3], const double v[3] );
+DQ_API void vec3_cross( double o[3], const double u[3], const double v[3] );
 /**
  * @brief Adds two 3d vectors.
  *
@@ -47,7 +49,7 @@ void vec3_cross( double o[3], const double u[3], const double v[3] );
  *    @param[in] u First 3d vector to operate on.
  *    @param[in] v Second 3d vector to operate on.
  */
-void vec3_add( double o[3], const double u[3], const double v[3] );
+DQ_API void vec3_add( double o[3], const double u[3], const double v[3] );
 /**
  * @brief Subtracts two 3d vectors.
  *
@@ -59,7 +61,7 @@ void vec3_add( double o[3], const double u[3], const double v[3] );
  *    @param[in] u First 3d vector to operate on.
  *    @param[in] v Second 3d vector to operate on.
  */
-void vec3_sub( double o[3], const double u[3], const double v[3] );
+DQ_API void vec3_sub( double o[3], const double u[3], const double v[3] );
 /**
  * @brief Changes the sign of a vector.
  *
@@ -69,7 +71,7 @@ void vec3_sub( double o[3], const double u[3], const double v[3] );
  *
  *    @param v Vector to change sign of.
  */
-void vec3_sign( double v[3] );
+DQ_API void vec3_sign( double v[3] );
 /**
  * @brief Gets the norm of a 3d vector.
  *
@@ -80,7 +82,7 @@ void vec3_sign( double v[3] );
  *    @param[in] v Vector to get norm of.
  *    @return The norm of the 3d vector.
  */
-double vec3_norm( const double v[3] );
+DQ_API double vec3_norm( const double v[3] );
 /**
  * @brief Normalizes a 3d vector.
  *
@@ -90,7 +92,7 @@ double vec3_norm( const double v[3] );
  *
  *    @param v Vector to normalize.
  */
-void vec3_normalize( double v[3] );
+DQ_API void vec3_normalize( double v[3] );
 /**
  * @brief Gets the distance between two vectors.
  *
@@ -102,7 +104,7 @@ void vec3_normalize( double v[3] );
  *    @param[in] v Vector to get distance from u.
  *    @return The distance between the two vectors.
  */
-double vec3_distance( const double u[3], const double v[3] );
+DQ_API double vec3_distance( const double u[3], const double v[3] );
 /**
  * @brief Compares two 3d vectors.
  *
@@ -110,7 +112,7 @@ double vec3_distance( const double u[3], const double v[3] );
  *    @param[in] v Second 3d vector to compare.
  *    @return 0 if they are the same.
  */
-int vec3_cmp( const double u[3], const double v[3] );
+DQ_API int vec3_cmp( const double u[3], const double v[3] );
 /**
  * @brief Compares two 3d vectors with variable precision.
  *
@@ -119,13 +121,13 @@ int vec3_cmp( const double u[3], const double v[3] );
  *    @param[in] precision Precision to use.
  *    @return 0 if they are the same.
  */
-int vec3_cmpV( const double u[3], const double v[3], double precision );
+DQ_API int vec3_cmpV( const double u[3], const double v[3], double precision );
 /**
  * @brief Prints a 3d vector on screen.
  *
  *    @param[in] v Vector to print.
  */
-void vec3_print( const double v[3] );
+DQ_API void vec3_print( const double v[3] );
 /** @} */
 
 #endif /* _DQ_VEC3_H */
@@ -0,0 +1,49 @@
+/*
+ * Single precision version of the library.
+ *
+ * The double precision sources are built again with DQ_FLOAT defined, which
+ *  makes dq_real.h map all the names to the ones declared in dqf.h.
+ */
+#define DQ_FLOAT
+#include "dq_vec3.c"
+#include "dq_mat3.c"
+#include "dq_homo.c"
+#include "dq_soa.c"
+#include "dq.c"
+
+
+/*
+ * Conversion between precisions, only makes sense here.
+ */
+#undef dq_t
+
+void dqf_from_dq( dqf_t O, const dq_t Q )
+{
+   int i;
+   for (i=0; i<8; i++)
+      O[i] = (float) Q[i];
+}
+
+
+void dqf_to_dq( dq_t O, const dqf_t Q )
+{
+   int i;
+   for (i=0; i<8; i++)
+      O[i] = Q[i];
+}
+
+
+void dqf_from_dq_n( dqf_t *O, dq_t *Q, int n )
+{
+   int i;
+   for (i=0; i<n; i++)
+      dqf_from_dq( O[i], Q[i] );
+}
+
+
+void dqf_to_dq_n( dq_t *O, dqf_t *Q, int n )
+{
+   int i;
+   for (i=0; i<n; i++)
+      dqf_to_dq( O[i], Q[i] );
+}
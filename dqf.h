@@ -0,0 +1,272 @@
+#ifndef _DQF_H
+#  define _DQF_H
+
+/**
+ * @file dqf.h
+ *
+ * @brief Single precision version of the libdq library.
+ */
+
+#include "dq.h"
+
+/**
+ * @defgroup dqf Single Precision Functions
+ * @brief Single precision versions of the whole library.
+ *
+ * Every function of the library has a single precision counterpart that takes
+ *  float instead of double. Dual quaternion functions are prefixed with dqf_
+ *  instead of dq_, and the auxiliary functions with vec3f_, mat3f_ and homof_
+ *  instead of vec3_, mat3_ and homo_. They are compiled from the same sources
+ *  as the double precision functions, so refer to those for documentation.
+ *
+ * Comparisons default to DQF_PRECISION instead of DQ_PRECISION.
+ */
+/** @{ */
+#define DQF_PRECISION   1e-5f/**< Precision to use when comparing floats. */
+
+
+/**
+ * @brief A representation of a dual quaternion in single precision.
+ * @sa dq_t
+ */
+typedef float dqf_t[8];
+
+
+/**
+ * @brief Single precision dual quaternions stored as a structure of arrays.
+ * @sa dq_soa_t
+ */
+typedef struct dqf_soa_s {
+   float *q[8]; /**< Component streams, q[i][k] is component i of dual quaternion k. */
+   int n;       /**< Number of dual quaternions stored. */
+} dqf_soa_t;
+
+
+/* Dual quaternions, see dq.h. */
+/** @brief Single precision version of dq_cr_rotation. */
+void dqf_cr_rotation( dqf_t O, float theta, const float s[3], const float c[3] );
+/** @brief Single precision version of dq_cr_rotation_plucker. */
+void dqf_cr_rotation_plucker( dqf_t O, float theta, const float s[3], const float s0[3] );
+/** @brief Single precision version of dq_cr_rotation_plucker_n. */
+void dqf_cr_rotation_plucker_n( dqf_t *O, float *theta, float s[][3], float s0[][3], int n );
+/** @brief Single precision version of dq_cr_rotation_matrix. */
+void dqf_cr_rotation_matrix( dqf_t O, float R[3][3] );
+/** @brief Single precision version of dq_cr_rotation_matrix_n. */
+void dqf_cr_rotation_matrix_n( dqf_t *O, float R[][3][3], int n );
+/** @brief Single precision version of dq_cr_translation. */
+void dqf_cr_translation( dqf_t O, float t, const float s[3] );
+/** @brief Single precision version of dq_cr_translation_vector. */
+void dqf_cr_translation_vector( dqf_t O, const float t[3] );
+/** @brief Single precision version of dq_cr_dh. */
+void dqf_cr_dh( dqf_t O, float theta, float d, float a, float alpha );
+/** @brief Single precision version of dq_cr_mdh. */
+void dqf_cr_mdh( dqf_t O, float theta, float d, float a, float alpha );
+/** @brief Single precision version of dq_cr_point. */
+void dqf_cr_point( dqf_t O, const float pos[3] );
+/** @brief Single precision version of dq_cr_line. */
+void dqf_cr_line( dqf_t O, const float s[3], const float c[3] );
+/** @brief Single precision version of dq_cr_line_plucker. */
+void dqf_cr_line_plucker( dqf_t O, const float s[3], const float s0[3] );
+/** @brief Single precision version of dq_cr_plane. */
+void dqf_cr_plane( dqf_t O, const float n[3], const float d );
+/** @brief Single precision version of dq_cr_homo. */
+void dqf_cr_homo( dqf_t O, float R[3][3], const float d[3] );
+/** @brief Single precision version of dq_cr_homo_n. */
+void dqf_cr_homo_n( dqf_t *O, float H[][3][4], int n );
+/** @brief Single precision version of dq_cr_copy. */
+void dqf_cr_copy( dqf_t O, const dqf_t Q );
+/** @brief Single precision version of dq_cr_conj. */
+void dqf_cr_conj( dqf_t O, const dqf_t Q );
+/** @brief Single precision version of dq_cr_inv. */
+void dqf_cr_inv( dqf_t O, const dqf_t Q );
+/** @brief Single precision version of dq_op_norm2. */
+void dqf_op_norm2( float *real, float *dual, const dqf_t Q );
+/** @brief Single precision version of dq_op_add. */
+void dqf_op_add( dqf_t O, const dqf_t P, const dqf_t Q );
+/** @brief Single precision version of dq_op_sub. */
+void dqf_op_sub( dqf_t O, const dqf_t P, const dqf_t Q );
+/** @brief Single precision version of dq_op_mul. */
+void dqf_op_mul( dqf_t PQ, const dqf_t P, const dqf_t Q );
+/** @brief Single precision version of dq_op_mul_nr. */
+void dqf_op_mul_nr( float * DQ_RESTRICT PQ, const float * DQ_RESTRICT P, const float * DQ_RESTRICT Q );
+/** @brief Single precision version of dq_op_mul_ip. */
+void dqf_op_mul_ip( dqf_t P, const dqf_t Q );
+/** @brief Single precision version of dq_op_mul_n. */
+void dqf_op_mul_n( dqf_t *PQ, const dqf_t *P, const dqf_t *Q, int n );
+/** @brief Single precision version of dq_op_mul_chain. */
+void dqf_op_mul_chain( dqf_t out, dqf_t *links, int n );
+/** @brief Single precision version of dq_op_scan. */
+void dqf_op_scan( dqf_t *out, dqf_t *links, int n );
+/** @brief Single precision version of dq_op_sign. */
+void dqf_op_sign( dqf_t P, const dqf_t Q );
+/** @brief Single precision version of dq_op_f1g. */
+void dqf_op_f1g( dqf_t ABA, const dqf_t A, const dqf_t B );
+/** @brief Single precision version of dq_op_f1g_n. */
+void dqf_op_f1g_n( dqf_t *ABA, const dqf_t A, dqf_t *B, int n );
+/** @brief Single precision version of dq_op_f2g. */
+void dqf_op_f2g( dqf_t ABA, const dqf_t A, const dqf_t B );
+/** @brief Single precision version of dq_op_f2g_n. */
+void dqf_op_f2g_n( dqf_t *ABA, const dqf_t A, dqf_t *B, int n );
+/** @brief Single precision version of dq_op_f3g. */
+void dqf_op_f3g( dqf_t ABA, const dqf_t A, const dqf_t B );
+/** @brief Single precision version of dq_op_f3g_n. */
+void dqf_op_f3g_n( dqf_t *ABA, const dqf_t A, dqf_t *B, int n );
+/** @brief Single precision version of dq_op_f4g. */
+void dqf_op_f4g( dqf_t ABA, const dqf_t A, const dqf_t B );
+/** @brief Single precision version of dq_op_f4g_n. */
+void dqf_op_f4g_n( dqf_t *ABA, const dqf_t A, dqf_t *B, int n );
+/** @brief Single precision version of dq_op_extract. */
+void dqf_op_extract( float R[3][3], float d[3], const dqf_t Q );
+/** @brief Single precision version of dq_op_transform_points. */
+void dqf_op_transform_points( const dqf_t Q, const float *in, float *out, int n );
+/** @brief Single precision version of dq_op_exp. */
+void dqf_op_exp( dqf_t O, const dqf_t X );
+/** @brief Single precision version of dq_op_log. */
+void dqf_op_log( dqf_t O, const dqf_t Q );
+/** @brief Single precision version of dq_op_pow. */
+void dqf_op_pow( dqf_t O, const dqf_t Q, float t );
+/** @brief Single precision version of dq_op_pow_n. */
+void dqf_op_pow_n( dqf_t *O, const dqf_t Q, const float *t, int n );
+/** @brief Single precision version of dq_op_sclerp. */
+void dqf_op_sclerp( dqf_t O, const dqf_t P, const dqf_t Q, float t );
+/** @brief Single precision version of dq_op_sclerp_n. */
+void dqf_op_sclerp_n( dqf_t *O, const dqf_t P, const dqf_t Q, const float *t, int n );
+/** @brief Single precision version of dq_op_extract_n. */
+void dqf_op_extract_n( double *M, int stride, int flags, dqf_t *Q, int n );
+/** @brief Single precision version of dq_op_extract_nf. */
+void dqf_op_extract_nf( float *M, int stride, int flags, dqf_t *Q, int n );
+/** @brief Single precision version of dq_ch_unit. */
+int dqf_ch_unit( const dqf_t Q );
+/** @brief Single precision version of dq_ch_point_plane. */
+int dqf_ch_point_plane( const dqf_t P, const dqf_t Q );
+/** @brief Single precision version of dq_ch_cmp. */
+int dqf_ch_cmp( const dqf_t P, const dqf_t Q );
+/** @brief Single precision version of dq_ch_cmpV. */
+int dqf_ch_cmpV( const dqf_t P, const dqf_t Q, float precision );
+/** @brief Single precision version of dq_print. */
+void dqf_print( const dqf_t Q );
+/** @brief Single precision version of dq_print_vert. */
+void dqf_print_vert( const dqf_t Q );
+
+/* 3d vectors, see dq_vec3.h. */
+/** @brief Single precision version of vec3_dot. */
+float vec3f_dot( const float u[3], const float v[3] );
+/** @brief Single precision version of vec3_cross. */
+void vec3f_cross( float o[3], const float u[3], const float v[3] );
+/** @brief Single precision version of vec3_add. */
+void vec3f_add( float o[3], const float u[3], const float v[3] );
+/** @brief Single precision version of vec3_sub. */
+void vec3f_sub( float o[3], const float u[3], const float v[3] );
+/** @brief Single precision version of vec3_sign. */
+void vec3f_sign( float v[3] );
+/** @brief Single precision version of vec3_norm. */
+float vec3f_norm( const float v[3] );
+/** @brief Single precision version of vec3_normalize. */
+void vec3f_normalize( float v[3] );
+/** @brief Single precision version of vec3_distance. */
+float vec3f_distance( const float u[3], const float v[3] );
+/** @brief Single precision version of vec3_cmp. */
+int vec3f_cmp( const float u[3], const float v[3] );
+/** @brief Single precision version of vec3_cmpV. */
+int vec3f_cmpV( const float u[3], const float v[3], float precision );
+/** @brief Single precision version of vec3_print. */
+void vec3f_print( const float v[3] );
+
+/* 3x3 matrices, see dq_mat3.h. */
+/** @brief Single precision version of mat3_eye. */
+void mat3f_eye( float M[3][3] );
+/** @brief Single precision version of mat3_det. */
+float mat3f_det( float M[3][3] );
+/** @brief Single precision version of mat3_add. */
+void mat3f_add( float out[3][3], float A[3][3], float B[3][3] );
+/** @brief Single precision version of mat3_sub. */
+void mat3f_sub( float out[3][3], float A[3][3], float B[3][3] );
+/** @brief Single precision version of mat3_inv. */
+void mat3f_inv( float out[3][3], float in[3][3] );
+/** @brief Single precision version of mat3_mul. */
+void mat3f_mul( float AB[3][3], float A[3][3], float B[3][3] );
+/** @brief Single precision version of mat3_mul_nr. */
+void mat3f_mul_nr( float (* DQ_RESTRICT AB)[3], float (* DQ_RESTRICT A)[3], float (* DQ_RESTRICT B)[3] );
+/** @brief Single precision version of mat3_mul_ip. */
+void mat3f_mul_ip( float A[3][3], float B[3][3] );
+/** @brief Single precision version of mat3_mul_vec. */
+void mat3f_mul_vec( float out[3], float M[3][3], const float v[3] );
+/** @brief Single precision version of mat3_mul_vec_nr. */
+void mat3f_mul_vec_nr( float * DQ_RESTRICT out, float (* DQ_RESTRICT M)[3], const float * DQ_RESTRICT v );
+/** @brief Single precision version of mat3_mul_vec_ip. */
+void mat3f_mul_vec_ip( float v[3], float M[3][3] );
+/** @brief Single precision version of mat3_solve. */
+void mat3f_solve( float x[3], float A[3][3], const float b[3] );
+/** @brief Single precision version of mat3_cmp. */
+int mat3f_cmp( float A[3][3], float B[3][3] );
+/** @brief Single precision version of mat3_cmpV. */
+int mat3f_cmpV( float A[3][3], float B[3][3], float precision );
+/** @brief Single precision version of mat3_print. */
+void mat3f_print( float M[3][3] );
+
+/* Homogeneous matrices, see dq_homo.h. */
+/** @brief Single precision version of homo_cr_join. */
+void homof_cr_join( float H[3][4], float R[3][3], float d[3] );
+/** @brief Single precision version of homo_op_mul. */
+void homof_op_mul( float O[3][4], float A[3][4], float B[3][4] );
+/** @brief Single precision version of homo_op_mul_nr. */
+void homof_op_mul_nr( float (* DQ_RESTRICT O)[4], float (* DQ_RESTRICT A)[4], float (* DQ_RESTRICT B)[4] );
+/** @brief Single precision version of homo_op_mul_ip. */
+void homof_op_mul_ip( float A[3][4], float B[3][4] );
+/** @brief Single precision version of homo_op_split. */
+void homof_op_split( float R[3][3], float d[3], float H[3][4] );
+/** @brief Single precision version of homo_op_mul_vec. */
+void homof_op_mul_vec( float o[4], float H[3][4], const float v[4] );
+/** @brief Single precision version of homo_ch_cmpV. */
+int homof_ch_cmpV( float A[3][4], float B[3][4], float precision );
+/** @brief Single precision version of homo_ch_cmp. */
+int homof_ch_cmp( float A[3][4], float B[3][4] );
+/** @brief Single precision version of homo_print. */
+void homof_print( float H[3][4] );
+
+/* Structure of arrays, see dq_soa.h. */
+/** @brief Single precision version of dq_soa_create. */
+int dqf_soa_create( dqf_soa_t *S, int n );
+/** @brief Single precision version of dq_soa_free. */
+void dqf_soa_free( dqf_soa_t *S );
+/** @brief Single precision version of dq_soa_load. */
+void dqf_soa_load( dqf_soa_t *S, dqf_t *Q, int n );
+/** @brief Single precision version of dq_soa_store. */
+void dqf_soa_store( dqf_t *Q, const dqf_soa_t *S, int n );
+/** @brief Single precision version of dq_soa_op_mul. */
+void dqf_soa_op_mul( dqf_soa_t *PQ, const dqf_soa_t *P, const dqf_soa_t *Q );
+
+/* Conversion between precisions. */
+/**
+ * @brief Converts a double precision dual quaternion to single precision.
+ *
+ *    @param[out] O Single precision dual quaternion.
+ *    @param[in] Q Double precision dual quaternion to convert.
+ */
+void dqf_from_dq( dqf_t O, const dq_t Q );
+/**
+ * @brief Converts a single precision dual quaternion to double precision.
+ *
+ *    @param[out] O Double precision dual quaternion.
+ *    @param[in] Q Single precision dual quaternion to convert.
+ */
+void dqf_to_dq( dq_t O, const dqf_t Q );
+/**
+ * @brief Converts an array of double precision dual quaternions to single precision.
+ *
+ *    @param[out] O Array of n single precision dual quaternions.
+ *    @param[in] Q Array of n double precision dual quaternions to convert.
+ *    @param[in] n Number of dual quaternions to convert.
+ */
+void dqf_from_dq_n( dqf_t *O, dq_t *Q, int n );
+/**
+ * @brief Converts an array of single precision dual quaternions to double precision.
+ *
+ *    @param[out] O Array of n double precision dual quaternions.
+ *    @param[in] Q Array of n single precision dual quaternions to convert.
+ *    @param[in] n Number of dual quaternions to convert.
+ */
+void dqf_to_dq_n( dq_t *O, dqf_t *Q, int n );
+/** @} */
+
+#endif /* _DQF_H */
@@ -51,6 +51,8 @@ DQL( cr_rotation_plucker );
 DQL( cr_rotation_matrix );
 DQL( cr_translation );
 DQL( cr_translation_vector );
+DQL( cr_dh );
+DQL( cr_mdh );
 DQL( cr_point );
 DQL( cr_line );
 DQL( cr_line_plucker );
@@ -86,6 +88,8 @@ static const luaL_Reg dqL_methods[] = {
    { "rotation_matrix", dqL_cr_rotation_matrix },
    { "translation", dqL_cr_translation },
    { "translation_vector", dqL_cr_translation_vector },
+   { "dh", dqL_cr_dh },
+   { "mdh", dqL_cr_mdh },
    { "point", dqL_cr_point },
    { "line", dqL_cr_line },
    { "line_plucker", dqL_cr_line_plucker },
@@ -311,6 +315,16 @@ static int dqL_##n( lua_State *L ) { \
    dq_##n( Q.dq, d, v, u ); \
    lua_pushdq( L, Q ); \
    return 1; }
+#define DQL_CR_DDDD( n ) \
+static int dqL_##n( lua_State *L ) { \
+   dqL_t Q; double a, b, c, d; \
+   a = luaL_checknumber( L, 1 ); \
+   b = luaL_checknumber( L, 2 ); \
+   c = luaL_checknumber( L, 3 ); \
+   d = luaL_checknumber( L, 4 ); \
+   dq_##n( Q.dq, a, b, c, d ); \
+   lua_pushdq( L, Q ); \
+   return 1; }
 #define DQL_CR_M( n ) \
 static int dqL_##n( lua_State *L ) { \
    dqL_t Q; double M[3][3]; \
@@ -349,6 +363,8 @@ DQL_CR_DVV( cr_rotation_plucker )
 DQL_CR_M(   cr_rotation_matrix )
 DQL_CR_DV(  cr_translation )
 DQL_CR_V(   cr_translation_vector )
+DQL_CR_DDDD( cr_dh )
+DQL_CR_DDDD( cr_mdh )
 DQL_CR_V(   cr_point )
 DQL_CR_VV(  cr_line )
 DQL_CR_VV(  cr_line_plucker )
@@ -4,6 +4,14 @@
 #include "../dq_vec3.h"
 #include "../dq_mat3.h"
 #include "../dq_homo.h"
+#include "../dq_soa.h"
+#include "../dq_chain.h"
+#include "../dq_tree.h"
+#include "../dqf.h"
+
+/* Generated by dq_codegen from scara.chain and ur5.chain. */
+#include "scara_gen.h"
+#include "ur5_gen.h"
 
 #include <stdio.h>
 #include <math.h>
@@ -24,6 +32,28 @@ double rnd_double (void)
 }
 
 
+static void rnd_dq( dq_t Q )
+{
+   double a, s[3], c[3];
+   a    = rnd_double() * 2. * M_PI;
+   s[0] = rnd_double();
+   s[1] = rnd_double();
+   s[2] = rnd_double();
+   vec3_normalize( s );
+   c[0] = rnd_double() * 10.;
+   c[1] = rnd_double() * 10.;
+   c[2] = rnd_double() * 10.;
+   dq_cr_rotation( Q, a, s, c );
+}
+
+
+static double elapsed( const struct timeval *tstart, const struct timeval *tend )
+{
+   long us = ((tend->tv_sec - tstart->tv_sec) * 1000000 + (tend->tv_usec - tstart->tv_usec));
+   return ((double)us) / 1e6;
+}
+
+
 static int test_vector (void)
 {
    double v0[3] = { 3., -3., 1. };
@@ -66,7 +96,8 @@ static int test_matrix (void)
    double eye[3][3] = { { 1., 0., 0. },
                         { 0., 1., 0. },
                         { 0., 0., 1. } };
-   double det, inv[3][3], mmul[3][3];
+   double det, inv[3][3], mmul[3][3], mnr[3][3];
+   double v[3] = { 3., -3., 1. }, mv[3], vnr[3];
 
    det = mat3_det( M );
    if (fabs(det+1.) > 1e-10) {
@@ -94,6 +125,23 @@ static int test_matrix (void)
       return -1;
    }
 
+   /* Copy-free and in place versions must match. */
+   mat3_mul( mmul, M, comp );
+   mat3_mul_nr( mnr, M, comp );
+   memcpy( inv, M, sizeof(inv) );
+   mat3_mul_ip( inv, comp );
+   if ((mat3_cmp( mnr, mmul ) != 0) || (mat3_cmp( inv, mmul ) != 0)) {
+      fprintf( stderr, "Error with copy-free matrix multiplication!\n" );
+      return -1;
+   }
+   mat3_mul_vec( mv, M, v );
+   mat3_mul_vec_nr( vnr, M, v );
+   mat3_mul_vec_ip( v, M );
+   if ((vec3_cmp( vnr, mv ) != 0) || (vec3_cmp( v, mv ) != 0)) {
+      fprintf( stderr, "Error with copy-free matrix vector multiplication!\n" );
+      return -1;
+   }
+
    return 0;
 }
 
@@ -352,12 +400,308 @@ static void test_mat_rot( double R[3][3], double a1, double a2, double a3 )
 }
 
 
+/**
+ * Screw of angle a and translation d along the line of direction s through c.
+ */
+static void screw_dq( dq_t O, double a, double d, const double s[3], const double c[3] )
+{
+   dq_t R, T;
+
+   dq_cr_rotation( R, a, s, c );
+   dq_cr_translation( T, d, s );
+   dq_op_mul( O, T, R );
+}
+
+
+/**
+ * Interpolation of the rotation with a slerp and of the translation with a
+ *  lerp, the usual way without dual quaternions, to compare with
+ *  dq_op_sclerp. The translation moves along a chord instead of the screw.
+ */
+static void slerp_lerp_dq( dq_t O, const dq_t P, const dq_t Q, double t )
+{
+   double R[3][3], dp[3], dq[3], d[3], c, a, sa, wp, wq;
+   dq_t T, S;
+   int i;
+
+   dq_op_extract( R, dp, P );
+   dq_op_extract( R, dq, Q );
+
+   /* Shortest arc between the rotations. */
+   c  = P[0]*Q[0] + P[1]*Q[1] + P[2]*Q[2] + P[3]*Q[3];
+   a  = acos( (fabs(c) < 1.) ? fabs(c) : 1. );
+   sa = sin( a );
+   wp = (sa > 1e-12) ? sin( (1.-t)*a ) / sa : 1.-t;
+   wq = (sa > 1e-12) ? sin( t*a ) / sa : t;
+   wq = (c < 0.) ? -wq : wq;
+   memset( S, 0, sizeof(dq_t) );
+   for (i=0; i<4; i++)
+      S[i] = wp*P[i] + wq*Q[i];
+   for (i=0; i<3; i++)
+      d[i] = (1.-t)*dp[i] + t*dq[i];
+
+   dq_cr_translation_vector( T, d );
+   dq_op_mul( O, T, S );
+}
+
+
+static int test_screw (void)
+{
+   int i, j, k, N;
+   double a, d, s[3], c[3], s0[3], p[3], pf[3], v[3], t[1000];
+   double small[] = { 0., 1e-12, 1e-8, 1e-5, 1e-3, 9.9e-3, 1.01e-2, 0.1, M_PI - 1e-9 };
+   dq_t P, Q, R, RT, L, O, E, F, PF, Pn[1000], On[1000];
+   dqf_t Pf, Qf, Of;
+   struct timeval tstart, tend;
+   double dt[3], err[2];
+
+   rnd_init();
+
+   /* Half of the rotation of test_rotation. */
+   s[0] = 0.;
+   s[1] = 0.;
+   s[2] = 1.;
+   c[0] = 0.;
+   c[1] = 0.;
+   c[2] = 0.;
+   p[0] = 1.;
+   p[1] = 1.;
+   p[2] = 1.;
+   pf[0] = 0.;
+   pf[1] = M_SQRT2;
+   pf[2] = 1.;
+   dq_cr_rotation( R, M_PI/2., s, c );
+   dq_op_pow( O, R, 0.5 );
+   dq_cr_point( P, p );
+   dq_op_f4g( E, O, P );
+   dq_cr_point( PF, pf );
+   if (dq_ch_cmp( E, PF ) != 0) {
+      fprintf( stderr, "Half of a rotation failed!\n" );
+      dq_print_vert( E );
+      return -1;
+   }
+
+   /* Interpolating the movement of test_movement, which is a screw. */
+   s[0] = 1./M_SQRT2;
+   s[1] = -1./M_SQRT2;
+   s[2] = 0.;
+   c[0] = 1.;
+   c[1] = 0.;
+   c[2] = 0.;
+   v[0] = 1.;
+   v[1] = 2.;
+   v[2] = 3.;
+   p[0] = 0.;
+   p[1] = 0.;
+   p[2] = 0.;
+   pf[0] = 0.5 + v[0];
+   pf[1] = 0.5 + v[1];
+   pf[2] = -1./M_SQRT2 + v[2];
+   dq_cr_rotation( R, M_PI/2., s, c );
+   dq_cr_translation_vector( E, v );
+   dq_op_mul( RT, E, R );
+   dq_cr_translation_vector( Q, p );
+   dq_op_sclerp( O, Q, RT, 1. );
+   dq_cr_point( P, p );
+   dq_op_f4g( E, O, P );
+   dq_cr_point( PF, pf );
+   if (dq_ch_cmp( E, PF ) != 0) {
+      fprintf( stderr, "Screw linear interpolation of a movement failed at t = 1!\n" );
+      dq_print_vert( E );
+      return -1;
+   }
+   dq_op_sclerp( O, Q, RT, 0.5 );
+   dq_op_pow( E, RT, 0.5 );
+   dq_op_mul( F, O, O );
+   if ((dq_ch_cmp( O, E ) != 0) || (dq_ch_cmp( F, RT ) != 0) || !dq_ch_unit( O )) {
+      fprintf( stderr, "Screw linear interpolation of a movement failed at t = 0.5!\n" );
+      dq_print_vert( O );
+      return -1;
+   }
+
+   /* Screws of known axis, angle and translation. */
+   for (i=0; i<10000; i++) {
+      a    = rnd_double() * M_PI;
+      d    = (rnd_double() - 0.5) * 20.;
+      s[0] = rnd_double() - 0.5;
+      s[1] = rnd_double() - 0.5;
+      s[2] = rnd_double() - 0.5;
+      vec3_normalize( s );
+      c[0] = rnd_double() * 10.;
+      c[1] = rnd_double() * 10.;
+      c[2] = rnd_double() * 10.;
+      screw_dq( Q, a, d, s, c );
+      dq_op_log( L, Q );
+      vec3_cross( s0, c, s );
+      for (j=0; j<3; j++) {
+         E[1+j] = a/2. * s[j];
+         E[4+j] = a/2. * s0[j] + d/2. * s[j];
+      }
+      E[0] = E[7] = 0.;
+      if (dq_ch_cmpV( L, E, 1e-9 ) != 0) {
+         fprintf( stderr, "Logarithm of a screw failed!\n" );
+         dq_print_vert( L );
+         dq_print_vert( E );
+         return -1;
+      }
+      dq_op_exp( O, L );
+      a *= 0.3;
+      d *= 0.3;
+      screw_dq( E, a, d, s, c );
+      dq_op_pow( F, Q, 0.3 );
+      if ((dq_ch_cmpV( O, Q, 1e-9 ) != 0) || (dq_ch_cmpV( F, E, 1e-9 ) != 0)) {
+         fprintf( stderr, "Exponential or power of a screw failed!\n" );
+         dq_print_vert( F );
+         dq_print_vert( E );
+         return -1;
+      }
+
+      /* Any displacement, through the shortest screw. */
+      rnd_dq( P );
+      rnd_dq( R );
+      dq_op_mul( Q, P, R );
+      dq_op_log( L, Q );
+      dq_op_exp( O, L );
+      dq_op_pow( E, Q, 0.5 );
+      dq_op_mul( F, E, E );
+      if ((dq_ch_cmpV( O, Q, 1e-9 ) != 0) || (dq_ch_cmpV( F, Q, 1e-9 ) != 0) ||
+            (L[0] != 0.) || (L[7] != 0.) ||
+            (fabs( atan2( vec3_norm( &Q[1] ), fabs( Q[0] ) ) - vec3_norm( &L[1] ) ) > 1e-12)) {
+         fprintf( stderr, "Logarithm of a displacement failed!\n" );
+         dq_print_vert( Q );
+         dq_print_vert( O );
+         return -1;
+      }
+      dq_op_sclerp( O, P, Q, 0. );
+      dq_op_sclerp( E, P, Q, 1. );
+      if ((dq_ch_cmpV( O, P, 1e-9 ) != 0) || (dq_ch_cmpV( E, Q, 1e-9 ) != 0)) {
+         fprintf( stderr, "Screw linear interpolation does not reach its ends!\n" );
+         return -1;
+      }
+   }
+
+   /* Small angles must keep their precision, down to pure translations. */
+   for (i=0; i<(int)(sizeof(small)/sizeof(small[0])); i++) {
+      for (k=0; k<100; k++) {
+         d    = (rnd_double() - 0.5) * 20.;
+         s[0] = rnd_double() - 0.5;
+         s[1] = rnd_double() - 0.5;
+         s[2] = rnd_double() - 0.5;
+         vec3_normalize( s );
+         c[0] = rnd_double() * 10.;
+         c[1] = rnd_double() * 10.;
+         c[2] = rnd_double() * 10.;
+         screw_dq( Q, small[i], d, s, c );
+         dq_op_log( L, Q );
+         dq_op_exp( O, L );
+         screw_dq( E, small[i]*0.7, d*0.7, s, c );
+         dq_op_pow( F, Q, 0.7 );
+         if ((dq_ch_cmpV( O, Q, 1e-13 ) != 0) || (dq_ch_cmpV( F, E, 1e-13 ) != 0)) {
+            fprintf( stderr, "Screw of angle %g lost precision!\n", small[i] );
+            dq_print_vert( F );
+            dq_print_vert( E );
+            return -1;
+         }
+      }
+   }
+
+   /* Batch versions for many parameters, inside and outside of [0,1]. */
+   for (i=0; i<1000; i++)
+      t[i] = (rnd_double() - 0.25) * 2.;
+   rnd_dq( P );
+   rnd_dq( Q );
+   dq_op_pow_n( Pn, Q, t, 1000 );
+   dq_op_sclerp_n( On, P, Q, t, 1000 );
+   for (i=0; i<1000; i++) {
+      dq_op_pow( E, Q, t[i] );
+      dq_op_sclerp( F, P, Q, t[i] );
+      if ((dq_ch_cmpV( Pn[i], E, 1e-12 ) != 0) || (dq_ch_cmpV( On[i], F, 1e-12 ) != 0)) {
+         fprintf( stderr, "Batch screw linear interpolation failed at t = %g!\n", t[i] );
+         return -1;
+      }
+   }
+
+   /* Single precision. */
+   for (j=0; j<8; j++) {
+      Pf[j] = (float)P[j];
+      Qf[j] = (float)Q[j];
+   }
+   dqf_op_sclerp( Of, Pf, Qf, 0.3f );
+   dq_op_sclerp( O, P, Q, 0.3 );
+   for (j=0; j<8; j++) {
+      if (fabs( Of[j] - O[j] ) > 1e-4 * (1. + fabs(O[j]))) {
+         fprintf( stderr, "Single precision screw linear interpolation failed!\n" );
+         dqf_print_vert( Of );
+         dq_print_vert( O );
+         return -1;
+      }
+   }
+
+   /* Only the screw keeps the intermediate poses on the motion. */
+   a    = 2.;
+   d    = 3.;
+   s[0] = 0.;
+   s[1] = 0.;
+   s[2] = 1.;
+   c[0] = 5.;
+   c[1] = 0.;
+   c[2] = 0.;
+   memset( P, 0, sizeof(dq_t) );
+   P[0] = 1.;
+   screw_dq( Q, a, d, s, c );
+   err[0] = err[1] = 0.;
+   for (i=1; i<10; i++) {
+      screw_dq( E, a*(double)i/10., d*(double)i/10., s, c );
+      dq_op_sclerp( O, P, Q, (double)i/10. );
+      slerp_lerp_dq( F, P, Q, (double)i/10. );
+      for (j=0; j<8; j++) {
+         err[0] = (fabs( O[j] - E[j] ) > err[0]) ? fabs( O[j] - E[j] ) : err[0];
+         err[1] = (fabs( F[j] - E[j] ) > err[1]) ? fabs( F[j] - E[j] ) : err[1];
+      }
+   }
+   if ((err[0] > 1e-12) || (err[1] < 0.1)) {
+      fprintf( stderr, "Screw linear interpolation left the screw by %.3e, slerp and lerp by %.3e!\n",
+            err[0], err[1] );
+      return -1;
+   }
+
+   /* Benchmark sampling a trajectory. */
+   N = 1000;
+   rnd_dq( P );
+   rnd_dq( Q );
+   for (i=0; i<1000; i++)
+      t[i] = (double)i / 999.;
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++)
+      for (i=0; i<1000; i++)
+         dq_op_sclerp( On[i], P, Q, t[i] );
+   gettimeofday( &tend, NULL );
+   dt[0] = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++)
+      dq_op_sclerp_n( On, P, Q, t, 1000 );
+   gettimeofday( &tend, NULL );
+   dt[1] = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++)
+      for (i=0; i<1000; i++)
+         slerp_lerp_dq( On[i], P, Q, t[i] );
+   gettimeofday( &tend, NULL );
+   dt[2] = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d screw linear interpolations: %.3e (dq_op_sclerp), %.3e (dq_op_sclerp_n), "
+         "%.3e (slerp and lerp) seconds/interpolation, off the screw by %.1e (dq_op_sclerp), %.1e (slerp and lerp).\n",
+         1000*N, dt[0]/(1000.*(double)N), dt[1]/(1000.*(double)N), dt[2]/(1000.*(double)N), err[0], err[1] );
+
+   return 0;
+}
+
+
 static int test_homo (void)
 {
-   dq_t E, P, Q, PF, H[10];
+   dq_t E, P, Q, PF, H[10], Qnr;
    double RR[3][3], Rt[10][3][3];
    double dd[3], dt[3*10];
-   double HH[3][4], Ht[10][3][4];
+   double HH[3][4], Ht[10][3][4], Hnr[3][4];
    double p[4] = { 7., 5., 6., 1. };
    double pf[3];
    double ph[4];
@@ -417,6 +761,18 @@ static int test_homo (void)
 
       /* Calculate with homogeneous matrix math. */
       homo_op_mul( HH, Ht[1], Ht[0] );
+      homo_op_mul_nr( Hnr, Ht[1], Ht[0] );
+      if (homo_ch_cmp( Hnr, HH ) != 0) {
+         fprintf( stderr, "Copy-free homogeneous matrix multiplication failed!\n" );
+         return -1;
+      }
+      homo_op_mul_ip( Hnr, Ht[2] );
+      homo_op_mul( HH, HH, Ht[2] );
+      if (homo_ch_cmp( Hnr, HH ) != 0) {
+         fprintf( stderr, "In place homogeneous matrix multiplication failed!\n" );
+         return -1;
+      }
+      homo_op_mul( HH, Ht[1], Ht[0] );
       for (j=2; j<10; j++)
          homo_op_mul( HH, Ht[j], HH );
       homo_op_mul_vec( ph, HH, p );
@@ -431,6 +787,17 @@ static int test_homo (void)
 
       /* Calculations with quaternions. */
       dq_op_mul( Q, H[1], H[0] );
+      dq_op_mul_nr( Qnr, H[1], H[0] );
+      if (dq_ch_cmp( Qnr, Q ) != 0) {
+         fprintf( stderr, "Copy-free dual quaternion multiplication failed!\n" );
+         return -1;
+      }
+      dq_op_mul_ip( Qnr, H[2] );
+      dq_op_mul( E, Q, H[2] );
+      if (dq_ch_cmp( Qnr, E ) != 0) {
+         fprintf( stderr, "In place dual quaternion multiplication failed!\n" );
+         return -1;
+      }
       for (j=2; j<10; j++)
          dq_op_mul( Q, H[j], Q );
       dq_cr_point( P, p );
@@ -450,6 +817,31 @@ static int test_homo (void)
 }
 
 
+/**
+ * @brief Joints of the SCARA robot Epson E2L65.
+ */
+static int scara_chain( dq_chain_t *C )
+{
+   double s1[3] = { 0., 0., 1. };
+   double c1[3] = { 0., 0., 0. };
+   double s2[3] = { 0., 0., 1. };
+   double c2[3] = { 300., 0., 0. };
+   double s3[3] = { 0., 0., 1. };
+   double c3[3] = { 0., -650., 0. };
+   double s4[3] = { 0., 0., -1. };
+   double s0[3];
+
+   if (dq_chain_create( C, 4 ) != 0)
+      return -1;
+   vec3_cross( s0, c2, s2 );
+   dq_chain_set_axis( C, 0, DQ_JOINT_REVOLUTE, s1, c1 );
+   dq_chain_set_axis( C, 1, DQ_JOINT_REVOLUTE, s2, s0 );
+   dq_chain_set_axis( C, 2, DQ_JOINT_REVOLUTE, s3, c3 );
+   dq_chain_set_axis( C, 3, DQ_JOINT_PRISMATIC, s4, c1 );
+   return 0;
+}
+
+
 static int test_scara (void)
 {
    int i;
@@ -463,10 +855,16 @@ static int test_scara (void)
    double a1, a2, a3, t4;
    dq_t S1, S2, S3, S4;
    dq_t S1234;
+   dq_t Sc[4], Sc1234;
    dq_t St;
+   dq_chain_t C;
+   dq_t L[4];
+   double q[4];
 
    /* Make function deterministic. */
    rnd_init();
+   if (scara_chain( &C ) != 0)
+      return -1;
 
    /* Example taken form Alba Perez.
     *
@@ -487,6 +885,28 @@ static int test_scara (void)
       dq_op_mul( S1234, S1, S2 );
       dq_op_mul( S1234, S1234, S3 );
       dq_op_mul( S1234, S1234, S4 );
+      /* Chain multiplication associates differently but must agree. */
+      dq_cr_copy( Sc[0], S1 );
+      dq_cr_copy( Sc[1], S2 );
+      dq_cr_copy( Sc[2], S3 );
+      dq_cr_copy( Sc[3], S4 );
+      dq_op_mul_chain( Sc1234, Sc, 4 );
+      if (dq_ch_cmp( S1234, Sc1234 ) != 0) {
+         fprintf( stderr, "Scara chain multiplication failed!\n" );
+         dq_chain_free( &C );
+         return -1;
+      }
+      /* Same robot as a kinematic chain. */
+      q[0] = a1;
+      q[1] = a2;
+      q[2] = a3;
+      q[3] = t4;
+      dq_chain_fk( &C, q, L );
+      if (dq_ch_cmp( S1234, L[3] ) != 0) {
+         fprintf( stderr, "Scara kinematic chain failed!\n" );
+         dq_chain_free( &C );
+         return -1;
+      }
       /* Calculate movement as per the document. */
       St[0] = cos( (a1+a2+a3)/2. );
       St[1] = 0.;
@@ -503,9 +923,93 @@ static int test_scara (void)
          dq_print_vert( S1234 );
          printf( "Expected:\n" );
          dq_print_vert( St );
+         dq_chain_free( &C );
          return -1;
       }
    }
+   dq_chain_free( &C );
+   return 0;
+}
+
+
+static int test_benchmark_nr( int N )
+{
+   int i, k, level;
+   dq_t A[2], B;
+   double MA[2][3][3], MB[3][3], v[2][3];
+   double HA[2][3][4], HB[3][4];
+   struct timeval tstart, tend;
+   double dt[3][4];
+
+   rnd_init();
+   rnd_dq( A[0] );
+   rnd_dq( B );
+   test_mat_rot( MA[0], rnd_double(), rnd_double(), rnd_double() );
+   test_mat_rot( MB, rnd_double(), rnd_double(), rnd_double() );
+   v[0][0] = v[0][1] = v[0][2] = 1.;
+   homo_cr_join( HA[0], MA[0], v[0] );
+   homo_cr_join( HB, MB, v[0] );
+
+   /* Alternate between two buffers so the copy-free versions can be used.
+    * Use the scalar kernels so dq_op_mul runs the same arithmetic. */
+   level = dq_simd_get();
+   dq_simd_set( DQ_SIMD_SCALAR );
+   for (k=0; k<3; k++) {
+      gettimeofday( &tstart, NULL );
+      for (i=0; i<N; i++) {
+         if (k == 0)
+            dq_op_mul( A[(i+1)%2], A[i%2], B );
+         else if (k == 1)
+            dq_op_mul_nr( A[(i+1)%2], A[i%2], B );
+         else
+            dq_op_mul_ip( A[0], B );
+      }
+      gettimeofday( &tend, NULL );
+      dt[k][0] = elapsed( &tstart, &tend );
+
+      gettimeofday( &tstart, NULL );
+      for (i=0; i<N; i++) {
+         if (k == 0)
+            mat3_mul( MA[(i+1)%2], MA[i%2], MB );
+         else if (k == 1)
+            mat3_mul_nr( MA[(i+1)%2], MA[i%2], MB );
+         else
+            mat3_mul_ip( MA[0], MB );
+      }
+      gettimeofday( &tend, NULL );
+      dt[k][1] = elapsed( &tstart, &tend );
+
+      gettimeofday( &tstart, NULL );
+      for (i=0; i<N; i++) {
+         if (k == 0)
+            mat3_mul_vec( v[(i+1)%2], MB, v[i%2] );
+         else if (k == 1)
+            mat3_mul_vec_nr( v[(i+1)%2], MB, v[i%2] );
+         else
+            mat3_mul_vec_ip( v[0], MB );
+      }
+      gettimeofday( &tend, NULL );
+      dt[k][2] = elapsed( &tstart, &tend );
+
+      gettimeofday( &tstart, NULL );
+      for (i=0; i<N; i++) {
+         if (k == 0)
+            homo_op_mul( HA[(i+1)%2], HA[i%2], HB );
+         else if (k == 1)
+            homo_op_mul_nr( HA[(i+1)%2], HA[i%2], HB );
+         else
+            homo_op_mul_ip( HA[0], HB );
+      }
+      gettimeofday( &tend, NULL );
+      dt[k][3] = elapsed( &tstart, &tend );
+   }
+   dq_simd_set( level );
+
+   fprintf( stdout, "Benchmarked copy-free variants (seconds/call, copying / _nr / _ip):\n" );
+   fprintf( stdout, "   dq_op_mul    %.3e / %.3e / %.3e\n", dt[0][0]/(double)N, dt[1][0]/(double)N, dt[2][0]/(double)N );
+   fprintf( stdout, "   mat3_mul     %.3e / %.3e / %.3e\n", dt[0][1]/(double)N, dt[1][1]/(double)N, dt[2][1]/(double)N );
+   fprintf( stdout, "   mat3_mul_vec %.3e / %.3e / %.3e\n", dt[0][2]/(double)N, dt[1][2]/(double)N, dt[2][2]/(double)N );
+   fprintf( stdout, "   homo_op_mul  %.3e / %.3e / %.3e\n", dt[0][3]/(double)N, dt[1][3]/(double)N, dt[2][3]/(double)N );
    return 0;
 }
 
@@ -576,6 +1080,2630 @@ static int test_benchmark (void)
       dq_print_vert( RP );
       return -1;
    }
+
+   return test_benchmark_nr( N );
+}
+
+
+static int test_batch (void)
+{
+   int i, N, level, best;
+   dq_t *P, *Q, *PQ, *O, *Os;
+   dq_soa_t SP, SQ, SPQ;
+   const char *names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+
+   /* Not a multiple of any register width, so the last lanes are left over. */
+   N = 1003;
+   rnd_init();
+
+   P  = malloc( sizeof(dq_t)*(size_t)N );
+   Q  = malloc( sizeof(dq_t)*(size_t)N );
+   PQ = malloc( sizeof(dq_t)*(size_t)N );
+   O  = malloc( sizeof(dq_t)*(size_t)N );
+   Os = malloc( sizeof(dq_t)*(size_t)N );
+   if ((dq_soa_create( &SP, N ) != 0) || (dq_soa_create( &SQ, N ) != 0) ||
+         (dq_soa_create( &SPQ, N ) != 0)) {
+      fprintf( stderr, "Failed to allocate structure of arrays!\n" );
+      return -1;
+   }
+
+   for (i=0; i<N; i++) {
+      rnd_dq( P[i] );
+      rnd_dq( Q[i] );
+      dq_op_mul( PQ[i], P[i], Q[i] );
+   }
+
+   /* Array of structures. */
+   dq_op_mul_n( O, (const dq_t *)P, (const dq_t *)Q, N );
+   for (i=0; i<N; i++) {
+      if (dq_ch_cmp( PQ[i], O[i] ) != 0) {
+         fprintf( stderr, "Batch multiplication failed at %d!\n", i );
+         printf( "Got:\n" );
+         dq_print_vert( O[i] );
+         printf( "Expected:\n" );
+         dq_print_vert( PQ[i] );
+         return -1;
+      }
+   }
+
+   /* Structure of arrays with every kernel, into separate streams then in place. */
+   best = dq_simd_get();
+   for (level=DQ_SIMD_SCALAR; level<=best; level++) {
+      dq_simd_set( level );
+      dq_soa_load( &SP, P, N );
+      dq_soa_load( &SQ, Q, N );
+      dq_soa_op_mul( &SPQ, &SP, &SQ );
+      dq_soa_store( Os, &SPQ, N );
+      dq_soa_op_mul( &SQ, &SP, &SQ );
+      dq_soa_store( O, &SQ, N );
+      for (i=0; i<N; i++) {
+         if ((dq_ch_cmp( PQ[i], Os[i] ) != 0) || (dq_ch_cmp( PQ[i], O[i] ) != 0)) {
+            fprintf( stderr, "%s %sstructure of arrays multiplication failed at %d!\n",
+                  names[level], (dq_ch_cmp( PQ[i], Os[i] ) != 0) ? "" : "in-place ", i );
+            dq_simd_set( best );
+            return -1;
+         }
+      }
+   }
+   dq_simd_set( best );
+
+   /* Output may alias the input. */
+   dq_op_mul_n( P, (const dq_t *)P, (const dq_t *)Q, N );
+   for (i=0; i<N; i++) {
+      if (dq_ch_cmp( PQ[i], P[i] ) != 0) {
+         fprintf( stderr, "In-place batch multiplication failed at %d!\n", i );
+         return -1;
+      }
+   }
+
+   dq_soa_free( &SP );
+   dq_soa_free( &SQ );
+   dq_soa_free( &SPQ );
+   free( P );
+   free( Q );
+   free( PQ );
+   free( O );
+   free( Os );
+   return 0;
+}
+
+
+static int test_benchmark_batch (void)
+{
+   int i, r, N, R;
+   dq_t *P, *Q, *PQ;
+   dq_soa_t SP, SQ, SPQ;
+   struct timeval tstart, tend;
+   double dt1, dtn, dts;
+
+   N = 1000;
+   R = 1000;
+   rnd_init();
+
+   P  = malloc( sizeof(dq_t)*(size_t)N );
+   Q  = malloc( sizeof(dq_t)*(size_t)N );
+   PQ = malloc( sizeof(dq_t)*(size_t)N );
+   if ((dq_soa_create( &SP, N ) != 0) || (dq_soa_create( &SQ, N ) != 0) ||
+         (dq_soa_create( &SPQ, N ) != 0)) {
+      fprintf( stderr, "Failed to allocate structure of arrays!\n" );
+      return -1;
+   }
+   for (i=0; i<N; i++) {
+      rnd_dq( P[i] );
+      rnd_dq( Q[i] );
+   }
+   dq_soa_load( &SP, P, N );
+   dq_soa_load( &SQ, Q, N );
+
+   /* One call per product. */
+   gettimeofday( &tstart, NULL );
+   for (r=0; r<R; r++)
+      for (i=0; i<N; i++)
+         dq_op_mul( PQ[i], P[i], Q[i] );
+   gettimeofday( &tend, NULL );
+   dt1 = elapsed( &tstart, &tend );
+
+   /* Array of structures. */
+   gettimeofday( &tstart, NULL );
+   for (r=0; r<R; r++)
+      dq_op_mul_n( PQ, (const dq_t *)P, (const dq_t *)Q, N );
+   gettimeofday( &tend, NULL );
+   dtn = elapsed( &tstart, &tend );
+
+   /* Structure of arrays. */
+   gettimeofday( &tstart, NULL );
+   for (r=0; r<R; r++)
+      dq_soa_op_mul( &SPQ, &SP, &SQ );
+   gettimeofday( &tend, NULL );
+   dts = elapsed( &tstart, &tend );
+
+   fprintf( stdout, "Benchmarked %d batch multiplications: %.3e (dq_op_mul), %.3e (dq_op_mul_n), %.3e (dq_soa_op_mul) seconds/multiplication.\n",
+         N*R, dt1/(double)(N*R), dtn/(double)(N*R), dts/(double)(N*R) );
+
+   dq_soa_free( &SP );
+   dq_soa_free( &SQ );
+   dq_soa_free( &SPQ );
+   free( P );
+   free( Q );
+   free( PQ );
+   return 0;
+}
+
+
+static int test_simd (void)
+{
+   int i, level, best;
+   dq_t P, Q, B, PQ[2], PBP[2], C[2];
+   double R[2][3][3], d[2][3], p[3];
+   const char *names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+
+   best = dq_simd_get();
+   for (level=DQ_SIMD_SSE2; level<=best; level++) {
+      rnd_init();
+      for (i=0; i<10000; i++) {
+         rnd_dq( P );
+         rnd_dq( Q );
+         p[0] = rnd_double() * 10.;
+         p[1] = rnd_double() * 10.;
+         p[2] = rnd_double() * 10.;
+         dq_cr_point( B, p );
+
+         /* Scalar reference. */
+         dq_simd_set( DQ_SIMD_SCALAR );
+         dq_op_mul( PQ[0], P, Q );
+         dq_op_f4g( PBP[0], P, B );
+         dq_op_extract( R[0], d[0], PQ[0] );
+         dq_cr_conj( C[0], PQ[0] );
+
+         /* Vectorized. */
+         dq_simd_set( level );
+         dq_op_mul( PQ[1], P, Q );
+         dq_op_f4g( PBP[1], P, B );
+         dq_op_extract( R[1], d[1], PQ[0] );
+         dq_cr_conj( C[1], PQ[0] );
+
+         if ((dq_ch_cmp( PQ[0], PQ[1] ) != 0) || (dq_ch_cmp( PBP[0], PBP[1] ) != 0) ||
+               (mat3_cmp( R[0], R[1] ) != 0) || (vec3_cmp( d[0], d[1] ) != 0) ||
+               (dq_ch_cmp( C[0], C[1] ) != 0)) {
+            fprintf( stderr, "%s kernels do not match scalar implementation!\n", names[level] );
+            printf( "Multiplication:\n" );
+            dq_print_vert( PQ[1] );
+            printf( "Expected:\n" );
+            dq_print_vert( PQ[0] );
+            dq_simd_set( best );
+            return -1;
+         }
+      }
+   }
+   dq_simd_set( best );
+   return 0;
+}
+
+
+static int test_benchmark_simd (void)
+{
+   int i, level, best, N;
+   double a, s[3], c[3], dt;
+   dq_t R, RR, B;
+   struct timeval tstart, tend;
+   const char *names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+
+   N = 1000000;
+   rnd_init();
+   a     = rnd_double() * 2. * M_PI / (double)N;
+   s[0]  = rnd_double();
+   s[1]  = rnd_double();
+   s[2]  = rnd_double();
+   vec3_normalize( s );
+   c[0]  = rnd_double() * 10.;
+   c[1]  = rnd_double() * 10.;
+   c[2]  = rnd_double() * 10.;
+   dq_cr_rotation( R, a, s, c );
+
+   best = dq_simd_get();
+   for (level=DQ_SIMD_SCALAR; level<=best; level++) {
+      dq_simd_set( level );
+      dq_cr_copy( RR, R );
+      gettimeofday( &tstart, NULL );
+      for (i=0; i<N; i++)
+         dq_op_mul( RR, RR, R );
+      gettimeofday( &tend, NULL );
+      dt = elapsed( &tstart, &tend );
+
+      /* The scalar level is the fused form of dq_op_f4g_n. */
+      dq_cr_point( B, c );
+      gettimeofday( &tstart, NULL );
+      for (i=0; i<N; i++)
+         dq_op_f4g( B, R, B );
+      gettimeofday( &tend, NULL );
+      fprintf( stdout, "Benchmarked %d %s multiplications and f4g: %.3e seconds/multiplication, %.3e seconds/f4g.\n",
+            N, names[level], dt/(double)N, elapsed( &tstart, &tend )/(double)N );
+   }
+   dq_simd_set( best );
+   return 0;
+}
+
+
+static int test_transform_points (void)
+{
+   int i, j, N;
+   dq_t Q, P, PF;
+   double *in, *out;
+   struct timeval tstart, tend;
+   double dtf, dtp;
+
+   N = 1000;
+   rnd_init();
+   in  = malloc( sizeof(double)*3*(size_t)N );
+   out = malloc( sizeof(double)*3*(size_t)N );
+
+   for (j=0; j<100; j++) {
+      rnd_dq( Q );
+      for (i=0; i<3*N; i++)
+         in[i] = rnd_double() * 20. - 10.;
+      dq_op_transform_points( Q, in, out, N );
+
+      for (i=0; i<N; i++) {
+         dq_cr_point( P, &in[3*i] );
+         dq_op_f4g( PF, Q, P );
+         if (vec3_cmp( &PF[4], &out[3*i] ) != 0) {
+            fprintf( stderr, "Point transformation failed!\n" );
+            printf( "Got:\n" );
+            vec3_print( &out[3*i] );
+            printf( "Expected:\n" );
+            vec3_print( &PF[4] );
+            return -1;
+         }
+      }
+
+      /* In place must give the same. */
+      dq_op_transform_points( Q, in, in, N );
+      for (i=0; i<3*N; i++) {
+         if (in[i] != out[i]) {
+            fprintf( stderr, "In-place point transformation failed!\n" );
+            return -1;
+         }
+      }
+   }
+
+   /* Benchmark against the generic sandwich product. */
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<1000; j++) {
+      for (i=0; i<N; i++) {
+         dq_cr_point( P, &in[3*i] );
+         dq_op_f4g( PF, Q, P );
+         out[3*i+0] = PF[4];
+         out[3*i+1] = PF[5];
+         out[3*i+2] = PF[6];
+      }
+   }
+   gettimeofday( &tend, NULL );
+   dtf = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<1000; j++)
+      dq_op_transform_points( Q, in, out, N );
+   gettimeofday( &tend, NULL );
+   dtp = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d point transformations: %.3e (dq_op_f4g), %.3e (dq_op_transform_points) seconds/point.\n",
+         1000*N, dtf/(double)(1000*N), dtp/(double)(1000*N) );
+
+   free( in );
+   free( out );
+   return 0;
+}
+
+
+static void test_sandwich_ref( dq_t ABA, const dq_t A, const dq_t B, int type )
+{
+   dq_t C;
+   int i;
+   /* Signs of the conjugates of A used by f1g, f2g, f3g and f4g. */
+   static const double sign[4][8] = {
+      {  1.,  1.,  1.,  1.,  1.,  1.,  1.,  1. },
+      {  1., -1., -1., -1., -1., -1., -1.,  1. },
+      {  1.,  1.,  1.,  1., -1., -1., -1., -1. },
+      {  1., -1., -1., -1.,  1.,  1.,  1., -1. }
+   };
+   for (i=0; i<8; i++)
+      C[i] = sign[type][i] * A[i];
+   dq_op_mul( ABA, A, B );
+   dq_op_mul( ABA, ABA, C );
+}
+
+
+static int test_sandwich (void)
+{
+   int i, j, k, N;
+   dq_t A, O, E;
+   dq_t *B, *BA;
+   struct timeval tstart, tend;
+   double dtm, dtf, dtn;
+   void (*f[4])( dq_t, const dq_t, const dq_t ) = {
+      dq_op_f1g, dq_op_f2g, dq_op_f3g, dq_op_f4g };
+   void (*fn[4])( dq_t*, const dq_t, dq_t*, int ) = {
+      dq_op_f1g_n, dq_op_f2g_n, dq_op_f3g_n, dq_op_f4g_n };
+
+   N = 1000;
+   rnd_init();
+   B  = malloc( sizeof(dq_t)*(size_t)N );
+   BA = malloc( sizeof(dq_t)*(size_t)N );
+
+   for (j=0; j<100; j++) {
+      /* The fused forms hold for any A, not only unit dual quaternions. */
+      for (i=0; i<8; i++)
+         A[i] = rnd_double() * 2. - 1.;
+      for (i=0; i<N; i++)
+         for (k=0; k<8; k++)
+            B[i][k] = rnd_double() * 20. - 10.;
+
+      for (k=0; k<4; k++) {
+         for (i=0; i<N; i++) {
+            test_sandwich_ref( E, A, B[i], k );
+            f[k]( O, A, B[i] );
+            if (dq_ch_cmp( O, E ) != 0) {
+               fprintf( stderr, "Fused f%dg transformation failed!\n", k+1 );
+               printf( "Got:\n" );
+               dq_print_vert( O );
+               printf( "Expected:\n" );
+               dq_print_vert( E );
+               return -1;
+            }
+         }
+
+         /* Batch version must match, also in place. */
+         fn[k]( BA, A, B, N );
+         memcpy( O, B[N-1], sizeof(dq_t) );
+         fn[k]( B, A, B, N );
+         for (i=0; i<N; i++) {
+            if (memcmp( B[i], BA[i], sizeof(dq_t) ) != 0) {
+               fprintf( stderr, "Batch f%dg transformation failed!\n", k+1 );
+               return -1;
+            }
+         }
+         f[k]( E, A, O );
+         if (dq_ch_cmp( E, BA[N-1] ) != 0) {
+            fprintf( stderr, "Batch f%dg transformation does not match single!\n", k+1 );
+            return -1;
+         }
+      }
+   }
+
+   /* Benchmark transforming many points by one transformation. */
+   rnd_dq( A );
+   for (i=0; i<N; i++)
+      dq_cr_point( B[i], &B[i][4] );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<1000; j++)
+      for (i=0; i<N; i++)
+         test_sandwich_ref( BA[i], A, B[i], 3 );
+   gettimeofday( &tend, NULL );
+   dtm = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<1000; j++)
+      for (i=0; i<N; i++)
+         dq_op_f4g( BA[i], A, B[i] );
+   gettimeofday( &tend, NULL );
+   dtf = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<1000; j++)
+      dq_op_f4g_n( BA, A, B, N );
+   gettimeofday( &tend, NULL );
+   dtn = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d f4g transformations: %.3e (2 x dq_op_mul), %.3e (dq_op_f4g), %.3e (dq_op_f4g_n) seconds/transformation.\n",
+         1000*N, dtm/(double)(1000*N), dtf/(double)(1000*N), dtn/(double)(1000*N) );
+
+   free( B );
+   free( BA );
+   return 0;
+}
+
+
+static int test_rotation_matrix (void)
+{
+   int i, j, N;
+   dq_t Q, O, *QN;
+   double R[3][3], d[3], (*RN)[3][3];
+   double s[3], c[3] = { 0., 0., 0. };
+   double axes[6][3] = {
+      { 1., 0., 0. },
+      { 0., 1., 0. },
+      { 0., 0., 1. },
+      { M_SQRT1_2, M_SQRT1_2, 0. },
+      { 0., -M_SQRT1_2, M_SQRT1_2 },
+      { 0.6, 0., -0.8 }
+   };
+   struct timeval tstart, tend;
+   double dt;
+
+   N = 1000;
+   rnd_init();
+   QN = malloc( sizeof(dq_t)*(size_t)N );
+   RN = malloc( sizeof(double)*9*(size_t)N );
+
+   /* Random rotations and half turns, which are singular for the Cayley transform. */
+   for (i=0; i<N+6; i++) {
+      if (i < N) {
+         rnd_dq( Q );
+         Q[4] = Q[5] = Q[6] = Q[7] = 0.;
+      }
+      else {
+         memcpy( s, axes[i-N], sizeof(s) );
+         dq_cr_rotation( Q, M_PI, s, c );
+      }
+      dq_op_extract( R, d, Q );
+      dq_cr_rotation_matrix( O, R );
+      /* Both Q and -Q represent the same rotation. */
+      if (Q[0]*O[0] + Q[1]*O[1] + Q[2]*O[2] + Q[3]*O[3] < 0.)
+         dq_op_sign( Q, Q );
+      if ((dq_ch_cmp( O, Q ) != 0) || (O[0] < 0.)) {
+         fprintf( stderr, "Rotation matrix conversion failed!\n" );
+         printf( "Got:\n" );
+         dq_print_vert( O );
+         printf( "Expected:\n" );
+         dq_print_vert( Q );
+         return -1;
+      }
+      if (i < N)
+         memcpy( RN[i], R, sizeof(R) );
+   }
+
+   /* Batch version must match. */
+   dq_cr_rotation_matrix_n( QN, RN, N );
+   for (i=0; i<N; i++) {
+      dq_cr_rotation_matrix( O, RN[i] );
+      if (memcmp( O, QN[i], sizeof(dq_t) ) != 0) {
+         fprintf( stderr, "Batch rotation matrix conversion failed!\n" );
+         return -1;
+      }
+   }
+
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<1000; j++)
+      dq_cr_rotation_matrix_n( QN, RN, N );
+   gettimeofday( &tend, NULL );
+   dt = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d rotation matrix conversions (%.3e seconds/conversion).\n",
+         1000*N, dt/(double)(1000*N) );
+
+   free( QN );
+   free( RN );
+   return 0;
+}
+
+
+static int test_homo_n (void)
+{
+   int i, j, N;
+   dq_t Q, QR, QT, E, *QN;
+   double R[3][3], d[3], (*H)[3][4];
+   struct timeval tstart, tend;
+   double dt;
+
+   N = 1000;
+   rnd_init();
+   QN = malloc( sizeof(dq_t)*(size_t)N );
+   H  = malloc( sizeof(double)*12*(size_t)N );
+
+   for (i=0; i<N; i++) {
+      rnd_dq( Q );
+      dq_op_extract( R, d, Q );
+      homo_cr_join( H[i], R, d );
+
+      /* Direct construction must match translation times rotation. */
+      dq_cr_rotation_matrix( QR, R );
+      dq_cr_translation_vector( QT, d );
+      dq_op_mul( E, QT, QR );
+      dq_cr_homo( Q, R, d );
+      if (dq_ch_cmp( Q, E ) != 0) {
+         fprintf( stderr, "Homogeneous matrix conversion failed!\n" );
+         printf( "Got:\n" );
+         dq_print_vert( Q );
+         printf( "Expected:\n" );
+         dq_print_vert( E );
+         return -1;
+      }
+   }
+
+   /* Batch version must match. */
+   dq_cr_homo_n( QN, H, N );
+   for (i=0; i<N; i++) {
+      homo_op_split( R, d, H[i] );
+      dq_cr_homo( Q, R, d );
+      if (memcmp( Q, QN[i], sizeof(dq_t) ) != 0) {
+         fprintf( stderr, "Batch homogeneous matrix conversion failed!\n" );
+         return -1;
+      }
+   }
+
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<1000; j++)
+      dq_cr_homo_n( QN, H, N );
+   gettimeofday( &tend, NULL );
+   dt = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d homogeneous matrix conversions (%.3e seconds/conversion).\n",
+         1000*N, dt/(double)(1000*N) );
+
+   free( QN );
+   free( H );
+   return 0;
+}
+
+
+static int test_extract_n (void)
+{
+   int i, j, r, c, l, N, size, stride, rows, off, level, best;
+   dq_t *Q;
+   double R[3][3], d[3], H[4][4], *M;
+   float *Mf;
+   struct timeval tstart, tend;
+   double dte, dtn;
+   int flags[4] = {
+      DQ_MATRIX_ROW_MAJOR | DQ_MATRIX_4X4,
+      DQ_MATRIX_COL_MAJOR | DQ_MATRIX_4X4,
+      DQ_MATRIX_ROW_MAJOR | DQ_MATRIX_3X4,
+      DQ_MATRIX_COL_MAJOR | DQ_MATRIX_3X4 };
+
+   /* Not a multiple of four so the last block is partial. */
+   N = 100001;
+   rnd_init();
+   Q  = malloc( sizeof(dq_t)*(size_t)N );
+   M  = malloc( sizeof(double)*19*(size_t)N );
+   Mf = malloc( sizeof(float)*19*(size_t)N );
+   for (i=0; i<N; i++)
+      rnd_dq( Q[i] );
+
+   /* Every kernel level must give the same matrices. */
+   best = dq_simd_get();
+   for (level=DQ_SIMD_SCALAR; level<=best; level++) {
+      dq_simd_set( level );
+      for (l=0; l<4; l++) {
+         rows   = (flags[l] & DQ_MATRIX_3X4) ? 3 : 4;
+         size   = 4*rows;
+         /* Pad the matrices to check nothing is written in between. */
+         stride = size + 3;
+         for (i=0; i<stride*N; i++) {
+            M[i]  = -42.;
+            Mf[i] = -42.f;
+         }
+         dq_op_extract_n( M, stride, flags[l], Q, N );
+         dq_op_extract_nf( Mf, stride, flags[l], Q, N );
+
+         for (i=0; i<N; i++) {
+            dq_op_extract( R, d, Q[i] );
+            for (r=0; r<3; r++) {
+               for (c=0; c<3; c++)
+                  H[r][c] = R[r][c];
+               H[r][3] = d[r];
+            }
+            H[3][0] = H[3][1] = H[3][2] = 0.;
+            H[3][3] = 1.;
+            for (r=0; r<rows; r++) {
+               for (c=0; c<4; c++) {
+                  off = i*stride + ((flags[l] & DQ_MATRIX_COL_MAJOR) ? c*rows + r : 4*r + c);
+                  if ((fabs( M[off] - H[r][c] ) > DQ_PRECISION) ||
+                        (fabs( Mf[off] - H[r][c] ) > 1e-5)) {
+                     fprintf( stderr, "Matrix extraction failed with flags %d at (%d,%d) at SIMD level %d!\n",
+                           flags[l], r, c, level );
+                     printf( "Got %.10e and %.10e, expected %.10e\n", M[off], Mf[off], H[r][c] );
+                     dq_simd_set( best );
+                     return -1;
+                  }
+               }
+            }
+            for (j=size; j<stride; j++) {
+               if ((M[i*stride+j] != -42.) || (Mf[i*stride+j] != -42.f)) {
+                  fprintf( stderr, "Matrix extraction wrote outside the matrix with flags %d!\n", flags[l] );
+                  dq_simd_set( best );
+                  return -1;
+               }
+            }
+         }
+      }
+   }
+   dq_simd_set( best );
+
+   /* Benchmark exporting column-major float matrices as used by renderers. */
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<10; j++) {
+      for (i=0; i<N; i++) {
+         dq_op_extract( R, d, Q[i] );
+         for (c=0; c<3; c++)
+            for (r=0; r<3; r++)
+               Mf[16*i + 4*c + r] = (float)R[r][c];
+         Mf[16*i+3] = Mf[16*i+7] = Mf[16*i+11] = 0.f;
+         Mf[16*i+12] = (float)d[0];
+         Mf[16*i+13] = (float)d[1];
+         Mf[16*i+14] = (float)d[2];
+         Mf[16*i+15] = 1.f;
+      }
+   }
+   gettimeofday( &tend, NULL );
+   dte = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<10; j++)
+      dq_op_extract_nf( Mf, 0, DQ_MATRIX_COL_MAJOR | DQ_MATRIX_4X4, Q, N );
+   gettimeofday( &tend, NULL );
+   dtn = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d float matrix exports: %.3e (dq_op_extract), %.3e (dq_op_extract_nf) seconds/matrix.\n",
+         10*N, dte/(double)(10*N), dtn/(double)(10*N) );
+
+   free( Q );
+   free( M );
+   free( Mf );
+   return 0;
+}
+
+
+static int test_rotation_plucker_n (void)
+{
+   int i, k, N, mode;
+   dq_t *O, R;
+   double *theta, (*s)[3], (*s0)[3], c[3], e[3], err, bad[2];
+   dqf_t Of[4], Rf;
+   float thetaf[4], sf[4][3], s0f[4][3];
+   struct timeval tstart, tend;
+   double dt[4];
+   double tol[3] = { 0., 1e-15, 5e-9 };
+   double doc[3] = { 0., 2.3e-16, 3e-9 }; /* Documented in dq_sincos_set. */
+   const char *names[3] = { "libm", "vector", "fast" };
+
+   rnd_init();
+   N     = 1000000;
+   O     = malloc( sizeof(dq_t) * (size_t)N );
+   theta = malloc( sizeof(double) * 7 * (size_t)N );
+   if ((O == NULL) || (theta == NULL)) {
+      free( O );
+      free( theta );
+      return -1;
+   }
+   s  = (double(*)[3]) &theta[N];
+   s0 = &s[N];
+   for (i=0; i<N; i++) {
+      s[i][0] = rnd_double() - 0.5;
+      s[i][1] = rnd_double() - 0.5;
+      s[i][2] = rnd_double() - 0.5;
+      vec3_normalize( s[i] );
+      c[0] = rnd_double() * 10.;
+      c[1] = rnd_double() * 10.;
+      c[2] = rnd_double() * 10.;
+      vec3_cross( s0[i], c, s[i] );
+      theta[i] = (rnd_double() - 0.5) * 40.;
+   }
+   /* Huge angles go through libm. */
+   theta[N-1] = 1e6;
+
+   /* Must match dq_cr_rotation_plucker within the error of each mode. */
+   for (mode=DQ_SINCOS_LIBM; mode<=DQ_SINCOS_FAST; mode++) {
+      dq_sincos_set( mode );
+      dq_cr_rotation_plucker_n( O, theta, s, s0, N );
+      for (i=0; i<N; i++) {
+         dq_cr_rotation_plucker( R, theta[i], s[i], s0[i] );
+         for (k=0; k<8; k++) {
+            if (fabs( O[i][k] - R[k] ) > tol[mode] * (1. + fabs(R[k]) + vec3_norm(s0[i]))) {
+               fprintf( stderr, "Rotation from Plücker coordinates with %s sine and cosine failed at %d!\n",
+                     names[mode], i );
+               dq_print_vert( O[i] );
+               dq_print_vert( R );
+               dq_sincos_set( DQ_SINCOS_VECTOR );
+               free( O );
+               free( theta );
+               return -1;
+            }
+         }
+      }
+   }
+   if (dq_sincos_set( -1 ) != DQ_SINCOS_FAST) {
+      fprintf( stderr, "Invalid sine and cosine mode was accepted!\n" );
+      free( O );
+      free( theta );
+      return -1;
+   }
+
+   /* NaN and infinities go through libm with the rest of their block. */
+   err = 0.;
+   bad[0] = err / err;
+   bad[1] = HUGE_VAL;
+   e[0]   = theta[0];
+   e[1]   = theta[1];
+   for (mode=DQ_SINCOS_LIBM; mode<=DQ_SINCOS_FAST; mode++) {
+      dq_sincos_set( mode );
+      for (k=0; k<2; k++) {
+         theta[0] = (k == 0) ? bad[0] : 1.;
+         theta[1] = (k == 0) ? 1. : bad[1];
+         dq_cr_rotation_plucker_n( O, theta, s, s0, 2 );
+         dq_cr_rotation_plucker( R, 1., s[1-k], s0[1-k] );
+         if ((O[k][0] == O[k][0]) || (dq_ch_cmpV( O[1-k], R, 0. ) != 0)) {
+            fprintf( stderr, "Rotation from Plücker coordinates with %s sine and cosine mishandled %s!\n",
+                  names[mode], (k == 0) ? "NaN" : "an infinity" );
+            dq_sincos_set( DQ_SINCOS_VECTOR );
+            free( O );
+            free( theta );
+            return -1;
+         }
+      }
+   }
+   dq_sincos_set( DQ_SINCOS_VECTOR );
+   theta[0] = e[0];
+   theta[1] = e[1];
+
+   /* Single precision. */
+   for (i=0; i<4; i++) {
+      thetaf[i] = (float)theta[i];
+      for (k=0; k<3; k++) {
+         sf[i][k]  = (float)s[i][k];
+         s0f[i][k] = (float)s0[i][k];
+      }
+   }
+   dqf_cr_rotation_plucker_n( Of, thetaf, sf, s0f, 4 );
+   for (i=0; i<4; i++) {
+      dqf_cr_rotation_plucker( Rf, thetaf[i], sf[i], s0f[i] );
+      if (dqf_ch_cmpV( Of[i], Rf, 1e-5f ) != 0) {
+         fprintf( stderr, "Single precision rotation from Plücker coordinates failed!\n" );
+         dq_sincos_set( DQ_SINCOS_VECTOR );
+         free( O );
+         free( theta );
+         return -1;
+      }
+   }
+
+   /* Benchmark against one rotation at a time, with the error of the sine
+    * and cosine of the half angle against libm. */
+   e[0] = 1.;
+   e[1] = e[2] = 0.;
+   c[0] = c[1] = c[2] = 0.;
+   for (i=0; i<N; i++) {
+      memcpy( s[i], e, sizeof(e) );
+      memcpy( s0[i], c, sizeof(c) );
+   }
+   gettimeofday( &tstart, NULL );
+   for (i=0; i<N; i++)
+      dq_cr_rotation_plucker( O[i], theta[i], s[i], s0[i] );
+   gettimeofday( &tend, NULL );
+   dt[3] = elapsed( &tstart, &tend );
+   for (mode=DQ_SINCOS_LIBM; mode<=DQ_SINCOS_FAST; mode++) {
+      dq_sincos_set( mode );
+      gettimeofday( &tstart, NULL );
+      dq_cr_rotation_plucker_n( O, theta, s, s0, N );
+      gettimeofday( &tend, NULL );
+      dt[mode] = elapsed( &tstart, &tend );
+      err = 0.;
+      for (i=0; i<N; i++) {
+         e[0] = fabs( O[i][0] - cos( theta[i]/2. ) );
+         e[1] = fabs( O[i][1] - sin( theta[i]/2. ) );
+         err  = (e[0] > err) ? e[0] : err;
+         err  = (e[1] > err) ? e[1] : err;
+      }
+      if (err > doc[mode]) {
+         fprintf( stderr, "Sine and cosine %s error %.3e is larger than documented!\n", names[mode], err );
+         dq_sincos_set( DQ_SINCOS_VECTOR );
+         free( O );
+         free( theta );
+         return -1;
+      }
+      fprintf( stdout, "Benchmarked %d rotations: %.3e (dq_cr_rotation_plucker), %.3e (%s dq_cr_rotation_plucker_n) seconds/rotation, error %.3e.\n",
+            N, dt[3]/(double)N, dt[mode]/(double)N, names[mode], err );
+   }
+   dq_sincos_set( DQ_SINCOS_VECTOR );
+
+   free( O );
+   free( theta );
+   return 0;
+}
+
+
+/**
+ * @brief Builds a Denavit-Hartenberg row with four creations and three multiplications.
+ */
+static void dh_product( dq_t O, double theta, double d, double a, double alpha, int modified )
+{
+   double x[3] = { 1., 0., 0. };
+   double z[3] = { 0., 0., 1. };
+   double o[3] = { 0., 0., 0. };
+   dq_t Rz, Tz, Tx, Rx, A, B;
+
+   dq_cr_rotation( Rz, theta, z, o );
+   dq_cr_translation( Tz, d, z );
+   dq_cr_translation( Tx, a, x );
+   dq_cr_rotation( Rx, alpha, x, o );
+   if (modified) {
+      dq_op_mul( A, Rx, Tx );
+      dq_op_mul( B, A, Rz );
+      dq_op_mul( O, B, Tz );
+   }
+   else {
+      dq_op_mul( A, Rz, Tz );
+      dq_op_mul( B, A, Tx );
+      dq_op_mul( O, B, Rx );
+   }
+}
+
+
+static int test_dh (void)
+{
+   int i, k, m, N;
+   dq_t O, P;
+   dqf_t Of;
+   double dh[4], dt[2];
+   struct timeval tstart, tend;
+   const char *names[2] = { "dq_cr_dh", "dq_cr_mdh" };
+
+   rnd_init();
+   N = 1000000;
+
+   /* Same as the product of the four transforms. */
+   for (m=0; m<2; m++) {
+      for (i=0; i<1000; i++) {
+         dh[0] = (rnd_double() - 0.5) * 4. * M_PI;
+         dh[1] = (rnd_double() - 0.5) * 20.;
+         dh[2] = (rnd_double() - 0.5) * 20.;
+         dh[3] = (rnd_double() - 0.5) * 4. * M_PI;
+         if (m)
+            dq_cr_mdh( O, dh[0], dh[1], dh[2], dh[3] );
+         else
+            dq_cr_dh( O, dh[0], dh[1], dh[2], dh[3] );
+         dh_product( P, dh[0], dh[1], dh[2], dh[3], m );
+         if (dq_ch_cmpV( O, P, 1e-12 ) != 0) {
+            fprintf( stderr, "%s does not match the product of its transforms!\n", names[m] );
+            dq_print_vert( O );
+            dq_print_vert( P );
+            return -1;
+         }
+         if (i < 4) {
+            if (m)
+               dqf_cr_mdh( Of, (float)dh[0], (float)dh[1], (float)dh[2], (float)dh[3] );
+            else
+               dqf_cr_dh( Of, (float)dh[0], (float)dh[1], (float)dh[2], (float)dh[3] );
+            for (k=0; k<8; k++) {
+               if (fabs( Of[k] - P[k] ) > 1e-5 * (1. + fabs(dh[1]) + fabs(dh[2]))) {
+                  fprintf( stderr, "Single precision %s failed!\n", names[m] );
+                  return -1;
+               }
+            }
+         }
+      }
+   }
+
+   /* Benchmark against the product. */
+   dh[0] = rnd_double();
+   dh[1] = rnd_double();
+   dh[2] = rnd_double();
+   dh[3] = rnd_double();
+   gettimeofday( &tstart, NULL );
+   for (i=0; i<N; i++) {
+      dh_product( P, dh[0], dh[1], dh[2], dh[3], 0 );
+      dh[0] += P[7] * 1e-20;
+   }
+   gettimeofday( &tend, NULL );
+   dt[0] = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (i=0; i<N; i++) {
+      dq_cr_dh( O, dh[0], dh[1], dh[2], dh[3] );
+      dh[0] += O[7] * 1e-20;
+   }
+   gettimeofday( &tend, NULL );
+   dt[1] = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d Denavit-Hartenberg rows: %.3e (4 creations, 3 multiplications), %.3e (dq_cr_dh) seconds/row.\n",
+         N, dt[0] / (double)N, dt[1] / (double)N );
+   return 0;
+}
+
+
+static int test_mul_chain (void)
+{
+   int i, j, k, N, threads;
+   int sizes[] = { 0, 1, 2, 3, 7, 8, 9, 17, 100, 1001, 200000 };
+   double z[3] = { 0., 0., 0. };
+   dq_t *L, O, T;
+   struct timeval tstart, tend;
+   double dts, dtc, dtt;
+
+   N = 200000;
+   rnd_init();
+   L = malloc( sizeof(dq_t)*(size_t)N );
+   for (i=0; i<N; i++)
+      rnd_dq( L[i] );
+
+   /* Must match the left to right product. */
+   for (k=0; k<(int)(sizeof(sizes)/sizeof(sizes[0])); k++) {
+      dq_cr_translation_vector( T, z );
+      for (i=0; i<sizes[k]; i++)
+         dq_op_mul( T, T, L[i] );
+      dq_op_mul_chain( O, L, sizes[k] );
+      if (dq_ch_cmpV( O, T, 1e-8 ) != 0) {
+         fprintf( stderr, "Chain multiplication of %d links failed!\n", sizes[k] );
+         printf( "Got:\n" );
+         dq_print_vert( O );
+         printf( "Expected:\n" );
+         dq_print_vert( T );
+         free( L );
+         return -1;
+      }
+   }
+
+   /* The association does not depend on the number of threads. */
+   dq_op_mul_chain( T, L, N );
+   threads = dq_threads_get();
+   for (j=2; j<=8; j*=2) {
+      dq_threads_set( j );
+      dq_op_mul_chain( O, L, N );
+      if (memcmp( O, T, sizeof(dq_t) ) != 0) {
+         fprintf( stderr, "Chain multiplication with %d threads differs from a single thread!\n", j );
+         dq_threads_set( threads );
+         free( L );
+         return -1;
+      }
+   }
+
+   /* Benchmark against repeated multiplication. */
+   dq_threads_set( 1 );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<10; j++) {
+      dq_cr_copy( T, L[0] );
+      for (i=1; i<N; i++)
+         dq_op_mul( T, T, L[i] );
+   }
+   gettimeofday( &tend, NULL );
+   dts = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<10; j++)
+      dq_op_mul_chain( O, L, N );
+   gettimeofday( &tend, NULL );
+   dtc = elapsed( &tstart, &tend );
+   dq_threads_set( 0 );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<10; j++)
+      dq_op_mul_chain( O, L, N );
+   gettimeofday( &tend, NULL );
+   dtt = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d link chains: %.3e (dq_op_mul), %.3e (dq_op_mul_chain), %.3e (%d threads) seconds/link.\n",
+         N, dts/(double)(10*N), dtc/(double)(10*N), dtt/(double)(10*N), dq_threads_get() );
+   dq_threads_set( threads );
+
+   free( L );
+   return 0;
+}
+
+
+static int test_scan (void)
+{
+   int i, j, k, N, threads, reps;
+   int sizes[] = { 0, 1, 2, 5, 100, 8191, 100003 };
+   dq_t *L, *O, *S;
+   struct timeval tstart, tend;
+   double dts, dt1, dtt;
+
+   N = 1000000;
+   rnd_init();
+   L = malloc( sizeof(dq_t)*(size_t)N );
+   O = malloc( sizeof(dq_t)*(size_t)N );
+   S = malloc( sizeof(dq_t)*(size_t)N );
+   for (i=0; i<N; i++)
+      rnd_dq( L[i] );
+
+   /* Must match the left to right products with any number of threads. */
+   threads = dq_threads_get();
+   for (j=1; j<=4; j*=2) {
+      dq_threads_set( j );
+      for (k=0; k<(int)(sizeof(sizes)/sizeof(sizes[0])); k++) {
+         if (sizes[k] > 0)
+            dq_cr_copy( S[0], L[0] );
+         for (i=1; i<sizes[k]; i++)
+            dq_op_mul( S[i], S[i-1], L[i] );
+         dq_op_scan( O, L, sizes[k] );
+         /* In place. */
+         memcpy( L+N-sizes[k], L, sizeof(dq_t)*(size_t)sizes[k] );
+         dq_op_scan( L+N-sizes[k], L+N-sizes[k], sizes[k] );
+         for (i=0; i<sizes[k]; i++) {
+            if ((dq_ch_cmpV( O[i], S[i], 1e-8 ) != 0) ||
+                  (memcmp( O[i], L[N-sizes[k]+i], sizeof(dq_t) ) != 0)) {
+               fprintf( stderr, "Scan of %d links with %d threads failed at link %d!\n", sizes[k], j, i );
+               printf( "Got:\n" );
+               dq_print_vert( O[i] );
+               printf( "Expected:\n" );
+               dq_print_vert( S[i] );
+               dq_threads_set( threads );
+               return -1;
+            }
+         }
+         for (i=N-sizes[k]; i<N; i++)
+            rnd_dq( L[i] );
+      }
+   }
+
+   /* Benchmark scaling with the length of the chain, warm up the outputs first. */
+   dq_op_scan( S, L, N );
+   dq_op_scan( O, L, N );
+   for (k=10; k<=N; k*=10) {
+      reps = N / k;
+      dq_threads_set( 1 );
+      gettimeofday( &tstart, NULL );
+      for (j=0; j<reps; j++) {
+         dq_cr_copy( S[0], L[0] );
+         for (i=1; i<k; i++)
+            dq_op_mul( S[i], S[i-1], L[i] );
+      }
+      gettimeofday( &tend, NULL );
+      dts = elapsed( &tstart, &tend );
+      gettimeofday( &tstart, NULL );
+      for (j=0; j<reps; j++)
+         dq_op_scan( O, L, k );
+      gettimeofday( &tend, NULL );
+      dt1 = elapsed( &tstart, &tend );
+      dq_threads_set( 0 );
+      gettimeofday( &tstart, NULL );
+      for (j=0; j<reps; j++)
+         dq_op_scan( O, L, k );
+      gettimeofday( &tend, NULL );
+      dtt = elapsed( &tstart, &tend );
+      fprintf( stdout, "Benchmarked scan of %d links: %.3e (dq_op_mul), %.3e (dq_op_scan), %.3e (%d threads) seconds/link.\n",
+            k, dts/(double)(reps*k), dt1/(double)(reps*k), dtt/(double)(reps*k), dq_threads_get() );
+   }
+   dq_threads_set( threads );
+
+   free( L );
+   free( O );
+   free( S );
+   return 0;
+}
+
+
+/* Defined in test_inline.c with the header-only library. */
+void test_inline_ops( dq_t *O, dq_t *A, int n );
+static void test_inline_ops_lib( dq_t *O, dq_t *A, int n )
+{
+   int i;
+   dq_t C, S, D;
+   for (i=0; i<n; i++) {
+      dq_cr_conj( C, A[i] );
+      dq_op_add( S, A[i], C );
+      dq_op_sub( D, A[i], C );
+      dq_op_mul( O[i], S, D );
+      O[i][0] += vec3_dot( &A[i][1], &A[i][4] );
+   }
+}
+
+
+static int test_inline (void)
+{
+   int i, j, N, reps;
+   dq_t *A, *O, *Oi;
+   struct timeval tstart, tend;
+   double dtl, dti;
+
+   N    = 1000;
+   reps = 10000;
+   rnd_init();
+   A  = malloc( sizeof(dq_t)*(size_t)N );
+   O  = malloc( sizeof(dq_t)*(size_t)N );
+   Oi = malloc( sizeof(dq_t)*(size_t)N );
+   for (i=0; i<N; i++)
+      rnd_dq( A[i] );
+
+   /* Both builds must agree, up to the rounding of the vectorized kernels. */
+   test_inline_ops_lib( O, A, N );
+   test_inline_ops( Oi, A, N );
+   for (i=0; i<N; i++) {
+      if (dq_ch_cmp( O[i], Oi[i] ) != 0) {
+         fprintf( stderr, "Header-only build differs from the library!\n" );
+         printf( "Got:\n" );
+         dq_print_vert( Oi[i] );
+         printf( "Expected:\n" );
+         dq_print_vert( O[i] );
+         return -1;
+      }
+   }
+
+   /* Benchmark the call overhead of small operations. */
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<reps; j++)
+      test_inline_ops_lib( O, A, N );
+   gettimeofday( &tend, NULL );
+   dtl = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<reps; j++)
+      test_inline_ops( Oi, A, N );
+   gettimeofday( &tend, NULL );
+   dti = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d small operation sequences: %.3e (libdq), %.3e (dq_inline.h) seconds/sequence.\n",
+         N*reps, dtl/(double)(N*reps), dti/(double)(N*reps) );
+
+   free( A );
+   free( O );
+   free( Oi );
+   return 0;
+}
+
+
+static void rnd_chain( dq_chain_t *C, dq_t *J, double *q, int n )
+{
+   int i, type;
+   double s[3], c[3], s0[3];
+   dq_t M;
+
+   for (i=0; i<n; i++) {
+      s[0] = rnd_double() - 0.5;
+      s[1] = rnd_double() - 0.5;
+      s[2] = rnd_double() - 0.5;
+      vec3_normalize( s );
+      c[0] = rnd_double() * 10.;
+      c[1] = rnd_double() * 10.;
+      c[2] = rnd_double() * 10.;
+      vec3_cross( s0, c, s );
+      type = (rnd_double() < 0.25) ? DQ_JOINT_PRISMATIC : DQ_JOINT_REVOLUTE;
+      dq_chain_set_axis( C, i, type, s, s0 );
+      if (type == DQ_JOINT_REVOLUTE) {
+         q[i] = rnd_double() * 2. * M_PI;
+         dq_cr_rotation_plucker( J[i], q[i], s, s0 );
+      }
+      else {
+         q[i] = rnd_double() * 10.;
+         dq_cr_translation( J[i], q[i], s );
+      }
+      rnd_dq( M );
+      dq_chain_set_home( C, i, M );
+   }
+}
+
+
+static int test_chain (void)
+{
+   int i, j, k, N;
+   dq_chain_t C;
+   dq_t J[7], L[7], P, T;
+   double q[7];
+   struct timeval tstart, tend;
+   double dtp, dtc;
+
+   rnd_init();
+   if (dq_chain_create( &C, 7 ) != 0) {
+      fprintf( stderr, "Failed to allocate chain!\n" );
+      return -1;
+   }
+
+   /* Must match building and multiplying the joints with the public API. */
+   for (k=0; k<1000; k++) {
+      rnd_chain( &C, J, q, 7 );
+      dq_chain_fk( &C, q, L );
+      dq_cr_copy( P, J[0] );
+      for (i=0; i<7; i++) {
+         if (i > 0)
+            dq_op_mul( P, P, J[i] );
+         dq_op_mul( T, P, C.home[i] );
+         if (dq_ch_cmp( L[i], T ) != 0) {
+            fprintf( stderr, "Chain forward kinematics failed at link %d!\n", i );
+            printf( "Got:\n" );
+            dq_print_vert( L[i] );
+            printf( "Expected:\n" );
+            dq_print_vert( T );
+            dq_chain_free( &C );
+            return -1;
+         }
+      }
+   }
+
+   /* Benchmark against the public API, without home poses. */
+   N = 1000000;
+   for (i=0; i<7; i++)
+      dq_cr_translation_vector( C.home[i], q );
+   C.has_home = 0;
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<N/7; j++) {
+      for (i=0; i<7; i++) {
+         if (C.joint[i].type == DQ_JOINT_REVOLUTE)
+            dq_cr_rotation_plucker( J[i], q[i], C.joint[i].s, C.joint[i].s0 );
+         else
+            dq_cr_translation( J[i], q[i], C.joint[i].s );
+         if (i == 0)
+            dq_cr_copy( L[0], J[0] );
+         else
+            dq_op_mul( L[i], L[i-1], J[i] );
+      }
+   }
+   gettimeofday( &tend, NULL );
+   dtp = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (j=0; j<N/7; j++)
+      dq_chain_fk( &C, q, L );
+   gettimeofday( &tend, NULL );
+   dtc = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d joints of forward kinematics: %.3e (public API), %.3e (dq_chain_fk) seconds/joint.\n",
+         7*(N/7), dtp/(double)(7*(N/7)), dtc/(double)(7*(N/7)) );
+
+   dq_chain_free( &C );
+   return 0;
+}
+
+
+static int test_chain_incremental (void)
+{
+   int i, j, k, N;
+   dq_chain_t C;
+   dq_t J[7], L[7], O, *Lc;
+   double q[7];
+   unsigned long total;
+   struct timeval tstart, tend;
+   double dtf, dti;
+
+   rnd_init();
+   if (dq_chain_create( &C, 7 ) != 0)
+      return -1;
+   rnd_chain( &C, J, q, 7 );
+   dq_chain_set_joints( &C, q );
+
+   /* Change a few joints per tick, mostly close to the tip. */
+   total = 0;
+   for (k=0; k<10000; k++) {
+      for (j=0; j<2; j++) {
+         i = 6 - (int)(rnd_double() * rnd_double() * 7.);
+         q[i] += rnd_double() - 0.5;
+         dq_chain_set_joint( &C, i, q[i] );
+      }
+      dq_chain_fk( &C, q, L );
+      /* Request an intermediate link first, which only updates up to it. */
+      i = (int)(rnd_double() * 6.99);
+      dq_chain_link( &C, i, O );
+      total += (unsigned long)(i+1);
+      if (memcmp( O, L[i], sizeof(dq_t) ) != 0) {
+         fprintf( stderr, "Incremental forward kinematics failed at link %d!\n", i );
+         dq_chain_free( &C );
+         return -1;
+      }
+      Lc = dq_chain_links( &C );
+      total += 7;
+      for (i=0; i<7; i++) {
+         if (memcmp( Lc[i], L[i], sizeof(dq_t) ) != 0) {
+            fprintf( stderr, "Incremental forward kinematics failed at link %d!\n", i );
+            printf( "Got:\n" );
+            dq_print_vert( Lc[i] );
+            printf( "Expected:\n" );
+            dq_print_vert( L[i] );
+            dq_chain_free( &C );
+            return -1;
+         }
+      }
+   }
+   if ((C.stats.evaluations != 20000) ||
+         (C.stats.computed + C.stats.saved != total)) {
+      fprintf( stderr, "Incremental forward kinematics statistics are wrong!\n" );
+      dq_chain_free( &C );
+      return -1;
+   }
+
+   /* Benchmark changing only the last joint every tick. */
+   N = 1000000;
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      q[6] += 1e-6;
+      dq_chain_fk( &C, q, L );
+   }
+   gettimeofday( &tend, NULL );
+   dtf = elapsed( &tstart, &tend );
+   dq_chain_stats_reset( &C );
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      q[6] += 1e-6;
+      dq_chain_set_joint( &C, 6, q[6] );
+      Lc = dq_chain_links( &C );
+   }
+   gettimeofday( &tend, NULL );
+   dti = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d ticks of a 7 joint chain moving the last joint: %.3e (dq_chain_fk), %.3e (dq_chain_links) seconds/tick, %lu of %lu joints saved.\n",
+         N, dtf/(double)N, dti/(double)N, C.stats.saved, C.stats.saved + C.stats.computed );
+
+   dq_chain_free( &C );
+   return 0;
+}
+
+
+static int test_chain_batch (void)
+{
+   int i, j, k, N, threads;
+   dq_chain_t C;
+   dq_t J[7], L[7], *O;
+   double *q;
+   struct timeval tstart, tend;
+   double dts, dtb, dtt;
+
+   rnd_init();
+   N = 100003; /* Not a multiple of the lanes. */
+   q = malloc( sizeof(double) * 7 * (size_t)N );
+   O = malloc( sizeof(dq_t) * (size_t)N );
+   if ((q == NULL) || (O == NULL) || (dq_chain_create( &C, 7 ) != 0)) {
+      free( q );
+      free( O );
+      return -1;
+   }
+   rnd_chain( &C, J, q, 7 );
+   for (k=0; k<N; k++)
+      for (i=0; i<7; i++)
+         q[7*k+i] = rnd_double() * 2. * M_PI;
+
+   /* Must match the tip of dq_chain_fk, with and without threads. */
+   threads = dq_threads_get();
+   for (j=1; j<=4; j*=2) {
+      dq_threads_set( j );
+      memset( O, 0, sizeof(dq_t) * (size_t)N );
+      dq_chain_fk_batch( &C, q, O, N );
+      for (k=0; k<N; k++) {
+         dq_chain_fk( &C, &q[7*k], L );
+         if (dq_ch_cmp( O[k], L[6] ) != 0) {
+            fprintf( stderr, "Batch chain forward kinematics failed at %d with %d threads!\n", k, j );
+            dq_threads_set( threads );
+            dq_chain_free( &C );
+            free( q );
+            free( O );
+            return -1;
+         }
+      }
+   }
+
+   /* Benchmark against computing each configuration. */
+   dq_threads_set( 1 );
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      dq_chain_fk( &C, &q[7*k], L );
+      dq_cr_copy( O[k], L[6] );
+   }
+   gettimeofday( &tend, NULL );
+   dts = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   dq_chain_fk_batch( &C, q, O, N );
+   gettimeofday( &tend, NULL );
+   dtb = elapsed( &tstart, &tend );
+   dq_threads_set( 0 );
+   gettimeofday( &tstart, NULL );
+   dq_chain_fk_batch( &C, q, O, N );
+   gettimeofday( &tend, NULL );
+   dtt = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d 7 joint configurations: %.3e (dq_chain_fk), %.3e (dq_chain_fk_batch), %.3e (%d threads) configurations/second.\n",
+         N, (double)N/dts, (double)N/dtb, (double)N/dtt, dq_threads_get() );
+   dq_threads_set( threads );
+
+   dq_chain_free( &C );
+   free( q );
+   free( O );
+   return 0;
+}
+
+
+static int test_chain_jacobian (void)
+{
+   int i, j, k, r, N, l;
+   dq_chain_t C;
+   dq_t Jd[7], L[7];
+   double q[7], qh[7], J[6*7], Jc[7*9], Jn[6][7];
+   double R0[3][3], R1[3][3], p0[3], p1[3], W[3][3], h;
+   struct timeval tstart, tend;
+   double dtn, dtj;
+
+   rnd_init();
+   if (dq_chain_create( &C, 7 ) != 0)
+      return -1;
+
+   /* Compare with central differences of the forward kinematics. */
+   h = 1e-6;
+   for (k=0; k<100; k++) {
+      rnd_chain( &C, Jd, q, 7 );
+      dq_chain_set_joints( &C, q );
+      for (i=0; i<7; i++) {
+         memcpy( qh, q, sizeof(q) );
+         qh[i] = q[i] + h;
+         dq_chain_fk( &C, qh, L );
+         dq_op_extract( R1, p1, L[6] );
+         qh[i] = q[i] - h;
+         dq_chain_fk( &C, qh, L );
+         dq_op_extract( R0, p0, L[6] );
+         /* Angular velocity from dR R^T, which is skew symmetric. */
+         for (r=0; r<3; r++)
+            for (j=0; j<3; j++)
+               W[r][j] = ((R1[r][0]-R0[r][0])*R1[j][0] + (R1[r][1]-R0[r][1])*R1[j][1] +
+                     (R1[r][2]-R0[r][2])*R1[j][2]) / (2.*h);
+         Jn[0][i] = (p1[0]-p0[0]) / (2.*h);
+         Jn[1][i] = (p1[1]-p0[1]) / (2.*h);
+         Jn[2][i] = (p1[2]-p0[2]) / (2.*h);
+         Jn[3][i] = W[2][1];
+         Jn[4][i] = W[0][2];
+         Jn[5][i] = W[1][0];
+      }
+
+      /* Row-major packed and column-major with padding must agree. */
+      dq_chain_jacobian( &C, J, 0, DQ_MATRIX_ROW_MAJOR | DQ_JACOBIAN_TIP );
+      for (i=0; i<7*9; i++)
+         Jc[i] = -42.;
+      dq_chain_jacobian( &C, Jc, 9, DQ_MATRIX_COL_MAJOR | DQ_JACOBIAN_TIP );
+      for (r=0; r<6; r++) {
+         for (i=0; i<7; i++) {
+            if ((fabs( J[7*r+i] - Jn[r][i] ) > 1e-4*(1.+fabs(Jn[r][i]))) ||
+                  (Jc[9*i+r] != J[7*r+i])) {
+               fprintf( stderr, "Chain Jacobian failed at (%d,%d), got %.6e expected %.6e!\n",
+                     r, i, J[7*r+i], Jn[r][i] );
+               dq_chain_free( &C );
+               return -1;
+            }
+         }
+      }
+      for (i=0; i<7; i++) {
+         for (l=6; l<9; l++) {
+            if (Jc[9*i+l] != -42.) {
+               fprintf( stderr, "Chain Jacobian wrote outside the matrix!\n" );
+               dq_chain_free( &C );
+               return -1;
+            }
+         }
+      }
+
+      /* The spatial Jacobian differs by the moment around the tip. */
+      dq_chain_jacobian( &C, J, 0, DQ_MATRIX_ROW_MAJOR | DQ_JACOBIAN_SPATIAL );
+      dq_op_extract( R0, p0, dq_chain_links( &C )[6] );
+      for (i=0; i<7; i++) {
+         p1[0] = Jn[0][i] - (Jn[4][i]*p0[2] - Jn[5][i]*p0[1]);
+         p1[1] = Jn[1][i] - (Jn[5][i]*p0[0] - Jn[3][i]*p0[2]);
+         p1[2] = Jn[2][i] - (Jn[3][i]*p0[1] - Jn[4][i]*p0[0]);
+         for (r=0; r<3; r++) {
+            if (fabs( J[7*r+i] - p1[r] ) > 1e-4*(1.+fabs(p1[r]))) {
+               fprintf( stderr, "Spatial chain Jacobian failed at (%d,%d)!\n", r, i );
+               dq_chain_free( &C );
+               return -1;
+            }
+         }
+      }
+   }
+
+   /* Benchmark against forward differences after changing all the joints. */
+   N = 100000;
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      q[0] += 1e-9;
+      dq_chain_fk( &C, q, L );
+      dq_op_extract( R0, p0, L[6] );
+      for (i=0; i<7; i++) {
+         memcpy( qh, q, sizeof(q) );
+         qh[i] += h;
+         dq_chain_fk( &C, qh, L );
+         dq_op_extract( R1, p1, L[6] );
+         for (r=0; r<3; r++)
+            J[7*r+i] = (p1[r]-p0[r]) / h;
+      }
+   }
+   gettimeofday( &tend, NULL );
+   dtn = elapsed( &tstart, &tend );
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      q[0] += 1e-9;
+      dq_chain_set_joint( &C, 0, q[0] );
+      dq_chain_jacobian( &C, J, 0, DQ_MATRIX_ROW_MAJOR | DQ_JACOBIAN_TIP );
+   }
+   gettimeofday( &tend, NULL );
+   dtj = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d 6x7 Jacobians: %.3e (finite differences), %.3e (dq_chain_jacobian) seconds/Jacobian.\n",
+         N, dtn/(double)N, dtj/(double)N );
+
+   dq_chain_free( &C );
+   return 0;
+}
+
+
+static int test_chain_ik (void)
+{
+   int i, k, N, fails, iters;
+   dq_chain_t C;
+   dq_chain_ik_t P;
+   dq_t J[7], L[7];
+   double q[7], qt[4];
+   struct timeval tstart, tend;
+   double dtw, dtc;
+
+   rnd_init();
+   dq_chain_ik_init( &P );
+
+   /* An empty chain only reaches its base frame. */
+   if (dq_chain_create( &C, 0 ) != 0)
+      return -1;
+   memset( qt, 0, sizeof(qt) );
+   dq_cr_translation_vector( L[0], qt );
+   i = dq_chain_ik( &C, L[0], &P );
+   qt[0] = 1.;
+   dq_cr_translation_vector( L[1], qt );
+   if ((i != 0) || (dq_chain_ik( &C, L[1], &P ) != -1) || (P.iterations != 0)) {
+      fprintf( stderr, "Chain inverse kinematics of an empty chain failed!\n" );
+      dq_chain_free( &C );
+      return -1;
+   }
+   dq_chain_free( &C );
+
+   /* Must reach targets from nearby joint values on random chains. */
+   if (dq_chain_create( &C, 7 ) != 0)
+      return -1;
+   for (k=0; k<1000; k++) {
+      rnd_chain( &C, J, q, 7 );
+      dq_chain_fk( &C, q, L );
+      for (i=0; i<7; i++)
+         q[i] += (rnd_double() - 0.5) * 0.2;
+      dq_chain_set_joints( &C, q );
+      if ((dq_chain_ik( &C, L[6], &P ) != 0) ||
+            (dq_ch_cmpV( L[6], dq_chain_links( &C )[6], 1e-8 ) != 0)) {
+         fprintf( stderr, "Chain inverse kinematics failed after %d steps with error %.3e!\n",
+               P.iterations, P.residual );
+         dq_chain_free( &C );
+         return -1;
+      }
+   }
+   dq_chain_free( &C );
+
+   /* Track a SCARA along a trajectory, warm started from the previous
+    * solution, and reach random poses from zero. */
+   if (scara_chain( &C ) != 0)
+      return -1;
+   P.weight = 500.; /* Size of the arm in mm. */
+   N     = 10000;
+   iters = 0;
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      qt[0] = 0.5 + 0.3*sin( 1e-3*k );
+      qt[1] = 1.0 + 0.4*cos( 1.3e-3*k );
+      qt[2] = -0.5 + 0.2*sin( 0.7e-3*k );
+      qt[3] = 5. + 2.*cos( 1e-3*k );
+      dq_chain_fk( &C, qt, L );
+      if (k == 0)
+         dq_chain_set_joints( &C, qt );
+      if (dq_chain_ik( &C, L[3], &P ) != 0) {
+         fprintf( stderr, "Scara inverse kinematics lost track at %d with error %.3e!\n",
+               k, P.residual );
+         dq_chain_free( &C );
+         return -1;
+      }
+      iters += P.iterations;
+   }
+   gettimeofday( &tend, NULL );
+   dtw = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d warm started SCARA inverse kinematics: %.3e seconds/solve, %.2f steps/solve.\n",
+         N, dtw/(double)N, (double)iters/(double)N );
+
+   fails = 0;
+   iters = 0;
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      qt[0] = rnd_double() * 2. * M_PI;
+      qt[1] = rnd_double() * 2. * M_PI;
+      qt[2] = rnd_double() * 2. * M_PI;
+      qt[3] = rnd_double() * 10.;
+      dq_chain_fk( &C, qt, L );
+      memset( q, 0, sizeof(q) );
+      dq_chain_set_joints( &C, q );
+      if (dq_chain_ik( &C, L[3], &P ) != 0)
+         fails++;
+      iters += P.iterations;
+   }
+   gettimeofday( &tend, NULL );
+   dtc = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d cold started SCARA inverse kinematics: %.3e seconds/solve, %.2f steps/solve, %d failed.\n",
+         N, dtc/(double)N, (double)iters/(double)N, fails );
+   dq_chain_free( &C );
+   return 0;
+}
+
+
+static int test_chain_dh (void)
+{
+   int i, j, k, m, N;
+   dq_chain_t C;
+   dq_t L[6], P, T, R;
+   double dh[24], q[6], dt[3];
+   int type[6];
+   struct timeval tstart, tend;
+
+   rnd_init();
+   N = 100000;
+
+   /* Random tables with a prismatic joint, both conventions. */
+   for (m=0; m<2; m++) {
+      for (i=0; i<6; i++) {
+         dh[4*i+0] = (rnd_double() - 0.5) * 2. * M_PI;
+         dh[4*i+1] = (rnd_double() - 0.5) * 2.;
+         dh[4*i+2] = (rnd_double() - 0.5) * 2.;
+         dh[4*i+3] = (rnd_double() - 0.5) * 2. * M_PI;
+         type[i]   = (i == 2) ? DQ_JOINT_PRISMATIC : DQ_JOINT_REVOLUTE;
+      }
+      if (dq_chain_create_dh( &C, dh, type, 6, m ? DQ_DH_MODIFIED : DQ_DH_STANDARD ) != 0)
+         return -1;
+      for (k=0; k<100; k++) {
+         for (i=0; i<6; i++)
+            q[i] = (rnd_double() - 0.5) * 2. * M_PI;
+         dq_chain_fk( &C, q, L );
+         memset( P, 0, sizeof(dq_t) );
+         P[0] = 1.;
+         for (i=0; i<6; i++) {
+            j = (type[i] == DQ_JOINT_REVOLUTE);
+            dh_product( T, dh[4*i] + (j ? q[i] : 0.), dh[4*i+1] + (j ? 0. : q[i]),
+                  dh[4*i+2], dh[4*i+3], m );
+            dq_op_mul( R, P, T );
+            dq_cr_copy( P, R );
+            if (dq_ch_cmpV( L[i], P, 1e-10 ) != 0) {
+               fprintf( stderr, "Chain from a %s Denavit-Hartenberg table differs at link %d!\n",
+                     m ? "modified" : "standard", i );
+               dq_print_vert( L[i] );
+               dq_print_vert( P );
+               dq_chain_free( &C );
+               return -1;
+            }
+         }
+      }
+      dq_chain_free( &C );
+   }
+
+   /* Benchmark a tick of a 6 joint arm, building every row or not. */
+   for (m=0; m<2; m++) {
+      gettimeofday( &tstart, NULL );
+      for (k=0; k<N; k++) {
+         memset( P, 0, sizeof(dq_t) );
+         P[0] = 1.;
+         for (i=0; i<6; i++) {
+            if (m)
+               dq_cr_dh( T, dh[4*i] + q[i], dh[4*i+1], dh[4*i+2], dh[4*i+3] );
+            else
+               dh_product( T, dh[4*i] + q[i], dh[4*i+1], dh[4*i+2], dh[4*i+3], 0 );
+            dq_op_mul( L[i], P, T );
+            dq_cr_copy( P, L[i] );
+         }
+         q[0] += L[5][7] * 1e-20;
+      }
+      gettimeofday( &tend, NULL );
+      dt[m] = elapsed( &tstart, &tend );
+   }
+   if (dq_chain_create_dh( &C, dh, type, 6, DQ_DH_STANDARD ) != 0)
+      return -1;
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      dq_chain_fk( &C, q, L );
+      q[0] += L[5][7] * 1e-20;
+   }
+   gettimeofday( &tend, NULL );
+   dt[2] = elapsed( &tstart, &tend );
+   dq_chain_free( &C );
+   fprintf( stdout, "Benchmarked %d ticks of a 6 joint Denavit-Hartenberg arm: %.3e (product per row), %.3e (dq_cr_dh per row), %.3e (dq_chain_create_dh) seconds/tick.\n",
+         N, dt[0] / (double)N, dt[1] / (double)N, dt[2] / (double)N );
+   return 0;
+}
+
+
+/**
+ * Lines of a description of the SCARA of scara_chain, with limits.
+ */
+static const char *scara_desc[] = {
+   "# SCARA robot Epson E2L65, in millimetres.\n",
+   "joints 4\n",
+   "revolute  axis 0 0 1  point 0 0 0      limits -2.5 2.5\n",
+   "revolute  plucker 0 0 1  0 -300 0      limits -2.5 2.5\n",
+   "\n",
+   "revolute  axis 0 0 2  point 650 0 0    # Not unit.\n",
+   "prismatic axis 0 0 -1  limits 0 150\n",
+   NULL
+};
+
+
+static int test_chain_load (void)
+{
+   int i, j, k, m, n, N, line, ret;
+   dq_chain_t C, S;
+   dq_t L[6], Ls[6], T, R, M;
+   double q[6], t[3] = { 1., 2., 3. }, s[3] = { 0., 0., 1. }, z[3] = { 0., 0., 0. };
+   char desc[1024], fuzz[1024], big[1100];
+   const char *chars = "0123456789.-+e #\nabcdefghijklmnopqrstuvwxyz";
+   const char *bad[][2] = {
+      { "revolute axis 0 0 1\n", "1" },
+      { "joints 0\n", "1" },
+      { "joints 1000000000\n", "1" },
+      { "joints 4097\n", "1" },
+      { "joints 2 3\n", "1" },
+      { "joints 2\nrevolute axis 0 0 1\n", "3" },
+      { "joints 1\nrevolute\n", "2" },
+      { "joints 1\nrevolute point 1 2 3\n", "2" },
+      { "joints 1\nrevolute axis 0 0 0\n", "2" },
+      { "joints 1\nrevolute axis 0 0 1 2\n", "2" },
+      { "joints 1\nrevolute axis 0 0 1 axis 0 0 1\n", "2" },
+      { "joints 1\nrevolute axis 0 0 1 point 0 0 nan\n", "2" },
+      { "joints 1\nrevolute axis 0 0 1e999\n", "2" },
+      { "joints 1\nrevolute plucker 0 0 1 0 0 1\n", "2" },
+      { "joints 1\nrevolute axis 0 0 1 limits 1 -1\n", "2" },
+      { "joints 1\n\n#\nhelical axis 0 0 1\n", "4" },
+      { "joints 1\nrevolute axis 0 0 1\nrevolute axis 0 0 1\n", "3" },
+      { "joints 1\nrevolute axis 0 0 1 rotate 1 0 0 0\n", "2" },
+      { "joints 1\nrevolute axis 0,0,1\n", "2" },
+      { NULL, NULL }
+   };
+   FILE *fp;
+   struct timeval tstart, tend;
+   double dt;
+
+   rnd_init();
+
+   /* Same chain as built in code. */
+   desc[0] = '\0';
+   for (i=0; scara_desc[i] != NULL; i++)
+      strcat( desc, scara_desc[i] );
+   if (dq_chain_parse( &C, desc, &line ) != 0) {
+      fprintf( stderr, "Chain description failed to parse at line %d!\n", line );
+      return -1;
+   }
+   if (scara_chain( &S ) != 0) {
+      dq_chain_free( &C );
+      return -1;
+   }
+   ret = (line != 0) || (C.n != 4) || (C.limit[0] != -2.5) || (C.limit[3] != 2.5) ||
+         (C.limit[4] != -HUGE_VAL) || (C.limit[5] != HUGE_VAL) || (C.limit[7] != 150.);
+   for (k=0; (k<100) && !ret; k++) {
+      for (i=0; i<4; i++)
+         q[i] = (rnd_double() - 0.5) * 2. * M_PI;
+      dq_chain_fk( &C, q, L );
+      dq_chain_fk( &S, q, Ls );
+      ret = (dq_ch_cmp( L[3], Ls[3] ) != 0);
+   }
+   dq_chain_free( &S );
+   if (ret) {
+      fprintf( stderr, "Chain description differs from the chain!\n" );
+      dq_chain_free( &C );
+      return -1;
+   }
+
+   /* Streams give the same chain. */
+   fp = tmpfile();
+   if (fp == NULL) {
+      dq_chain_free( &C );
+      return -1;
+   }
+   fputs( desc, fp );
+   rewind( fp );
+   ret = dq_chain_load( &S, fp, NULL );
+   fclose( fp );
+   if (ret != 0) {
+      fprintf( stderr, "Chain description failed to load!\n" );
+      dq_chain_free( &C );
+      return -1;
+   }
+   dq_chain_fk( &C, q, L );
+   dq_chain_fk( &S, q, Ls );
+   ret = (dq_ch_cmp( L[3], Ls[3] ) != 0) || (memcmp( C.limit, S.limit, 8*sizeof(double) ) != 0);
+   dq_chain_free( &S );
+   dq_chain_free( &C );
+   if (ret) {
+      fprintf( stderr, "Loaded chain description differs from the parsed one!\n" );
+      return -1;
+   }
+
+   /* Home pose of a link. */
+   if (dq_chain_parse( &C, "joints 1\nrevolute axis 0 0 1 rotate 0.5 0 0 2 offset 1 2 3\n", NULL ) != 0) {
+      fprintf( stderr, "Chain description with an offset failed to parse!\n" );
+      return -1;
+   }
+   dq_cr_translation_vector( T, t );
+   dq_cr_rotation_plucker( R, 0.5, s, z );
+   dq_op_mul( M, T, R );
+   q[0] = 0.;
+   dq_chain_fk( &C, q, L );
+   dq_chain_free( &C );
+   if (dq_ch_cmp( L[0], M ) != 0) {
+      fprintf( stderr, "Chain description offset failed!\n" );
+      return -1;
+   }
+
+   /* Errors are reported at their line and leave nothing allocated. */
+   for (i=0; bad[i][0] != NULL; i++) {
+      ret = dq_chain_parse( &C, bad[i][0], &line );
+      if ((ret == 0) || (line != atoi( bad[i][1] )) || (C.home != NULL)) {
+         fprintf( stderr, "Invalid chain description %d reported at line %d, expected %s!\n",
+               i, line, bad[i][1] );
+         if (ret == 0)
+            dq_chain_free( &C );
+         return -1;
+      }
+   }
+
+   /* Lines of 1022 characters are read both ways, longer ones fail. */
+   for (k=0; k<4; k++) {
+      memset( big, ' ', sizeof(big) );
+      memcpy( big, "joints 1", 8 );
+      strcpy( &big[1022 + k%2], "\nrevolute axis 0 0 1\n" );
+      if (k < 2)
+         ret = dq_chain_parse( &C, big, &line );
+      else {
+         fp = tmpfile();
+         if (fp == NULL)
+            return -1;
+         fputs( big, fp );
+         rewind( fp );
+         ret = dq_chain_load( &C, fp, &line );
+         fclose( fp );
+      }
+      if (ret == 0)
+         dq_chain_free( &C );
+      if ((ret == 0) != (k%2 == 0)) {
+         fprintf( stderr, "Chain description with a line of %d characters %s!\n",
+               1022 + k%2, (ret == 0) ? "was accepted" : "failed" );
+         return -1;
+      }
+   }
+
+   /* Random edits must fail cleanly or give a usable chain, the checks of
+    * the chain functions catch broken axes. */
+   n = (int)strlen( desc );
+   m = 0;
+   for (k=0; k<100000; k++) {
+      memcpy( fuzz, desc, (size_t)n+1 );
+      for (j=1+(k%4); j>0; j--) {
+         i = (int)(rnd_double() * (double)(n-1));
+         if (k % 7 == 0)
+            fuzz[i] = (char)(1 + (int)(rnd_double() * 254.));
+         else
+            fuzz[i] = chars[ (int)(rnd_double() * (double)(strlen(chars)-1)) ];
+      }
+      if (k % 5 == 0)
+         fuzz[ (int)(rnd_double() * (double)n) ] = '\0';
+      if (dq_chain_parse( &C, fuzz, &line ) != 0) {
+         if ((line < 1) || (C.home != NULL)) {
+            fprintf( stderr, "Failed chain description left a chain or no line!\n" );
+            return -1;
+         }
+         continue;
+      }
+      m++;
+      for (i=0; i<C.n && i<6; i++)
+         q[i] = C.limit[2*i] > -HUGE_VAL ? C.limit[2*i] : 0.;
+      ret = (line != 0) || (C.n < 1) || (C.n > 6);
+      for (i=0; (i<C.n) && !ret; i++)
+         ret = (fabs( vec3_dot( C.joint[i].s, C.joint[i].s ) - 1. ) > DQ_PRECISION) ||
+               (fabs( vec3_dot( C.joint[i].s, C.joint[i].s0 ) ) > 1e-9*(1.+vec3_norm( C.joint[i].s0 ))) ||
+               !(C.limit[2*i] <= C.limit[2*i+1]);
+      if (!ret)
+         dq_chain_fk( &C, q, L );
+      dq_chain_free( &C );
+      if (ret) {
+         fprintf( stderr, "Chain description parsed into an invalid chain!\n%s", fuzz );
+         return -1;
+      }
+   }
+
+   /* Benchmark a six joint arm with limits. */
+   N = 100000;
+   sprintf( desc, "joints 6\n" );
+   for (i=0; i<6; i++)
+      sprintf( desc + strlen(desc), "revolute axis %.6f %.6f %.6f point %.3f %.3f %.3f limits -3.1415 3.1415%s\n",
+            rnd_double(), rnd_double(), 1., rnd_double()*1000., rnd_double()*1000., rnd_double()*1000.,
+            (i == 5) ? " offset 0 82.3 0" : "" );
+   gettimeofday( &tstart, NULL );
+   for (k=0; k<N; k++) {
+      if (dq_chain_parse( &C, desc, NULL ) != 0) {
+         fprintf( stderr, "Chain description benchmark failed to parse!\n" );
+         return -1;
+      }
+      dq_chain_free( &C );
+   }
+   gettimeofday( &tend, NULL );
+   dt = elapsed( &tstart, &tend );
+   fprintf( stdout, "Benchmarked %d 6 joint chain descriptions: %.3e seconds/description, %.3e bytes/second (%d of the fuzzed descriptions were valid).\n",
+         N, dt/(double)N, (double)strlen(desc)*(double)N/dt, m );
+   return 0;
+}
+
+
+static int test_chain_synth (void)
+{
+   int i, k, threads, ret;
+   dq_chain_t C, F;
+   dq_chain_synth_t P, P1;
+   dq_t J[3], L[3], D[5];
+   double q[5][3], qf[5][3], qf1[5][3], q0[3];
+   struct timeval tstart, tend;
+   double dt1, dtt;
+
+   rnd_init();
+   if (dq_chain_create( &C, 3 ) != 0)
+      return -1;
+   if (dq_chain_create( &F, 3 ) != 0) {
+      dq_chain_free( &C );
+      return -1;
+   }
+
+   /* Displacements of a random spatial 3R chain, like the smart hand finger. */
+   rnd_chain( &C, J, q0, 3 );
+   /* Displacements do not include the home poses. */
+   memset( L[0], 0, sizeof(dq_t) );
+   L[0][0] = 1.;
+   for (i=0; i<3; i++) {
+      dq_chain_set_axis( &C, i, DQ_JOINT_REVOLUTE, C.joint[i].s, C.joint[i].s0 );
+      dq_chain_set_home( &C, i, L[0] );
+   }
+   for (k=0; k<5; k++) {
+      for (i=0; i<3; i++)
+         q[k][i] = (rnd_double() - 0.5) * M_PI;
+      dq_chain_fk( &C, q[k], L );
+      dq_cr_copy( D[k], L[2] );
+   }
+
+   /* The fit must reproduce the displacements. */
+   dq_chain_synth_init( &P );
+   P.scale  = 10.;
+   P.weight = 10.;
+   P.seed   = 42;
+   threads = dq_threads_get();
+   dq_threads_set( 1 );
+   gettimeofday( &tstart, NULL );
+   ret = dq_chain_synth( &F, D, 5, &qf1[0][0], &P );
+   gettimeofday( &tend, NULL );
+   dt1 = elapsed( &tstart, &tend );
+   if (ret != 0) {
+      fprintf( stderr, "Kinematic synthesis failed with error %.3e!\n", P.residual );
+      dq_threads_set( threads );
+      dq_chain_free( &C );
+      dq_chain_free( &F );
+      return -1;
+   }
+   for (k=0; k<5; k++) {
+      dq_chain_fk( &F, qf1[k], L );
+      if (dq_ch_cmpV( D[k], L[2], 1e-7 ) != 0) {
+         fprintf( stderr, "Kinematic synthesis does not reproduce displacement %d!\n", k );
+         dq_threads_set( threads );
+         dq_chain_free( &C );
+         dq_chain_free( &F );
+         return -1;
+      }
+   }
+
+   /* Same result with any number of threads. */
+   dq_threads_set( 4 );
+   P1 = P;
+   gettimeofday( &tstart, NULL );
+   dq_chain_synth( &F, D, 5, &qf[0][0], &P1 );
+   gettimeofday( &tend, NULL );
+   dtt = elapsed( &tstart, &tend );
+   if ((P1.best != P.best) || (P1.residual != P.residual) ||
+         (memcmp( qf, qf1, sizeof(qf) ) != 0)) {
+      fprintf( stderr, "Kinematic synthesis with threads differs from a single thread!\n" );
+      dq_threads_set( threads );
+      dq_chain_free( &C );
+      dq_chain_free( &F );
+      return -1;
+   }
+   fprintf( stdout, "Benchmarked kinematic synthesis of a 3R chain to 5 displacements, %d restarts: %.3e (1 thread), %.3e (4 threads) seconds, best restart %d with error %.3e after %d steps.\n",
+         P.restarts, dt1, dtt, P.best, P.residual, P.iterations );
+   dq_threads_set( threads );
+
+   /* Nothing to fit without restarts or displacements. */
+   P1 = P;
+   P1.restarts = 0;
+   if ((dq_chain_synth( &F, D, 5, NULL, &P1 ) != -1) ||
+         (dq_chain_synth( &F, D, 0, NULL, &P ) != -1)) {
+      fprintf( stderr, "Kinematic synthesis without restarts or displacements succeeded!\n" );
+      dq_chain_free( &C );
+      dq_chain_free( &F );
+      return -1;
+   }
+
+   dq_chain_free( &C );
+   dq_chain_free( &F );
+   return 0;
+}
+
+
+/**
+ * @brief Writes every slab of a workspace grid to a stream.
+ */
+static int workspace_write( dq_chain_t *C, double *limits, size_t n,
+      dq_chain_grid_t *G, FILE *fp )
+{
+   int z;
+
+   for (z=0; z<G->dim[2]; z+=G->slices) {
+      dq_chain_grid_slab( G, z );
+      if ((dq_chain_workspace( C, limits, n, G ) != 0) ||
+            (dq_chain_grid_write( G, fp ) != 0))
+         return -1;
+   }
+   return 0;
+}
+
+
+static int test_chain_workspace (void)
+{
+   int i, k, x, y, threads, ret;
+   dq_chain_t C;
+   dq_chain_grid_t G, G1;
+   dq_t J[6], M;
+   double q[6], limits[12], r;
+   double min[3] = { -2.5, -2.5, -0.25 };
+   double max[3] = {  2.5,  2.5,  0.25 };
+   double t[3]   = {  2.,   0.,   0.   };
+   double s[3]   = {  0.,   0.,   1.   };
+   double s0[3]  = {  0.,  -1.,   0.   };
+   size_t total, n, cells;
+   FILE *fa, *fb;
+   struct timeval tstart, tend;
+   double dt1, dtt;
+
+   rnd_init();
+   threads = dq_threads_get();
+
+   /* Planar 2R arm with unit links, it reaches the disc of radius 2. */
+   if (dq_chain_create( &C, 2 ) != 0)
+      return -1;
+   dq_chain_set_axis( &C, 1, DQ_JOINT_REVOLUTE, s, s0 );
+   dq_cr_translation_vector( M, t );
+   dq_chain_set_home( &C, 1, M );
+   for (i=0; i<2; i++) {
+      limits[2*i]   = -M_PI;
+      limits[2*i+1] =  M_PI;
+   }
+   if (dq_chain_grid_create( &G, min, max, 0.1, 0 ) != 0) {
+      dq_chain_free( &C );
+      return -1;
+   }
+   if (dq_chain_grid_create( &G1, min, max, 0.1, 0 ) != 0) {
+      dq_chain_grid_free( &G );
+      dq_chain_free( &C );
+      return -1;
+   }
+   cells = (size_t)(G.dim[0]*G.dim[1]*G.dim[2]);
+   dq_threads_set( 1 );
+   dq_chain_workspace( &C, limits, 100000, &G1 );
+   dq_threads_set( 4 );
+   dq_chain_workspace( &C, limits, 60000, &G );
+   dq_chain_workspace( &C, limits, 40000, &G );
+   dq_threads_set( threads );
+   ret   = 0;
+   total = 0;
+   for (k=0; k<(int)cells; k++) {
+      if (G.count[k] == 0)
+         continue;
+      total += G.count[k];
+      x = k % G.dim[0];
+      y = (k / G.dim[0]) % G.dim[1];
+      r = sqrt( pow( G.min[0] + G.voxel*(x+0.5), 2. ) + pow( G.min[1] + G.voxel*(y+0.5), 2. ) );
+      if (r > 2. + G.voxel) {
+         fprintf( stderr, "Workspace sample out of reach at %.3f!\n", r );
+         ret = -1;
+      }
+   }
+   if ((G.outside != 0) || (total != 100000) || (G.samples != 100000)) {
+      fprintf( stderr, "Workspace lost samples, %lu counted and %lu outside!\n",
+            (unsigned long)total, (unsigned long)G.outside );
+      ret = -1;
+   }
+   /* Same counts with any number of threads or calls. */
+   if (memcmp( G.count, G1.count, sizeof(size_t)*cells ) != 0) {
+      fprintf( stderr, "Workspace with threads differs from a single thread!\n" );
+      ret = -1;
+   }
+   /* Another seed draws other samples, and the same seed the same ones. */
+   G.seed = 1;
+   dq_chain_grid_slab( &G, 0 );
+   dq_chain_workspace( &C, limits, 100000, &G );
+   if (memcmp( G.count, G1.count, sizeof(size_t)*cells ) == 0) {
+      fprintf( stderr, "Workspace with another seed draws the same samples!\n" );
+      ret = -1;
+   }
+   G1.seed = 1;
+   dq_chain_grid_slab( &G1, 0 );
+   dq_threads_set( 4 );
+   dq_chain_workspace( &C, limits, 100000, &G1 );
+   dq_threads_set( threads );
+   if (memcmp( G.count, G1.count, sizeof(size_t)*cells ) != 0) {
+      fprintf( stderr, "Workspace with the same seed differs!\n" );
+      ret = -1;
+   }
+   dq_chain_grid_free( &G );
+   dq_chain_grid_free( &G1 );
+   dq_chain_free( &C );
+   if (ret != 0)
+      return -1;
+
+   /* A spatial chain computed at once and slab by slab. */
+   if (dq_chain_create( &C, 6 ) != 0)
+      return -1;
+   rnd_chain( &C, J, q, 6 );
+   for (i=0; i<6; i++) {
+      limits[2*i]   = (C.joint[i].type == DQ_JOINT_REVOLUTE) ? -M_PI : 0.;
+      limits[2*i+1] = (C.joint[i].type == DQ_JOINT_REVOLUTE) ?  M_PI : 10.;
+   }
+   for (i=0; i<3; i++) {
+      min[i] = -40.;
+      max[i] =  40.;
+   }
+   if (dq_chain_grid_create( &G, min, max, 1., 0 ) != 0) {
+      dq_chain_free( &C );
+      return -1;
+   }
+   if (dq_chain_grid_create( &G1, min, max, 1., 7 ) != 0) {
+      dq_chain_grid_free( &G );
+      dq_chain_free( &C );
+      return -1;
+   }
+   fa = tmpfile();
+   fb = tmpfile();
+   if ((fa == NULL) || (fb == NULL) ||
+         (workspace_write( &C, limits, 20000, &G, fa ) != 0) ||
+         (workspace_write( &C, limits, 20000, &G1, fb ) != 0)) {
+      fprintf( stderr, "Unable to write workspace grids!\n" );
+      ret = -1;
+   }
+   else if ((ftell( fa ) != (long)(8*G.dim[0]*G.dim[1]*G.dim[2])) || (ftell( fa ) != ftell( fb ))) {
+      fprintf( stderr, "Workspace grid written slab by slab has the wrong size!\n" );
+      ret = -1;
+   }
+   else {
+      rewind( fa );
+      rewind( fb );
+      while ((k = fgetc( fa )) != EOF) {
+         if (k != fgetc( fb )) {
+            fprintf( stderr, "Workspace grid written slab by slab differs!\n" );
+            ret = -1;
+            break;
+         }
+      }
+   }
+   if (fa != NULL)
+      fclose( fa );
+   if (fb != NULL)
+      fclose( fb );
+
+   /* Throughput. */
+   if (ret == 0) {
+      n = 1000000;
+      dq_chain_grid_slab( &G, 0 );
+      dq_threads_set( 1 );
+      gettimeofday( &tstart, NULL );
+      dq_chain_workspace( &C, limits, n, &G );
+      gettimeofday( &tend, NULL );
+      dt1 = elapsed( &tstart, &tend );
+      dq_threads_set( 4 );
+      gettimeofday( &tstart, NULL );
+      dq_chain_workspace( &C, limits, n, &G );
+      gettimeofday( &tend, NULL );
+      dtt = elapsed( &tstart, &tend );
+      dq_threads_set( threads );
+      fprintf( stdout, "Benchmarked workspace sampling of a 6 joint chain: %.3e (1 thread), %.3e (4 threads) samples/second, %.1f%% inside the grid.\n",
+            (double)n / dt1, (double)n / dtt, 100. - 100.*(double)G.outside/(double)G.samples );
+   }
+
+   dq_chain_grid_free( &G );
+   dq_chain_grid_free( &G1 );
+   dq_chain_free( &C );
+   return ret;
+}
+
+
+/**
+ * Chain with the axes and home of ur5.chain.
+ */
+static int ur5_chain( dq_chain_t *C )
+{
+   double s[6][3] = { { 0., 0., 1. }, { 0., 1., 0. }, { 0., 1., 0. },
+                      { 0., 1., 0. }, { 0., 0., -1. }, { 0., 1., 0. } };
+   double c[6][3] = { { 0., 0., 0. }, { 0., 0., 89. }, { 425., 0., 89. },
+                      { 817., 0., 89. }, { 817., 109., 0. }, { 817., 0., -6. } };
+   double t[3] = { 817., 191., -6. };
+   double x[3] = { 1., 0., 0. }, z[3] = { 0., 0., 0. };
+   double s0[3];
+   dq_t T, R, H;
+   int i;
+
+   if (dq_chain_create( C, 6 ) != 0)
+      return -1;
+   for (i=0; i<6; i++) {
+      vec3_cross( s0, c[i], s[i] );
+      dq_chain_set_axis( C, i, DQ_JOINT_REVOLUTE, s[i], s0 );
+   }
+   dq_cr_translation_vector( T, t );
+   dq_cr_rotation_plucker( R, -M_PI/2., x, z );
+   dq_op_mul( H, T, R );
+   dq_chain_set_home( C, 5, H );
+   return 0;
+}
+
+
+static int test_codegen (void)
+{
+   int i, k, r, m, n, N, line;
+   dq_chain_t C, D;
+   dq_t L[6], LD[6], O;
+   double q[6], J[6*6], Jg[6*6], dt[4], acc;
+   const char *name[2] = { "SCARA", "UR5" };
+   /* Run from the top directory or from test. */
+   const char *file[2] = { "test/scara.chain", "test/ur5.chain" };
+   FILE *fp;
+   struct timeval tstart, tend;
+
+   rnd_init();
+   N = 1000000;
+
+   for (m=0; m<2; m++) {
+      if ((m ? ur5_chain( &C ) : scara_chain( &C )) != 0)
+         return -1;
+      n = C.n;
+
+      /* The description the code was generated from loads as the same chain. */
+      fp = fopen( file[m], "r" );
+      if (fp == NULL)
+         fp = fopen( &file[m][5], "r" );
+      if ((fp == NULL) || (dq_chain_load( &D, fp, &line ) != 0)) {
+         fprintf( stderr, "Unable to load %s!\n", file[m] );
+         if (fp != NULL)
+            fclose( fp );
+         dq_chain_free( &C );
+         return -1;
+      }
+      fclose( fp );
+      for (i=0; i<n; i++)
+         q[i] = (rnd_double() - 0.5) * 2. * M_PI;
+      dq_chain_fk( &C, q, L );
+      dq_chain_fk( &D, q, LD );
+      dq_chain_free( &D );
+      if (dq_ch_cmpV( L[n-1], LD[n-1], 1e-9 ) != 0) {
+         fprintf( stderr, "Loaded %s differs from the chain built in code!\n", file[m] );
+         dq_chain_free( &C );
+         return -1;
+      }
+
+      /* Generated code must match the generic path. */
+      for (k=0; k<1000; k++) {
+         for (i=0; i<n; i++)
+            q[i] = (rnd_double() - 0.5) * 2. * M_PI;
+         dq_chain_fk( &C, q, L );
+         if (m)
+            ur5_fk( q, O );
+         else
+            scara_fk( q, O );
+         if (dq_ch_cmpV( L[n-1], O, 1e-9 ) != 0) {
+            fprintf( stderr, "Generated %s forward kinematics differ!\n", name[m] );
+            dq_print_vert( L[n-1] );
+            dq_print_vert( O );
+            dq_chain_free( &C );
+            return -1;
+         }
+         dq_chain_set_joints( &C, q );
+         dq_chain_jacobian( &C, J, 0, DQ_MATRIX_ROW_MAJOR | DQ_JACOBIAN_SPATIAL );
+         if (m)
+            ur5_jacobian( q, Jg );
+         else
+            scara_jacobian( q, Jg );
+         for (r=0; r<6*n; r++) {
+            if (fabs( J[r] - Jg[r] ) > 1e-9*(1.+fabs(J[r]))) {
+               fprintf( stderr, "Generated %s Jacobian differs at (%d,%d), got %.6e expected %.6e!\n",
+                     name[m], r/n, r%n, Jg[r], J[r] );
+               dq_chain_free( &C );
+               return -1;
+            }
+         }
+      }
+
+      /* Benchmark, feeding the results back so nothing is hoisted. */
+      acc = 0.;
+      gettimeofday( &tstart, NULL );
+      for (k=0; k<N; k++) {
+         dq_chain_fk( &C, q, L );
+         q[0] += L[n-1][7] * 1e-20;
+      }
+      gettimeofday( &tend, NULL );
+      dt[0] = elapsed( &tstart, &tend );
+      gettimeofday( &tstart, NULL );
+      for (k=0; k<N; k++) {
+         if (m)
+            ur5_fk( q, O );
+         else
+            scara_fk( q, O );
+         q[0] += O[7] * 1e-20;
+      }
+      gettimeofday( &tend, NULL );
+      dt[1] = elapsed( &tstart, &tend );
+      gettimeofday( &tstart, NULL );
+      for (k=0; k<N; k++) {
+         q[0] += acc * 1e-20;
+         dq_chain_set_joints( &C, q );
+         dq_chain_jacobian( &C, J, 0, DQ_MATRIX_ROW_MAJOR | DQ_JACOBIAN_SPATIAL );
+         acc = J[0];
+      }
+      gettimeofday( &tend, NULL );
+      dt[2] = elapsed( &tstart, &tend );
+      gettimeofday( &tstart, NULL );
+      for (k=0; k<N; k++) {
+         q[0] += acc * 1e-20;
+         if (m)
+            ur5_jacobian( q, Jg );
+         else
+            scara_jacobian( q, Jg );
+         acc = Jg[0];
+      }
+      gettimeofday( &tend, NULL );
+      dt[3] = elapsed( &tstart, &tend );
+      dq_chain_free( &C );
+      fprintf( stdout, "Benchmarked %d %s kinematics: %.3e (dq_chain_fk), %.3e (generated) seconds/pose, "
+            "%.3e (dq_chain_jacobian), %.3e (generated) seconds/Jacobian.\n",
+            N, name[m], dt[0]/(double)N, dt[1]/(double)N, dt[2]/(double)N, dt[3]/(double)N );
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Computes the world pose of a node walking up to its root.
+ */
+static void tree_world( dq_t O, const int *parent, dq_t *local, int i )
+{
+   dq_t T;
+   dq_cr_copy( O, local[i] );
+   for (i=parent[i]; i>=0; i=parent[i]) {
+      dq_op_mul( T, local[i], O );
+      dq_cr_copy( O, T );
+   }
+}
+
+
+/**
+ * @brief Parents of a 50 bone humanoid skeleton.
+ *
+ * Pelvis, spine and head, then each arm with its hand and five fingers of
+ *  three bones, then each leg.
+ */
+static void tree_skeleton( int *parent )
+{
+   int i, j, k, n, hand;
+
+   n = 0;
+   parent[n++] = -1;                /* Pelvis. */
+   for (i=0; i<5; i++, n++)         /* Spine, neck and head. */
+      parent[n] = n-1;
+   for (j=0; j<2; j++) {
+      parent[n++] = 3;              /* Clavicle. */
+      parent[n] = n-1; n++;         /* Upper arm. */
+      parent[n] = n-1; n++;         /* Forearm. */
+      parent[n] = n-1; hand = n++;  /* Hand. */
+      for (i=0; i<5; i++) {
+         parent[n++] = hand;
+         for (k=1; k<3; k++, n++)
+            parent[n] = n-1;
+      }
+   }
+   for (j=0; j<2; j++) {
+      parent[n++] = 0;              /* Thigh. */
+      parent[n] = n-1; n++;         /* Shin. */
+      parent[n] = n-1; n++;         /* Foot. */
+   }
+}
+
+
+static int test_tree (void)
+{
+   int i, j, k, c, N, threads, *parent, *orig, *num;
+   dq_tree_t T;
+   dq_t *L, *W, O;
+   struct timeval tstart, tend;
+   double dtn, dtt, dtp;
+   int s, sizes[2] = { 50, 10000 };
+
+   rnd_init();
+   N      = 10000;
+   parent = malloc( 3 * sizeof(int) * (size_t)N );
+   L      = malloc( 2 * sizeof(dq_t) * (size_t)N );
+   if ((parent == NULL) || (L == NULL)) {
+      free( parent );
+      free( L );
+      return -1;
+   }
+   orig = &parent[N];
+   num  = &orig[N];
+   W    = &L[N];
+
+   /* Cycles and invalid parents are not trees. */
+   parent[0] = 1;
+   parent[1] = 2;
+   parent[2] = 0;
+   parent[3] = -1;
+   if ((dq_tree_create( &T, parent, 4 ) != -1) || (T.local != NULL)) {
+      fprintf( stderr, "Tree with a cycle was accepted!\n" );
+      free( parent );
+      free( L );
+      return -1;
+   }
+   parent[0] = 4;
+   if (dq_tree_create( &T, parent, 4 ) != -1) {
+      fprintf( stderr, "Tree with an invalid parent was accepted!\n" );
+      free( parent );
+      free( L );
+      return -1;
+   }
+
+   threads = dq_threads_get();
+   for (s=0; s<2; s++) {
+      N = sizes[s];
+      /* Skeleton or random tree, with parents before their children. */
+      if (s == 0)
+         tree_skeleton( orig );
+      else {
+         orig[0] = -1;
+         for (i=1; i<N; i++)
+            orig[i] = (int)(rnd_double() * (double)i) % i;
+      }
+      /* Renumber the nodes randomly, node i becomes num[i]. */
+      for (i=0; i<N; i++)
+         num[i] = i;
+      for (i=N-1; i>0; i--) {
+         j      = (int)(rnd_double() * (double)(i+1)) % (i+1);
+         c      = num[i];
+         num[i] = num[j];
+         num[j] = c;
+      }
+      for (i=0; i<N; i++)
+         parent[ num[i] ] = (orig[i] >= 0) ? num[ orig[i] ] : -1;
+
+      if (dq_tree_create( &T, parent, N ) != 0) {
+         fprintf( stderr, "Failed to create tree of %d nodes!\n", N );
+         free( parent );
+         free( L );
+         return -1;
+      }
+      for (i=0; i<N; i++) {
+         rnd_dq( L[i] );
+         dq_tree_set_local( &T, i, L[i] );
+      }
+
+      /* Must match walking up from each node, with and without threads. */
+      for (j=1; j<=4; j*=2) {
+         dq_threads_set( j );
+         dq_tree_eval( &T );
+         for (i=0; i<N; i++) {
+            tree_world( W[i], parent, L, i );
+            dq_tree_world( &T, i, O );
+            if (dq_ch_cmpV( O, W[i], 1e-8 ) != 0) {
+               fprintf( stderr, "Tree of %d nodes failed at node %d with %d threads!\n", N, i, j );
+               dq_threads_set( threads );
+               dq_tree_free( &T );
+               free( parent );
+               free( L );
+               return -1;
+            }
+         }
+      }
+
+      /* Benchmark against computing the nodes with their own numbering,
+       * taking them in an order where parents go first. */
+      dq_threads_set( 1 );
+      gettimeofday( &tstart, NULL );
+      for (j=0; j<1000000/N; j++) {
+         for (k=0; k<N; k++) {
+            i = num[k];
+            if (parent[i] < 0)
+               dq_cr_copy( W[i], L[i] );
+            else
+               dq_op_mul( W[i], W[ parent[i] ], L[i] );
+         }
+      }
+      gettimeofday( &tend, NULL );
+      dtn = elapsed( &tstart, &tend );
+      gettimeofday( &tstart, NULL );
+      for (j=0; j<1000000/N; j++)
+         dq_tree_eval( &T );
+      gettimeofday( &tend, NULL );
+      dtt = elapsed( &tstart, &tend );
+      dq_threads_set( 0 );
+      gettimeofday( &tstart, NULL );
+      for (j=0; j<1000000/N; j++)
+         dq_tree_eval( &T );
+      gettimeofday( &tend, NULL );
+      dtp = elapsed( &tstart, &tend );
+      fprintf( stdout, "Benchmarked %d node trees: %.3e (own numbering), %.3e (dq_tree_eval), %.3e (%d threads) seconds/tree.\n",
+            N, dtn/(double)(1000000/N), dtt/(double)(1000000/N), dtp/(double)(1000000/N), dq_threads_get() );
+      dq_threads_set( threads );
+      dq_tree_free( &T );
+   }
+
+   free( parent );
+   free( L );
+   return 0;
+}
+
+
+static int test_float (void)
+{
+   int i, j, k;
+   dq_t P, Q, PQ, B, PBP, O;
+   dqf_t Pf, Qf, PQf, Bf, PBPf, Hf, Hinvf, If, Mf;
+   double R[3][3], d[3], a[3], pts[3*10], outd[3*10];
+   float Rf[3][3], Rf2[3][3], df[3], df2[3], ptsf[3*10], outf[3*10];
+   float u[3] = { 3.f, -3.f, 1.f }, v[3] = { 4.f, 9.f, 2.f }, w[3];
+   float uv[3] = { -15.f, -2.f, 39.f };
+   float zf[3] = { 0.f, 0.f, 0.f };
+
+   rnd_init();
+
+   /* Auxiliary functions. */
+   vec3f_cross( w, u, v );
+   if (vec3f_cmp( w, uv ) != 0) {
+      fprintf( stderr, "Error with single precision cross product!\n" );
+      vec3f_print( w );
+      return -1;
+   }
+
+   dqf_cr_translation_vector( If, zf );
+   for (i=0; i<10000; i++) {
+      /* Multiplication and point transformation against double precision. */
+      rnd_dq( P );
+      rnd_dq( Q );
+      for (j=0; j<3; j++)
+         d[j] = rnd_double() * 10.;
+      dq_cr_point( B, d );
+      dq_op_mul( PQ, P, Q );
+      dq_op_f4g( PBP, P, B );
+
+      dqf_from_dq( Pf, P );
+      dqf_from_dq( Qf, Q );
+      dqf_from_dq( Bf, B );
+      dqf_op_mul( PQf, Pf, Qf );
+      dqf_op_f4g( PBPf, Pf, Bf );
+
+      dqf_to_dq( O, PQf );
+      if (dq_ch_cmpV( PQ, O, 1e-4 ) != 0) {
+         fprintf( stderr, "Single precision multiplication failed!\n" );
+         printf( "Got:\n" );
+         dq_print_vert( O );
+         printf( "Expected:\n" );
+         dq_print_vert( PQ );
+         return -1;
+      }
+      dqf_to_dq( O, PBPf );
+      if (dq_ch_cmpV( PBP, O, 1e-3 ) != 0) {
+         fprintf( stderr, "Single precision point transformation failed!\n" );
+         printf( "Got:\n" );
+         dq_print_vert( O );
+         printf( "Expected:\n" );
+         dq_print_vert( PBP );
+         return -1;
+      }
+
+      /* Homogeneous matrix round trip. */
+      for (j=0; j<3; j++) {
+         a[j]  = 2.*M_PI * rnd_double();
+         df[j] = (float)(10. * rnd_double() - 5.);
+      }
+      test_mat_rot( R, a[0], a[1], a[2] );
+      for (j=0; j<3; j++)
+         for (k=0; k<3; k++)
+            Rf[j][k] = (float)R[j][k];
+      dqf_cr_homo( Hf, Rf, df );
+      dqf_op_extract( Rf2, df2, Hf );
+      if ((mat3f_cmpV( Rf, Rf2, 1e-4f ) != 0) || (vec3f_cmpV( df, df2, 1e-4f ) != 0)) {
+         fprintf( stderr, "Single precision extraction failed!\n" );
+         printf( "Got:\n" );
+         mat3f_print( Rf2 );
+         vec3f_print( df2 );
+         printf( "Expected:\n" );
+         mat3f_print( Rf );
+         vec3f_print( df );
+         return -1;
+      }
+
+      /* Inversion. */
+      dqf_cr_inv( Hinvf, Hf );
+      dqf_op_mul( Mf, Hf, Hinvf );
+      if (dqf_ch_cmpV( Mf, If, 1e-4f ) != 0) {
+         fprintf( stderr, "Single precision inversion failed!\n" );
+         printf( "Got:\n" );
+         dqf_print_vert( Mf );
+         return -1;
+      }
+   }
+
+   /* Batch point transformation. */
+   for (j=0; j<3*10; j++) {
+      pts[j]  = rnd_double() * 10.;
+      ptsf[j] = (float)pts[j];
+   }
+   dq_op_transform_points( P, pts, outd, 10 );
+   dqf_op_transform_points( Pf, ptsf, outf, 10 );
+   for (j=0; j<3*10; j++) {
+      if (fabs( outd[j] - outf[j] ) > 1e-3) {
+         fprintf( stderr, "Single precision batch point transformation failed!\n" );
+         return -1;
+      }
+   }
+
    return 0;
 }
 
@@ -833,11 +3961,38 @@ int main( int argc, char *argv[] )
    ret += !!test_translation();
    ret += !!test_rotation();
    ret += !!test_movement();
+   ret += !!test_screw();
    ret += !!test_homo();
    ret += !!test_scara();
    ret += !!test_inversion();
    ret += !!test_extract();
+   ret += !!test_transform_points();
+   ret += !!test_sandwich();
+   ret += !!test_rotation_matrix();
+   ret += !!test_homo_n();
+   ret += !!test_extract_n();
+   ret += !!test_rotation_plucker_n();
+   ret += !!test_dh();
+   ret += !!test_mul_chain();
+   ret += !!test_scan();
+   ret += !!test_inline();
+   ret += !!test_chain();
+   ret += !!test_chain_incremental();
+   ret += !!test_chain_batch();
+   ret += !!test_chain_jacobian();
+   ret += !!test_chain_ik();
+   ret += !!test_chain_dh();
+   ret += !!test_chain_load();
+   ret += !!test_chain_synth();
+   ret += !!test_chain_workspace();
+   ret += !!test_codegen();
+   ret += !!test_tree();
+   ret += !!test_float();
    ret += !!test_benchmark();
+   ret += !!test_batch();
+   ret += !!test_benchmark_batch();
+   ret += !!test_simd();
+   ret += !!test_benchmark_simd();
    ret += !!test_solve();
    ret += !!test_stress( 100000 );
 
@@ -0,0 +1,21 @@
+/*
+ * Same operations as test_inline_ops_lib in test.c but with the library
+ *  built header-only, so they can be inlined into the loop.
+ */
+#define DQ_INLINE
+#include "dq_inline.h"
+
+
+void test_inline_ops( dq_t *O, dq_t *A, int n );
+void test_inline_ops( dq_t *O, dq_t *A, int n )
+{
+   int i;
+   dq_t C, S, D;
+   for (i=0; i<n; i++) {
+      dq_cr_conj( C, A[i] );
+      dq_op_add( S, A[i], C );
+      dq_op_sub( D, A[i], C );
+      dq_op_mul( O[i], S, D );
+      O[i][0] += vec3_dot( &A[i][1], &A[i][4] );
+   }
+}
@@ -0,0 +1,877 @@
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Generates C code computing the forward kinematics and Jacobian of a fixed
+ *  serial chain, unrolled and with every constant folded.
+ *
+ * Usage:
+ *
+ @verbatim
+   dq_codegen name description output.c output.h
+ @endverbatim
+ *
+ * The description is the same as read by dq_chain_load, the number of
+ *  joints then one line per joint from the base to the tip with its axis
+ *  in the base frame with all the joints at zero:
+ *
+ @verbatim
+   joints 2
+   revolute  axis 0 0 1  point 300 0 0  limits -2.5 2.5
+   prismatic axis 0 0 -1  offset 300 0 0  rotate 3.14159 1 0 0
+ @endverbatim
+ *
+ * Limits are checked but unused, and only the offset and rotation of the
+ *  last joint matter since the others do not move the tip.
+ *
+ * The output defines, for a description of n joints:
+ *
+ @verbatim
+   void name_fk( const double *q, dq_t out );
+   void name_jacobian( const double *q, double *J );
+ @endverbatim
+ *
+ * Which give the same results as dq_chain_fk for the tip and
+ *  dq_chain_jacobian with DQ_MATRIX_ROW_MAJOR and DQ_JACOBIAN_SPATIAL into a
+ *  packed 6 by n matrix.
+ *
+ * Every component is tracked symbolically as a constant or a constant times
+ *  a variable. Products with zeros vanish, products of constants are folded
+ *  and sums of a single term are aliased, so only the terms that depend on
+ *  the joints are ever written out. Statements whose result is never used
+ *  are dropped before writing, along with the sines and cosines they needed.
+ */
+
+
+#define GEN_JOINTS_MAX     64    /**< Maximum number of joints. */
+#define GEN_TERMS_MAX      128   /**< Maximum number of terms of a sum. */
+#define GEN_NAME_MAX       16    /**< Maximum length of the name of a variable. */
+#define GEN_VARS_MAX       65536 /**< Maximum number of variables and statements. */
+
+
+/**
+ * @brief Value of a component, k times variable v, or the constant k if v < 0.
+ */
+typedef struct gen_sym_s {
+   double k;   /**< Coefficient. */
+   int v;      /**< Variable, -1 for none. */
+} gen_sym_t;
+
+
+/**
+ * @brief Term of a sum, k times variables a and b, -1 for none.
+ */
+typedef struct gen_term_s {
+   double k;   /**< Coefficient. */
+   int a;      /**< First variable. */
+   int b;      /**< Second variable. */
+} gen_term_t;
+
+
+/**
+ * @brief Statement, a temporary or an output set to a sum of terms.
+ */
+typedef struct gen_stmt_s {
+   int var;                   /**< Temporary set, -1 for an output. */
+   char lhs[GEN_NAME_MAX];    /**< Output set. */
+   int first;                 /**< First term in the pool. */
+   int n;                     /**< Number of terms. */
+} gen_stmt_t;
+
+
+/**
+ * @brief State of the generator for a function.
+ */
+typedef struct gen_s {
+   char (*name)[GEN_NAME_MAX]; /**< Name of each variable, temporaries are named when written. */
+   char *live;                /**< Whether each variable is needed. */
+   int vars;                  /**< Number of variables. */
+   gen_stmt_t *stmt;          /**< Statements in order. */
+   int stmts;                 /**< Number of statements. */
+   gen_term_t *pool;          /**< Terms of the statements. */
+   int terms;                 /**< Number of terms in the pool. */
+   int size;                  /**< Size of the pool. */
+} gen_t;
+
+
+/**
+ * @brief Joint of the description.
+ */
+typedef struct gen_joint_s {
+   int revolute;  /**< Whether the joint is revolute. */
+   double s[3];   /**< Unit direction of the axis. */
+   double s0[3];  /**< Moment of the axis. */
+} gen_joint_t;
+
+
+/**
+ * Terms of the product of dual quaternions P Q, the same as dq_op_mul:
+ *  component of PQ, component of P, component of Q and sign.
+ */
+static const int gen_mul_tab[48][4] = {
+   { 0, 0, 0, 1 }, { 0, 1, 1, -1 }, { 0, 2, 2, -1 }, { 0, 3, 3, -1 },
+   { 1, 0, 1, 1 }, { 1, 1, 0, 1 }, { 1, 2, 3, 1 }, { 1, 3, 2, -1 },
+   { 2, 0, 2, 1 }, { 2, 2, 0, 1 }, { 2, 1, 3, -1 }, { 2, 3, 1, 1 },
+   { 3, 0, 3, 1 }, { 3, 3, 0, 1 }, { 3, 1, 2, 1 }, { 3, 2, 1, -1 },
+   { 4, 4, 0, 1 }, { 4, 0, 4, 1 }, { 4, 7, 1, 1 }, { 4, 6, 2, -1 },
+   { 4, 2, 6, 1 }, { 4, 5, 3, 1 }, { 4, 3, 5, -1 }, { 4, 1, 7, 1 },
+   { 5, 5, 0, 1 }, { 5, 0, 5, 1 }, { 5, 6, 1, 1 }, { 5, 1, 6, -1 },
+   { 5, 7, 2, 1 }, { 5, 4, 3, -1 }, { 5, 3, 4, 1 }, { 5, 2, 7, 1 },
+   { 6, 6, 0, 1 }, { 6, 0, 6, 1 }, { 6, 5, 1, -1 }, { 6, 1, 5, 1 },
+   { 6, 4, 2, 1 }, { 6, 2, 4, -1 }, { 6, 7, 3, 1 }, { 6, 3, 7, 1 },
+   { 7, 7, 0, 1 }, { 7, 1, 4, -1 }, { 7, 4, 1, -1 }, { 7, 2, 5, -1 },
+   { 7, 5, 2, -1 }, { 7, 3, 6, -1 }, { 7, 6, 3, -1 }, { 7, 0, 7, 1 }
+};
+
+
+/**
+ * Terms of the rotation matrix of a unit dual quaternion P: row, column,
+ *  components of P and coefficient. Component 8 is the constant 1, the
+ *  diagonal uses the unit norm so the axes of the joints fold it.
+ */
+static const int gen_rot_tab[21][5] = {
+   { 0, 0, 8, 8, 1 }, { 0, 0, 2, 2, -2 }, { 0, 0, 3, 3, -2 },
+   { 0, 1, 1, 2, 2 }, { 0, 1, 0, 3, -2 },
+   { 0, 2, 1, 3, 2 }, { 0, 2, 0, 2, 2 },
+   { 1, 0, 1, 2, 2 }, { 1, 0, 0, 3, 2 },
+   { 1, 1, 8, 8, 1 }, { 1, 1, 1, 1, -2 }, { 1, 1, 3, 3, -2 },
+   { 1, 2, 2, 3, 2 }, { 1, 2, 0, 1, -2 },
+   { 2, 0, 1, 3, 2 }, { 2, 0, 0, 2, -2 },
+   { 2, 1, 2, 3, 2 }, { 2, 1, 0, 1, 2 },
+   { 2, 2, 8, 8, 1 }, { 2, 2, 1, 1, -2 }, { 2, 2, 2, 2, -2 }
+};
+
+
+/**
+ * Terms of the translation of a unit dual quaternion P, as in dq_op_extract:
+ *  component, components of P and coefficient.
+ */
+static const int gen_trans_tab[12][4] = {
+   { 0, 0, 4, 2 }, { 0, 1, 7, -2 }, { 0, 2, 6, 2 }, { 0, 3, 5, -2 },
+   { 1, 0, 5, 2 }, { 1, 2, 7, -2 }, { 1, 1, 6, -2 }, { 1, 3, 4, 2 },
+   { 2, 0, 6, 2 }, { 2, 3, 7, -2 }, { 2, 1, 5, 2 }, { 2, 2, 4, -2 }
+};
+
+
+/**
+ * @brief Adds a variable.
+ *
+ *    @return Index of the variable.
+ */
+static int gen_var( gen_t *G, const char *name )
+{
+   if (G->vars >= GEN_VARS_MAX) {
+      fprintf( stderr, "dq_codegen: too many variables\n" );
+      exit( EXIT_FAILURE );
+   }
+   G->live[G->vars] = 0;
+   sprintf( G->name[G->vars], "%.*s", GEN_NAME_MAX-1, name );
+   return G->vars++;
+}
+
+
+/**
+ * @brief Adds the term k A B to a sum, unless it is zero.
+ */
+static void gen_term( gen_term_t *T, int *n, double k, gen_sym_t A, gen_sym_t B )
+{
+   k *= A.k * B.k;
+   if (k == 0.)
+      return;
+   if (*n >= GEN_TERMS_MAX) {
+      fprintf( stderr, "dq_codegen: too many terms\n" );
+      exit( EXIT_FAILURE );
+   }
+   /* Variables are sorted so equal products are merged. */
+   T[*n].k = k;
+   T[*n].a = (A.v < B.v) ? A.v : B.v;
+   T[*n].b = (A.v < B.v) ? B.v : A.v;
+   (*n)++;
+}
+
+
+/**
+ * @brief Writes a number so it is always a double literal.
+ */
+static void gen_print_num( FILE *fp, double k )
+{
+   char buf[32];
+
+   sprintf( buf, "%.17g", k );
+   fprintf( fp, (strpbrk( buf, ".e" ) != NULL) ? "%s" : "%s.", buf );
+}
+
+
+/**
+ * @brief Writes the magnitude of a term of a sum, or a whole sum.
+ */
+static void gen_print_term( FILE *fp, const gen_t *G, const gen_term_t *T )
+{
+   double k = fabs( T->k );
+   int v[2], i, first;
+
+   v[0]  = T->a;
+   v[1]  = T->b;
+   first = 1;
+   if ((k != 1.) || ((v[0] < 0) && (v[1] < 0))) {
+      gen_print_num( fp, k );
+      first = 0;
+   }
+   for (i=0; i<2; i++) {
+      if (v[i] < 0)
+         continue;
+      fprintf( fp, "%s%s", first ? "" : "*", G->name[ v[i] ] );
+      first = 0;
+   }
+}
+
+
+static void gen_print_sum( FILE *fp, const gen_t *G, const gen_term_t *T, int n )
+{
+   int i;
+
+   if (n == 0) {
+      fprintf( fp, "0." );
+      return;
+   }
+   for (i=0; i<n; i++) {
+      if (i == 0)
+         fprintf( fp, (T[i].k < 0.) ? "-" : "" );
+      else
+         fprintf( fp, (T[i].k < 0.) ? " - " : " + " );
+      gen_print_term( fp, G, &T[i] );
+   }
+}
+
+
+/**
+ * @brief Adds a statement setting a temporary, or an output if lhs is not NULL.
+ *
+ *    @return Temporary set, -1 for outputs.
+ */
+static int gen_stmt( gen_t *G, const char *lhs, const gen_term_t *T, int n )
+{
+   gen_stmt_t *S;
+
+   if (G->stmts >= GEN_VARS_MAX) {
+      fprintf( stderr, "dq_codegen: too many statements\n" );
+      exit( EXIT_FAILURE );
+   }
+   if (G->terms + n > G->size) {
+      G->size = 2*G->size + n;
+      G->pool = realloc( G->pool, sizeof(gen_term_t) * (size_t)G->size );
+      if (G->pool == NULL) {
+         fprintf( stderr, "dq_codegen: out of memory\n" );
+         exit( EXIT_FAILURE );
+      }
+   }
+   S        = &G->stmt[ G->stmts++ ];
+   S->var   = (lhs == NULL) ? gen_var( G, "" ) : -1;
+   S->first = G->terms;
+   S->n     = n;
+   strcpy( S->lhs, (lhs == NULL) ? "" : lhs );
+   memcpy( &G->pool[G->terms], T, sizeof(gen_term_t) * (size_t)n );
+   G->terms += n;
+   return S->var;
+}
+
+
+/**
+ * @brief Folds a sum of terms into a value, writing a temporary if needed.
+ */
+static gen_sym_t gen_sum( gen_t *G, gen_term_t *T, int n )
+{
+   gen_sym_t S;
+   int i, j, m;
+
+   /* Merge equal products and drop the ones that cancel. */
+   m = 0;
+   for (i=0; i<n; i++) {
+      for (j=0; j<m; j++)
+         if ((T[j].a == T[i].a) && (T[j].b == T[i].b))
+            break;
+      if (j < m)
+         T[j].k += T[i].k;
+      else
+         T[m++] = T[i];
+   }
+   n = 0;
+   for (i=0; i<m; i++)
+      if (T[i].k != 0.)
+         T[n++] = T[i];
+
+   S.k = 0.;
+   S.v = -1;
+   if (n == 0)
+      return S;
+   if ((n == 1) && (T[0].a < 0)) {
+      S.k = T[0].k;
+      S.v = T[0].b;
+      return S;
+   }
+
+   S.k = 1.;
+   S.v = gen_stmt( G, NULL, T, n );
+   return S;
+}
+
+
+/**
+ * @brief Sets an output to a value.
+ */
+static void gen_output( gen_t *G, const char *lhs, gen_sym_t S )
+{
+   gen_term_t T;
+
+   T.k = S.k;
+   T.a = -1;
+   T.b = S.v;
+   gen_stmt( G, lhs, &T, (S.k != 0.) ? 1 : 0 );
+}
+
+
+/**
+ * @brief Multiplies two dual quaternions of values, O = P Q.
+ */
+static void gen_mul( gen_t *G, gen_sym_t O[8], const gen_sym_t P[8], const gen_sym_t Q[8] )
+{
+   gen_term_t T[GEN_TERMS_MAX];
+   gen_sym_t R[8];
+   int i, k, n;
+
+   for (k=0; k<8; k++) {
+      n = 0;
+      for (i=0; i<48; i++)
+         if (gen_mul_tab[i][0] == k)
+            gen_term( T, &n, (double)gen_mul_tab[i][3],
+                  P[ gen_mul_tab[i][1] ], Q[ gen_mul_tab[i][2] ] );
+      R[k] = gen_sum( G, T, n );
+   }
+   memcpy( O, R, sizeof(R) );
+}
+
+
+/**
+ * @brief Sets a dual quaternion of values to constants.
+ */
+static void gen_const( gen_sym_t O[8], const double Q[8] )
+{
+   int k;
+
+   for (k=0; k<8; k++) {
+      O[k].k = Q[k];
+      O[k].v = -1;
+   }
+}
+
+
+/**
+ * @brief Values of the dual quaternion of joint i, see dq_cr_rotation_plucker and dq_cr_translation.
+ */
+static void gen_joint( gen_sym_t O[8], const gen_joint_t *J, const int *var )
+{
+   double Q[8];
+   int k;
+
+   memset( Q, 0, sizeof(Q) );
+   if (J->revolute) {
+      gen_const( O, Q );
+      O[0].k = 1.;
+      O[0].v = var[0];
+      for (k=0; k<3; k++) {
+         O[1+k].k = J->s[k];
+         O[1+k].v = (J->s[k] != 0.) ? var[1] : -1;
+         O[4+k].k = J->s0[k];
+         O[4+k].v = (J->s0[k] != 0.) ? var[1] : -1;
+      }
+   }
+   else {
+      Q[0] = 1.;
+      gen_const( O, Q );
+      for (k=0; k<3; k++) {
+         O[4+k].k = J->s[k];
+         O[4+k].v = (J->s[k] != 0.) ? var[0] : -1;
+      }
+   }
+}
+
+
+/**
+ * @brief Writes a function, only with the statements its outputs need.
+ */
+static void gen_function( FILE *out, const char *proto, gen_t *G,
+      const gen_joint_t *J, int n, int var[][2] )
+{
+   const gen_stmt_t *S;
+   const gen_term_t *T;
+   int i, k, r, p, temps;
+
+   /* Statements only use variables set before them, so a single backwards
+    * pass finds everything the outputs need. */
+   for (i=G->stmts-1; i>=0; i--) {
+      S = &G->stmt[i];
+      if ((S->var >= 0) && !G->live[ S->var ])
+         continue;
+      for (k=0; k<S->n; k++) {
+         T = &G->pool[ S->first + k ];
+         if (T->a >= 0)
+            G->live[ T->a ] = 1;
+         if (T->b >= 0)
+            G->live[ T->b ] = 1;
+      }
+   }
+   temps = 0;
+   for (i=0; i<G->stmts; i++) {
+      S = &G->stmt[i];
+      if ((S->var >= 0) && G->live[ S->var ])
+         sprintf( G->name[ S->var ], "t[%d]", temps++ );
+   }
+
+   /* Only the joints that are needed. */
+   r = 0;
+   p = 0;
+   for (i=0; i<n; i++) {
+      if (J[i].revolute)
+         r += G->live[ var[i][0] ] + G->live[ var[i][1] ];
+      else
+         p += G->live[ var[i][0] ];
+   }
+   fprintf( out, "%s\n{\n", proto );
+   if (r > 0)
+      fprintf( out, "   double c[%d], s[%d];\n", n, n );
+   if (p > 0)
+      fprintf( out, "   double h[%d];\n", n );
+   if (temps > 0)
+      fprintf( out, "   double t[%d];\n", temps );
+   if (r+p == 0)
+      fprintf( out, "   (void) q;\n" );
+   fprintf( out, "\n" );
+   for (i=0; i<n; i++) {
+      if (J[i].revolute) {
+         if (G->live[ var[i][0] ])
+            fprintf( out, "   c[%d] = cos( q[%d] / 2. );\n", i, i );
+         if (G->live[ var[i][1] ])
+            fprintf( out, "   s[%d] = sin( q[%d] / 2. );\n", i, i );
+      }
+      else if (G->live[ var[i][0] ])
+         fprintf( out, "   h[%d] = q[%d] / 2.;\n", i, i );
+   }
+   for (i=0; i<G->stmts; i++) {
+      S = &G->stmt[i];
+      if ((S->var >= 0) && !G->live[ S->var ])
+         continue;
+      fprintf( out, "   %s = ", (S->var >= 0) ? G->name[ S->var ] : S->lhs );
+      gen_print_sum( out, G, &G->pool[ S->first ], S->n );
+      fprintf( out, ";\n" );
+   }
+   fprintf( out, "}\n" );
+}
+
+
+/**
+ * @brief Starts a function, adding the variables of the joints.
+ */
+static void gen_begin( gen_t *G, const gen_joint_t *J, int n, int var[][2] )
+{
+   char name[GEN_NAME_MAX];
+   int i;
+
+   G->vars  = 0;
+   G->stmts = 0;
+   G->terms = 0;
+   for (i=0; i<n; i++) {
+      if (J[i].revolute) {
+         sprintf( name, "c[%d]", i );
+         var[i][0] = gen_var( G, name );
+         sprintf( name, "s[%d]", i );
+         var[i][1] = gen_var( G, name );
+      }
+      else {
+         sprintf( name, "h[%d]", i );
+         var[i][0] = gen_var( G, name );
+         var[i][1] = -1;
+      }
+   }
+}
+
+
+/**
+ * @brief Generates the forward kinematics.
+ */
+static void gen_fk( gen_t *G, const gen_joint_t *J, int n, int var[][2],
+      const double H[8], int has_home )
+{
+   gen_sym_t P[8], Q[8];
+   double I[8] = { 1., 0., 0., 0., 0., 0., 0., 0. };
+   char lhs[GEN_NAME_MAX];
+   int i, k;
+
+   gen_begin( G, J, n, var );
+   gen_const( P, I );
+   for (i=0; i<n; i++) {
+      gen_joint( Q, &J[i], var[i] );
+      gen_mul( G, P, P, Q );
+   }
+   if (has_home) {
+      gen_const( Q, H );
+      gen_mul( G, P, P, Q );
+   }
+   for (k=0; k<8; k++) {
+      sprintf( lhs, "out[%d]", k );
+      gen_output( G, lhs, P[k] );
+   }
+}
+
+
+/**
+ * @brief Adds the terms of R v to a sum, for row r of the rotation R of P.
+ */
+static void gen_rotate( gen_term_t *T, int *n, const gen_sym_t P[8], const double v[3], int r )
+{
+   gen_sym_t Q[9];
+   int t;
+
+   memcpy( Q, P, sizeof(gen_sym_t)*8 );
+   Q[8].k = 1.;
+   Q[8].v = -1;
+   for (t=0; t<21; t++)
+      if (gen_rot_tab[t][0] == r)
+         gen_term( T, n, v[ gen_rot_tab[t][1] ] * (double)gen_rot_tab[t][4],
+               Q[ gen_rot_tab[t][2] ], Q[ gen_rot_tab[t][3] ] );
+}
+
+
+/**
+ * @brief Generates the spatial Jacobian.
+ *
+ * The axis of joint i is moved by the product P of the joints before it:
+ *  s' = R s and s0' = R s0 + d x s', with R and d the rotation and
+ *  translation of P.
+ */
+static void gen_jacobian( gen_t *G, const gen_joint_t *J, int n, int var[][2] )
+{
+   gen_term_t T[GEN_TERMS_MAX];
+   gen_sym_t P[8], Q[8], s[3], d[3], m[3], Z;
+   double I[8] = { 1., 0., 0., 0., 0., 0., 0., 0. };
+   char lhs[GEN_NAME_MAX];
+   int i, r, t, k;
+
+   Z.k = 0.;
+   Z.v = -1;
+   gen_begin( G, J, n, var );
+   gen_const( P, I );
+   for (i=0; i<n; i++) {
+      /* s' = R s. */
+      for (r=0; r<3; r++) {
+         k = 0;
+         gen_rotate( T, &k, P, J[i].s, r );
+         s[r] = gen_sum( G, T, k );
+      }
+
+      if (J[i].revolute) {
+         for (r=0; r<3; r++) {
+            k = 0;
+            for (t=0; t<12; t++)
+               if (gen_trans_tab[t][0] == r)
+                  gen_term( T, &k, (double)gen_trans_tab[t][3],
+                        P[ gen_trans_tab[t][1] ], P[ gen_trans_tab[t][2] ] );
+            d[r] = gen_sum( G, T, k );
+         }
+         /* s0' = R s0 + d x s'. */
+         for (r=0; r<3; r++) {
+            k = 0;
+            gen_rotate( T, &k, P, J[i].s0, r );
+            gen_term( T, &k,  1., d[(r+1)%3], s[(r+2)%3] );
+            gen_term( T, &k, -1., d[(r+2)%3], s[(r+1)%3] );
+            m[r] = gen_sum( G, T, k );
+         }
+      }
+      for (r=0; r<3; r++) {
+         sprintf( lhs, "J[%d]", r*n+i );
+         gen_output( G, lhs, J[i].revolute ? m[r] : s[r] );
+      }
+      for (r=0; r<3; r++) {
+         sprintf( lhs, "J[%d]", (r+3)*n+i );
+         gen_output( G, lhs, J[i].revolute ? s[r] : Z );
+      }
+
+      /* The last joint does not move any other axis. */
+      if (i < n-1) {
+         gen_joint( Q, &J[i], var[i] );
+         gen_mul( G, P, P, Q );
+      }
+   }
+}
+
+
+/**
+ * @brief Reads finite numbers after an attribute, as dq_chain_load.
+ *
+ *    @return 0 on success, -1 on error.
+ */
+static int gen_read_nums( char **p, double *v, int n )
+{
+   char *end;
+   int i;
+
+   for (i=0; i<n; i++) {
+      v[i] = strtod( *p, &end );
+      /* Also rejects infinities and NaN. */
+      if ((end == *p) || ((*end != '\0') && !isspace( (unsigned char)*end )) ||
+            !(v[i] - v[i] == 0.))
+         return -1;
+      *p = end;
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Normalizes a direction, and a moment with it if not NULL.
+ *
+ *    @return 0 on success, -1 if it has no direction.
+ */
+static int gen_read_unit( double s[3], double s0[3] )
+{
+   double m, l;
+   int k;
+
+   m = fabs( s[0] );
+   m = (fabs( s[1] ) > m) ? fabs( s[1] ) : m;
+   m = (fabs( s[2] ) > m) ? fabs( s[2] ) : m;
+   if (!(m > 0.))
+      return -1;
+   l = sqrt( (s[0]/m)*(s[0]/m) + (s[1]/m)*(s[1]/m) + (s[2]/m)*(s[2]/m) );
+   for (k=0; k<3; k++) {
+      s[k] = (s[k]/m) / l;
+      if (s0 != NULL)
+         s0[k] = (s0[k]/m) / l;
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Reads the attributes of a joint, and its home pose into H if it has one.
+ *
+ *    @return NULL on success, the error otherwise.
+ */
+static const char *gen_read_joint( char *p, gen_joint_t *J, double H[8], int *has_home )
+{
+   char w[32];
+   double c[3], lim[2], t[3] = { 0., 0., 0. }, r[4] = { 0., 0., 0., 1. }, sn, cs, d;
+   int has_s, has_c, has_m, has_l, has_t, has_r, k;
+
+   has_s = has_c = has_m = has_l = has_t = has_r = 0;
+   while (sscanf( p, "%31s%n", w, &k ) == 1) {
+      p += k;
+      if ((strcmp( w, "axis" ) == 0) && !has_s) {
+         has_s = 1;
+         k = gen_read_nums( &p, J->s, 3 );
+      }
+      else if ((strcmp( w, "point" ) == 0) && !has_c && !has_m) {
+         has_c = 1;
+         k = gen_read_nums( &p, c, 3 );
+      }
+      else if ((strcmp( w, "plucker" ) == 0) && !has_s && !has_c) {
+         has_s = 1;
+         has_m = 1;
+         k = gen_read_nums( &p, J->s, 3 ) || gen_read_nums( &p, J->s0, 3 );
+      }
+      else if ((strcmp( w, "limits" ) == 0) && !has_l) {
+         has_l = 1;
+         k = gen_read_nums( &p, lim, 2 ) || !(lim[0] <= lim[1]);
+      }
+      else if ((strcmp( w, "offset" ) == 0) && !has_t) {
+         has_t = 1;
+         k = gen_read_nums( &p, t, 3 );
+      }
+      else if ((strcmp( w, "rotate" ) == 0) && !has_r) {
+         has_r = 1;
+         k = gen_read_nums( &p, r, 4 ) || gen_read_unit( &r[1], NULL );
+      }
+      else
+         return "unknown or repeated attribute";
+      if (k != 0)
+         return "invalid values";
+   }
+   if (!has_s || (gen_read_unit( J->s, has_m ? J->s0 : NULL ) != 0))
+      return "no direction";
+
+   if (has_c) {
+      J->s0[0] = c[1]*J->s[2] - c[2]*J->s[1];
+      J->s0[1] = c[2]*J->s[0] - c[0]*J->s[2];
+      J->s0[2] = c[0]*J->s[1] - c[1]*J->s[0];
+   }
+   else if (!has_m)
+      memset( J->s0, 0, sizeof(J->s0) );
+   d = J->s[0]*J->s0[0] + J->s[1]*J->s0[1] + J->s[2]*J->s0[2];
+   if (fabs( d ) > 1e-9 * (1. + sqrt( J->s0[0]*J->s0[0] + J->s0[1]*J->s0[1] + J->s0[2]*J->s0[2] )))
+      return "moment not normal to the direction";
+   for (k=0; k<3; k++)
+      J->s0[k] -= d * J->s[k];
+
+   /* Home pose, the offset then a rotation around an axis through it, T R
+    * with the dual part of R zero. */
+   *has_home = has_t || has_r;
+   memset( H, 0, sizeof(double)*8 );
+   H[0] = 1.;
+   if (*has_home) {
+      cs   = cos( r[0]/2. );
+      sn   = sin( r[0]/2. );
+      H[0] = cs;
+      for (k=0; k<3; k++) {
+         H[1+k] = sn * r[1+k];
+         H[4+k] = cs * t[k] / 2.;
+      }
+      H[4] += (t[1]*H[3] - t[2]*H[2]) / 2.;
+      H[5] += (t[2]*H[1] - t[0]*H[3]) / 2.;
+      H[6] += (t[0]*H[2] - t[1]*H[1]) / 2.;
+      H[7]  = -(t[0]*H[1] + t[1]*H[2] + t[2]*H[3]) / 2.;
+   }
+   return NULL;
+}
+
+
+/**
+ * @brief Reads the description, with the same grammar as dq_chain_load.
+ *
+ * Only the home pose of the last joint moves the tip, the others are read
+ *  and checked but do not change the generated code, nor do the limits.
+ *
+ *    @return Number of joints, -1 on error.
+ */
+static int gen_read( FILE *fp, const char *file, gen_joint_t *J, double H[8], int *has_home )
+{
+   char line[1024], word[32], *p;
+   const char *err;
+   int n, m, l, k;
+
+   n = -1;
+   m = 0;
+   l = 0;
+   *has_home = 0;
+   while (fgets( line, sizeof(line), fp ) != NULL) {
+      l++;
+      if ((strchr( line, '\n' ) == NULL) && !feof( fp )) {
+         fprintf( stderr, "%s:%d: line too long\n", file, l );
+         return -1;
+      }
+      for (k=0; line[k] != '\0'; k++)
+         if (line[k] == '#')
+            line[k] = '\0';
+      if (sscanf( line, "%31s%n", word, &k ) != 1)
+         continue;
+      p = &line[k];
+
+      if (n < 0) {
+         if ((strcmp( word, "joints" ) != 0) || (sscanf( p, "%d %31s", &n, word ) != 1) ||
+               (n < 1) || (n > GEN_JOINTS_MAX)) {
+            fprintf( stderr, "%s:%d: expected joints with a number from 1 to %d\n",
+                  file, l, GEN_JOINTS_MAX );
+            return -1;
+         }
+         continue;
+      }
+      if ((strcmp( word, "revolute" ) != 0) && (strcmp( word, "prismatic" ) != 0)) {
+         fprintf( stderr, "%s:%d: expected revolute or prismatic\n", file, l );
+         return -1;
+      }
+      if (m >= n) {
+         fprintf( stderr, "%s:%d: more than %d joints\n", file, l, n );
+         return -1;
+      }
+      J[m].revolute = (strcmp( word, "revolute" ) == 0);
+      err = gen_read_joint( p, &J[m], H, has_home );
+      if (err != NULL) {
+         fprintf( stderr, "%s:%d: %s\n", file, l, err );
+         return -1;
+      }
+      m++;
+   }
+   if (ferror( fp ) || (m < n) || (n < 0)) {
+      fprintf( stderr, "%s: %s\n", file, ferror( fp ) ? "unable to read" : "missing joints" );
+      return -1;
+   }
+   return n;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   gen_joint_t J[GEN_JOINTS_MAX];
+   int var[GEN_JOINTS_MAX][2];
+   double H[8];
+   char proto[2][256];
+   const char *header;
+   gen_t G;
+   FILE *fp, *out;
+   int n, has_home;
+
+   if (argc != 5) {
+      fprintf( stderr, "Usage: %s name description output.c output.h\n", argv[0] );
+      return EXIT_FAILURE;
+   }
+   fp = fopen( argv[2], "r" );
+   if (fp == NULL) {
+      fprintf( stderr, "dq_codegen: unable to open %s\n", argv[2] );
+      return EXIT_FAILURE;
+   }
+   n = gen_read( fp, argv[2], J, H, &has_home );
+   fclose( fp );
+   if (n < 0)
+      return EXIT_FAILURE;
+
+   G.name = malloc( sizeof(*G.name) * GEN_VARS_MAX );
+   G.live = malloc( GEN_VARS_MAX );
+   G.stmt = malloc( sizeof(gen_stmt_t) * GEN_VARS_MAX );
+   G.pool = NULL;
+   G.size = 0;
+   if ((G.name == NULL) || (G.live == NULL) || (G.stmt == NULL)) {
+      fprintf( stderr, "dq_codegen: out of memory\n" );
+      return EXIT_FAILURE;
+   }
+   sprintf( proto[0], "void %.64s_fk( const double *q, dq_t out )", argv[1] );
+   sprintf( proto[1], "void %.64s_jacobian( const double *q, double *J )", argv[1] );
+
+   /* Header. */
+   out = fopen( argv[4], "w" );
+   if (out == NULL) {
+      fprintf( stderr, "dq_codegen: unable to open %s\n", argv[4] );
+      return EXIT_FAILURE;
+   }
+   fprintf( out, "/* Generated by dq_codegen from %s, do not edit. */\n", argv[2] );
+   fprintf( out, "#ifndef _DQ_GEN_%s_H\n#  define _DQ_GEN_%s_H\n\n", argv[1], argv[1] );
+   fprintf( out, "#include \"dq.h\"\n\n" );
+   fprintf( out, "/** @brief Pose of the tip of %s, as dq_chain_fk. */\n%s;\n", argv[1], proto[0] );
+   fprintf( out, "/** @brief Spatial Jacobian of %s, packed 6 by %d row-major as dq_chain_jacobian. */\n%s;\n",
+         argv[1], n, proto[1] );
+   fprintf( out, "\n#endif /* _DQ_GEN_%s_H */\n", argv[1] );
+   fclose( out );
+
+   /* Source. */
+   out = fopen( argv[3], "w" );
+   if (out == NULL) {
+      fprintf( stderr, "dq_codegen: unable to open %s\n", argv[3] );
+      return EXIT_FAILURE;
+   }
+   fprintf( out, "/* Generated by dq_codegen from %s, do not edit. */\n", argv[2] );
+   header = strrchr( argv[4], '/' );
+   header = (header != NULL) ? header+1 : argv[4];
+   fprintf( out, "#include <math.h>\n\n#include \"%s\"\n\n\n", header );
+   gen_fk( &G, J, n, var, H, has_home );
+   gen_function( out, proto[0], &G, J, n, var );
+   fprintf( out, "\n\n" );
+   gen_jacobian( &G, J, n, var );
+   gen_function( out, proto[1], &G, J, n, var );
+   fclose( out );
+
+   free( G.name );
+   free( G.live );
+   free( G.stmt );
+   free( G.pool );
+   return EXIT_SUCCESS;
+}